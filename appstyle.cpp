@@ -0,0 +1,171 @@
+#include "appstyle.h"
+
+QString AppStyle::styleSheet()
+{
+    return QString::fromUtf8(R"(
+        /* ===== Общее ===== */
+        QMainWindow {
+            background: qlineargradient(x1:0, y1:0, x2:0, y2:1,
+                stop:0 #f3f6fb, stop:1 #ffffff);
+        }
+        QGroupBox {
+            font-weight: 600;
+            font-size: 12px;
+            color: #1f2937;
+            border: 1px solid #e2e8f0;
+            border-radius: 10px;
+            margin-top: 10px;
+            padding-top: 15px;
+            background: #ffffff;
+        }
+        QGroupBox::title {
+            subcontrol-origin: margin;
+            subcontrol-position: top center;
+            padding: 2px 10px;
+            background: #eef2f7;
+            border-radius: 6px;
+            color: #334155;
+        }
+        QFrame {
+            background: #ffffff;
+            border-radius: 12px;
+            border: 1px solid #e5e7eb;
+        }
+        QLabel { color: #1f2937; }
+
+        /* ===== Вкладка данных ===== */
+        QFrame#dataPanel {
+            background: qlineargradient(x1:0, y1:0, x2:0, y2:1,
+                stop:0 #ffffff, stop:1 #f7fafc);
+            border-radius: 12px;
+            border: 1px solid #e5e7eb;
+        }
+        QComboBox#cityCombo {
+            padding: 8px;
+            border: 2px solid #bdc3c7;
+            border-radius: 6px;
+            background: white;
+            font-size: 11px;
+        }
+        QComboBox#cityCombo:hover { border-color: #3498db; }
+        QComboBox#cityCombo::drop-down {
+            subcontrol-origin: padding;
+            subcontrol-position: top right;
+            width: 20px;
+            border-left: 1px solid #bdc3c7;
+        }
+        QDateTimeEdit#dateEdit {
+            padding: 8px;
+            border: 2px solid #bdc3c7;
+            border-radius: 6px;
+            background: #ffffff;
+            color: #2c3e50;
+            font-size: 11px;
+        }
+        QDateTimeEdit#dateEdit:hover { border-color: #3498db; }
+        QDateTimeEdit#dateEdit::drop-down {
+            subcontrol-origin: padding;
+            subcontrol-position: top right;
+            width: 20px;
+            border-left: 1px solid #bdc3c7;
+        }
+        QDateTimeEdit#dateEdit QAbstractItemView {
+            background-color: white;
+            border: 1px solid #bdc3c7;
+            selection-background-color: #3498db;
+            selection-color: white;
+        }
+        QSpinBox#radiationSpin {
+            padding: 8px;
+            border: 2px solid #bdc3c7;
+            border-radius: 6px;
+            background: white;
+            font-size: 11px;
+        }
+        QSpinBox#radiationSpin:hover { border-color: #3498db; }
+
+        /* крупные кнопки действий: общая форма, цвет — по имени */
+        QPushButton#btnAdd, QPushButton#btnSave, QPushButton#btnLoad,
+        QPushButton#btnAnalyze, QPushButton#btnUpdateCharts {
+            padding: 12px;
+            font-weight: bold;
+            border-radius: 8px;
+            font-size: 11px;
+            border: none;
+            margin: 2px;
+            color: white;
+        }
+        QPushButton#btnAdd {
+            background: qlineargradient(x1: 0, y1: 0, x2: 0, y2: 1,
+                stop: 0 #27ae60, stop: 1 #2ecc71);
+        }
+        QPushButton#btnSave {
+            background: qlineargradient(x1: 0, y1: 0, x2: 0, y2: 1,
+                stop: 0 #f39c12, stop: 1 #f1c40f);
+        }
+        QPushButton#btnLoad {
+            background: qlineargradient(x1: 0, y1: 0, x2: 0, y2: 1,
+                stop: 0 #8e44ad, stop: 1 #9b59b6);
+        }
+        QPushButton#btnAnalyze {
+            background: qlineargradient(x1: 0, y1: 0, x2: 0, y2: 1,
+                stop: 0 #2980b9, stop: 1 #3498db);
+        }
+        QPushButton#btnUpdateCharts {
+            background: qlineargradient(x1: 0, y1: 0, x2: 0, y2: 1,
+                stop: 0 #e74c3c, stop: 1 #c0392b);
+        }
+
+        QTableView#recordsTable {
+            background-color: white;
+            border: 2px solid #dfe6e9;
+            border-radius: 8px;
+            gridline-color: #dce1e5;
+            font-size: 11px;
+        }
+        QTableView#recordsTable::item { padding: 6px; border-bottom: 1px solid #ecf0f1; }
+        QTableView#recordsTable::item:selected { background-color: #3498db; color: white; }
+        QTableView#recordsTable QHeaderView::section {
+            background: qlineargradient(x1: 0, y1: 0, x2: 0, y2: 1,
+                stop: 0 #34495e, stop: 1 #2c3e50);
+            color: white; padding: 8px; border: 1px solid #2c3e50; font-weight: bold; font-size: 11px;
+        }
+        QTableView#recordsTable QScrollBar:vertical { border: none; background: #ecf0f1; width: 12px; margin: 0px; }
+        QTableView#recordsTable QScrollBar::handle:vertical { background: #bdc3c7; border-radius: 6px; min-height: 20px; }
+
+        QPlainTextEdit#analysisText {
+            background-color: #0b132b;
+            color: #e0e1dd;
+            border: 2px solid #1c2541;
+            border-radius: 8px;
+            padding: 12px;
+            font-family: 'Consolas', 'Monospace';
+            font-size: 12px;
+        }
+        QPlainTextEdit#analysisText:focus { border-color: #3a506b; }
+
+        /* ===== Вкладка графиков ===== */
+        QWidget#chartControls { background: #ffffff; border: 1px solid #e5e7eb; border-radius: 10px; }
+        QWidget#chartControls QLabel { color: #1f2937; font-weight: 600; }
+        QWidget#chartControls QComboBox { padding: 8px; border: 1px solid #cbd5e1; border-radius: 8px; background: #ffffff; color: #1f2937; }
+        QWidget#chartControls QComboBox:hover { border-color: #3b82f6; }
+        QWidget#chartControls QCheckBox { color: #1f2937; }
+        QWidget#chartControls QPushButton { padding: 9px 12px; border-radius: 8px; background: #3b82f6; color: #ffffff; font-weight: 700; }
+        QWidget#chartControls QPushButton:hover { background: #2563eb; }
+        QScrollArea#chartsScroll { border: none; background: transparent; }
+        QLabel#chartCaption { font-weight: bold; font-size: 16px; color: #2c3e50; }
+        QListView#overlayList { border: 2px solid #dfe6e9; border-radius: 8px; }
+        QListView#overlayList::item { padding: 6px; }
+        QListView#overlayList::indicator { width: 16px; height: 16px; }
+
+        /* ===== Строка состояния ===== */
+        QStatusBar {
+            background: qlineargradient(x1: 0, y1: 0, x2: 0, y2: 1,
+                stop: 0 #2c3e50, stop: 1 #34495e);
+            color: white;
+            font-weight: bold;
+            padding: 5px;
+        }
+        QStatusBar QLabel { color: white; font-weight: normal; background: transparent; border: none; }
+    )");
+}
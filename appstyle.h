@@ -0,0 +1,18 @@
+#ifndef APPSTYLE_H
+#define APPSTYLE_H
+
+#include <QString>
+
+// ============================
+// Стиль приложения
+// ============================
+// Одна таблица стилей на всё приложение: ставится на QApplication до создания окна
+// и разбирается один раз. Виджеты выбираются по objectName, поэтому отдельным
+// виджетам свои таблицы не нужны — каждая такая таблица разбиралась бы заново.
+namespace AppStyle {
+
+QString styleSheet();
+
+} // namespace AppStyle
+
+#endif
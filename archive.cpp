@@ -0,0 +1,524 @@
+#include "archive.h"
+#include "stationregistry.h"
+#include "tracing.h"
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QtEndian>
+#include <cstring>
+#include <algorithm>
+#include <numeric>
+
+using namespace Qt::StringLiterals;
+
+namespace Archive {
+
+namespace {
+
+constexpr char kMagic[4] = {'R', 'A', 'D', 'A'};
+constexpr char kEndMagic[4] = {'R', 'A', 'D', 'E'};
+constexpr int kFooterBytes = 8 + 8 + 4;
+// Наименьший размер записей хвоста: станция — длина имени, lat, lon, флаг; блок — поля BlockHeader
+constexpr qint64 kMinStationBytes = 4 + 8 + 8 + 1;
+constexpr qint64 kBlockHeaderBytes = 2 + 2 + 2 + 4 + 4 + 4 + 8 + 4;
+
+inline quint32 zigzag(qint32 v) { return (quint32(v) << 1) ^ quint32(v >> 31); }
+inline qint32 unzigzag(quint32 v) { return qint32(v >> 1) ^ -qint32(v & 1); }
+
+inline void putVarint(QByteArray &out, quint32 v)
+{
+    while (v >= 0x80) {
+        out.append(char(v | 0x80));
+        v >>= 7;
+    }
+    out.append(char(v));
+}
+
+// Быстрый путь — однобайтовое значение: для суточных рядов это почти все случаи
+inline bool getVarint(const uchar *&p, const uchar *end, quint32 &v)
+{
+    if (p < end && *p < 0x80) {
+        v = *p++;
+        return true;
+    }
+    v = 0;
+    for (int shift = 0; p < end && shift <= 28; shift += 7) {
+        const uchar b = *p++;
+        v |= quint32(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+QDataStream &operator<<(QDataStream &s, const BlockHeader &h)
+{
+    return s << h.station << h.minRad << h.maxRad << h.firstDay << h.lastDay << h.count << h.offset << h.bytes;
+}
+
+QDataStream &operator>>(QDataStream &s, BlockHeader &h)
+{
+    return s >> h.station >> h.minRad >> h.maxRad >> h.firstDay >> h.lastDay >> h.count >> h.offset >> h.bytes;
+}
+
+} // namespace
+
+// ============================
+// Кодек блока
+// ============================
+
+void encodeBlock(const PackedReading *records, int count, QByteArray &out)
+{
+    out.clear();
+    if (count == 0) return;
+
+    qint32 firstDay = records[0].day;
+    for (int i = 1; i < count; ++i) firstDay = std::min(firstDay, records[i].day);
+
+    // первая запись — относительно начала блока, дальше — дельты
+    putVarint(out, quint32(records[0].day - firstDay));
+    putVarint(out, records[0].rad);
+
+    qint32 prevDelta = 0;
+    for (int i = 1; i < count; ++i) {
+        const qint32 delta = records[i].day - records[i - 1].day;
+        putVarint(out, zigzag(delta - prevDelta));
+        putVarint(out, zigzag(qint32(records[i].rad) - qint32(records[i - 1].rad)));
+        prevDelta = delta;
+    }
+}
+
+bool decodeBlock(const uchar *data, qsizetype bytes, quint16 station, int count, PackedReading *out)
+{
+    if (count == 0) return true;
+    const uchar *p = data;
+    const uchar *end = data + bytes;
+
+    quint32 v0 = 0, r0 = 0;
+    if (!getVarint(p, end, v0) || !getVarint(p, end, r0)) return false;
+    // день первой записи хранится от начала блока: вызывающий добавляет firstDay
+    qint32 day = qint32(v0);
+    qint32 rad = qint32(r0);
+    out[0] = PackedReading{station, quint16(rad), day};
+
+    qint32 delta = 0;
+    for (int i = 1; i < count; ++i) {
+        quint32 dod, dr;
+        if (!getVarint(p, end, dod) || !getVarint(p, end, dr)) return false;
+        delta += unzigzag(dod);
+        day += delta;
+        rad += unzigzag(dr);
+        out[i] = PackedReading{station, quint16(rad), day};
+    }
+    return p == end;
+}
+
+// ============================
+// Writer
+// ============================
+
+bool Writer::begin(const QVector<GeneratedStation> &generated, QString *error)
+{
+    QVector<StationInfo> infos;
+    infos.reserve(generated.size());
+    for (const GeneratedStation &st : generated) infos.append({st.name, st.pos, true});
+    return begin(infos, error);
+}
+
+bool Writer::begin(const QVector<StationInfo> &stationList, QString *error)
+{
+    if (stationList.size() > RadiationModel::kMaxStations) {
+        if (error) *error = u"Слишком много станций для архива"_s;
+        return false;
+    }
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+
+    stations = stationList;
+    pending = QVector<QVector<PackedReading>>(stations.size());
+    blocks.clear();
+
+    file.write(kMagic, 4);
+    QByteArray version(4, 0);
+    qToLittleEndian<quint32>(kVersion, version.data());
+    file.write(version);
+    return true;
+}
+
+bool Writer::write(int station, qint64 day, int rad)
+{
+    QVector<PackedReading> &block = pending[station];
+    if (block.isEmpty()) block.reserve(kBlockRecords);
+    block.append(PackedReading{quint16(station), quint16(std::clamp(rad, 0, RadiationModel::kMaxRadiation)), qint32(day)});
+    return block.size() < kBlockRecords || flushBlock(station);
+}
+
+bool Writer::flushBlock(int station)
+{
+    QVector<PackedReading> &block = pending[station];
+    if (block.isEmpty()) return true;
+
+    encodeBlock(block.constData(), int(block.size()), scratch);
+
+    BlockHeader h;
+    h.station = quint16(station);
+    h.minRad = h.maxRad = block[0].rad;
+    h.firstDay = h.lastDay = block[0].day;
+    for (const PackedReading &r : block) {
+        h.minRad = std::min(h.minRad, r.rad);
+        h.maxRad = std::max(h.maxRad, r.rad);
+        h.firstDay = std::min(h.firstDay, r.day);
+        h.lastDay = std::max(h.lastDay, r.day);
+    }
+    h.count = quint32(block.size());
+    h.offset = quint64(file.pos());
+    h.bytes = quint32(scratch.size());
+    blocks.append(h);
+
+    block.clear();
+    return file.write(scratch) == scratch.size();
+}
+
+bool Writer::finish(QString *error)
+{
+    for (int s = 0; s < pending.size(); ++s) {
+        if (!flushBlock(s)) {
+            if (error) *error = file.errorString();
+            return false;
+        }
+    }
+
+    QByteArray tail;
+    QDataStream ds(&tail, QIODevice::WriteOnly);
+    ds.setByteOrder(QDataStream::LittleEndian);
+    ds.setFloatingPointPrecision(QDataStream::DoublePrecision);
+
+    const quint64 tableOffset = quint64(file.pos());
+    ds << quint32(stations.size());
+    for (const StationInfo &st : stations)
+        ds << st.name.toUtf8() << st.pos.lat << st.pos.lon << quint8(st.hasCoord);
+
+    const quint64 indexOffset = tableOffset + quint64(tail.size());
+    ds << quint32(blocks.size());
+    for (const BlockHeader &h : blocks) ds << h;
+
+    ds << tableOffset << indexOffset;
+    ds.writeRawData(kEndMagic, 4);
+
+    if (file.write(tail) != tail.size()) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    file.close();
+    return true;
+}
+
+QVector<StationInfo> Writer::stationsOf(const StationRegistry &registry)
+{
+    QVector<StationInfo> infos;
+    infos.reserve(registry.count());
+    for (int id = 0; id < registry.count(); ++id) {
+        StationInfo st{registry.name(id), {0.0, 0.0}, false};
+        st.hasCoord = registry.coord(id, &st.pos);
+        infos.append(st);
+    }
+    return infos;
+}
+
+bool Writer::save(const QString &fileName, const RadiationModel &records,
+                  const StationRegistry &registry, QString *error)
+{
+    TRACE_SCOPE("archive save");
+
+    const QVector<StationInfo> infos = stationsOf(registry);
+
+    // группировка по станции подсчётом, внутри станции — по дню (мелкие дельты)
+    const RecordArena &arena = records.arena();
+    QVector<qsizetype> start(infos.size() + 1, 0);
+    for (const PackedReading &r : arena) ++start[r.station + 1];
+    for (int s = 0; s < infos.size(); ++s) start[s + 1] += start[s];
+    QVector<PackedReading> grouped(arena.size());
+    {
+        QVector<qsizetype> fill = start;
+        for (const PackedReading &r : arena) grouped[fill[r.station]++] = r;
+    }
+
+    Writer writer(fileName);
+    if (!writer.begin(infos, error)) return false;
+    for (int s = 0; s < infos.size(); ++s) {
+        PackedReading *first = grouped.data() + start[s];
+        PackedReading *last = grouped.data() + start[s + 1];
+        std::stable_sort(first, last, [](const PackedReading &a, const PackedReading &b) { return a.day < b.day; });
+        for (PackedReading *r = first; r != last; ++r) {
+            if (!writer.write(s, r->day, r->rad)) {
+                if (error) *error = writer.file.errorString();
+                return false;
+            }
+        }
+    }
+    return writer.finish(error);
+}
+
+// ============================
+// Reader
+// ============================
+
+bool Reader::open(const QString &fileName, QString *error)
+{
+    close();
+    file.setFileName(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    size = file.size();
+    data = file.map(0, size);
+    if (!data || size < 8 + kFooterBytes || std::memcmp(data, kMagic, 4) != 0
+        || std::memcmp(data + size - 4, kEndMagic, 4) != 0) {
+        if (error) *error = u"Файл не является архивом радиации"_s;
+        close();
+        return false;
+    }
+    if (qFromLittleEndian<quint32>(data + 4) != kVersion) {
+        if (error) *error = u"Неподдерживаемая версия архива"_s;
+        close();
+        return false;
+    }
+
+    const quint64 tableOffset = qFromLittleEndian<quint64>(data + size - kFooterBytes);
+    if (tableOffset >= quint64(size)) {
+        if (error) *error = u"Повреждён индекс архива"_s;
+        close();
+        return false;
+    }
+
+    const QByteArray tail = QByteArray::fromRawData(reinterpret_cast<const char *>(data + tableOffset),
+                                                    size - kFooterBytes - qint64(tableOffset));
+    QDataStream ds(tail);
+    ds.setByteOrder(QDataStream::LittleEndian);
+    ds.setFloatingPointPrecision(QDataStream::DoublePrecision);
+
+    // счётчики из файла сверяются с размером хвоста до резервирования памяти
+    const qint64 tailBytes = tail.size();
+    quint32 nStations = 0;
+    ds >> nStations;
+    if (qint64(nStations) > RadiationModel::kMaxStations || qint64(nStations) * kMinStationBytes > tailBytes) {
+        if (error) *error = u"Повреждён индекс архива"_s;
+        close();
+        return false;
+    }
+    stationTable.reserve(nStations);
+    for (quint32 i = 0; i < nStations && ds.status() == QDataStream::Ok; ++i) {
+        QByteArray name;
+        StationInfo st;
+        quint8 has = 0;
+        ds >> name >> st.pos.lat >> st.pos.lon >> has;
+        st.name = QString::fromUtf8(name);
+        st.hasCoord = has != 0;
+        stationTable.append(st);
+    }
+
+    quint32 nBlocks = 0;
+    ds >> nBlocks;
+    if (ds.status() != QDataStream::Ok || qint64(nBlocks) * kBlockHeaderBytes > tailBytes - ds.device()->pos()) {
+        if (error) *error = u"Повреждён индекс архива"_s;
+        close();
+        return false;
+    }
+    blockIndex.reserve(nBlocks);
+    for (quint32 i = 0; i < nBlocks && ds.status() == QDataStream::Ok; ++i) {
+        BlockHeader h;
+        ds >> h;
+        if (h.station >= nStations || h.count == 0 || h.count > quint32(kBlockRecords)
+            || h.firstDay > h.lastDay || h.offset + h.bytes > tableOffset)
+            break;
+        blockIndex.append(h);
+        totalRecords += h.count;
+    }
+
+    if (ds.status() != QDataStream::Ok || blockIndex.size() != qsizetype(nBlocks)) {
+        if (error) *error = u"Повреждён индекс архива"_s;
+        close();
+        return false;
+    }
+
+    // порядок для двоичного поиска: станция, затем первый день блока
+    stationOrder.resize(blockIndex.size());
+    std::iota(stationOrder.begin(), stationOrder.end(), 0u);
+    std::sort(stationOrder.begin(), stationOrder.end(), [this](quint32 a, quint32 b) {
+        const BlockHeader &x = blockIndex[a], &y = blockIndex[b];
+        return x.station != y.station ? x.station < y.station : x.firstDay < y.firstDay;
+    });
+    stationStart.fill(0, qsizetype(nStations) + 1);
+    runningLastDay.resize(stationOrder.size());
+    for (qsizetype k = 0; k < stationOrder.size(); ++k) {
+        const BlockHeader &h = blockIndex[stationOrder[k]];
+        ++stationStart[h.station + 1];
+        const bool sameStation = k > 0 && blockIndex[stationOrder[k - 1]].station == h.station;
+        runningLastDay[k] = sameStation ? std::max(runningLastDay[k - 1], h.lastDay) : h.lastDay;
+        spanFirst = k == 0 ? h.firstDay : std::min<qint64>(spanFirst, h.firstDay);
+        spanLast = k == 0 ? h.lastDay : std::max<qint64>(spanLast, h.lastDay);
+    }
+    for (quint32 s = 0; s < nStations; ++s) stationStart[s + 1] += stationStart[s];
+    return true;
+}
+
+void Reader::close()
+{
+    if (data) file.unmap(const_cast<uchar *>(data));
+    data = nullptr;
+    size = 0;
+    file.close();
+    stationTable.clear();
+    blockIndex.clear();
+    totalRecords = 0;
+    spanFirst = 0;
+    spanLast = -1;
+    stationOrder.clear();
+    stationStart.clear();
+    runningLastDay.clear();
+}
+
+bool Reader::readRange(int station, qint64 fromDay, qint64 toDay, QVector<PackedReading> &out) const
+{
+    TRACE_SCOPE("archive range");
+    if (station < 0 || station >= stationTable.size() || fromDay > toDay) return true;
+
+    // первый блок, у которого нарастающий максимум lastDay дошёл до fromDay, и первый,
+    // который начинается после toDay; блоки между ними проверяются по своим дням
+    const qsizetype lo = stationStart[station], hi = stationStart[station + 1];
+    const qsizetype from = std::lower_bound(runningLastDay.cbegin() + lo, runningLastDay.cbegin() + hi, fromDay,
+                                            [](qint32 last, qint64 day) { return last < day; })
+                           - runningLastDay.cbegin();
+    const qsizetype to = std::upper_bound(stationOrder.cbegin() + from, stationOrder.cbegin() + hi, toDay,
+                                          [this](qint64 day, quint32 b) { return day < blockIndex[b].firstDay; })
+                         - stationOrder.cbegin();
+
+    QVector<PackedReading> block;
+    for (qsizetype k = from; k < to; ++k) {
+        const BlockHeader &h = blockIndex[stationOrder[k]];
+        if (h.lastDay < fromDay) continue;
+
+        block.resize(h.count);
+        if (!decodeBlock(data + h.offset, h.bytes, h.station, int(h.count), block.data())) return false;
+        const bool whole = h.firstDay >= fromDay && h.lastDay <= toDay;
+        for (PackedReading &r : block) {
+            r.day += h.firstDay;
+            if (whole || (r.day >= fromDay && r.day <= toDay)) out.append(r);
+        }
+    }
+    return true;
+}
+
+QVector<int> Reader::internStations(StationRegistry &registry) const
+{
+    registry.beginUpdate();
+    QVector<int> ids(stationTable.size());
+    for (int i = 0; i < stationTable.size(); ++i) {
+        ids[i] = registry.intern(stationTable[i].name);
+        if (stationTable[i].hasCoord) registry.setCoord(ids[i], stationTable[i].pos);
+    }
+    registry.endUpdate();
+    return ids;
+}
+
+bool Reader::loadInto(RadiationModel &records, StationRegistry &registry, QString *error) const
+{
+    TRACE_SCOPE("archive load");
+    const QVector<int> ids = internStations(registry);
+
+    records.beginBulkLoad(true, totalRecords);
+    QVector<PackedReading> block;
+    bool ok = true;
+    for (const BlockHeader &h : blockIndex) {
+        block.resize(h.count);
+        if (!decodeBlock(data + h.offset, h.bytes, h.station, int(h.count), block.data())) {
+            ok = false;
+            break;
+        }
+        const int id = ids[h.station];
+        for (const PackedReading &r : block)
+            records.bulkAppend(id, qint64(r.day) + h.firstDay, r.rad);
+    }
+    records.endBulkLoad();
+
+    if (!ok && error) *error = u"Повреждён блок архива"_s;
+    return ok;
+}
+
+bool Reader::loadRange(RadiationModel &records, StationRegistry &registry, qint64 fromDay, qint64 toDay,
+                       QString *error) const
+{
+    TRACE_SCOPE("archive load range");
+    const QVector<int> ids = internStations(registry);
+
+    records.beginBulkLoad(true);
+    QVector<PackedReading> rows;
+    bool ok = true;
+    for (int s = 0; s < stationTable.size() && ok; ++s) {
+        rows.clear();
+        ok = readRange(s, fromDay, toDay, rows);
+        for (const PackedReading &r : std::as_const(rows)) records.bulkAppend(ids[s], r.day, r.rad);
+    }
+    records.endBulkLoad();
+
+    if (!ok && error) *error = u"Повреждён блок архива"_s;
+    return ok;
+}
+
+int Reader::benchmark(const QString &fileName, QTextStream &out)
+{
+    Reader reader;
+    QString error;
+    QElapsedTimer timer;
+    timer.start();
+    if (!reader.open(fileName, &error)) {
+        out << "error: " << error << "\n";
+        return 1;
+    }
+    const qint64 openMs = timer.elapsed();
+
+    // полное декодирование всех блоков, без модели: чистая скорость кодека
+    QVector<PackedReading> block;
+    qint64 decoded = 0;
+    timer.restart();
+    for (const BlockHeader &h : reader.blockIndex) {
+        block.resize(h.count);
+        if (!decodeBlock(reader.data + h.offset, h.bytes, h.station, int(h.count), block.data())) {
+            out << "error: corrupt block\n";
+            return 1;
+        }
+        decoded += h.count;
+    }
+    const qint64 decodeNs = std::max<qint64>(1, timer.nsecsElapsed());
+
+    // по запросу на станцию: последние 30 дней и весь архив
+    auto queries = [&reader](qint64 days, qint64 *rows) {
+        QElapsedTimer t;
+        t.start();
+        QVector<PackedReading> found;
+        for (int s = 0; s < reader.stationTable.size(); ++s) {
+            found.clear();
+            reader.readRange(s, reader.spanLast - days + 1, reader.spanLast, found);
+            *rows += found.size();
+        }
+        return double(t.nsecsElapsed()) / 1000.0 / std::max<qsizetype>(1, reader.stationTable.size());
+    };
+    qint64 recentRows = 0, allRows = 0;
+    const double recentUs = queries(30, &recentRows);
+    const double allUs = queries(reader.spanLast - reader.spanFirst + 1, &allRows);
+
+    const double mb = double(reader.size) / (1024.0 * 1024.0);
+    out << fileName << ": " << decoded << " records, " << reader.stationTable.size() << " stations, "
+        << reader.blockIndex.size() << " blocks, " << QString::number(mb, 'f', 1) << " MB, "
+        << QString::number(double(reader.size) / std::max<qint64>(1, decoded), 'f', 2) << " B/record\n";
+    out << "open+index: " << openMs << " ms\n";
+    out << "decode all: " << QString::number(decodeNs / 1e6, 'f', 1) << " ms, "
+        << QString::number(double(decoded) / (decodeNs / 1e9) / 1e6, 'f', 1) << " M records/s\n";
+    out << "range last 30 days: " << QString::number(recentUs, 'f', 1) << " us/station (" << recentRows << " rows)\n";
+    out << "range whole span:   " << QString::number(allUs, 'f', 1) << " us/station (" << allRows << " rows)\n";
+    return 0;
+}
+
+} // namespace Archive
@@ -0,0 +1,139 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include <QString>
+#include <QVector>
+#include <QFile>
+#include <QByteArray>
+#include <QFileInfo>
+#include "datagen.h"
+#include "radiationmodel.h"
+
+class QTextStream;
+class StationRegistry;
+
+// ============================
+// Архив временных рядов (.rada)
+// ============================
+// Показания сгруппированы по станциям и разбиты на блоки до kBlockRecords штук.
+// Внутри блока на запись: дельта-от-дельты дня и дельта радиации, обе zig-zag
+// varint — для суточного ряда это обычно 2 байта вместо ~70 в JSON.
+//
+//   "RADA" u32 версия | блоки ... | таблица станций | индекс блоков | u64 смещение
+//   таблицы | u64 смещение индекса | "RADE"
+//
+// Индекс блоков (станция, дни, min/max, смещение) читается при открытии целиком,
+// а сами блоки — из отображённого в память файла только те, что попали в запрос.
+namespace Archive {
+
+constexpr quint32 kVersion = 1;
+constexpr int kBlockRecords = 4096;
+constexpr const char *kSuffix = "rada";
+
+inline bool isArchiveFile(const QString &fileName)
+{
+    return QFileInfo(fileName).suffix().compare(QLatin1StringView(kSuffix), Qt::CaseInsensitive) == 0;
+}
+
+struct BlockHeader {
+    quint16 station;
+    quint16 minRad, maxRad;
+    qint32 firstDay, lastDay;   // минимальный и максимальный день блока
+    quint32 count;
+    quint64 offset;             // от начала файла
+    quint32 bytes;
+};
+
+struct StationInfo {
+    QString name;
+    Coord pos;
+    bool hasCoord;
+};
+
+// Кодирование/декодирование одного блока (вынесено для повторного использования)
+void encodeBlock(const PackedReading *records, int count, QByteArray &out);
+// Возвращает false, если данные блока повреждены
+bool decodeBlock(const uchar *data, qsizetype bytes, quint16 station, int count, PackedReading *out);
+
+// ============================
+// Запись архива
+// ============================
+// Потоковый приёмник: у каждой станции открыт свой блок, полный блок сразу
+// уходит на диск, так что память — kBlockRecords записей на станцию.
+class Writer : public ReadingWriter
+{
+public:
+    explicit Writer(const QString &fileName) : file(fileName) {}
+
+    bool begin(const QVector<GeneratedStation> &stations, QString *error) override;
+    bool begin(const QVector<StationInfo> &stations, QString *error);
+    bool write(int station, qint64 day, int rad) override;
+    bool finish(QString *error) override;
+    QString errorString() const { return file.errorString(); }
+
+    // Таблица станций архива — весь реестр, номер станции в архиве равен id реестра
+    static QVector<StationInfo> stationsOf(const StationRegistry &registry);
+    // Весь набор модели: записи каждой станции предварительно упорядочиваются по дню
+    static bool save(const QString &fileName, const RadiationModel &records,
+                     const StationRegistry &registry, QString *error);
+
+private:
+    bool flushBlock(int station);
+
+    QFile file;
+    QVector<StationInfo> stations;
+    QVector<QVector<PackedReading>> pending;   // незаполненный блок каждой станции
+    QVector<BlockHeader> blocks;
+    QByteArray scratch;
+};
+
+// ============================
+// Чтение архива
+// ============================
+class Reader
+{
+public:
+    ~Reader() { close(); }
+
+    bool open(const QString &fileName, QString *error);
+    void close();
+
+    const QVector<StationInfo> &stations() const { return stationTable; }
+    const QVector<BlockHeader> &blocks() const { return blockIndex; }
+    qint64 recordCount() const { return totalRecords; }
+    qint64 firstDay() const { return spanFirst; }   // весь архив — [firstDay, lastDay]
+    qint64 lastDay() const { return spanLast; }
+
+    // Показания станции за [fromDay, toDay]; блоки станции находятся двоичным поиском
+    // по индексу, декодируются только пересекающиеся
+    bool readRange(int station, qint64 fromDay, qint64 toDay, QVector<PackedReading> &out) const;
+
+    // Все блоки в модель; станции регистрируются в реестре (id архива → id реестра)
+    bool loadInto(RadiationModel &records, StationRegistry &registry, QString *error) const;
+    // Только [fromDay, toDay] всех станций, по станциям подряд — частичная загрузка большого архива
+    bool loadRange(RadiationModel &records, StationRegistry &registry, qint64 fromDay, qint64 toDay,
+                   QString *error) const;
+
+    // Замер чтения: полное декодирование и запросы диапазона по каждой станции
+    static int benchmark(const QString &fileName, QTextStream &out);
+
+private:
+    QVector<int> internStations(StationRegistry &registry) const;
+
+    QFile file;
+    const uchar *data = nullptr;
+    qint64 size = 0;
+    QVector<StationInfo> stationTable;
+    QVector<BlockHeader> blockIndex;
+    qint64 totalRecords = 0;
+    qint64 spanFirst = 0, spanLast = -1;
+    // Поиск блоков станции: номера блоков по (станция, firstDay), начало станции в этом
+    // порядке и нарастающий максимум lastDay внутри станции — блоки могут перекрываться
+    QVector<quint32> stationOrder;
+    QVector<qsizetype> stationStart;
+    QVector<qint32> runningLastDay;
+};
+
+} // namespace Archive
+
+#endif
@@ -0,0 +1,318 @@
+#include "correlation.h"
+#include "resample.h"
+#include "tracing.h"
+#include <QSet>
+#include <QPainter>
+#include <QMouseEvent>
+#include <QToolTip>
+#include <QLinearGradient>
+#include <QtConcurrent>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <limits>
+
+using namespace Qt::StringLiterals;
+
+namespace {
+
+// Строки станций на общей сетке: x — отклонение от среднего станции (0 в пропуске),
+// xx — его квадрат, m — 1 в наблюдённый день и 0 в пропуске. Тогда суммы по общим
+// дням пары — скалярные произведения этих строк.
+struct Rows {
+    QVector<float> x, xx, m;
+    qsizetype stride = 0;
+
+    const float *xAt(int i) const { return x.constData() + i * stride; }
+    const float *xxAt(int i) const { return xx.constData() + i * stride; }
+    const float *mAt(int i) const { return m.constData() + i * stride; }
+};
+
+// Суммы по перекрытию двух рядов
+struct PairSums {
+    double n = 0, sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0;
+
+    // NaN — мало общих дней или один из рядов постоянен на перекрытии
+    float r() const
+    {
+        if (n < CorrelationEngine::kMinOverlap) return std::numeric_limits<float>::quiet_NaN();
+        const double vx = sxx - sx * sx / n;
+        const double vy = syy - sy * sy / n;
+        if (vx <= 1e-9 * std::max(1.0, sxx) || vy <= 1e-9 * std::max(1.0, syy))
+            return std::numeric_limits<float>::quiet_NaN();
+        return float(std::clamp((sxy - sx * sy / n) / std::sqrt(vx * vy), -1.0, 1.0));
+    }
+};
+
+inline float dot(const float *a, const float *b, int len)
+{
+    // простой цикл, который компилятор векторизует; накопление в float на коротком отрезке
+    float acc = 0.0f;
+    for (int t = 0; t < len; ++t) acc += a[t] * b[t];
+    return acc;
+}
+
+// Суммы по отрезку [0, len): строка i с a0, строка j с b0 (сдвиг j — целые дни)
+void accumulate(const Rows &rows, int i, qsizetype a0, int j, qsizetype b0, int len, PairSums *s)
+{
+    const float *xi = rows.xAt(i) + a0, *xxi = rows.xxAt(i) + a0, *mi = rows.mAt(i) + a0;
+    const float *xj = rows.xAt(j) + b0, *xxj = rows.xxAt(j) + b0, *mj = rows.mAt(j) + b0;
+    s->n += dot(mi, mj, len);
+    s->sx += dot(xi, mj, len);
+    s->sy += dot(mi, xj, len);
+    s->sxx += dot(xxi, mj, len);
+    s->syy += dot(mi, xxj, len);
+    s->sxy += dot(xi, xj, len);
+}
+
+} // namespace
+
+CorrelationMatrix CorrelationEngine::compute(const QVector<StationReading> &readings, int maxLag)
+{
+    if (readings.isEmpty()) return {};
+
+    // суточная сетка без заполнения пропусков: в пустой ячейке NaN
+    QSet<int> seen;
+    for (const StationReading &r : readings) seen.insert(r.station);
+    QVector<int> ids(seen.cbegin(), seen.cend());
+    std::sort(ids.begin(), ids.end());
+    ResampleOptions grid;
+    grid.step = ResampleOptions::Step::Day;
+    grid.gapFill = ResampleOptions::GapFill::None;
+    return compute(Resampler::resampleAll(readings, ids, grid), maxLag);
+}
+
+CorrelationMatrix CorrelationEngine::compute(QVector<ResampledSeries> series, int maxLag)
+{
+    TRACE_SCOPE("correlation");
+    CorrelationMatrix m;
+    Resampler::align(series);
+    if (series.isEmpty()) return m;
+
+    for (const ResampledSeries &s : std::as_const(series)) m.stations.append(s.station);
+    m.n = int(series.size());
+    m.days = series.first().size();
+    const int n = m.n;
+    const int days = m.days;
+
+    // строки выравниваются до кратного 16 — хвост с нулевой маской в суммы не входит
+    Rows rows;
+    rows.stride = (days + 15) & ~15;
+    rows.x.fill(0.0f, qsizetype(n) * rows.stride);
+    rows.xx.fill(0.0f, qsizetype(n) * rows.stride);
+    rows.m.fill(0.0f, qsizetype(n) * rows.stride);
+    {
+        // сырые указатели берутся до запуска потоков: потоки пишут в непересекающиеся участки
+        float *x = rows.x.data(), *xx = rows.xx.data(), *mask = rows.m.data();
+        QVector<int> order(n);
+        std::iota(order.begin(), order.end(), 0);
+        QtConcurrent::blockingMap(order, [&](int i) {
+            const ResampledSeries &s = std::as_const(series)[i];
+            double mean = 0.0;
+            int cnt = 0;
+            for (int t = 0; t < days; ++t)
+                if (s.observed[t]) { mean += s.values[t]; ++cnt; }
+            mean /= std::max(1, cnt);
+            const qsizetype base = qsizetype(i) * rows.stride;
+            for (int t = 0; t < days; ++t) {
+                if (!s.observed[t]) continue;
+                const float v = float(s.values[t] - mean);   // отклонение — меньше потерь точности в суммах
+                x[base + t] = v;
+                xx[base + t] = v * v;
+                mask[base + t] = 1.0f;
+            }
+        });
+    }
+
+    m.r.fill(std::numeric_limits<float>::quiet_NaN(), qsizetype(n) * n);
+    m.overlap.fill(0, qsizetype(n) * n);
+    float *r = m.r.data();
+    qint32 *overlap = m.overlap.data();
+    const int lag = std::clamp(maxLag, 0, days - 1);
+    if (lag > 0) m.lags.fill(0, qsizetype(n) * n);
+    qint16 *lags = m.lags.data();
+
+    auto store = [&](int i, int j, const PairSums &s, int l) {
+        const float v = s.r();
+        r[qsizetype(i) * n + j] = v;
+        r[qsizetype(j) * n + i] = v;
+        overlap[qsizetype(i) * n + j] = overlap[qsizetype(j) * n + i] = qint32(s.n);
+        if (lags) {
+            lags[qsizetype(i) * n + j] = qint16(l);
+            lags[qsizetype(j) * n + i] = qint16(-l);
+        }
+    };
+
+    // верхний треугольник блоков; диагональные блоки считаются целиком
+    struct Tile { int i0, j0; };
+    QVector<Tile> tiles;
+    for (int i0 = 0; i0 < n; i0 += kBlockStations)
+        for (int j0 = i0; j0 < n; j0 += kBlockStations)
+            tiles.append({i0, j0});
+
+    QtConcurrent::blockingMap(tiles, [&](const Tile &tile) {
+        TRACE_SCOPE("correlation tile");
+        const int i1 = std::min(n, tile.i0 + kBlockStations);
+        const int j1 = std::min(n, tile.j0 + kBlockStations);
+
+        if (lag == 0) {
+            std::vector<PairSums> acc(size_t(kBlockStations) * kBlockStations);
+            for (qsizetype t0 = 0; t0 < rows.stride; t0 += kBlockDays) {
+                const int len = int(std::min<qsizetype>(kBlockDays, rows.stride - t0));
+                for (int i = tile.i0; i < i1; ++i)
+                    for (int j = std::max(tile.j0, i); j < j1; ++j)
+                        accumulate(rows, i, t0, j, t0, len, &acc[size_t(i - tile.i0) * kBlockStations + (j - tile.j0)]);
+            }
+            for (int i = tile.i0; i < i1; ++i)
+                for (int j = std::max(tile.j0, i); j < j1; ++j)
+                    store(i, j, acc[size_t(i - tile.i0) * kBlockStations + (j - tile.j0)], 0);
+            return;
+        }
+
+        // с лагами: день t станции i сравнивается с днём t + l станции j, ровно на l суток позже;
+        // r для каждого сдвига считается заново по его собственному перекрытию
+        for (int i = tile.i0; i < i1; ++i) {
+            for (int j = std::max(tile.j0, i); j < j1; ++j) {
+                PairSums best;
+                float bestR = std::numeric_limits<float>::quiet_NaN();
+                int bestLag = 0;
+                for (int l = -lag; l <= lag; ++l) {
+                    const int len = days - std::abs(l);
+                    const qsizetype a0 = l >= 0 ? 0 : -l;
+                    const qsizetype b0 = l >= 0 ? l : 0;
+                    PairSums s;
+                    for (int t0 = 0; t0 < len; t0 += kBlockDays)
+                        accumulate(rows, i, a0 + t0, j, b0 + t0, std::min(kBlockDays, len - t0), &s);
+                    const float v = s.r();
+                    if (std::isnan(v)) continue;
+                    if (std::isnan(bestR) || std::abs(v) > std::abs(bestR)) { best = s; bestR = v; bestLag = l; }
+                }
+                store(i, j, best, bestLag);
+            }
+        }
+    });
+
+    return m;
+}
+
+// ============================
+// CorrelationHeatmap
+// ============================
+
+static QColor correlationColor(float r)
+{
+    if (std::isnan(r)) return QColor("#cbd5e1");   // не определена
+
+    // синий (-1) — белый (0) — красный (+1)
+    const float t = std::clamp(r, -1.0f, 1.0f);
+    if (t >= 0) return QColor(255, int(255 * (1 - t)), int(255 * (1 - t)));
+    return QColor(int(255 * (1 + t)), int(255 * (1 + t)), 255);
+}
+
+CorrelationHeatmap::CorrelationHeatmap(QWidget *parent)
+    : QWidget(parent)
+{
+    setMouseTracking(true);
+    setMinimumSize(480, 480);
+}
+
+void CorrelationHeatmap::setMatrix(const CorrelationMatrix &mat, const QStringList &stationNames)
+{
+    matrix = mat;
+    names = stationNames;
+
+    const int n = matrix.n;
+    const int side = std::min(n, kMaxImageSide);
+    image = QImage();
+    if (n > 0) {
+        image = QImage(side, side, QImage::Format_RGB32);
+        // каждая точка изображения — среднее по покрываемым ячейкам матрицы
+        for (int y = 0; y < side; ++y) {
+            const int i0 = int(qint64(y) * n / side), i1 = std::max(i0 + 1, int(qint64(y + 1) * n / side));
+            QRgb *line = reinterpret_cast<QRgb*>(image.scanLine(y));
+            for (int x = 0; x < side; ++x) {
+                const int j0 = int(qint64(x) * n / side), j1 = std::max(j0 + 1, int(qint64(x + 1) * n / side));
+                // неопределённые ячейки в среднее не входят; если других нет — точка серая
+                double sum = 0.0;
+                int defined = 0;
+                for (int i = i0; i < i1; ++i)
+                    for (int j = j0; j < j1; ++j)
+                        if (matrix.isDefined(i, j)) { sum += matrix.at(i, j); ++defined; }
+                line[x] = correlationColor(defined ? float(sum / defined) : std::numeric_limits<float>::quiet_NaN()).rgb();
+            }
+        }
+    }
+    update();
+}
+
+QRectF CorrelationHeatmap::matrixRect() const
+{
+    const qreal labels = (matrix.n > 0 && matrix.n <= 40) ? 90 : 10;
+    const qreal side = std::max<qreal>(0, std::min(width() - labels - 10, height() - labels - 30));
+    return QRectF(labels, labels, side, side);
+}
+
+void CorrelationHeatmap::paintEvent(QPaintEvent *)
+{
+    QPainter p(this);
+    p.fillRect(rect(), QColor("#f8fafc"));
+    if (image.isNull()) {
+        p.setPen(QColor("#64748b"));
+        p.drawText(rect(), Qt::AlignCenter, u"Нажмите «Рассчитать», чтобы построить матрицу корреляций"_s);
+        return;
+    }
+
+    const QRectF area = matrixRect();
+    p.drawImage(area, image);
+    p.setPen(QPen(QColor("#cbd5e1"), 1));
+    p.drawRect(area);
+
+    // подписи только для небольшого числа станций
+    if (matrix.n <= 40) {
+        QFont f = p.font(); f.setPointSize(8); p.setFont(f);
+        p.setPen(QColor("#0f172a"));
+        const qreal cell = area.width() / matrix.n;
+        for (int i = 0; i < matrix.n; ++i) {
+            const QString name = names.value(i);
+            p.drawText(QRectF(0, area.top() + i * cell, area.left() - 4, cell), Qt::AlignRight | Qt::AlignVCenter, name);
+            p.save();
+            p.translate(area.left() + (i + 0.5) * cell, area.top() - 4);
+            p.rotate(-60);
+            p.drawText(QPointF(0, 0), name);
+            p.restore();
+        }
+    }
+
+    // шкала
+    const QRectF legend(area.left(), area.bottom() + 10, std::min<qreal>(240, area.width()), 10);
+    QLinearGradient lg(legend.topLeft(), legend.topRight());
+    lg.setColorAt(0.0, correlationColor(-1));
+    lg.setColorAt(0.5, correlationColor(0));
+    lg.setColorAt(1.0, correlationColor(1));
+    p.fillRect(legend, lg);
+    p.setPen(QColor("#334155"));
+    p.drawText(legend.bottomLeft() + QPointF(0, 14), u"-1"_s);
+    p.drawText(legend.bottomRight() + QPointF(-10, 14), u"+1"_s);
+}
+
+void CorrelationHeatmap::mouseMoveEvent(QMouseEvent *event)
+{
+    const QRectF area = matrixRect();
+    if (matrix.n == 0 || !area.contains(event->position())) {
+        QToolTip::hideText();
+        return;
+    }
+    const int i = std::clamp(int((event->position().y() - area.top()) / area.height() * matrix.n), 0, matrix.n - 1);
+    const int j = std::clamp(int((event->position().x() - area.left()) / area.width() * matrix.n), 0, matrix.n - 1);
+
+    QString text = QString(u"%1 ↔ %2\n"_s).arg(names.value(i), names.value(j));
+    if (!matrix.isDefined(i, j)) {
+        text += QString(u"r не определена: %1 общих дней (нужно ≥ %2) или ряд постоянен"_s)
+                    .arg(matrix.overlapAt(i, j)).arg(CorrelationEngine::kMinOverlap);
+    } else {
+        text += QString(u"r = %1 по %2 общим дням"_s).arg(matrix.at(i, j), 0, 'f', 3).arg(matrix.overlapAt(i, j));
+        if (!matrix.lags.isEmpty())
+            text += QString(u"\nлаг: %1 дн."_s).arg(matrix.lagAt(i, j));
+    }
+    QToolTip::showText(event->globalPosition().toPoint(), text, this);
+}
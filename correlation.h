@@ -0,0 +1,76 @@
+#ifndef CORRELATION_H
+#define CORRELATION_H
+
+#include <QWidget>
+#include <QVector>
+#include <QStringList>
+#include <QImage>
+#include <cmath>
+#include "resample.h"
+
+// Симметричная матрица корреляций Пирсона по станциям
+struct CorrelationMatrix {
+    QVector<int> stations;     // id станций в порядке строк
+    int n = 0;
+    int days = 0;              // длина общей суточной сетки
+    QVector<float> r;          // n*n, построчно; NaN — корреляция не определена
+    QVector<qint32> overlap;   // n*n: общих наблюдённых дней при выбранном лаге
+    QVector<qint16> lags;      // лаг (дни) с максимальной |r|; пусто, если лаги не считались
+
+    float at(int i, int j) const { return r[i * n + j]; }
+    bool isDefined(int i, int j) const { return !std::isnan(at(i, j)); }
+    int overlapAt(int i, int j) const { return overlap[i * n + j]; }
+    int lagAt(int i, int j) const { return lags.isEmpty() ? 0 : lags[i * n + j]; }
+};
+
+// ============================
+// Расчёт корреляций
+// ============================
+// Станции приводятся к общей суточной сетке Resampler (среднее за день, пропуски
+// не заполняются). r(i, j) считается только по дням, наблюдённым на обеих
+// станциях (со сдвигом j на целое число дней при поиске лага): пропуски и края
+// рядов не подставляются и не завышают корреляцию. Меньше kMinOverlap общих дней
+// или постоянный ряд на перекрытии — ячейка не определена (NaN); на диагонали
+// это бывает только у постоянной станции.
+// Суммы по перекрытию — скалярные произведения строк значений и масок, они
+// считаются блоками kBlockStations × kBlockStations по отрезкам kBlockDays дней,
+// чтобы обе группы строк оставались в кэше; блоки — параллельно.
+class CorrelationEngine
+{
+public:
+    static constexpr int kBlockStations = 32;
+    static constexpr int kBlockDays = 1024;
+    static constexpr int kMinOverlap = 3;
+
+    // maxLag > 0: для каждой пары ищется сдвиг в [-maxLag, maxLag] с максимальной |r|
+    static CorrelationMatrix compute(const QVector<StationReading> &readings, int maxLag = 0);
+    // Готовые суточные ряды (например, из DailyGridBuilder); выравниваются здесь же
+    static CorrelationMatrix compute(QVector<ResampledSeries> series, int maxLag = 0);
+};
+
+// ============================
+// Виджет тепловой карты матрицы
+// ============================
+class CorrelationHeatmap : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit CorrelationHeatmap(QWidget *parent = nullptr);
+
+    void setMatrix(const CorrelationMatrix &matrix, const QStringList &names);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+
+private:
+    QRectF matrixRect() const;
+
+    CorrelationMatrix matrix;
+    QStringList names;
+    QImage image;     // не больше kMaxImageSide пикселей по стороне, ячейки усредняются
+
+    static constexpr int kMaxImageSide = 1024;
+};
+
+#endif
@@ -0,0 +1,151 @@
+#include "datagen.h"
+#include <QRandomGenerator>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QtMath>
+#include <algorithm>
+
+using namespace Qt::StringLiterals;
+
+static constexpr double kTwoPi = 6.283185307179586;
+
+static QRandomGenerator seededRng(quint64 seed)
+{
+    const quint32 words[2] = { quint32(seed), quint32(seed >> 32) };
+    return QRandomGenerator(words, 2);
+}
+
+// ============================
+// JsonReadingWriter
+// ============================
+
+bool JsonReadingWriter::begin(const QVector<GeneratedStation> &stations, QString *error)
+{
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+
+    prefixes.clear();
+    prefixes.reserve(stations.size());
+    for (const GeneratedStation &st : stations) {
+        // экранирование имени берём у QJsonDocument, чтобы не повторять правила JSON
+        const QByteArray name = QJsonDocument(QJsonArray{st.name}).toJson(QJsonDocument::Compact).mid(1).chopped(1);
+        prefixes.append("{\"city\":" + name
+                        + ",\"lat\":" + QByteArray::number(st.pos.lat, 'f', 4)
+                        + ",\"lon\":" + QByteArray::number(st.pos.lon, 'f', 4));
+    }
+
+    buffer.clear();
+    buffer.reserve(kFlushBytes + 256);
+    buffer.append("[\n");
+    first = true;
+    return true;
+}
+
+bool JsonReadingWriter::write(int station, qint64 day, int rad)
+{
+    if (!first) buffer.append(",\n");
+    first = false;
+
+    buffer.append(prefixes[station]);
+    buffer.append(",\"datetime\":\"");
+    if (day != cachedDay) {   // записи идут по дням — дата форматируется раз в сутки
+        cachedDay = day;
+        cachedDate = QDate::fromJulianDay(day).toString("yyyy-MM-dd").toLatin1();
+    }
+    buffer.append(cachedDate);
+    buffer.append("\",\"radiation\":");
+    buffer.append(QByteArray::number(rad));
+    buffer.append('}');
+
+    return buffer.size() < kFlushBytes || flush();
+}
+
+bool JsonReadingWriter::flush()
+{
+    if (file.write(buffer) != buffer.size()) return false;
+    buffer.clear();
+    return true;
+}
+
+bool JsonReadingWriter::finish(QString *error)
+{
+    buffer.append("\n]\n");
+    if (!flush()) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    file.close();
+    return true;
+}
+
+// ============================
+// SyntheticGenerator
+// ============================
+
+SyntheticGenerator::SyntheticGenerator(const GeneratorOptions &options)
+    : options(options)
+{
+    // станции зависят только от seed, а не от длины ряда
+    QRandomGenerator rng = seededRng(options.seed);
+    const GeoBounds &a = options.area;
+    stationList.reserve(options.stations);
+    for (int i = 0; i < options.stations; ++i) {
+        GeneratedStation st;
+        st.name = QString(u"Станция %1"_s).arg(i + 1, 4, 10, QChar('0'));
+        st.pos = { a.minLat + rng.generateDouble() * (a.maxLat - a.minLat),
+                   a.minLon + rng.generateDouble() * (a.maxLon - a.minLon) };
+        st.base = 8.0 + rng.generateDouble() * 14.0;
+        st.phase = rng.generateDouble() * 0.1 - 0.05;
+        stationList.append(st);
+    }
+}
+
+bool SyntheticGenerator::run(ReadingWriter &writer, QString *error,
+                             const std::function<bool(qint64, qint64)> &progress)
+{
+    if (!writer.begin(stationList, error)) return false;
+
+    // отдельный поток случайных чисел для значений: список станций от него не зависит
+    QRandomGenerator rng = seededRng(options.seed ^ 0x9E3779B97F4A7C15ULL);
+    // Бокс — Мюллер: QRandomGenerator воспроизводим на всех платформах, std::normal_distribution — нет
+    auto gaussian = [&rng]() {
+        const double u1 = std::max(rng.generateDouble(), 1e-300);
+        const double u2 = rng.generateDouble();
+        return std::sqrt(-2.0 * std::log(u1)) * std::cos(kTwoPi * u2);
+    };
+
+    const qint64 total = options.totalRecords();
+    const qint64 firstDay = options.firstDay.toJulianDay();
+    qint64 written = 0;
+
+    for (int d = 0; d < options.days; ++d) {
+        const qint64 day = firstDay + d;
+        const double yearFraction = std::fmod(double(day - firstDay) / 365.25, 1.0);
+
+        for (int s = 0; s < options.samplesPerDay; ++s) {
+            for (int i = 0; i < stationList.size(); ++i) {
+                const GeneratedStation &st = stationList[i];
+                double value = st.base * (1.0 + options.seasonalAmplitude
+                                                    * std::sin(kTwoPi * (yearFraction + st.phase)));
+                value += gaussian() * options.noise;
+                if (rng.generateDouble() < options.spikeRate)
+                    value = st.base * options.spikeScale * (1.0 + rng.generateDouble());
+
+                if (!writer.write(i, day, std::max(0, int(std::lround(value))))) {
+                    if (error) *error = u"Ошибка записи на диск"_s;
+                    return false;
+                }
+
+                if ((++written & 0xFFFFF) == 0 && progress && !progress(written, total)) {
+                    if (error) *error = u"Прервано"_s;
+                    return false;
+                }
+            }
+        }
+    }
+
+    if (progress) progress(written, total);
+    return writer.finish(error);
+}
@@ -0,0 +1,95 @@
+#ifndef DATAGEN_H
+#define DATAGEN_H
+
+#include <QString>
+#include <QVector>
+#include <QDate>
+#include <QFile>
+#include <QByteArray>
+#include <functional>
+#include "stationmap.h"
+
+// Параметры синтетического набора; одинаковые параметры и seed дают байт-в-байт одинаковый файл
+struct GeneratorOptions {
+    quint64 seed = 1;
+    int stations = 50;
+    QDate firstDay = QDate(2015, 1, 1);
+    int days = 3650;
+    int samplesPerDay = 1;             // показаний на станцию в сутки
+    double seasonalAmplitude = 0.25;   // доля базового уровня
+    double noise = 1.5;                // σ шума, мкР/ч
+    double spikeRate = 0.001;          // вероятность выброса на показание
+    double spikeScale = 4.0;           // выброс = базовый уровень × spikeScale
+    GeoBounds area{51.2, 56.2, 23.2, 32.8};
+
+    qint64 totalRecords() const { return qint64(stations) * days * samplesPerDay; }
+};
+
+// Станция синтетического набора
+struct GeneratedStation {
+    QString name;
+    Coord pos;
+    double base;     // средний уровень, мкР/ч
+    double phase;    // сдвиг сезонной волны, доля года
+};
+
+// ============================
+// Приёмники записей
+// ============================
+// Генератор пишет поток записей в приёмник; новый формат файла — новый приёмник.
+class ReadingWriter
+{
+public:
+    virtual ~ReadingWriter() = default;
+
+    virtual bool begin(const QVector<GeneratedStation> &stations, QString *error) = 0;
+    virtual bool write(int station, qint64 day, int rad) = 0;
+    virtual bool finish(QString *error) = 0;
+};
+
+// Массив JSON, совместимый с saveToJson/loadFromJson; буфер сбрасывается на диск
+// порциями, поэтому память не растёт с размером файла
+class JsonReadingWriter : public ReadingWriter
+{
+public:
+    explicit JsonReadingWriter(const QString &fileName) : file(fileName) {}
+
+    bool begin(const QVector<GeneratedStation> &stations, QString *error) override;
+    bool write(int station, qint64 day, int rad) override;
+    bool finish(QString *error) override;
+
+private:
+    bool flush();
+
+    static constexpr int kFlushBytes = 1 << 20;
+
+    QFile file;
+    QByteArray buffer;
+    QVector<QByteArray> prefixes;   // {"city":"...","lat":...,"lon":..., — заранее для каждой станции
+    bool first = true;
+    qint64 cachedDay = -1;
+    QByteArray cachedDate;
+};
+
+// ============================
+// Генератор
+// ============================
+// Значение = база × (1 + A·sin(2π(доля года + сдвиг))) + N(0, σ), изредка — выброс.
+// Записи идут по дням, внутри дня — по станциям, как при реальном сборе данных.
+class SyntheticGenerator
+{
+public:
+    explicit SyntheticGenerator(const GeneratorOptions &options);
+
+    const QVector<GeneratedStation> &stations() const { return stationList; }
+
+    // progress(записано, всего) вызывается примерно раз на миллион записей; false — прервать
+    bool run(ReadingWriter &writer, QString *error,
+             const std::function<bool(qint64, qint64)> &progress = {});
+
+private:
+    GeneratorOptions options;
+    QVector<GeneratedStation> stationList;
+};
+
+#endif
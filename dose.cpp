@@ -0,0 +1,191 @@
+#include "dose.h"
+#include "radiationmodel.h"
+#include "tracing.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+constexpr double kHoursPerDay = 24.0;
+
+} // namespace
+
+DoseIndex::DoseIndex(const RadiationModel *records)
+    : records(records)
+{
+}
+
+void DoseIndex::clear()
+{
+    stations.clear();
+    merged = Network();
+}
+
+bool DoseIndex::isCurrent(int station) const
+{
+    if (station < 0 || station >= stations.size()) return false;
+    const Series &s = stations[station];
+    return s.built && s.version == records->stationVersion(station);
+}
+
+void DoseIndex::recordsAboutToBeInserted()
+{
+    // версии станций вставка поднимет до уведомления о ней, поэтому актуальность
+    // запоминается заранее: устаревший ряд не должен стать «актуальным» после дописывания
+    for (int id = 0; id < stations.size(); ++id)
+        stations[id].currentBeforeInsert = isCurrent(id);
+}
+
+void DoseIndex::recordsInserted(qsizetype first, qsizetype last)
+{
+    for (qsizetype row = first; row <= last; ++row) {
+        const PackedReading &r = records->at(row);
+        if (r.station >= stations.size()) continue;   // станция ещё не запрашивалась
+        Series &s = stations[r.station];
+        if (!s.built || !s.currentBeforeInsert || s.resetVersion != records->lastResetVersion()) continue;
+        // дописывание в конец сохраняет ряд актуальным; запись «в прошлое» его сбрасывает —
+        // он пересоберётся при запросе
+        if (appendReading(s, r.day, r.rad)) s.version = records->stationVersion(r.station);
+        else s.built = false;
+    }
+}
+
+bool DoseIndex::appendReading(Series &s, qint64 day, int rad)
+{
+    const int n = int(s.days.size());
+    if (n > 0 && day < s.days.last()) return false;
+    if (n > 0 && day == s.days.last()) {
+        s.sum.last() += rad;
+        ++s.count.last();
+        refreshPrefixTail(s, n - 1);
+        return true;
+    }
+    s.days.append(day);
+    s.sum.append(rad);
+    s.count.append(1);
+    s.prefix.append(0.0);
+    refreshPrefixTail(s, n);
+    return true;
+}
+
+void DoseIndex::refreshPrefixTail(Series &s, int from)
+{
+    for (int k = std::max(0, from); k < s.days.size(); ++k) {
+        if (k == 0) { s.prefix[0] = 0.0; continue; }
+        // полные сутки предыдущего дня ряда; дни между ними без показаний ничего не добавляют
+        s.prefix[k] = s.prefix[k - 1] + kHoursPerDay * s.rate(k - 1);
+    }
+}
+
+void DoseIndex::sync(const QVector<int> &ids)
+{
+    int maxId = -1;
+    for (int id : ids) maxId = std::max(maxId, id);
+    if (maxId >= stations.size()) stations.resize(maxId + 1);
+
+    std::vector<bool> stale(size_t(stations.size()), false);
+    bool any = false;
+    for (int id : ids)
+        if (id >= 0 && !isCurrent(id)) { stale[size_t(id)] = true; any = true; }
+    if (!any) return;
+
+    TRACE_SCOPE("dose index");
+    QVector<QVector<std::pair<qint64, int>>> pending(stations.size());
+    for (const PackedReading &r : records->arena())
+        if (r.station < stale.size() && stale[r.station]) pending[r.station].append({r.day, int(r.rad)});
+
+    for (int id = 0; id < stations.size(); ++id) {
+        if (!stale[size_t(id)]) continue;
+        QVector<std::pair<qint64, int>> &rows = pending[id];
+        std::sort(rows.begin(), rows.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+
+        Series s;
+        for (const auto &[day, rad] : std::as_const(rows)) appendReading(s, day, rad);
+        s.version = records->stationVersion(id);
+        s.resetVersion = records->lastResetVersion();
+        s.built = true;
+        stations[id] = std::move(s);
+    }
+}
+
+DoseIndex::Series &DoseIndex::series(int station)
+{
+    if (!isCurrent(station)) sync({station});
+    return stations[station];
+}
+
+double DoseIndex::integralTo(const Series &s, double t) const
+{
+    const int n = int(s.days.size());
+    if (n == 0 || t <= double(s.days.first())) return 0.0;
+
+    // k — последний день ряда, начавшийся не позже t; из него учитывается не больше суток
+    const auto it = std::upper_bound(s.days.cbegin(), s.days.cend(), t, [](double x, qint64 d) { return x < double(d); });
+    const int k = int(it - s.days.cbegin()) - 1;
+    const double part = std::min(t - double(s.days[k]), 1.0);
+    return s.prefix[k] + part * kHoursPerDay * s.rate(k);
+}
+
+double DoseIndex::dose(int station, qint64 fromDay, qint64 toDay)
+{
+    if (station < 0 || toDay < fromDay) return 0.0;
+    const Series &s = series(station);
+    return integralTo(s, double(toDay) + 1.0) - integralTo(s, double(fromDay));
+}
+
+double DoseIndex::cumulative(int station, qint64 day)
+{
+    if (station < 0) return 0.0;
+    return integralTo(series(station), double(day));
+}
+
+const DoseIndex::Network &DoseIndex::network(const QVector<int> &ids)
+{
+    if (merged.built && merged.version == records->dataVersion() && merged.ids == ids) return merged;
+
+    TRACE_SCOPE("network dose");
+    sync(ids);   // все устаревшие станции — за один проход
+    std::vector<std::pair<qint64, double>> daily;   // (день, суточная доза станции)
+    for (int id : ids) {
+        if (id < 0) continue;
+        const Series &s = stations[id];
+        for (int k = 0; k < s.days.size(); ++k) daily.emplace_back(s.days[k], kHoursPerDay * s.rate(k));
+    }
+    std::sort(daily.begin(), daily.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+
+    Network net;
+    net.ids = ids;
+    net.prefix.append(0.0);
+    for (const auto &[day, amount] : daily) {
+        if (net.days.isEmpty() || net.days.last() != day) {
+            net.days.append(day);
+            net.prefix.append(net.prefix.last());
+        }
+        net.prefix.last() += amount;
+    }
+    net.version = records->dataVersion();
+    net.built = true;
+    merged = std::move(net);
+    return merged;
+}
+
+double DoseIndex::networkDose(const QVector<int> &ids, qint64 fromDay, qint64 toDay)
+{
+    if (toDay < fromDay) return 0.0;
+    const Network &net = network(ids);
+    // дни ряда сети — целые сутки, поэтому доза за [fromDay, toDay] — разность двух префиксов
+    const auto from = std::lower_bound(net.days.cbegin(), net.days.cend(), fromDay) - net.days.cbegin();
+    const auto to = std::upper_bound(net.days.cbegin(), net.days.cend(), toDay) - net.days.cbegin();
+    return net.prefix[to] - net.prefix[from];
+}
+
+double DoseIndex::networkCumulative(const QVector<int> &ids, qint64 day)
+{
+    const Network &net = network(ids);
+    return net.prefix[std::lower_bound(net.days.cbegin(), net.days.cend(), day) - net.days.cbegin()];
+}
+
+const QVector<qint64> &DoseIndex::days(int station)
+{
+    return series(station).days;
+}
@@ -0,0 +1,84 @@
+#ifndef DOSE_H
+#define DOSE_H
+
+#include <QVector>
+#include <QtGlobal>
+
+class RadiationModel;
+
+// ============================
+// Накопленная доза
+// ============================
+// Мощность (мкР/ч) станции сводится к среднему за день и считается постоянной весь этот
+// день, от полуночи до полуночи; доза — интеграл мощности по времени, в мкР. Дни без
+// показаний (перерывы в работе станции) дают ноль — мощность через них не
+// интерполируется. Для каждой станции хранятся префиксные суммы по дням ряда, поэтому
+// доза за любой интервал — два бинарных поиска и два неполных дня, O(log n).
+//
+// Новые показания после последнего дня станции дописываются за O(1). Запись «в прошлое»
+// или сброс модели делает станцию устаревшей — она пересчитывается при следующем запросе
+// (версия станции в модели сверяется так же, как в ResultCache). Фильтр не учитывается:
+// доза считается по всем показаниям.
+//
+// Для суммы по набору станций суточные дозы их рядов сливаются в один ряд с префиксными
+// суммами; он собирается один раз на версию данных модели и набор станций, после чего
+// доза сети на любой день — один бинарный поиск, а не запрос к каждой станции.
+class DoseIndex
+{
+public:
+    explicit DoseIndex(const RadiationModel *records);
+
+    // Уведомления до и после вставки записей [first, last] в конец модели
+    void recordsAboutToBeInserted();
+    void recordsInserted(qsizetype first, qsizetype last);
+    void clear();
+
+    // Доза станции за дни [fromDay, toDay] включительно, мкР; вне ряда станции — 0
+    double dose(int station, qint64 fromDay, qint64 toDay);
+    // Накопленная с начала ряда доза на начало дня day, мкР
+    double cumulative(int station, qint64 day);
+    // Сумма по станциям ids
+    double networkDose(const QVector<int> &stations, qint64 fromDay, qint64 toDay);
+    // Накопленная станциями ids доза на начало дня day, мкР
+    double networkCumulative(const QVector<int> &stations, qint64 day);
+    // Дни с показаниями станции (вне их накопленная доза не растёт); ссылка годна до следующего запроса
+    const QVector<qint64> &days(int station);
+
+    static double toMilliR(double microR) { return microR / 1000.0; }
+
+private:
+    struct Series {
+        QVector<qint64> days;      // различные дни по возрастанию
+        QVector<double> sum;       // сумма показаний дня
+        QVector<int> count;        // их число
+        QVector<double> prefix;    // prefix[k] — доза от начала days[0] до начала days[k], мкР
+        quint64 version = 0;       // stationVersion на момент последнего обновления
+        quint64 resetVersion = 0;  // lastResetVersion() модели на момент сборки
+        bool built = false;
+        bool currentBeforeInsert = false;   // ряд был актуален перед текущей вставкой
+
+        double rate(int k) const { return sum[k] / count[k]; }
+    };
+
+    struct Network {
+        QVector<int> ids;          // станции, по которым собран ряд
+        QVector<qint64> days;      // дни с показаниями хотя бы одной из них, по возрастанию
+        QVector<double> prefix;    // prefix[k] — доза до начала days[k], мкР; последний — за весь ряд
+        quint64 version = 0;       // dataVersion модели на момент сборки
+        bool built = false;
+    };
+
+    Series &series(int station);   // актуальный ряд станции (при необходимости пересобирается)
+    bool isCurrent(int station) const;
+    void sync(const QVector<int> &ids);   // устаревшие станции пересобираются одним проходом по записям
+    bool appendReading(Series &s, qint64 day, int rad);   // false — запись не в конец ряда
+    void refreshPrefixTail(Series &s, int from);
+    double integralTo(const Series &s, double t) const;   // t — в днях, день d — отрезок [d, d + 1)
+    const Network &network(const QVector<int> &ids);      // общий ряд станций ids (при необходимости пересобирается)
+
+    const RadiationModel *records;
+    QVector<Series> stations;
+    Network merged;
+};
+
+#endif
@@ -0,0 +1,563 @@
+#include "filterexpr.h"
+#include "stationregistry.h"
+#include "tracing.h"
+#include <QDate>
+#include <QElapsedTimer>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace Qt::StringLiterals;
+
+namespace {
+
+// Больше этого число записей делится на блоки арены и фильтруется параллельно
+constexpr qsizetype kParallelRows = 4 * RecordArena::kChunkSize;
+
+template <typename Get>
+void compareField(const PackedReading *rows, int n, uchar *dst, int cmp, qint32 v, Get get)
+{
+    // сравнение выбрано вне цикла: каждый цикл — однородный и векторизуемый
+    switch (cmp) {
+    case 0: for (int i = 0; i < n; ++i) dst[i] = get(rows[i]) == v; break;
+    case 1: for (int i = 0; i < n; ++i) dst[i] = get(rows[i]) != v; break;
+    case 2: for (int i = 0; i < n; ++i) dst[i] = get(rows[i]) < v; break;
+    case 3: for (int i = 0; i < n; ++i) dst[i] = get(rows[i]) <= v; break;
+    case 4: for (int i = 0; i < n; ++i) dst[i] = get(rows[i]) > v; break;
+    case 5: for (int i = 0; i < n; ++i) dst[i] = get(rows[i]) >= v; break;
+    }
+}
+
+} // namespace
+
+// ============================
+// Разбор выражения
+// ============================
+
+class FilterParser
+{
+public:
+    FilterParser(const QString &text, const StationRegistry &registry, FilterExpression *out)
+        : text(text), registry(registry), out(out) {}
+
+    bool parse(QString *error)
+    {
+        next();
+        if (!parseOr()) {
+            if (error) *error = message;
+            return false;
+        }
+        if (tok.kind != Tok::End) {
+            if (error) *error = u"Лишний текст в позиции %1: «%2»"_s.arg(tok.pos + 1).arg(tok.text);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    enum class Tok { Ident, Number, Date, String, LParen, RParen, Comma, Op, End, Bad };
+    enum class Field { City, Radiation, Date };
+
+    struct Token {
+        Tok kind = Tok::End;
+        QString text;
+        double number = 0.0;
+        qint64 day = 0;
+        int pos = 0;
+    };
+
+    bool fail(const QString &what)
+    {
+        message = tok.kind == Tok::End
+            ? u"%1, а выражение закончилось"_s.arg(what)
+            : u"%1 в позиции %2, а найдено «%3»"_s.arg(what).arg(tok.pos + 1).arg(tok.text);
+        return false;
+    }
+
+    bool isWordChar(QChar c) const
+    {
+        return c.isLetterOrNumber() || c == u'_' || c == u'-' || c == u'.';
+    }
+
+    void next()
+    {
+        while (at < text.size() && text[at].isSpace()) ++at;
+        tok = Token();
+        tok.pos = int(at);
+        if (at >= text.size()) return;
+
+        const QChar c = text[at];
+        if (c == u'(' || c == u')' || c == u',') {
+            tok.kind = c == u'(' ? Tok::LParen : c == u')' ? Tok::RParen : Tok::Comma;
+            tok.text = c;
+            ++at;
+        } else if (c == u'\'' || c == u'"') {
+            const qsizetype end = text.indexOf(c, at + 1);
+            if (end < 0) {
+                tok.kind = Tok::Bad;
+                tok.text = text.mid(at);
+                at = text.size();
+                return;
+            }
+            tok.kind = Tok::String;
+            tok.text = text.mid(at + 1, end - at - 1);
+            at = end + 1;
+        } else if (c == u'=' || c == u'!' || c == u'<' || c == u'>') {
+            qsizetype end = at + 1;
+            if (end < text.size() && (text[end] == u'=' || (c == u'<' && text[end] == u'>'))) ++end;
+            tok.kind = Tok::Op;
+            tok.text = text.mid(at, end - at);
+            at = end;
+        } else if (c.isDigit() || (c == u'-' && at + 1 < text.size() && text[at + 1].isDigit())) {
+            // ведущий минус — знак числа: «-5» не имя, а отрицательный порог
+            qsizetype end = at;
+            while (end < text.size() && (text[end].isDigit() || text[end] == u'.' || text[end] == u'-')) ++end;
+            tok.text = text.mid(at, end - at);
+            at = end;
+            QDate date = QDate::fromString(tok.text, u"yyyy-MM-dd"_s);
+            if (!date.isValid()) date = QDate::fromString(tok.text, u"dd.MM.yyyy"_s);
+            bool ok = false;
+            if (date.isValid()) {
+                tok.kind = Tok::Date;
+                tok.day = date.toJulianDay();
+            } else if (tok.number = tok.text.toDouble(&ok); ok) {
+                tok.kind = Tok::Number;
+            } else {
+                tok.kind = Tok::Bad;
+            }
+        } else if (isWordChar(c)) {
+            qsizetype end = at;
+            while (end < text.size() && isWordChar(text[end])) ++end;
+            tok.kind = Tok::Ident;
+            tok.text = text.mid(at, end - at);
+            at = end;
+        } else {
+            tok.kind = Tok::Bad;
+            tok.text = c;
+            ++at;
+        }
+    }
+
+    bool keyword(QStringView word) const
+    {
+        return tok.kind == Tok::Ident && QStringView(tok.text).compare(word, Qt::CaseInsensitive) == 0;
+    }
+
+    // Учёт глубины стека масок по мере выдачи инструкций
+    void push(FilterExpression::Op op, FilterExpression::Cmp cmp = FilterExpression::Cmp::Eq, qint32 value = 0, int set = -1)
+    {
+        out->program.push_back({op, cmp, value, set});
+        switch (op) {
+        case FilterExpression::Op::And:
+        case FilterExpression::Op::Or: --stack; break;
+        case FilterExpression::Op::Not: break;
+        default: ++stack; break;
+        }
+        out->depth = std::max(out->depth, stack);
+    }
+
+    bool parseOr()
+    {
+        if (!parseAnd()) return false;
+        while (keyword(u"or")) {
+            next();
+            if (!parseAnd()) return false;
+            push(FilterExpression::Op::Or);
+        }
+        return true;
+    }
+
+    bool parseAnd()
+    {
+        if (!parseNot()) return false;
+        while (keyword(u"and")) {
+            next();
+            if (!parseNot()) return false;
+            push(FilterExpression::Op::And);
+        }
+        return true;
+    }
+
+    bool parseNot()
+    {
+        if (keyword(u"not")) {
+            next();
+            if (!parseNot()) return false;
+            push(FilterExpression::Op::Not);
+            return true;
+        }
+        return parsePrimary();
+    }
+
+    bool parsePrimary()
+    {
+        if (tok.kind == Tok::LParen) {
+            next();
+            if (!parseOr()) return false;
+            if (tok.kind != Tok::RParen) return fail(u"Ожидалась «)»"_s);
+            next();
+            return true;
+        }
+
+        Field field;
+        if (keyword(u"city") || keyword(u"station") || keyword(u"город")) field = Field::City;
+        else if (keyword(u"radiation") || keyword(u"rad") || keyword(u"радиация")) field = Field::Radiation;
+        else if (keyword(u"date") || keyword(u"дата")) field = Field::Date;
+        else return fail(u"Ожидалось поле city, radiation или date"_s);
+        next();
+
+        if (field == Field::City) return parseCity();
+
+        if (tok.kind != Tok::Op) return fail(u"Ожидалось сравнение (=, !=, <, <=, >, >=)"_s);
+        FilterExpression::Cmp cmp;
+        if (!comparison(tok.text, &cmp)) return fail(u"Неизвестная операция"_s);
+        next();
+
+        if (field == Field::Date) {
+            if (tok.kind != Tok::Date) return fail(u"Ожидалась дата yyyy-MM-dd"_s);
+            push(FilterExpression::Op::Day, cmp, qint32(tok.day));
+            next();
+            return true;
+        }
+
+        if (tok.kind != Tok::Number) return fail(u"Ожидалось число"_s);
+        emitRadiation(cmp, tok.number);
+        next();
+        return true;
+    }
+
+    static bool comparison(const QString &op, FilterExpression::Cmp *cmp)
+    {
+        using C = FilterExpression::Cmp;
+        if (op == "="_L1 || op == "=="_L1) *cmp = C::Eq;
+        else if (op == "!="_L1 || op == "<>"_L1) *cmp = C::Ne;
+        else if (op == "<"_L1) *cmp = C::Lt;
+        else if (op == "<="_L1) *cmp = C::Le;
+        else if (op == ">"_L1) *cmp = C::Gt;
+        else if (op == ">="_L1) *cmp = C::Ge;
+        else return false;
+        return true;
+    }
+
+    // Радиация хранится целой: дробный порог сводится к целому без изменения смысла.
+    // Порог за пределами 0…kMaxRadiation сжимается до соседнего с диапазоном целого —
+    // результат сравнения тот же, а приведение к qint32 определено
+    void emitRadiation(FilterExpression::Cmp cmp, double v)
+    {
+        using C = FilterExpression::Cmp;
+        v = std::clamp(v, -1.0, double(RadiationModel::kMaxRadiation) + 1.0);
+        const bool whole = v == std::floor(v);
+        qint32 t = 0;
+        switch (cmp) {
+        case C::Eq: case C::Ne: t = whole ? qint32(v) : -1; break;   // -1 не совпадает ни с одним значением
+        case C::Lt: case C::Ge: t = qint32(std::ceil(v)); break;
+        case C::Le: case C::Gt: t = qint32(std::floor(v)); break;
+        }
+        push(FilterExpression::Op::Radiation, cmp, t);
+    }
+
+    bool parseCity()
+    {
+        bool negate = false;
+        std::vector<quint64> set(RadiationModel::kMaxStations / 64, 0);
+        auto addName = [&]() {
+            if (tok.kind != Tok::Ident && tok.kind != Tok::String) return fail(u"Ожидалось название города"_s);
+            const int id = findStation(tok.text);
+            if (id < 0) {
+                message = u"Неизвестный город «%1» в позиции %2"_s.arg(tok.text).arg(tok.pos + 1);
+                return false;
+            }
+            if (id < RadiationModel::kMaxStations) set[size_t(id) >> 6] |= quint64(1) << (id & 63);
+            next();
+            return true;
+        };
+
+        if (tok.kind == Tok::Op) {
+            FilterExpression::Cmp cmp;
+            if (!comparison(tok.text, &cmp) || (cmp != FilterExpression::Cmp::Eq && cmp != FilterExpression::Cmp::Ne))
+                return fail(u"Для города допустимы только = и !="_s);
+            negate = cmp == FilterExpression::Cmp::Ne;
+            next();
+            if (!addName()) return false;
+        } else {
+            if (keyword(u"not")) { negate = true; next(); }
+            if (!keyword(u"in")) return fail(u"Ожидалось «in», «=» или «!=»"_s);
+            next();
+            if (tok.kind != Tok::LParen) return fail(u"Ожидалась «(»"_s);
+            next();
+            if (!addName()) return false;
+            while (tok.kind == Tok::Comma) {
+                next();
+                if (!addName()) return false;
+            }
+            if (tok.kind != Tok::RParen) return fail(u"Ожидалась «)»"_s);
+            next();
+        }
+
+        out->stationSets.push_back(std::move(set));
+        push(FilterExpression::Op::StationIn, FilterExpression::Cmp::Eq, 0, int(out->stationSets.size()) - 1);
+        if (negate) push(FilterExpression::Op::Not);
+        return true;
+    }
+
+    int findStation(const QString &name) const
+    {
+        const int exact = registry.find(name);
+        if (exact >= 0) return exact;
+        for (int id = 0; id < registry.count(); ++id)
+            if (registry.name(id).compare(name, Qt::CaseInsensitive) == 0) return id;
+        return -1;
+    }
+
+    const QString &text;
+    const StationRegistry &registry;
+    FilterExpression *out;
+    qsizetype at = 0;
+    Token tok;
+    QString message;
+    int stack = 0;
+};
+
+// ============================
+// FilterExpression
+// ============================
+
+bool FilterExpression::compile(const QString &text, const StationRegistry &registry,
+                               FilterExpression *out, QString *error)
+{
+    FilterExpression expr;
+    expr.source = text.trimmed();
+    if (expr.source.isEmpty()) {
+        *out = expr;
+        return true;
+    }
+    FilterParser parser(expr.source, registry, &expr);
+    if (!parser.parse(error)) return false;
+    *out = std::move(expr);
+    return true;
+}
+
+void FilterExpression::evaluate(const PackedReading *rows, int count, uchar *mask) const
+{
+    // стек масок по kBatch байт; у каждого потока свой
+    thread_local std::vector<uchar> stack;
+    stack.resize(size_t(std::max(depth, 1)) * kBatch);
+    uchar *base = stack.data();
+    int top = 0;
+
+    for (const Instr &in : program) {
+        switch (in.op) {
+        case Op::Radiation:
+            compareField(rows, count, base + size_t(top++) * kBatch, int(in.cmp), in.value,
+                         [](const PackedReading &r) { return qint32(r.rad); });
+            break;
+        case Op::Day:
+            compareField(rows, count, base + size_t(top++) * kBatch, int(in.cmp), in.value,
+                         [](const PackedReading &r) { return r.day; });
+            break;
+        case Op::StationIn: {
+            uchar *dst = base + size_t(top++) * kBatch;
+            const quint64 *bits = stationSets[size_t(in.set)].data();
+            for (int i = 0; i < count; ++i)
+                dst[i] = uchar((bits[rows[i].station >> 6] >> (rows[i].station & 63)) & 1);
+            break;
+        }
+        case Op::And: {
+            const uchar *b = base + size_t(--top) * kBatch;
+            uchar *a = base + size_t(top - 1) * kBatch;
+            for (int i = 0; i < count; ++i) a[i] &= b[i];
+            break;
+        }
+        case Op::Or: {
+            const uchar *b = base + size_t(--top) * kBatch;
+            uchar *a = base + size_t(top - 1) * kBatch;
+            for (int i = 0; i < count; ++i) a[i] |= b[i];
+            break;
+        }
+        case Op::Not: {
+            uchar *a = base + size_t(top - 1) * kBatch;
+            for (int i = 0; i < count; ++i) a[i] ^= 1;
+            break;
+        }
+        }
+    }
+    std::memcpy(mask, base, size_t(count));
+}
+
+QString FilterExpression::toSql(const QHash<int, int> &stationColumn) const
+{
+    static const char *const cmp[] = {"=", "<>", "<", "<=", ">", ">="};
+    QStringList stack;
+    for (const Instr &in : program) {
+        switch (in.op) {
+        case Op::Radiation:
+            stack.append(u"rad %1 %2"_s.arg(QLatin1StringView(cmp[int(in.cmp)])).arg(in.value));
+            break;
+        case Op::Day:
+            stack.append(u"day %1 %2"_s.arg(QLatin1StringView(cmp[int(in.cmp)])).arg(in.value));
+            break;
+        case Op::StationIn: {
+            QStringList ids;
+            const std::vector<quint64> &bits = stationSets[size_t(in.set)];
+            for (size_t w = 0; w < bits.size(); ++w)
+                for (int b = 0; b < 64; ++b) {
+                    if (!((bits[w] >> b) & 1)) continue;
+                    const auto it = stationColumn.constFind(int(w * 64) + b);
+                    if (it != stationColumn.cend()) ids.append(QString::number(*it));
+                }
+            // станции, которых нет в базе, не совпадают ни с одной строкой
+            stack.append(ids.isEmpty() ? u"0"_s : u"station IN (%1)"_s.arg(ids.join(u',')));
+            break;
+        }
+        case Op::And:
+        case Op::Or: {
+            const QString b = stack.takeLast();
+            const QString a = stack.takeLast();
+            stack.append(u"(%1 %2 %3)"_s.arg(a, in.op == Op::And ? u"AND"_s : u"OR"_s, b));
+            break;
+        }
+        case Op::Not:
+            stack.last() = u"NOT (%1)"_s.arg(stack.last());
+            break;
+        }
+    }
+    return stack.isEmpty() ? QString() : stack.first();
+}
+
+QVector<quint32> FilterExpression::select(const RecordArena &records, qsizetype from, qsizetype to) const
+{
+    auto scan = [this, &records](qsizetype begin, qsizetype end) {
+        QVector<quint32> hits;
+        uchar mask[kBatch];
+        for (qsizetype s = begin; s < end; ) {
+            // пакет не выходит за блок арены — записи в нём лежат подряд
+            const qsizetype chunkEnd = (s | RecordArena::kChunkMask) + 1;
+            const int n = int(std::min({qsizetype(kBatch), end - s, chunkEnd - s}));
+            evaluate(&records[s], n, mask);
+            for (int i = 0; i < n; ++i)
+                if (mask[i]) hits.append(quint32(s + i));
+            s += n;
+        }
+        return hits;
+    };
+
+    if (to - from < kParallelRows) return scan(from, to);
+
+    QVector<QPair<qsizetype, qsizetype>> ranges;
+    for (qsizetype s = from; s < to; ) {
+        const qsizetype e = std::min(to, (s | RecordArena::kChunkMask) + 1);
+        ranges.append({s, e});
+        s = e;
+    }
+    const QList<QVector<quint32>> parts = QtConcurrent::blockingMapped(ranges, [&scan](const QPair<qsizetype, qsizetype> &r) {
+        TRACE_SCOPE("filter block");
+        return scan(r.first, r.second);
+    });
+
+    qsizetype total = 0;
+    for (const QVector<quint32> &p : parts) total += p.size();
+    QVector<quint32> hits;
+    hits.reserve(total);
+    for (const QVector<quint32> &p : parts) hits.append(p);
+    return hits;
+}
+
+// ============================
+// FilterModel
+// ============================
+
+FilterModel::FilterModel(RadiationModel *source, StationRegistry *registry, QObject *parent)
+    : QAbstractTableModel(parent), source(source), registry(registry)
+{
+    connect(source, &QAbstractItemModel::modelAboutToBeReset, this, [this]() {
+        beginResetModel();
+        rows.clear();
+    });
+    connect(source, &QAbstractItemModel::modelReset, this, [this]() {
+        reselect();
+        endResetModel();
+        emit selectionChanged();
+    });
+    connect(source, &QAbstractItemModel::rowsInserted, this, &FilterModel::onRowsInserted);
+}
+
+bool FilterModel::setFilter(const QString &text, QString *error)
+{
+    FilterExpression compiled;
+    if (!FilterExpression::compile(text, *registry, &compiled, error)) return false;
+
+    beginResetModel();
+    expr = std::move(compiled);
+    reselect();
+    endResetModel();
+    emit selectionChanged();
+    return true;
+}
+
+void FilterModel::reselect()
+{
+    ++gen;
+    rows.clear();
+    if (!isActive()) return;
+    TRACE_SCOPE("filter");
+
+    // после загрузки в реестре могли появиться города, которых не было при разборе
+    FilterExpression fresh;
+    if (FilterExpression::compile(expr.text(), *registry, &fresh, nullptr)) expr = std::move(fresh);
+
+    QElapsedTimer timer;
+    timer.start();
+    rows = expr.select(source->arena(), 0, source->size());
+    selectUs = timer.nsecsElapsed() / 1000;
+}
+
+void FilterModel::onRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid() || !isActive()) return;
+    const QVector<quint32> added = expr.select(source->arena(), first, last + 1);
+    if (added.isEmpty()) return;
+
+    ++gen;
+    beginInsertRows(QModelIndex(), int(rows.size()), int(rows.size() + added.size() - 1));
+    rows.append(added);
+    endInsertRows();
+    emit selectionChanged();
+}
+
+ReadingStats FilterModel::stats(const QVector<int> &stations) const
+{
+    std::vector<bool> wanted(RadiationModel::kMaxStations, stations.isEmpty());
+    for (int id : stations)
+        if (id >= 0 && id < RadiationModel::kMaxStations) wanted[size_t(id)] = true;
+
+    ReadingStats st;
+    forEachReading([&](const PackedReading &r) {
+        if (wanted[r.station]) st.add(r.day, r.rad);
+    });
+    return st;
+}
+
+int FilterModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(rows.size());
+}
+
+int FilterModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : source->columnCount();
+}
+
+QVariant FilterModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rows.size()) return QVariant();
+    return source->data(source->index(int(rows[index.row()]), index.column()), role);
+}
+
+QVariant FilterModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    // номер строки — номер записи в полной таблице
+    if (orientation == Qt::Vertical && role == Qt::DisplayRole && section < rows.size())
+        return qint64(rows[section]) + 1;
+    return source->headerData(section, orientation, role);
+}
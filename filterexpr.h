@@ -0,0 +1,138 @@
+#ifndef FILTEREXPR_H
+#define FILTEREXPR_H
+
+#include <QAbstractTableModel>
+#include <QString>
+#include <QHash>
+#include <QVector>
+#include <vector>
+#include "radiationmodel.h"
+#include "resultcache.h"
+
+class StationRegistry;
+
+// ============================
+// Выражение фильтра
+// ============================
+// Текст вида «city in (Gomel, Bragin) and radiation > 30 and date >= 2024-01-01»
+// разбирается один раз в постфиксную программу. Программа выполняется пакетами
+// по kBatch записей: каждая инструкция — один плотный цикл по полю пакета,
+// результат — байтовая маска, логические операции сливают маски.
+//
+//   выражение := и { or и }        и := не { and не }       не := [not] первичное
+//   первичное := ( выражение ) | поле оп значение | city [not] in ( имя, ... )
+//   поле := city | radiation | date (город, радиация, дата)
+//   оп := = == != < <= > >=        дата — yyyy-MM-dd или dd.MM.yyyy
+class FilterExpression
+{
+public:
+    static constexpr int kBatch = 4096;
+
+    // Имена городов сверяются с реестром без учёта регистра; неизвестный город — ошибка
+    static bool compile(const QString &text, const StationRegistry &registry,
+                        FilterExpression *out, QString *error);
+
+    QString text() const { return source; }
+    bool isEmpty() const { return program.empty(); }
+
+    // mask[i] = 1, если rows[i] проходит фильтр; count ≤ kBatch
+    void evaluate(const PackedReading *rows, int count, uchar *mask) const;
+
+    // Номера подходящих записей [from, to) по возрастанию; большие диапазоны — параллельно по блокам арены
+    QVector<quint32> select(const RecordArena &records, qsizetype from, qsizetype to) const;
+
+    // То же условие для WHERE в SQL (столбцы station, day, rad); stationColumn — id реестра →
+    // значение столбца station. Пусто, если фильтр не задан
+    QString toSql(const QHash<int, int> &stationColumn) const;
+
+private:
+    enum class Op : quint8 { Radiation, Day, StationIn, And, Or, Not };
+    enum class Cmp : quint8 { Eq, Ne, Lt, Le, Gt, Ge };
+
+    struct Instr {
+        Op op;
+        Cmp cmp;
+        qint32 value;   // порог радиации или юлианский день
+        int set;        // индекс набора станций
+    };
+
+    friend class FilterParser;
+
+    QString source;
+    std::vector<Instr> program;
+    std::vector<std::vector<quint64>> stationSets;   // битовые множества id станций
+    int depth = 0;                                   // глубина стека масок
+};
+
+// ============================
+// Отфильтрованное представление записей
+// ============================
+// Пока фильтр не задан, модель пуста и не используется; с фильтром она хранит
+// номера подходящих записей (4 байта на совпадение) и показывает только их.
+// Сброс исходной модели (загрузка, сортировка) перевыбирает записи, вставка
+// одной записи проверяет только её.
+class FilterModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    FilterModel(RadiationModel *source, StationRegistry *registry, QObject *parent = nullptr);
+
+    // Пустой текст снимает фильтр; false — ошибка разбора, прежний фильтр остаётся
+    bool setFilter(const QString &text, QString *error);
+    bool isActive() const { return !expr.isEmpty(); }
+    QString filterText() const { return expr.text(); }
+
+    const QVector<quint32> &selectedRows() const { return rows; }   // номера записей; пусто без фильтра
+    qsizetype matchCount() const { return isActive() ? rows.size() : source->size(); }
+    qint64 lastSelectUs() const { return selectUs; }
+    // растёт при каждом изменении выборки (для кэшей, зависящих от фильтра)
+    quint64 generation() const { return gen; }
+
+    // Обход записей с учётом фильтра (без фильтра — все записи)
+    template <typename Fn>
+    void forEachReading(Fn fn) const
+    {
+        const RecordArena &arena = source->arena();
+        if (!isActive()) {
+            for (const PackedReading &r : arena) fn(r);
+            return;
+        }
+        for (quint32 i : rows) fn(arena[i]);
+    }
+
+    // То же с номером записи в исходной модели — для столбцов показателей
+    template <typename Fn>
+    void forEachRow(Fn fn) const
+    {
+        const RecordArena &arena = source->arena();
+        if (!isActive()) {
+            for (qsizetype i = 0; i < arena.size(); ++i) fn(i, arena[i]);
+            return;
+        }
+        for (quint32 i : rows) fn(qsizetype(i), arena[i]);
+    }
+
+    // Сводка по станциям с учётом фильтра (пустой список — по всем)
+    ReadingStats stats(const QVector<int> &stations) const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+signals:
+    void selectionChanged();
+
+private:
+    void reselect();
+    void onRowsInserted(const QModelIndex &parent, int first, int last);
+
+    RadiationModel *source;
+    StationRegistry *registry;
+    FilterExpression expr;
+    QVector<quint32> rows;
+    qint64 selectUs = 0;
+    quint64 gen = 0;
+};
+
+#endif
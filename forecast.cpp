@@ -0,0 +1,165 @@
+#include "forecast.h"
+#include "seasonal.h"
+#include "tracing.h"
+#include <QHash>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr double kAlphas[] = {0.05, 0.1, 0.2, 0.3, 0.5, 0.7, 0.9};
+constexpr double kBetas[]  = {0.0, 0.01, 0.05, 0.1, 0.2};
+constexpr double kGammas[] = {0.05, 0.1, 0.2, 0.4};
+
+struct HoltState {
+    double level = 0.0;
+    double slope = 0.0;
+    QVector<double> season;   // пусто для модели без сезонности
+};
+
+// Начальные уровень, наклон и сезонные индексы по первым двум циклам (или двум точкам).
+// Индексы считаются от линии тренда внутри цикла, уровень — на конец первого цикла,
+// с которого начинается сглаживание.
+HoltState initialState(const float *y, int n, int period)
+{
+    HoltState st;
+    if (period >= 2) {
+        double cycleMean[2] = {0.0, 0.0};
+        for (int c = 0; c < 2; ++c) {
+            for (int k = 0; k < period; ++k) cycleMean[c] += y[c * period + k];
+            cycleMean[c] /= period;
+        }
+        st.slope = (cycleMean[1] - cycleMean[0]) / period;
+        st.level = cycleMean[0] + st.slope * (period - 1) / 2.0;
+        st.season.resize(period);
+        double mean = 0.0;
+        for (int k = 0; k < period; ++k) {
+            const double drift = st.slope * (k - (period - 1) / 2.0);
+            st.season[k] = ((y[k] - cycleMean[0] - drift) + (y[period + k] - cycleMean[1] - drift)) / 2.0;
+            mean += st.season[k];
+        }
+        mean /= period;
+        for (double &v : st.season) v -= mean;
+    } else {
+        st.level = y[0];
+        st.slope = n > 1 ? y[1] - y[0] : 0.0;
+    }
+    return st;
+}
+
+// Один проход сглаживания; возвращает сумму квадратов ошибок на шаг вперёд
+double smooth(const float *y, int n, int period, double alpha, double beta, double gamma,
+              HoltState &st, int *steps)
+{
+    const bool seasonal = !st.season.isEmpty();
+    const int start = seasonal ? period : 1;
+    double sse = 0.0;
+    for (int t = start; t < n; ++t) {
+        const double s = seasonal ? st.season[t % period] : 0.0;
+        const double e = y[t] - (st.level + st.slope + s);
+        sse += e * e;
+        const double level = alpha * (y[t] - s) + (1.0 - alpha) * (st.level + st.slope);
+        st.slope = beta * (level - st.level) + (1.0 - beta) * st.slope;
+        st.level = level;
+        if (seasonal) st.season[t % period] = gamma * (y[t] - level) + (1.0 - gamma) * s;
+    }
+    *steps = std::max(0, n - start);
+    return sse;
+}
+
+} // namespace
+
+Forecast Forecaster::fit(const float *y, int n, int period, int horizon)
+{
+    Forecast f;
+    if (n < 3 || horizon <= 0) return f;
+    if (period < 2 || n < 2 * period) period = 0;
+
+    const HoltState init = initialState(y, n, period);
+    double best = std::numeric_limits<double>::max();
+    int bestSteps = 0;
+    HoltState bestState;
+    const int gammaCount = period ? int(std::size(kGammas)) : 1;
+    for (double a : kAlphas)
+        for (double b : kBetas)
+            for (int g = 0; g < gammaCount; ++g) {
+                const double c = period ? kGammas[g] : 0.0;
+                HoltState st = init;
+                int steps = 0;
+                const double sse = smooth(y, n, period, a, b, c, st, &steps);
+                if (sse < best) {
+                    best = sse;
+                    bestSteps = steps;
+                    bestState = std::move(st);
+                    f.alpha = a; f.beta = b; f.gamma = c;
+                }
+            }
+
+    f.period = period;
+    f.lastValue = y[n - 1];
+    f.sigma = bestSteps > 0 ? std::sqrt(best / bestSteps) : 0.0;
+    f.mean.resize(horizon);
+    f.lower.resize(horizon);
+    f.upper.resize(horizon);
+
+    // дисперсия на h шагов: σ²·(1 + Σ_{j<h} c_j²), c_j = α(1 + jβ) + γ·[j кратно периоду]
+    double spread = 1.0;
+    for (int h = 1; h <= horizon; ++h) {
+        const double s = period ? bestState.season[(n + h - 1) % period] : 0.0;
+        const double m = bestState.level + h * bestState.slope + s;
+        const double half = kZ95 * f.sigma * std::sqrt(spread);
+        f.mean[h - 1] = float(m);
+        f.lower[h - 1] = float(std::max(0.0, m - half));
+        f.upper[h - 1] = float(m + half);
+
+        const double cj = f.alpha * (1.0 + h * f.beta) + ((period && h % period == 0) ? f.gamma : 0.0);
+        spread += cj * cj;
+    }
+    return f;
+}
+
+QVector<Forecast> Forecaster::forecastAll(const QVector<StationReading> &readings, const QVector<int> &stations,
+                                          int horizon, int period)
+{
+    TRACE_SCOPE("forecast");
+
+    QHash<int, QVector<StationReading>> byStation;
+    for (int id : stations) byStation.insert(id, {});
+    for (const StationReading &r : readings) {
+        auto it = byStation.find(r.station);
+        if (it != byStation.end()) it->append(r);
+    }
+
+    QVector<Forecast> result(stations.size());
+    for (int i = 0; i < stations.size(); ++i) result[i].station = stations[i];
+
+    const auto &groups = byStation;   // только чтение из потоков
+    QtConcurrent::blockingMap(result, [&groups, horizon, period](Forecast &f) {
+        TRACE_SCOPE("forecast station");
+        const QVector<StationReading> &rows = groups.constFind(f.station).value();
+        if (rows.isEmpty()) return;
+
+        qint64 firstDay = 0;
+        const QVector<float> y = SeasonalAnalysis::dailyGrid(rows, &firstDay);
+        // подгонка только по хвосту ряда: дальняя история на недельный прогноз почти не влияет
+        const int n = std::min(int(y.size()), kFitDays);
+        const float *tail = y.constData() + (y.size() - n);
+
+        int p = period;
+        if (p == kAutoPeriod) {
+            const auto peaks = SeasonalAnalysis::periodogram(tail, n, 1);
+            p = peaks.isEmpty() ? 0 : int(std::lround(peaks.first().first));
+        }
+
+        const int station = f.station;
+        f = fit(tail, n, p, horizon);
+        f.station = station;
+        f.firstDay = firstDay + y.size();
+    });
+
+    result.erase(std::remove_if(result.begin(), result.end(), [](const Forecast &f) { return f.mean.isEmpty(); }),
+                 result.end());
+    return result;
+}
@@ -0,0 +1,42 @@
+#ifndef FORECAST_H
+#define FORECAST_H
+
+#include <QVector>
+#include "periodcompare.h"
+
+// Прогноз одной станции на horizon дней вперёд от последнего дня наблюдений
+struct Forecast {
+    int station = -1;
+    qint64 firstDay = 0;                 // первый прогнозный день
+    float lastValue = 0.0f;              // последнее значение суточной сетки (стык с графиком)
+    int period = 0;                      // сезонный период модели, дни (0 — модель Холта без сезонности)
+    double alpha = 0.0, beta = 0.0, gamma = 0.0;
+    double sigma = 0.0;                  // СКО ошибки прогноза на шаг
+    QVector<float> mean, lower, upper;   // точечный прогноз и границы 95%-го интервала
+
+    int horizon() const { return int(mean.size()); }
+};
+
+// ============================
+// Краткосрочный прогноз (Холт — Уинтерс)
+// ============================
+// Аддитивная модель: уровень + наклон + сезонность. Параметры сглаживания подбираются
+// перебором по сетке по сумме квадратов ошибок на шаг вперёд на последних kFitDays
+// днях суточной сетки. Интервал — ±1,96σ с ростом дисперсии по горизонту, как
+// у эквивалентной модели ETS(A,A,A). Все станции подгоняются одним пакетом параллельно.
+class Forecaster
+{
+public:
+    static constexpr int kHorizon = 7;
+    static constexpr int kFitDays = 730;
+    static constexpr int kAutoPeriod = 0;
+    static constexpr double kZ95 = 1.96;
+
+    static QVector<Forecast> forecastAll(const QVector<StationReading> &readings, const QVector<int> &stations,
+                                         int horizon = kHorizon, int period = kAutoPeriod);
+
+    // Подгонка по ряду y[0..n); period < 2 или n < 2·period — без сезонной составляющей
+    static Forecast fit(const float *y, int n, int period, int horizon);
+};
+
+#endif
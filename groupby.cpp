@@ -0,0 +1,102 @@
+#include "groupby.h"
+#include "tracing.h"
+#include <QThread>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// Меньше этого записи сводятся в одном потоке
+constexpr qsizetype kParallelRows = 1 << 18;
+
+using Partial = std::vector<StationSummary>;
+
+void summarizeRange(const RecordArena &records, const QVector<quint32> *rows,
+                    qsizetype from, qsizetype to, Partial &local)
+{
+    StationSummary *s = local.data();
+    const qsizetype stations = qsizetype(local.size());
+    if (rows) {
+        const quint32 *idx = rows->constData();
+        for (qsizetype i = from; i < to; ++i) {
+            const PackedReading &r = records[idx[i]];
+            if (r.station < stations) s[r.station].add(r.day, r.rad);
+        }
+        return;
+    }
+    // по блокам арены: внутри блока записи лежат подряд
+    for (qsizetype i = from; i < to; ) {
+        const qsizetype end = std::min(to, (i | RecordArena::kChunkMask) + 1);
+        const PackedReading *p = &records[i];
+        const qsizetype n = end - i;
+        for (qsizetype k = 0; k < n; ++k)
+            if (p[k].station < stations) s[p[k].station].add(p[k].day, p[k].rad);
+        i = end;
+    }
+}
+
+} // namespace
+
+void StationSummary::merge(const StationSummary &o)
+{
+    if (o.count == 0) return;
+    count += o.count;
+    sum += o.sum;
+    sumSq += o.sumSq;
+    min = std::min(min, o.min);
+    max = std::max(max, o.max);
+    // при равной дате побеждает более поздняя часть — как при последовательном проходе
+    if (o.lastDay >= lastDay) { lastDay = o.lastDay; lastRad = o.lastRad; }
+    for (int k = 0; k < kThresholds; ++k) above[k] += o.above[k];
+}
+
+double StationSummary::stddev() const
+{
+    if (count < 2) return 0.0;
+    const double m = mean();
+    return std::sqrt(std::max(0.0, (sumSq - sum * m) / double(count - 1)));
+}
+
+QVector<StationSummary> GroupBy::byStation(const RecordArena &records, const QVector<quint32> *rows,
+                                           int stationCount)
+{
+    TRACE_SCOPE("group by station");
+    const qsizetype n = rows ? rows->size() : records.size();
+    const int parts = n < kParallelRows ? 1 : std::max(1, QThread::idealThreadCount());
+
+    // 1. частичные сводки: по локальному массиву на диапазон записей
+    QVector<QPair<qsizetype, qsizetype>> ranges;
+    for (int k = 0; k < parts; ++k)
+        ranges.append({n * k / parts, n * (k + 1) / parts});
+    auto run = [&](const QPair<qsizetype, qsizetype> &r) {
+        TRACE_SCOPE("group by part");
+        Partial local(size_t(stationCount));
+        summarizeRange(records, rows, r.first, r.second, local);
+        return local;
+    };
+    const QList<Partial> partials = parts == 1 ? QList<Partial>{run(ranges.first())}
+                                               : QtConcurrent::blockingMapped(ranges, run);
+
+    // 2. слияние: каждый поток отвечает за свой диапазон станций
+    QVector<StationSummary> merged(stationCount);
+    QVector<QPair<int, int>> stationRanges;
+    const int mergeParts = parts == 1 ? 1 : std::min(parts, std::max(1, stationCount));
+    for (int k = 0; k < mergeParts; ++k)
+        stationRanges.append({int(qint64(stationCount) * k / mergeParts), int(qint64(stationCount) * (k + 1) / mergeParts)});
+    StationSummary *out0 = merged.data();
+    auto mergeRange = [&partials, out0](const QPair<int, int> &r) {
+        for (int id = r.first; id < r.second; ++id) {
+            StationSummary &out = out0[id];
+            out.station = id;
+            for (const Partial &p : partials) out.merge(p[size_t(id)]);
+        }
+    };
+    if (mergeParts == 1) mergeRange(stationRanges.first());
+    else QtConcurrent::blockingMap(stationRanges, mergeRange);
+
+    merged.erase(std::remove_if(merged.begin(), merged.end(), [](const StationSummary &s) { return s.count == 0; }),
+                 merged.end());
+    return merged;
+}
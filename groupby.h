@@ -0,0 +1,54 @@
+#ifndef GROUPBY_H
+#define GROUPBY_H
+
+#include <QVector>
+#include <algorithm>
+#include <array>
+#include <limits>
+#include "radiationmodel.h"
+
+// Сводка одной станции: сворачивается по записям и складывается из частичных сводок
+struct StationSummary {
+    static constexpr int kThresholds = RadiationModel::kBandCount - 1;   // пороги kBandLimits
+
+    int station = -1;
+    qint64 count = 0;
+    double sum = 0, sumSq = 0;
+    int min = std::numeric_limits<int>::max();
+    int max = std::numeric_limits<int>::min();
+    qint64 lastDay = std::numeric_limits<qint64>::min();   // последнее показание по дате
+    int lastRad = 0;
+    std::array<qint64, kThresholds> above{};               // above[k] — показаний выше kBandLimits[k]
+
+    void add(qint64 day, int rad)
+    {
+        ++count;
+        sum += rad;
+        sumSq += double(rad) * rad;
+        min = std::min(min, rad);
+        max = std::max(max, rad);
+        if (day >= lastDay) { lastDay = day; lastRad = rad; }
+        for (int k = 0; k < kThresholds && rad > RadiationModel::kBandLimits[k]; ++k) ++above[k];
+    }
+    void merge(const StationSummary &o);
+
+    double mean() const { return count ? sum / count : 0.0; }
+    double stddev() const;
+};
+
+// ============================
+// Сводка по всем станциям
+// ============================
+// Один проход по записям. Id станций плотные, поэтому «хеш» группировки — сам id:
+// каждый поток сворачивает свой диапазон записей в локальный массив частичных сводок,
+// затем массивы сливаются параллельно по диапазонам станций, без общих блокировок.
+class GroupBy
+{
+public:
+    // rows — номера выбранных записей (nullptr — все), stationCount — сколько id в реестре.
+    // В результате только станции, у которых есть показания, по возрастанию id.
+    static QVector<StationSummary> byStation(const RecordArena &records, const QVector<quint32> *rows,
+                                             int stationCount);
+};
+
+#endif
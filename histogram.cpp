@@ -0,0 +1,109 @@
+#include "histogram.h"
+#include "tracing.h"
+#include <QThread>
+#include <QtConcurrent>
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+// Меньше этого записи считаются в одном потоке
+constexpr qsizetype kParallelRows = 1 << 18;
+
+using LocalCounts = std::vector<quint32>;
+
+template <bool AllStations>
+void countRange(const RecordArena &records, const QVector<quint32> *rows, const std::vector<bool> &wanted,
+                qsizetype from, qsizetype to, LocalCounts &local)
+{
+    quint32 *c = local.data();
+    if (rows) {
+        const quint32 *idx = rows->constData();
+        for (qsizetype i = from; i < to; ++i) {
+            const PackedReading &r = records[idx[i]];
+            if (AllStations || wanted[r.station]) ++c[r.rad];
+        }
+        return;
+    }
+    // по блокам арены: внутри блока записи лежат подряд
+    for (qsizetype s = from; s < to; ) {
+        const qsizetype end = std::min(to, (s | RecordArena::kChunkMask) + 1);
+        const PackedReading *p = &records[s];
+        const qsizetype n = end - s;
+        for (qsizetype i = 0; i < n; ++i)
+            if (AllStations || wanted[p[i].station]) ++c[p[i].rad];
+        s = end;
+    }
+}
+
+} // namespace
+
+QVector<qint64> ValueCounts::bins(int width) const
+{
+    width = std::max(1, width);
+    QVector<qint64> out(counts.isEmpty() ? 0 : maxValue() / width + 1, 0);
+    for (int v = 0; v < counts.size(); ++v) out[v / width] += counts[v];
+    return out;
+}
+
+std::array<qint64, RadiationModel::kBandCount> ValueCounts::bands() const
+{
+    std::array<qint64, RadiationModel::kBandCount> out{};
+    for (int v = 0; v < counts.size(); ++v) out[RadiationModel::band(v)] += counts[v];
+    return out;
+}
+
+int ValueCounts::quantile(double q) const
+{
+    const qint64 target = qint64(q * double(total));
+    qint64 acc = 0;
+    for (int v = 0; v < counts.size(); ++v) {
+        acc += counts[v];
+        if (acc > target) return v;
+    }
+    return maxValue();
+}
+
+ValueCounts HistogramBuilder::count(const RecordArena &records, const QVector<quint32> *rows,
+                                    const QVector<int> &stations)
+{
+    TRACE_SCOPE("histogram");
+    std::vector<bool> wanted;
+    if (!stations.isEmpty()) {
+        wanted.assign(RadiationModel::kMaxStations, false);
+        for (int id : stations)
+            if (id >= 0 && id < RadiationModel::kMaxStations) wanted[size_t(id)] = true;
+    }
+    const bool all = stations.isEmpty();
+    const qsizetype n = rows ? rows->size() : records.size();
+
+    auto run = [&](qsizetype from, qsizetype to) {
+        LocalCounts local(size_t(RadiationModel::kMaxRadiation) + 1, 0);
+        if (all) countRange<true>(records, rows, wanted, from, to, local);
+        else countRange<false>(records, rows, wanted, from, to, local);
+        return local;
+    };
+
+    // диапазоны по числу потоков: локальных счётчиков столько же, слияние — T × 64К сложений
+    QVector<QPair<qsizetype, qsizetype>> ranges;
+    const int parts = n < kParallelRows ? 1 : std::max(1, QThread::idealThreadCount());
+    for (int k = 0; k < parts; ++k)
+        ranges.append({n * k / parts, n * (k + 1) / parts});
+    const QList<LocalCounts> locals = parts == 1
+        ? QList<LocalCounts>{run(0, n)}
+        : QtConcurrent::blockingMapped(ranges, [&run](const QPair<qsizetype, qsizetype> &r) {
+              TRACE_SCOPE("histogram part");
+              return run(r.first, r.second);
+          });
+
+    ValueCounts out;
+    std::vector<qint64> merged(size_t(RadiationModel::kMaxRadiation) + 1, 0);
+    for (const LocalCounts &local : locals)
+        for (size_t v = 0; v < local.size(); ++v) merged[v] += local[v];
+
+    int top = RadiationModel::kMaxRadiation;
+    while (top >= 0 && merged[size_t(top)] == 0) --top;
+    out.counts = QVector<qint64>(merged.begin(), merged.begin() + (top + 1));
+    for (qint64 c : out.counts) out.total += c;
+    return out;
+}
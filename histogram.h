@@ -0,0 +1,46 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <QVector>
+#include <array>
+#include "radiationmodel.h"
+
+// ============================
+// Распределение показаний
+// ============================
+// Значения целые (0…65535 мкР/ч), поэтому один проход считает показания для
+// каждого значения, а корзины любой ширины и полосы уровней собираются уже из
+// этих счётчиков — перетаскивание ширины корзины не трогает записи.
+struct ValueCounts {
+    QVector<qint64> counts;   // counts[v] — число показаний со значением v, до максимального
+    qint64 total = 0;
+
+    int maxValue() const { return int(counts.size()) - 1; }
+
+    // Одно показание — для обхода без арены (страницы постраничного файла)
+    void add(int value)
+    {
+        if (value >= counts.size()) counts.resize(value + 1, 0);
+        ++counts[value];
+        ++total;
+    }
+    bool isEmpty() const { return total == 0; }
+
+    // Корзины [k·width, (k+1)·width), начиная с нуля и до максимального значения
+    QVector<qint64> bins(int width) const;
+    // Показаний в полосах RadiationModel::kBandLimits: ≤15, ≤30, ≤60, >60
+    std::array<qint64, RadiationModel::kBandCount> bands() const;
+    // Значение, не превышаемое долью q показаний
+    int quantile(double q) const;
+};
+
+class HistogramBuilder
+{
+public:
+    // rows — номера выбранных записей (nullptr — все записи), stations — пусто для всех станций.
+    // Каждый поток считает свой локальный счётчик по своему диапазону, затем счётчики сливаются.
+    static ValueCounts count(const RecordArena &records, const QVector<quint32> *rows,
+                             const QVector<int> &stations);
+};
+
+#endif
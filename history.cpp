@@ -0,0 +1,72 @@
+#include "history.h"
+#include "radiationmodel.h"
+#include "tracing.h"
+#include <QSet>
+
+DatasetHistory::DatasetHistory(RadiationModel *model) : model(model)
+{
+}
+
+void DatasetHistory::record(const QString &label)
+{
+    undoStack.append({model->snapshot(), label});
+    redoStack.clear();
+    enforceBudget();
+}
+
+bool DatasetHistory::undo(bool keepRedo)
+{
+    if (undoStack.isEmpty()) return false;
+    TRACE_SCOPE("undo");
+    const Entry entry = undoStack.takeLast();
+    if (keepRedo) redoStack.append({model->snapshot(), entry.label});
+    model->restore(*entry.data);
+    return true;
+}
+
+bool DatasetHistory::redo()
+{
+    if (redoStack.isEmpty()) return false;
+    TRACE_SCOPE("redo");
+    const Entry entry = redoStack.takeLast();
+    undoStack.append({model->snapshot(), entry.label});
+    model->restore(*entry.data);
+    return true;
+}
+
+void DatasetHistory::clear()
+{
+    undoStack.clear();
+    redoStack.clear();
+}
+
+qint64 DatasetHistory::overheadBytes() const
+{
+    // блок, общий у нескольких версий или с текущим набором, считается один раз или не считается вовсе
+    QSet<const void *> seen;
+    model->snapshot()->forEachChunk([&seen](const void *chunk, qsizetype) { seen.insert(chunk); });
+    qint64 total = 0;
+    auto count = [&](const QVector<Entry> &stack) {
+        for (const Entry &e : stack) {
+            e.data->forEachChunk([&](const void *chunk, qsizetype bytes) {
+                if (!seen.contains(chunk)) {
+                    seen.insert(chunk);
+                    total += bytes;
+                }
+            });
+        }
+    };
+    count(undoStack);
+    count(redoStack);
+    return total;
+}
+
+void DatasetHistory::enforceBudget()
+{
+    while (versions() > kMaxVersions) {
+        if (!undoStack.isEmpty()) undoStack.removeFirst();
+        else redoStack.removeFirst();
+    }
+    // самые старые версии отмены уходят первыми; последнюю правку отменить можно всегда
+    while (undoStack.size() > 1 && overheadBytes() > kMaxOverheadBytes) undoStack.removeFirst();
+}
@@ -0,0 +1,56 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <QString>
+#include <QVector>
+#include <memory>
+
+class RadiationModel;
+struct DatasetSnapshot;
+
+// ============================
+// История правок набора
+// ============================
+// Перед каждой правкой (добавление, загрузка, сортировка) запоминается снимок
+// RadiationModel. Снимки делят неизменённые блоки записей и показателей с
+// текущим набором, поэтому версия стоит столько, сколько блоков правка
+// скопировала: добавление записи — один блок, сортировка или загрузка — весь набор.
+// Число версий и память сверх текущего набора ограничены; при превышении
+// отбрасываются самые старые версии отмены.
+class DatasetHistory
+{
+public:
+    static constexpr int kMaxVersions = 64;
+    static constexpr qint64 kMaxOverheadBytes = qint64(512) << 20;
+
+    explicit DatasetHistory(RadiationModel *model);
+
+    // Запомнить набор перед правкой label; ветка повтора сбрасывается
+    void record(const QString &label);
+    // keepRedo = false — текущий набор не из records (постраничный файл, база) и в повтор не попадает
+    bool undo(bool keepRedo = true);
+    bool redo();
+    void clear();
+
+    bool canUndo() const { return !undoStack.isEmpty(); }
+    bool canRedo() const { return !redoStack.isEmpty(); }
+    QString undoLabel() const { return canUndo() ? undoStack.last().label : QString(); }
+    QString redoLabel() const { return canRedo() ? redoStack.last().label : QString(); }
+
+    int versions() const { return int(undoStack.size() + redoStack.size()); }
+    // Байт в блоках, которые держит только история (общие с текущим набором не считаются)
+    qint64 overheadBytes() const;
+
+private:
+    struct Entry {
+        std::shared_ptr<const DatasetSnapshot> data;
+        QString label;
+    };
+    void enforceBudget();
+
+    RadiationModel *model;
+    QVector<Entry> undoStack;   // последняя — ближайшая отмена
+    QVector<Entry> redoStack;   // последняя — ближайший повтор
+};
+
+#endif
@@ -0,0 +1,548 @@
+#include "jsonpager.h"
+#include "stationregistry.h"
+#include "tracing.h"
+#include <QFileInfo>
+#include <QDataStream>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDate>
+#include <QSet>
+#include <QElapsedTimer>
+#include <QtConcurrent>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <vector>
+
+using namespace Qt::StringLiterals;
+
+namespace {
+
+constexpr quint32 kSidecarMagic = 0x58444952;   // "RIDX"
+constexpr quint32 kSidecarVersion = 2;          // 2: станции, показатели и диапазон дат
+constexpr qint64 kReadChunk = 4 << 20;
+
+static_assert(JsonPageIndex::kPageRows <= FilterExpression::kBatch, "страница фильтруется одним пакетом");
+
+// Разметка объектов на заданной глубине вложенности с учётом строк и экранирования
+struct JsonScanner {
+    int depth = 0;
+    bool inString = false;
+    bool escape = false;
+
+    // onStart(смещение '{'), onEnd(смещение за '}') для объектов, открытых на глубине objectDepth
+    template <typename OnStart, typename OnEnd>
+    void feed(const char *p, qint64 n, qint64 base, int objectDepth, OnStart onStart, OnEnd onEnd)
+    {
+        for (qint64 i = 0; i < n; ++i) {
+            const char c = p[i];
+            if (inString) {
+                if (escape) escape = false;
+                else if (c == '\\') escape = true;
+                else if (c == '"') inString = false;
+                continue;
+            }
+            switch (c) {
+            case '"': inString = true; break;
+            case '{':
+                if (depth == objectDepth) onStart(base + i);
+                ++depth;
+                break;
+            case '[': ++depth; break;
+            case '}':
+                --depth;
+                if (depth == objectDepth) onEnd(base + i + 1);
+                break;
+            case ']': --depth; break;
+            default: break;
+            }
+        }
+    }
+};
+
+// fn(объект) для каждой записи фрагмента, не больше limit
+void scanObjects(const QByteArray &bytes, int limit, const std::function<void(const QJsonObject &)> &fn)
+{
+    JsonScanner scanner;
+    int row = 0;
+    qint64 start = 0;
+    scanner.feed(bytes.constData(), bytes.size(), 0, 0,
+                 [&start](qint64 at) { start = at; },
+                 [&](qint64 end) {
+                     if (row >= limit) return;
+                     fn(QJsonDocument::fromJson(QByteArray::fromRawData(bytes.constData() + start, end - start)).object());
+                     ++row;
+                 });
+}
+
+// Поля записи без обращения к реестру — те же правила, что у RadiationModel::readJsonRow
+bool readFields(const QJsonObject &obj, QString *city, qint64 *day, int *rad)
+{
+    *city = obj.value("city"_L1).toString();
+    const QDate date = QDate::fromString(obj.value("datetime"_L1).toString(), "yyyy-MM-dd");
+    if (city->isEmpty() || !date.isValid()) return false;
+    *day = date.toJulianDay();
+    *rad = obj.value("radiation"_L1).toInt();
+    return true;
+}
+
+void writeStation(QDataStream &ds, const JsonStationInfo &st)
+{
+    const ReadingStats &s = st.stats;
+    ds << st.name << st.hasCoord << st.pos.lat << st.pos.lon
+       << s.count << s.sum << s.sumSq << qint32(s.min) << qint32(s.max) << s.sx << s.sxx << s.sxy;
+}
+
+void readStation(QDataStream &ds, JsonStationInfo *st)
+{
+    ReadingStats &s = st->stats;
+    qint32 lo = 0, hi = 0;
+    ds >> st->name >> st->hasCoord >> st->pos.lat >> st->pos.lon
+       >> s.count >> s.sum >> s.sumSq >> lo >> hi >> s.sx >> s.sxx >> s.sxy;
+    s.min = lo;
+    s.max = hi;
+}
+
+} // namespace
+
+// ============================
+// JsonPageIndex
+// ============================
+
+bool JsonPageIndex::build(const QString &fileName, JsonPageIndex *out, QString *error,
+                          const std::atomic<bool> *cancel)
+{
+    TRACE_SCOPE("json index");
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+
+    JsonPageIndex idx;
+    const QFileInfo info(fileName);
+    idx.fileSize = info.size();
+    idx.modifiedMs = info.lastModified().toMSecsSinceEpoch();
+
+    QHash<QString, int> stationSlot;
+    QSet<QString> metricSet;
+    auto indexRow = [&](const QJsonObject &obj) {
+        QString city;
+        qint64 day = 0;
+        int rad = 0;
+        if (!readFields(obj, &city, &day, &rad)) return;
+        auto slot = stationSlot.constFind(city);
+        if (slot == stationSlot.cend()) {
+            slot = stationSlot.insert(city, int(idx.stations.size()));
+            idx.stations.append({city});
+        }
+        JsonStationInfo &st = idx.stations[*slot];
+        // координаты станции — из последней записи с ними, как при полной загрузке
+        if (obj.contains("lat"_L1) && obj.contains("lon"_L1)) {
+            st.hasCoord = true;
+            st.pos = { obj.value("lat"_L1).toDouble(), obj.value("lon"_L1).toDouble() };
+        }
+        for (auto it = obj.constBegin(); it != obj.constEnd(); ++it) {
+            const QString key = it.key();
+            if (it.value().isDouble() && key != "radiation"_L1 && key != "lat"_L1 && key != "lon"_L1)
+                metricSet.insert(key);
+        }
+        if (rad < 0 || rad > RadiationModel::kMaxRadiation) return;
+        st.stats.add(day, rad);
+        if (idx.lastDay < idx.firstDay) idx.firstDay = idx.lastDay = day;
+        idx.firstDay = std::min(idx.firstDay, day);
+        idx.lastDay = std::max(idx.lastDay, day);
+    };
+
+    // запись может начаться в одном блоке чтения и закончиться в следующем:
+    // её начало переносится в буфер вместе со следующим блоком
+    JsonScanner scanner;
+    QByteArray buffer;
+    qint64 bufferBase = 0;     // смещение buffer[0] в файле
+    qint64 objectStart = -1;   // начало незакрытой записи верхнего массива
+    qint64 lastEnd = 0;
+    while (!file.atEnd()) {
+        if (cancel && cancel->load(std::memory_order_relaxed)) {
+            if (error) *error = u"Прервано"_s;
+            return false;
+        }
+        const QByteArray chunk = file.read(kReadChunk);
+        if (chunk.isEmpty()) {
+            if (error) *error = file.errorString();
+            return false;
+        }
+        const qint64 chunkBase = bufferBase + buffer.size();
+        buffer += chunk;
+        scanner.feed(chunk.constData(), chunk.size(), chunkBase, 1,
+                     [&](qint64 at) {
+                         if (idx.records % kPageRows == 0) idx.pageOffsets.append(at);
+                         ++idx.records;
+                         objectStart = at;
+                     },
+                     [&](qint64 at) {
+                         lastEnd = at;
+                         if (objectStart < 0) return;   // лишняя '}' в испорченном файле
+                         const char *p = buffer.constData() + (objectStart - bufferBase);
+                         indexRow(QJsonDocument::fromJson(QByteArray::fromRawData(p, at - objectStart)).object());
+                         objectStart = -1;
+                     });
+        const qint64 keep = objectStart >= 0 ? objectStart : bufferBase + buffer.size();
+        buffer.remove(0, keep - bufferBase);
+        bufferBase = keep;
+    }
+    if (idx.records > 0) idx.pageOffsets.append(lastEnd);
+
+    idx.metricKeys = QStringList(metricSet.cbegin(), metricSet.cend());
+    idx.metricKeys.sort();
+    *out = idx;
+    return true;
+}
+
+bool JsonPageIndex::loadSidecar(const QString &fileName)
+{
+    QFile file(sidecarName(fileName));
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    QDataStream ds(&file);
+    ds.setVersion(QDataStream::Qt_6_0);
+    ds.setByteOrder(QDataStream::LittleEndian);
+    quint32 magic = 0, version = 0;
+    JsonPageIndex idx;
+    ds >> magic >> version;
+    if (ds.status() != QDataStream::Ok || magic != kSidecarMagic || version != kSidecarVersion) return false;
+    qint32 nStations = 0;
+    ds >> idx.fileSize >> idx.modifiedMs >> idx.records >> idx.pageOffsets >> nStations;
+    // у каждой станции есть хотя бы одна запись: большее число — испорченный индекс
+    const qint64 pages = (idx.records + kPageRows - 1) / kPageRows;
+    if (ds.status() != QDataStream::Ok || nStations < 0 || nStations > idx.records
+        || idx.pageOffsets.size() != (pages > 0 ? pages + 1 : 0))
+        return false;
+    idx.stations.resize(nStations);
+    for (JsonStationInfo &st : idx.stations) readStation(ds, &st);
+    ds >> idx.metricKeys >> idx.firstDay >> idx.lastDay;
+    if (ds.status() != QDataStream::Ok) return false;
+
+    // индекс устарел, если файл данных с тех пор менялся
+    const QFileInfo info(fileName);
+    if (idx.fileSize != info.size() || idx.modifiedMs != info.lastModified().toMSecsSinceEpoch()) return false;
+
+    *this = idx;
+    return true;
+}
+
+bool JsonPageIndex::saveSidecar(const QString &fileName) const
+{
+    QSaveFile file(sidecarName(fileName));
+    if (!file.open(QIODevice::WriteOnly)) return false;
+
+    QDataStream ds(&file);
+    ds.setVersion(QDataStream::Qt_6_0);
+    ds.setByteOrder(QDataStream::LittleEndian);
+    ds << kSidecarMagic << kSidecarVersion << fileSize << modifiedMs << records << pageOffsets
+       << qint32(stations.size());
+    for (const JsonStationInfo &st : stations) writeStation(ds, st);
+    ds << metricKeys << firstDay << lastDay;
+    return ds.status() == QDataStream::Ok && file.commit();
+}
+
+// ============================
+// JsonPageSource
+// ============================
+
+bool JsonPageSource::readPage(QFile &file, const JsonPageIndex &index, int p, QByteArray *bytes)
+{
+    if (p < 0 || p >= index.pageCount()) return false;
+    const qint64 from = index.pageOffsets[p];
+    const qint64 to = index.pageOffsets[p + 1];
+    if (!file.seek(from)) return false;
+    *bytes = file.read(to - from);
+    return bytes->size() == to - from;
+}
+
+void JsonPageSource::parsePage(const QByteArray &bytes, int p, JsonPage *out) const
+{
+    const int expected = int(std::min<qint64>(JsonPageIndex::kPageRows, index.records - qint64(p) * JsonPageIndex::kPageRows));
+    out->rows.fill(PackedReading{0, 0, 0}, expected);
+    out->valid.fill(false, expected);
+
+    int row = 0;
+    scanObjects(bytes, expected, [&](const QJsonObject &obj) {
+        QString city;
+        qint64 day = 0;
+        int rad = 0;
+        if (readFields(obj, &city, &day, &rad)) {
+            const int station = stationIds.value(city, -1);
+            if (RadiationModel::isStorable(station, rad)) {
+                out->rows[row] = PackedReading{quint16(station), quint16(rad), qint32(day)};
+                out->valid[row] = true;
+            }
+        }
+        ++row;
+    });
+}
+
+bool JsonPageSource::forEachPage(const std::function<void(qint64, const JsonPage &)> &fn) const
+{
+    TRACE_SCOPE("json scan");
+    QFile in(path);
+    if (!in.open(QIODevice::ReadOnly)) return false;
+
+    // с фильтром читаются только страницы, где есть строки выборки
+    QVector<int> wanted;
+    if (filtered) {
+        for (quint32 row : rows) {
+            if (row >= index.records) break;
+            const int p = int(row / JsonPageIndex::kPageRows);
+            if (wanted.isEmpty() || wanted.last() != p) wanted.append(p);
+        }
+    } else {
+        wanted.resize(index.pageCount());
+        std::iota(wanted.begin(), wanted.end(), 0);
+    }
+
+    QVector<QByteArray> bytes;
+    QVector<JsonPage> parsed;
+    QVector<int> order;
+    for (qsizetype at = 0; at < wanted.size(); at += kScanWindow) {
+        const int n = int(std::min<qsizetype>(kScanWindow, wanted.size() - at));
+        bytes.resize(n);
+        parsed.resize(n);
+        order.resize(n);
+        std::iota(order.begin(), order.end(), 0);
+        for (int k = 0; k < n; ++k)
+            if (!readPage(in, index, wanted[at + k], &bytes[k])) return false;
+        // файл читается по порядку в этом потоке, разбор окна — параллельно
+        QtConcurrent::blockingMap(order, [&](int k) { parsePage(bytes[k], wanted[at + k], &parsed[k]); });
+        for (int k = 0; k < n; ++k) fn(qint64(wanted[at + k]) * JsonPageIndex::kPageRows, parsed[k]);
+    }
+    return true;
+}
+
+bool JsonPageSource::forEachReading(const QVector<int> &stations,
+                                    const std::function<void(const PackedReading &)> &fn) const
+{
+    std::vector<bool> want;
+    if (!stations.isEmpty()) {
+        want.assign(RadiationModel::kMaxStations, false);
+        for (int id : stations)
+            if (id >= 0 && id < RadiationModel::kMaxStations) want[size_t(id)] = true;
+    }
+    auto deliver = [&](const PackedReading &r) {
+        if (want.empty() || want[r.station]) fn(r);
+    };
+
+    const quint32 *sel = rows.constData();
+    const quint32 *selEnd = sel + rows.size();
+    const bool ok = forEachPage([&](qint64 first, const JsonPage &pg) {
+        if (!filtered) {
+            for (int i = 0; i < pg.rows.size(); ++i)
+                if (pg.valid[i]) deliver(pg.rows[i]);
+            return;
+        }
+        const qint64 end = first + pg.rows.size();
+        while (sel != selEnd && *sel < first) ++sel;
+        for (; sel != selEnd && *sel < end; ++sel)
+            if (pg.valid[*sel - first]) deliver(pg.rows[*sel - first]);
+    });
+    if (!ok) return false;
+
+    // добавленные записи идут после записей файла, их номера строк — тоже
+    if (!filtered) {
+        for (const PackedReading &r : appended) deliver(r);
+        return true;
+    }
+    while (sel != selEnd && *sel < index.records) ++sel;
+    for (; sel != selEnd; ++sel) deliver(appended[qsizetype(*sel - index.records)]);
+    return true;
+}
+
+bool JsonPageSource::forEachObject(const std::function<void(const QJsonObject &)> &fn) const
+{
+    QFile in(path);
+    if (!in.open(QIODevice::ReadOnly)) return false;
+    QByteArray bytes;
+    for (int p = 0; p < index.pageCount(); ++p) {
+        if (!readPage(in, index, p, &bytes)) return false;
+        scanObjects(bytes, JsonPageIndex::kPageRows, fn);
+    }
+    return true;
+}
+
+// ============================
+// PagedJsonModel
+// ============================
+
+PagedJsonModel::PagedJsonModel(StationRegistry *registry, QObject *parent)
+    : QAbstractTableModel(parent), registry(registry)
+{
+}
+
+bool PagedJsonModel::open(const QString &fileName, const JsonPageIndex &idx, QString *error)
+{
+    beginResetModel();
+    pages.clear();
+    file.close();
+    file.setFileName(fileName);
+    const bool ok = file.open(QIODevice::ReadOnly);
+    src = JsonPageSource();
+    fileStation.clear();
+    filterExpr = FilterExpression();
+    selectUs = 0;
+    if (ok) {
+        src.path = fileName;
+        src.index = idx;
+        registry->beginUpdate();
+        fileStation.reserve(idx.stations.size());
+        for (const JsonStationInfo &st : idx.stations) {
+            const int id = registry->intern(st.name);
+            if (st.hasCoord) registry->setCoord(id, st.pos);
+            fileStation.append(id);
+            src.stationIds.insert(st.name, id);
+        }
+        registry->endUpdate();
+    }
+    endResetModel();
+
+    if (!ok && error) *error = file.errorString();
+    return ok;
+}
+
+bool PagedJsonModel::setFilter(const FilterExpression &expr, QString *error)
+{
+    TRACE_SCOPE("json filter");
+    QElapsedTimer timer;
+    timer.start();
+
+    // выборка считается по всем записям, а не по текущей выборке
+    QVector<quint32> selected;
+    if (!expr.isEmpty()) {
+        const JsonPageSource all = src.unfiltered();
+        std::vector<uchar> mask(FilterExpression::kBatch);
+        const bool ok = all.forEachPage([&](qint64 first, const JsonPage &pg) {
+            const int n = int(pg.rows.size());
+            expr.evaluate(pg.rows.constData(), n, mask.data());
+            for (int i = 0; i < n; ++i)
+                if (mask[i] && pg.valid[i]) selected.append(quint32(first + i));
+        });
+        if (!ok) {
+            if (error) *error = u"Не удалось прочитать файл "_s + src.path;
+            return false;
+        }
+        for (qsizetype from = 0; from < src.appended.size(); from += FilterExpression::kBatch) {
+            const int n = int(std::min<qsizetype>(FilterExpression::kBatch, src.appended.size() - from));
+            expr.evaluate(src.appended.constData() + from, n, mask.data());
+            for (int i = 0; i < n; ++i)
+                if (mask[i]) selected.append(quint32(src.index.records + from + i));
+        }
+    }
+
+    beginResetModel();
+    filterExpr = expr;
+    src.rows = selected;
+    src.filtered = !expr.isEmpty();
+    endResetModel();
+    selectUs = timer.nsecsElapsed() / 1000;
+    return true;
+}
+
+bool PagedJsonModel::append(int station, qint64 day, int rad)
+{
+    if (!RadiationModel::isStorable(station, rad)) return false;
+    const PackedReading r{quint16(station), quint16(rad), qint32(day)};
+    const qint64 row = src.recordCount();
+
+    uchar match = 1;
+    if (src.filtered) filterExpr.evaluate(&r, 1, &match);
+    const int at = rowCount();
+    if (match) beginInsertRows(QModelIndex(), at, at);
+    src.appended.append(r);
+    if (match && src.filtered) src.rows.append(quint32(row));
+    if (match) endInsertRows();
+    return true;
+}
+
+ReadingStats PagedJsonModel::stationStats(const QVector<int> &stations) const
+{
+    const QSet<int> wanted(stations.cbegin(), stations.cend());
+    const bool all = wanted.isEmpty();
+    ReadingStats out;
+    for (qsizetype k = 0; k < fileStation.size(); ++k)
+        if (all || wanted.contains(fileStation[k])) out.merge(src.index.stations[k].stats);
+    for (const PackedReading &r : src.appended)
+        if (all || wanted.contains(r.station)) out.add(r.day, r.rad);
+    return out;
+}
+
+qint64 PagedJsonModel::stationRecords(int station) const
+{
+    qint64 n = 0;
+    for (qsizetype k = 0; k < fileStation.size(); ++k)
+        if (fileStation[k] == station) n += src.index.stations[k].stats.count;
+    for (const PackedReading &r : src.appended) n += r.station == station;
+    return n;
+}
+
+int PagedJsonModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(std::min<qint64>(matchCount(), std::numeric_limits<int>::max()));
+}
+
+int PagedJsonModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : 3;
+}
+
+QVariant PagedJsonModel::data(const QModelIndex &idx, int role) const
+{
+    if (!idx.isValid()) return QVariant();
+    qint64 row = idx.row();
+    if (src.filtered) {
+        if (row >= src.rows.size()) return QVariant();
+        row = src.rows[row];
+    }
+    PackedReading r;
+    if (!rowAt(row, &r)) return QVariant();
+    return RadiationModel::cellData(registry, r, idx.column(), role);
+}
+
+QVariant PagedJsonModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    return RadiationModel::headerText(section, orientation, role);
+}
+
+bool PagedJsonModel::rowAt(qint64 row, PackedReading *out) const
+{
+    if (row >= src.index.records) {
+        const qint64 i = row - src.index.records;
+        if (i >= src.appended.size()) return false;
+        *out = src.appended[i];
+        return true;
+    }
+    const JsonPage *pg = page(int(row / JsonPageIndex::kPageRows));
+    const int i = int(row % JsonPageIndex::kPageRows);
+    if (!pg || i >= pg->rows.size() || !pg->valid[i]) return false;
+    *out = pg->rows[i];
+    return true;
+}
+
+const JsonPage *PagedJsonModel::page(int p) const
+{
+    if (const JsonPage *cached = pages.object(p)) return cached;
+
+    TRACE_SCOPE("json page");
+    QByteArray bytes;
+    if (!JsonPageSource::readPage(file, src.index, p, &bytes)) return nullptr;
+    auto *pg = new JsonPage;
+    src.parsePage(bytes, p, pg);
+    pages.insert(p, pg);   // вытесняет самую давнюю страницу
+    return pages.object(p);
+}
+
+qint64 PagedJsonModel::residentBytes() const
+{
+    return qint64(pages.size()) * JsonPageIndex::kPageRows * qint64(sizeof(PackedReading) + sizeof(bool))
+         + src.index.pageOffsets.size() * qint64(sizeof(qint64))
+         + src.rows.size() * qint64(sizeof(quint32))
+         + src.appended.size() * qint64(sizeof(PackedReading));
+}
@@ -0,0 +1,173 @@
+#ifndef JSONPAGER_H
+#define JSONPAGER_H
+
+#include <QAbstractTableModel>
+#include <QVector>
+#include <QHash>
+#include <QStringList>
+#include <QFile>
+#include <QCache>
+#include <atomic>
+#include <functional>
+#include "radiationmodel.h"
+#include "resultcache.h"
+#include "filterexpr.h"
+
+class StationRegistry;
+
+// Станция постраничного файла: имя, последние координаты и сводка по всем её записям
+struct JsonStationInfo {
+    QString name;
+    bool hasCoord = false;
+    Coord pos{0.0, 0.0};
+    ReadingStats stats;   // только корректные записи (дата разобрана, радиация в 0…kMaxRadiation)
+};
+
+// ============================
+// Индекс страниц JSON-файла
+// ============================
+// Один последовательный проход по файлу запоминает смещение каждой kPageRows-й
+// записи верхнего массива — ~8 байт на страницу, а не на запись. Тот же проход
+// разбирает записи: станции файла, их координаты и сводки попадают в индекс, поэтому
+// страницы потом только сверяют имя с готовой таблицей, а сводки без фильтра не
+// требуют чтения файла. Индекс хранится рядом с файлом (<файл>.ridx) и годен, пока
+// совпадают размер и время изменения.
+struct JsonPageIndex {
+    static constexpr int kPageRows = 4096;
+
+    qint64 fileSize = 0;
+    qint64 modifiedMs = 0;
+    qint64 records = 0;
+    QVector<qint64> pageOffsets;   // начало первой записи каждой страницы + конец последней записи
+    QVector<JsonStationInfo> stations;   // в порядке первого появления в файле
+    QStringList metricKeys;              // числовые ключи записей сверх radiation/lat/lon
+    qint64 firstDay = 0;                 // диапазон дат корректных записей; lastDay < firstDay — их нет
+    qint64 lastDay = -1;
+
+    int pageCount() const { return pageOffsets.isEmpty() ? 0 : int(pageOffsets.size()) - 1; }
+
+    static QString sidecarName(const QString &fileName) { return fileName + QLatin1StringView(".ridx"); }
+
+    // cancel проверяется между блоками чтения
+    static bool build(const QString &fileName, JsonPageIndex *out, QString *error,
+                      const std::atomic<bool> *cancel = nullptr);
+    bool loadSidecar(const QString &fileName);
+    bool saveSidecar(const QString &fileName) const;
+};
+
+// Разобранная страница: станции уже переведены в id реестра
+struct JsonPage {
+    QVector<PackedReading> rows;
+    QVector<bool> valid;
+};
+
+// ============================
+// Потоковый обход постраничного файла
+// ============================
+// Срез состояния PagedJsonModel: индекс, таблица имён станций, добавленные в окне
+// записи и выборка фильтра. Копируется дёшево (общие данные Qt) и годится для рабочего
+// потока: у каждого обхода свой дескриптор файла, реестр и кэш страниц таблицы не
+// трогаются. Страницы читаются по порядку окнами по kScanWindow и разбираются
+// параллельно — в памяти одновременно только окно, а не файл.
+class JsonPageSource
+{
+public:
+    static constexpr int kScanWindow = 32;
+
+    QString fileName() const { return path; }
+    const JsonPageIndex &pageIndex() const { return index; }
+    qint64 recordCount() const { return index.records + appended.size(); }
+    bool isFiltered() const { return filtered; }
+    // Тот же срез без выборки фильтра — все записи файла и добавленные
+    JsonPageSource unfiltered() const
+    {
+        JsonPageSource all = *this;
+        all.filtered = false;
+        all.rows.clear();
+        return all;
+    }
+
+    // fn(запись) в порядке строк таблицы с учётом фильтра; stations — только эти станции
+    // (пусто — все). false — ошибка чтения файла
+    bool forEachReading(const QVector<int> &stations, const std::function<void(const PackedReading &)> &fn) const;
+    // Объекты файла как есть, вместе с показателями, — для сохранения; фильтр не учитывается
+    bool forEachObject(const std::function<void(const QJsonObject &)> &fn) const;
+    const QVector<PackedReading> &appendedRecords() const { return appended; }
+
+private:
+    friend class PagedJsonModel;
+
+    static bool readPage(QFile &file, const JsonPageIndex &index, int p, QByteArray *bytes);
+    void parsePage(const QByteArray &bytes, int p, JsonPage *out) const;
+    // fn(номер первой строки страницы, страница) по всем страницам, где есть нужные строки
+    bool forEachPage(const std::function<void(qint64, const JsonPage &)> &fn) const;
+
+    QString path;
+    JsonPageIndex index;
+    QHash<QString, int> stationIds;    // имя станции файла → id реестра
+    QVector<PackedReading> appended;   // записи, добавленные в окне, — после записей файла
+    QVector<quint32> rows;             // номера строк выборки фильтра по возрастанию
+    bool filtered = false;
+};
+
+// ============================
+// Постраничная модель большого файла
+// ============================
+// Таблица видит все записи сразу, но разбираются только страницы, до которых
+// дошла прокрутка; разобранные страницы лежат в LRU-кэше фиксированного размера.
+// Фильтр хранит номера подходящих строк (4 байта на совпадение), добавленные записи
+// держатся в памяти после записей файла и попадают в файл при сохранении.
+class PagedJsonModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    static constexpr int kMaxCachedPages = 64;   // 64 × 4096 × 9 Б ≈ 2,3 МБ
+
+    explicit PagedJsonModel(StationRegistry *registry, QObject *parent = nullptr);
+
+    // Станции индекса регистрируются в реестре здесь, один раз: чтение страниц реестр не меняет
+    bool open(const QString &fileName, const JsonPageIndex &index, QString *error);
+    QString fileName() const { return src.path; }
+    qint64 recordCount() const { return src.recordCount(); }
+    const JsonPageIndex &pageIndex() const { return src.index; }
+
+    // Выборка одним потоковым проходом по файлу; пустое выражение снимает фильтр
+    bool setFilter(const FilterExpression &expr, QString *error);
+    bool isFiltered() const { return src.filtered; }
+    QString filterText() const { return filterExpr.text(); }
+    qint64 matchCount() const { return src.filtered ? src.rows.size() : recordCount(); }
+    qint64 lastSelectUs() const { return selectUs; }
+
+    // Запись, добавленная в окне; false — станция или радиация вне 16-битного диапазона
+    bool append(int station, qint64 day, int rad);
+    qsizetype appendedCount() const { return src.appended.size(); }
+
+    // Сводка станций (пусто — всех) по всему файлу из индекса, без чтения страниц; фильтр не учитывается
+    ReadingStats stationStats(const QVector<int> &stations) const;
+    qint64 stationRecords(int station) const;
+
+    // Срез для потоковых обходов, в том числе из рабочего потока
+    const JsonPageSource &source() const { return src; }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    int cachedPages() const { return int(pages.size()); }
+    qint64 residentBytes() const;
+
+private:
+    const JsonPage *page(int p) const;
+    bool rowAt(qint64 row, PackedReading *out) const;   // строка файла или добавленная запись
+
+    StationRegistry *registry;
+    JsonPageSource src;
+    QVector<int> fileStation;   // номер станции в индексе → id реестра
+    mutable QFile file;         // только для страниц таблицы; обходы открывают файл сами
+    mutable QCache<int, JsonPage> pages{kMaxCachedPages};
+    FilterExpression filterExpr;
+    qint64 selectUs = 0;
+};
+
+#endif
@@ -1,13 +1,239 @@
 #include <QApplication>
+#include <QGuiApplication>
+#include <QElapsedTimer>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <QTimer>
+#include <memory>
 #include "mainwindow.h"
+#include "datagen.h"
+#include "archive.h"
+#include "soak.h"
+#include "report.h"
+#include "sqlbench.h"
+#include "sqlstore.h"
+#include "shmpublish.h"
+#include "stationregistry.h"
+#include "appstyle.h"
+#include <numeric>
+
+using namespace Qt::StringLiterals;
+
+static bool hasOption(int argc, char *argv[], const char *name)
+{
+    for (int i = 1; i < argc; ++i)
+        if (QByteArray(argv[i]).startsWith(name)) return true;
+    return false;
+}
+
+// Режимы без окна: генерация синтетического набора, нагрузочный прогон, пакет отчётов,
+// сравнение хранилищ и поставщик общей памяти
+static bool isConsoleMode(int argc, char *argv[])
+{
+    return hasOption(argc, argv, "--generate") || hasOption(argc, argv, "--soak") || hasOption(argc, argv, "--report")
+           || hasOption(argc, argv, "--benchmark-sqlite") || hasOption(argc, argv, "--benchmark-archive")
+           || hasOption(argc, argv, "--publish-shm");
+}
+
+static int runConsole(QCoreApplication &app)
+{
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    const QCommandLineOption generateOpt(u"generate"_s, u"Сгенерировать набор в <file> (.json, архив .rada или база .sqlite)."_s, u"file"_s);
+    const QCommandLineOption soakOpt(u"soak"_s, u"Нагрузочный прогон по набору <file>."_s, u"file"_s);
+    const QCommandLineOption seedOpt(u"seed"_s, u"Seed генератора."_s, u"n"_s, u"1"_s);
+    const QCommandLineOption stationsOpt(u"stations"_s, u"Число станций."_s, u"n"_s, u"50"_s);
+    const QCommandLineOption fromOpt(u"from"_s, u"Первый день (yyyy-MM-dd)."_s, u"date"_s, u"2015-01-01"_s);
+    const QCommandLineOption daysOpt(u"days"_s, u"Длина ряда в днях."_s, u"n"_s, u"3650"_s);
+    const QCommandLineOption rateOpt(u"per-day"_s, u"Показаний на станцию в сутки."_s, u"n"_s, u"1"_s);
+    const QCommandLineOption seasonOpt(u"season"_s, u"Амплитуда сезонной волны (доля базы)."_s, u"a"_s, u"0.25"_s);
+    const QCommandLineOption noiseOpt(u"noise"_s, u"σ шума, мкР/ч."_s, u"sigma"_s, u"1.5"_s);
+    const QCommandLineOption spikeOpt(u"spikes"_s, u"Вероятность выброса на показание."_s, u"p"_s, u"0.001"_s);
+    const QCommandLineOption cyclesOpt(u"cycles"_s, u"Циклов нагрузочного прогона."_s, u"n"_s, u"20"_s);
+    const QCommandLineOption driftOpt(u"max-drift"_s, u"Допустимый дрейф RSS, МБ/цикл."_s, u"mb"_s, u"1.0"_s);
+    const QCommandLineOption reportOpt(u"report"_s, u"Отчёты по всем станциям в каталог <dir>."_s, u"dir"_s);
+    const QCommandLineOption dataOpt(u"data"_s, u"Набор для отчётов (.json или .rada)."_s, u"file"_s);
+    const QCommandLineOption formatOpt(u"format"_s, u"Формат отчётов: png, svg или pdf."_s, u"fmt"_s, u"png"_s);
+    const QCommandLineOption noStatsOpt(u"no-stats"_s, u"Только график, без сводки."_s);
+    const QCommandLineOption sqlBenchOpt(u"benchmark-sqlite"_s, u"Сравнить память и SQLite; базы рядом с <file>."_s, u"file"_s);
+    const QCommandLineOption sizesOpt(u"sizes"_s, u"Размеры наборов через запятую."_s, u"n,..."_s,
+                                      u"1000000,10000000,100000000"_s);
+    const QCommandLineOption keepOpt(u"keep"_s, u"Не удалять базы после сравнения."_s);
+    const QCommandLineOption backendOpt(u"backend"_s, u"Замерить только memory или sqlite, без заголовка CSV."_s, u"name"_s);
+    const QCommandLineOption archiveBenchOpt(u"benchmark-archive"_s, u"Замер чтения архива <file> (.rada)."_s, u"file"_s);
+    const QCommandLineOption shmOpt(u"publish-shm"_s, u"Опубликовать набор <file> в общей памяти и дописывать записи."_s, u"file"_s);
+    const QCommandLineOption ticksOpt(u"ticks"_s, u"Сколько записей дописать."_s, u"n"_s, u"100"_s);
+    const QCommandLineOption intervalOpt(u"interval"_s, u"Пауза между записями, мс."_s, u"ms"_s, u"50"_s);
+    parser.addOptions({generateOpt, soakOpt, seedOpt, stationsOpt, fromOpt, daysOpt, rateOpt,
+                       seasonOpt, noiseOpt, spikeOpt, cyclesOpt, driftOpt,
+                       reportOpt, dataOpt, formatOpt, noStatsOpt, sqlBenchOpt, sizesOpt, keepOpt, backendOpt,
+                       archiveBenchOpt, shmOpt, ticksOpt, intervalOpt});
+    parser.process(app);
+
+    QTextStream out(stdout);
+
+    if (parser.isSet(generateOpt)) {
+        GeneratorOptions opts;
+        opts.seed = parser.value(seedOpt).toULongLong();
+        opts.stations = qBound(1, parser.value(stationsOpt).toInt(), RadiationModel::kMaxStations);
+        opts.firstDay = QDate::fromString(parser.value(fromOpt), "yyyy-MM-dd");
+        opts.days = qMax(1, parser.value(daysOpt).toInt());
+        opts.samplesPerDay = qMax(1, parser.value(rateOpt).toInt());
+        opts.seasonalAmplitude = parser.value(seasonOpt).toDouble();
+        opts.noise = parser.value(noiseOpt).toDouble();
+        opts.spikeRate = parser.value(spikeOpt).toDouble();
+        if (!opts.firstDay.isValid()) {
+            out << "error: bad --from date\n";
+            return 1;
+        }
+
+        SyntheticGenerator generator(opts);
+        // формат — по расширению: .rada — архив, .sqlite/.db — база, иначе JSON
+        const QString target = parser.value(generateOpt);
+        StationRegistry registry;
+        SqlStore store(&registry);
+        std::unique_ptr<ReadingWriter> writer;
+        if (Archive::isArchiveFile(target)) writer = std::make_unique<Archive::Writer>(target);
+        else if (SqlStore::isDatabaseFile(target)) writer = std::make_unique<SqlReadingWriter>(&store, target);
+        else writer = std::make_unique<JsonReadingWriter>(target);
+
+        QString error;
+        const bool ok = generator.run(*writer, &error, [&out](qint64 done, qint64 total) {
+            out << "\r" << done << " / " << total << Qt::flush;
+            return true;
+        });
+        out << "\n";
+        if (!ok) {
+            out << "error: " << error << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    if (parser.isSet(reportOpt)) {
+        ReportOptions options;
+        options.outDir = parser.value(reportOpt);
+        options.withStats = !parser.isSet(noStatsOpt);
+        if (!ReportOptions::parseFormat(parser.value(formatOpt), &options.format)) {
+            out << "error: unknown --format\n";
+            return 1;
+        }
+
+        StationRegistry registry;
+        RadiationModel model(&registry);
+        QString error;
+        if (!SoakHarness::loadDataset(parser.value(dataOpt), model, registry, &error)) {
+            out << "error: " << error << "\n";
+            return 1;
+        }
+        QVector<StationReading> readings;
+        readings.reserve(model.size());
+        for (const PackedReading &r : model.arena())
+            readings.append({int(r.station), r.day, int(r.rad)});
+        QVector<int> ids(registry.count());
+        std::iota(ids.begin(), ids.end(), 0);
+
+        QElapsedTimer timer;
+        timer.start();
+        QStringList errors;
+        const int written = ReportRenderer::exportAll(readings, ReportRenderer::stationNames(registry), ids, options, &errors);
+        for (const QString &e : errors) out << "error: " << e << "\n";
+        out << written << " reports in " << timer.elapsed() << " ms\n";
+        return errors.isEmpty() ? 0 : 1;
+    }
+
+    if (parser.isSet(sqlBenchOpt)) {
+        SqlBenchOptions bench;
+        bench.file = parser.value(sqlBenchOpt);
+        if (parser.isSet(stationsOpt))
+            bench.stations = qBound(1, parser.value(stationsOpt).toInt(), RadiationModel::kMaxStations);
+        bench.keepFiles = parser.isSet(keepOpt);
+        bench.backend = parser.value(backendOpt);
+        bench.sizes.clear();
+        for (const QString &part : parser.value(sizesOpt).split(u',', Qt::SkipEmptyParts))
+            if (const qint64 n = part.trimmed().toLongLong(); n > 0) bench.sizes.append(n);
+        if (bench.sizes.isEmpty()) {
+            out << "error: bad --sizes\n";
+            return 1;
+        }
+        return SqlBenchmark::run(bench, out);
+    }
+
+    if (parser.isSet(archiveBenchOpt)) return Archive::Reader::benchmark(parser.value(archiveBenchOpt), out);
+
+    if (parser.isSet(shmOpt))
+        return ShmPublisher::runFeed(parser.value(shmOpt), qMax(0, parser.value(ticksOpt).toInt()),
+                                     qMax(1, parser.value(intervalOpt).toInt()), out);
+
+    SoakOptions soak;
+    soak.file = parser.value(soakOpt);
+    soak.cycles = qMax(1, parser.value(cyclesOpt).toInt());
+    soak.maxDriftMbPerCycle = parser.value(driftOpt).toDouble();
+    return SoakHarness::run(soak, out);
+}
+
+// Замер холодного старта: от входа в main до первой отрисовки главного окна.
+// Первый Paint любого виджета окна открывает проход отрисовки; нулевой таймер
+// срабатывает, когда проход (и сброс буфера на экран) закончен.
+class FirstFrameProbe : public QObject
+{
+public:
+    FirstFrameProbe(QWidget *window, const QElapsedTimer &sinceStart, qint64 constructedMs)
+        : window(window), sinceStart(sinceStart), constructedMs(constructedMs) {}
+
+protected:
+    bool eventFilter(QObject *obj, QEvent *event) override
+    {
+        if (!seen && event->type() == QEvent::Paint && obj->isWidgetType()
+            && static_cast<QWidget*>(obj)->window() == window) {
+            seen = true;
+            QTimer::singleShot(0, this, [this]() {
+                QTextStream(stdout) << "startup: window constructed in " << constructedMs
+                                    << " ms, first frame in " << sinceStart.elapsed() << " ms\n";
+                QCoreApplication::quit();
+            });
+        }
+        return QObject::eventFilter(obj, event);
+    }
+
+private:
+    QWidget *window;
+    QElapsedTimer sinceStart;
+    qint64 constructedMs;
+    bool seen = false;
+};
 
 int main(int argc, char *argv[])
 {
+    QElapsedTimer sinceStart;
+    sinceStart.start();
+
+    if (hasOption(argc, argv, "--report")) {
+        // отчётам нужны шрифты, то есть QGuiApplication; окна не создаются
+        if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+        QGuiApplication app(argc, argv);
+        QCoreApplication::setApplicationName("RadiationAnalyzer");
+        return runConsole(app);
+    }
+    if (isConsoleMode(argc, argv)) {
+        QCoreApplication app(argc, argv);
+        QCoreApplication::setApplicationName("RadiationAnalyzer");
+        return runConsole(app);
+    }
+
     QApplication app(argc, argv);
     QApplication::setOrganizationName("ExampleOrg");
     QApplication::setApplicationName("RadiationAnalyzer");
+    app.setStyleSheet(AppStyle::styleSheet());
 
     MainWindow w;
+    if (hasOption(argc, argv, "--benchmark-startup")) {
+        // окно показывается как обычно, после первого кадра приложение выходит
+        FirstFrameProbe probe(&w, sinceStart, sinceStart.elapsed());
+        app.installEventFilter(&probe);
+        w.show();
+        return app.exec();
+    }
     w.show();
     return app.exec();
 }
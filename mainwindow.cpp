@@ -1,4 +1,9 @@
 #include "mainwindow.h"
+#include "archive.h"
+#include "seasonal.h"
+#include "report.h"
+#include "histogram.h"
+#include "pointcloud.h"
 #include <cfloat>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
@@ -12,6 +17,8 @@
 #include <QJsonObject>
 #include <QJsonDocument>
 #include <QFile>
+#include <QSaveFile>
+#include <QTextStream>
 #include <QHeaderView>
 #include <QDateTime>
 #include <cmath>
@@ -24,12 +31,24 @@
 #include <QDateTimeEdit>
 #include <QSpinBox>
 #include <QTableWidget>
+#include <QTableView>
 #include <QPlainTextEdit>
+#include <QListView>
+#include <QLineEdit>
+#include <QCompleter>
+#include <QSortFilterProxyModel>
+#include <QRegularExpression>
 #include <QListWidget>
+#include <QSet>
+#include <QElapsedTimer>
+#include <QMenuBar>
+#include <QMenu>
+#include <QAction>
 #include <QPushButton>
 
 #include <QChartView>
 #include <QLineSeries>
+#include <QAreaSeries>
 #include <QSplineSeries>
 #include <QScatterSeries>
 #include <QValueAxis>
@@ -44,11 +63,38 @@
 #include <QApplication>
 #include <limits>
 #include <algorithm>
+#include <numeric>
 #include <QDate>
 #include <QLegendMarker>
+#include <QSlider>
+#include <QtMath>
+#include <QAbstractButton>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+#include <QItemSelectionModel>
+#include <QInputDialog>
+#include <QTimer>
+#include <QCloseEvent>
+#include <QDialog>
+#include <QDialogButtonBox>
 
 using namespace Qt::StringLiterals;
 
+// Больше серий на графике не строим: каждая серия — это линия, точки и тултипы
+static constexpr int MaxOverlaySeries = 24;
+// JSON от этого размера открывается постранично, без разбора всех записей сразу
+static constexpr qint64 kLazyOpenBytes = 64ll << 20;
+// архив с таким числом записей можно загрузить не целиком, а за выбранный период
+static constexpr qint64 kArchiveRangeRecords = 5'000'000;
+// От этого числа точек на графике маркеры рисуются растровым слоем, а не QScatterSeries
+static constexpr qsizetype kRasterScatterPoints = 20000;
+// Куски линий сетки на весь график (каждый кусок — своя серия), поровну на станцию.
+// Линию не разрывают только самые короткие пропуски сверх доли станции
+static constexpr int kLineSegmentBudget = 2000;
+// Экспорт отчётов постраничного файла: показаний в памяти за один проход по страницам
+static constexpr qint64 kExportBatchReadings = 16'000'000;
+
 static qint64 toMs(const QDate &d) {
     // безопасное создание QDateTime без функционального кастинга
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 14, 0))
@@ -63,6 +109,33 @@ static qint64 toMs(const QDateTime &dt) {
 static QString fmtDate(qint64 ms) {
     return QDateTime::fromMSecsSinceEpoch(ms).date().toString("yyyy-MM-dd");
 }
+// Тот же выбор сортировки, что в applySort, для запросов к базе
+static SqlStore::Order sqlOrderFor(const QString &mode) {
+    if (mode.startsWith(u"Город A"_s))             return SqlStore::Order::CityAsc;
+    if (mode.startsWith(u"Город Я"_s))             return SqlStore::Order::CityDesc;
+    if (mode.startsWith(u"Дата: старые"_s))        return SqlStore::Order::DayAsc;
+    if (mode.startsWith(u"Дата: новые"_s))         return SqlStore::Order::DayDesc;
+    if (mode.startsWith(u"Радиация: больше"_s))    return SqlStore::Order::RadDesc;
+    if (mode.startsWith(u"Радиация: меньше"_s))    return SqlStore::Order::RadAsc;
+    return SqlStore::Order::Insertion;
+}
+// Вертикальная ось с нужной стороны (слева — мкР/ч, справа — показатели и компоненты разложения)
+static QValueAxis *valueAxisAt(QChart *chart, Qt::Alignment side) {
+    for (auto *ay : chart->axes(Qt::Vertical))
+        if (ay->alignment() == side) return qobject_cast<QValueAxis*>(ay);
+    return nullptr;
+}
+static QValueAxis *valueAxisNamed(QChart *chart, const QString &name) {
+    for (auto *ay : chart->axes(Qt::Vertical))
+        if (ay->objectName() == name) return qobject_cast<QValueAxis*>(ay);
+    return nullptr;
+}
+// Цвет основной линии станции на графике (серия названа именем города)
+static QColor seriesColor(QChart *chart, const QString &city, const QColor &fallback) {
+    for (QAbstractSeries *s : chart->series())
+        if (auto *xy = qobject_cast<QXYSeries*>(s); xy && xy->name() == city) return xy->color();
+    return fallback;
+}
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -79,51 +152,27 @@ MainWindow::MainWindow(QWidget *parent)
     chartsTab = new QWidget;
     tabWidget->addTab(chartsTab, u"📊 Графики"_s);
 
-    // ===== Глобальный стиль =====
-    this->setStyleSheet(R"(
-        QMainWindow {
-            background: qlineargradient(x1:0, y1:0, x2:0, y2:1,
-                stop:0 #f3f6fb, stop:1 #ffffff);
-        }
-        QGroupBox {
-            font-weight: 600;
-            font-size: 12px;
-            color: #1f2937;
-            border: 1px solid #e2e8f0;
-            border-radius: 10px;
-            margin-top: 10px;
-            padding-top: 15px;
-            background: #ffffff;
-        }
-        QGroupBox::title {
-            subcontrol-origin: margin;
-            subcontrol-position: top center;
-            padding: 2px 10px;
-            background: #eef2f7;
-            border-radius: 6px;
-            color: #334155;
-        }
-        QFrame {
-            background: #ffffff;
-            border-radius: 12px;
-            border: 1px solid #e5e7eb;
-        }
-        QLabel { color: #1f2937; }
-    )");
+    mapTab = new QWidget;
+    tabWidget->addTab(mapTab, u"🗺️ Карта"_s);
+
+    compareTab = new QWidget;
+    tabWidget->addTab(compareTab, u"📆 Сравнение периодов"_s);
+
+    correlationTab = new QWidget;
+    tabWidget->addTab(correlationTab, u"🔗 Корреляция"_s);
+
+    histogramTab = new QWidget;
+    tabWidget->addTab(histogramTab, u"📶 Распределение"_s);
+
+    summaryTab = new QWidget;
+    tabWidget->addTab(summaryTab, u"🏙️ Сводка по станциям"_s);
 
     QHBoxLayout *mainDataLayout = new QHBoxLayout(dataTab);
     mainDataLayout->setSpacing(20);
     mainDataLayout->setContentsMargins(20, 20, 20, 20);
 
     QFrame *leftPanel = new QFrame;
-    leftPanel->setStyleSheet(R"(
-        QFrame {
-            background: qlineargradient(x1:0, y1:0, x2:0, y2:1,
-                stop:0 #ffffff, stop:1 #f7fafc);
-            border-radius: 12px;
-            border: 1px solid #e5e7eb;
-        }
-    )");
+    leftPanel->setObjectName(u"dataPanel"_s);
 
     QVBoxLayout *leftLayout = new QVBoxLayout(leftPanel);
     leftLayout->setSpacing(15);
@@ -138,65 +187,28 @@ MainWindow::MainWindow(QWidget *parent)
 
     cityComboBox = new QComboBox;
     initializeCities();
-    cityComboBox->setStyleSheet(R"(
-        QComboBox {
-            padding: 8px;
-            border: 2px solid #bdc3c7;
-            border-radius: 6px;
-            background: white;
-            font-size: 11px;
-        }
-        QComboBox:hover { border-color: #3498db; }
-        QComboBox::drop-down {
-            subcontrol-origin: padding;
-            subcontrol-position: top right;
-            width: 20px;
-            border-left: 1px solid #bdc3c7;
-        }
-    )");
+    cityComboBox->setEditable(true);
+    cityComboBox->setInsertPolicy(QComboBox::NoInsert);
+    if (auto *popup = qobject_cast<QListView*>(cityComboBox->view()))
+        popup->setUniformItemSizes(true);
+    auto *cityCompleter = new QCompleter(cityModel, cityComboBox);
+    cityCompleter->setCaseSensitivity(Qt::CaseInsensitive);
+    cityCompleter->setFilterMode(Qt::MatchContains);
+    cityCompleter->setCompletionMode(QCompleter::PopupCompletion);
+    cityComboBox->setCompleter(cityCompleter);
+    cityComboBox->setObjectName(u"cityCombo"_s);
     formLayout->addRow(u"🏙️ Город:"_s, cityComboBox);
 
     dateTimeEdit = new QDateTimeEdit(QDateTime::currentDateTime());
     dateTimeEdit->setCalendarPopup(true);
     dateTimeEdit->setDisplayFormat("yyyy-MM-dd");
-    dateTimeEdit->setStyleSheet(R"(
-        QDateTimeEdit {
-            padding: 8px;
-            border: 2px solid #bdc3c7;
-            border-radius: 6px;
-            background: #ffffff;
-            color: #2c3e50;
-            font-size: 11px;
-        }
-        QDateTimeEdit:hover { border-color: #3498db; }
-        QDateTimeEdit::drop-down {
-            subcontrol-origin: padding;
-            subcontrol-position: top right;
-            width: 20px;
-            border-left: 1px solid #bdc3c7;
-        }
-        QDateTimeEdit QAbstractItemView {
-            background-color: white;
-            border: 1px solid #bdc3c7;
-            selection-background-color: #3498db;
-            selection-color: white;
-        }
-    )");
+    dateTimeEdit->setObjectName(u"dateEdit"_s);
     formLayout->addRow(u"📅 Дата:"_s, dateTimeEdit);
 
     radiationSpin = new QSpinBox;
     radiationSpin->setRange(0, 1000);
     radiationSpin->setSuffix(u" мкР/ч"_s);
-    radiationSpin->setStyleSheet(R"(
-        QSpinBox {
-            padding: 8px;
-            border: 2px solid #bdc3c7;
-            border-radius: 6px;
-            background: white;
-            font-size: 11px;
-        }
-        QSpinBox:hover { border-color: #3498db; }
-    )");
+    radiationSpin->setObjectName(u"radiationSpin"_s);
     formLayout->addRow(u"☢️ Радиация (мкР/ч):"_s, radiationSpin);
 
     inputGroup->setLayout(formLayout);
@@ -221,45 +233,53 @@ MainWindow::MainWindow(QWidget *parent)
     sortGroup->setLayout(sortLayout);
     leftLayout->addWidget(sortGroup);
 
+    // ===== Фильтр =====
+    QGroupBox *filterGroup = new QGroupBox(u"🔎 Фильтр"_s);
+    QVBoxLayout *filterLayout = new QVBoxLayout;
+    filterEdit = new QLineEdit;
+    filterEdit->setPlaceholderText(u"city in (Гомель, Брагин) and radiation > 30 and date >= 2024-01-01"_s);
+    filterEdit->setClearButtonEnabled(true);
+    QHBoxLayout *filterButtons = new QHBoxLayout;
+    QPushButton *btnApplyFilter = new QPushButton(u"Применить"_s);
+    QPushButton *btnClearFilter = new QPushButton(u"Сбросить"_s);
+    filterButtons->addWidget(btnApplyFilter);
+    filterButtons->addWidget(btnClearFilter);
+    filterInfo = new QLabel(u"Фильтр не задан"_s);
+    filterInfo->setWordWrap(true);
+    filterLayout->addWidget(filterEdit);
+    filterLayout->addLayout(filterButtons);
+    filterLayout->addWidget(filterInfo);
+    filterGroup->setLayout(filterLayout);
+    leftLayout->addWidget(filterGroup);
+    // ===== Доза =====
+    QGroupBox *doseGroup = new QGroupBox(u"☢️ Накопленная доза за период"_s);
+    QFormLayout *doseLayout = new QFormLayout;
+    doseFromEdit = new QDateEdit(QDate::currentDate().addYears(-1));
+    doseToEdit = new QDateEdit(QDate::currentDate());
+    for (QDateEdit *edit : {doseFromEdit, doseToEdit}) {
+        edit->setCalendarPopup(true);
+        edit->setDisplayFormat("yyyy-MM-dd");
+    }
+    doseLayout->addRow(u"С:"_s, doseFromEdit);
+    doseLayout->addRow(u"По:"_s, doseToEdit);
+    doseGroup->setLayout(doseLayout);
+    leftLayout->addWidget(doseGroup);
+
+    connect(filterEdit, &QLineEdit::returnPressed, this, &MainWindow::applyFilter);
+    connect(btnApplyFilter, &QPushButton::clicked, this, &MainWindow::applyFilter);
+    connect(btnClearFilter, &QPushButton::clicked, this, [this]() {
+        filterEdit->clear();
+        applyFilter();
+    });
+
     // ===== Кнопки =====
     btnAdd = new QPushButton(u"➕ Добавить запись"_s);
     btnSave = new QPushButton(u"💾 Сохранить JSON"_s);
     btnLoad = new QPushButton(u"📂 Загрузить JSON"_s);
 
-    QString buttonBaseStyle = R"(
-        QPushButton {
-            padding: 12px;
-            font-weight: bold;
-            border-radius: 8px;
-            font-size: 11px;
-            border: none;
-            margin: 2px;
-        }
-        QPushButton:hover { opacity: 0.9; transform: translateY(-1px); }
-        QPushButton:pressed { transform: translateY(1px); }
-    )";
-
-    btnAdd->setStyleSheet(buttonBaseStyle + R"(
-        QPushButton {
-            background: qlineargradient(x1: 0, y1: 0, x2: 0, y2: 1,
-                stop: 0 #27ae60, stop: 1 #2ecc71);
-            color: white;
-        }
-    )");
-    btnSave->setStyleSheet(buttonBaseStyle + R"(
-        QPushButton {
-            background: qlineargradient(x1: 0, y1: 0, x2: 0, y2: 1,
-                stop: 0 #f39c12, stop: 1 #f1c40f);
-            color: white;
-        }
-    )");
-    btnLoad->setStyleSheet(buttonBaseStyle + R"(
-        QPushButton {
-            background: qlineargradient(x1: 0, y1: 0, x2: 0, y2: 1,
-                stop: 0 #8e44ad, stop: 1 #9b59b6);
-            color: white;
-        }
-    )");
+    btnAdd->setObjectName(u"btnAdd"_s);
+    btnSave->setObjectName(u"btnSave"_s);
+    btnLoad->setObjectName(u"btnLoad"_s);
 
     connect(btnAdd,  &QPushButton::clicked, this, &MainWindow::addRecord);
     connect(btnSave, &QPushButton::clicked, this, &MainWindow::saveToJson);
@@ -268,15 +288,12 @@ MainWindow::MainWindow(QWidget *parent)
     leftLayout->addWidget(btnAdd);
 
     btnAnalyze = new QPushButton(u"📊 Анализировать данные"_s);
-    btnAnalyze->setStyleSheet(buttonBaseStyle + R"(
-        QPushButton {
-            background: qlineargradient(x1: 0, y1: 0, x2: 0, y2: 1,
-                stop: 0 #2980b9, stop: 1 #3498db);
-            color: white;
-        }
-    )");
+    btnAnalyze->setObjectName(u"btnAnalyze"_s);
     connect(btnAnalyze, &QPushButton::clicked, this, &MainWindow::analyzeData);
 
+    analysisMetricCombo = new QComboBox;
+    analysisMetricCombo->setToolTip(u"Показатель для анализа"_s);
+    leftLayout->addWidget(analysisMetricCombo);
     leftLayout->addWidget(btnAnalyze);
     leftLayout->addWidget(btnSave);
     leftLayout->addWidget(btnLoad);
@@ -289,31 +306,37 @@ MainWindow::MainWindow(QWidget *parent)
     QGroupBox *tableGroup = new QGroupBox(u"📋 Таблица измерений ионизирующего излучения"_s);
     QVBoxLayout *tableLayout = new QVBoxLayout;
 
-    table = new QTableWidget(0, 3);
-    QStringList headers = {u"🏙️ Город"_s, u"📅 Дата"_s, u"☢️ Ионизирующее излучение (мкР/ч)"_s};
-    table->setHorizontalHeaderLabels(headers);
+    // заголовки, текст и цвет ячеек отдаёт модель поверх упакованных записей
+    records = new RadiationModel(stations, this);
+    resultCache = std::make_unique<ResultCache>(records);
+    doseIndex = std::make_unique<DoseIndex>(records);
+    history = std::make_unique<DatasetHistory>(records);
+    connect(records, &QAbstractItemModel::rowsAboutToBeInserted, this, [this]() {
+        doseIndex->recordsAboutToBeInserted();
+    });
+    connect(records, &QAbstractItemModel::rowsInserted, this, [this](const QModelIndex &, int first, int last) {
+        doseIndex->recordsInserted(first, last);
+    });
+    filterModel = new FilterModel(records, stations, this);
+    connect(records, &QAbstractItemModel::modelReset, this, &MainWindow::refreshMetricLists);
+    // сброс (загрузка, сортировка) переписывает опубликованный набор, вставка — только хвост
+    connect(records, &QAbstractItemModel::modelReset, this, [this]() {
+        shmFullPending = true;
+        schedulePublish();
+    });
+    connect(records, &QAbstractItemModel::rowsInserted, this, &MainWindow::schedulePublish);
+    connect(filterModel, &FilterModel::selectionChanged, this, &MainWindow::updateFilterInfo);
+    connect(filterModel, &FilterModel::selectionChanged, this, &MainWindow::invalidateHistogram);
+    connect(filterModel, &FilterModel::selectionChanged, this, &MainWindow::invalidateSummary);
+    table = new QTableView;
+    table->setModel(records);
     table->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    table->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    table->verticalHeader()->setDefaultSectionSize(28);
     table->setAlternatingRowColors(true);
     table->setSelectionBehavior(QAbstractItemView::SelectRows);
     table->setEditTriggers(QAbstractItemView::NoEditTriggers);
-    table->setStyleSheet(R"(
-        QTableWidget {
-            background-color: white;
-            border: 2px solid #dfe6e9;
-            border-radius: 8px;
-            gridline-color: #dce1e5;
-            font-size: 11px;
-        }
-        QTableWidget::item { padding: 6px; border-bottom: 1px solid #ecf0f1; }
-        QTableWidget::item:selected { background-color: #3498db; color: white; }
-        QHeaderView::section {
-            background: qlineargradient(x1: 0, y1: 0, x2: 0, y2: 1,
-                stop: 0 #34495e, stop: 1 #2c3e50);
-            color: white; padding: 8px; border: 1px solid #2c3e50; font-weight: bold; font-size: 11px;
-        }
-        QTableWidget QScrollBar:vertical { border: none; background: #ecf0f1; width: 12px; margin: 0px; }
-        QTableWidget QScrollBar::handle:vertical { background: #bdc3c7; border-radius: 6px; min-height: 20px; }
-    )");
+    table->setObjectName(u"recordsTable"_s);
 
     tableLayout->addWidget(table);
     tableGroup->setLayout(tableLayout);
@@ -324,18 +347,7 @@ MainWindow::MainWindow(QWidget *parent)
     QVBoxLayout *analysisLayout = new QVBoxLayout;
     analysisText = new QPlainTextEdit;
     analysisText->setReadOnly(true);
-    analysisText->setStyleSheet(R"(
-        QPlainTextEdit {
-            background-color: #0b132b;
-            color: #e0e1dd;
-            border: 2px solid #1c2541;
-            border-radius: 8px;
-            padding: 12px;
-            font-family: 'Consolas', 'Monospace';
-            font-size: 12px;
-        }
-        QPlainTextEdit:focus { border-color: #3a506b; }
-    )");
+    analysisText->setObjectName(u"analysisText"_s);
     analysisText->setPlaceholderText(u"📈 Нажмите \"Анализировать данные\" для расчётов по текущему городу..."_s);
     analysisLayout->addWidget(analysisText);
     analysisBox->setLayout(analysisLayout);
@@ -344,149 +356,220 @@ MainWindow::MainWindow(QWidget *parent)
     mainDataLayout->addWidget(leftPanel, 3);
     mainDataLayout->addLayout(rightLayout, 7);
 
-    // ===== Вкладка графиков =====
-    QVBoxLayout *chartsLayout = new QVBoxLayout(chartsTab);
-    chartsLayout->setSpacing(15);
-    chartsLayout->setContentsMargins(20, 20, 20, 20);
+    // вкладки, кроме данных, строятся при первом открытии: до первого кадра — только таблица
+    tabBuilders = {
+        {chartsTab, &MainWindow::setupChartsTab},
+        {mapTab, &MainWindow::setupMapTab},
+        {compareTab, &MainWindow::setupCompareTab},
+        {correlationTab, &MainWindow::setupCorrelationTab},
+        {histogramTab, &MainWindow::setupHistogramTab},
+        {summaryTab, &MainWindow::setupSummaryTab},
+    };
+    connect(tabWidget, &QTabWidget::currentChanged, this, [this](int index) {
+        QWidget *tab = tabWidget->widget(index);
+        ensureTabBuilt(tab);
+        if (tab == mapTab) updateHeatmap();
+        else if (tab == compareTab) refreshComparePeriods();
+        else if (tab == histogramTab) updateHistogram();
+        else if (tab == summaryTab) updateSummary();
+    });
+    refreshMetricLists();
 
-    QHBoxLayout *chartsButtonLayout = new QHBoxLayout;
-    btnUpdateCharts = new QPushButton(u"🔄 Обновить график"_s);
-    btnUpdateCharts->setStyleSheet(buttonBaseStyle + R"(
-        QPushButton {
-            background: qlineargradient(x1: 0, y1: 0, x2: 0, y2: 1,
-                stop: 0 #e74c3c, stop: 1 #c0392b);
-            color: white;
-        }
-    )");
-    connect(btnUpdateCharts, &QPushButton::clicked, this, &MainWindow::updateCharts);
-    chartsButtonLayout->addStretch();
-    chartsButtonLayout->addWidget(btnUpdateCharts);
-    chartsButtonLayout->addStretch();
-    chartsLayout->addLayout(chartsButtonLayout);
+    statusBar()->showMessage(u"✅ Готов к работе. Добавьте записи и постройте график."_s);
 
-    // Панель управления графиком
-    QHBoxLayout *chartAndControls = new QHBoxLayout;
-    QWidget *controlsPanel = new QWidget;
-    controlsPanel->setFixedWidth(260);
-    controlsPanel->setStyleSheet(R"(
-        QWidget { background: #ffffff; border: 1px solid #e5e7eb; border-radius: 10px; }
-        QLabel { color: #1f2937; font-weight: 600; }
-        QComboBox { padding: 8px; border: 1px solid #cbd5e1; border-radius: 8px; background: #ffffff; color: #1f2937; }
-        QComboBox:hover { border-color: #3b82f6; }
-        QCheckBox { color: #1f2937; }
-        QPushButton { padding: 9px 12px; border-radius: 8px; background: #3b82f6; color: #ffffff; font-weight: 700; }
-        QPushButton:hover { background: #2563eb; }
-    )");
-    QVBoxLayout *controlsLayout = new QVBoxLayout(controlsPanel);
-    QLabel *chartTypeLbl = new QLabel(u"Тип графика:"_s);
-    chartTypeCombo = new QComboBox;
-    chartTypeCombo->addItems({u"Точки+линии"_s, u"Сглаженная"_s});
-    chartTypeCombo->setCurrentIndex(0);
-    controlsLayout->addWidget(chartTypeLbl);
-    controlsLayout->addWidget(chartTypeCombo);
+    // ===== Диагностика =====
+    perfLabel = new QLabel;
+    statusBar()->addPermanentWidget(perfLabel);
+    memLabel = new QLabel;
+    statusBar()->addPermanentWidget(memLabel);
+    updateMemoryReadout();
+    Trace::setOperationListener([this](const Trace::OperationSummary &summary) { showTraceSummary(summary); });
+
+    QMenu *editMenu = menuBar()->addMenu(u"✏️ Правка"_s);
+    undoAction = editMenu->addAction(u"Отменить"_s, this, &MainWindow::undoEdit);
+    undoAction->setShortcut(QKeySequence::Undo);
+    redoAction = editMenu->addAction(u"Повторить"_s, this, &MainWindow::redoEdit);
+    redoAction->setShortcut(QKeySequence::Redo);
+    updateEditActions();
+
+    QMenu *reportMenu = menuBar()->addMenu(u"📄 Отчёты"_s);
+    reportMenu->addAction(u"Экспорт отчётов по всем станциям..."_s, this, &MainWindow::exportReports);
+
+    QMenu *diagMenu = menuBar()->addMenu(u"🛠️ Диагностика"_s);
+    QAction *traceToggle = diagMenu->addAction(u"Трассировка горячих участков"_s);
+    traceToggle->setCheckable(true);
+    traceToggle->setChecked(Trace::isEnabled());
+    connect(traceToggle, &QAction::toggled, this, [](bool on) { Trace::setEnabled(on); });
+    diagMenu->addAction(u"Экспорт трассировки (Chrome/Perfetto JSON)..."_s, this, &MainWindow::exportTrace);
+    diagMenu->addAction(u"Очистить трассировку"_s, this, []() { Trace::clear(); });
+    diagMenu->addSeparator();
+    diagMenu->addAction(u"Память..."_s, this, &MainWindow::showMemoryReport);
+    diagMenu->addAction(u"Кэш результатов..."_s, this, &MainWindow::showCacheReport);
+    diagMenu->addSeparator();
+    QAction *shmToggle = diagMenu->addAction(QString(u"Публиковать набор в общую память (%1)"_s)
+                                                 .arg(QLatin1StringView(ShmLayout::kDefaultName)));
+    shmToggle->setCheckable(true);
+    shmToggle->setEnabled(ShmPublisher::isSupported());
+    connect(shmToggle, &QAction::toggled, this, [this, shmToggle](bool on) {
+        setSharedPublishing(on);
+        if (on && !shmPublisher) shmToggle->setChecked(false);   // область не создана
+    });
 
-    btnFindMinMax = new QPushButton(u"MIN/MAX"_s);
-    controlsLayout->addWidget(btnFindMinMax);
-    connect(btnFindMinMax, &QPushButton::clicked, this, &MainWindow::findMinMax);
-    btnTrend = new QPushButton(u"Тенденция"_s);
-    controlsLayout->addWidget(btnTrend);
-    connect(btnTrend, &QPushButton::clicked, this, &MainWindow::computeTrend);
-    controlsLayout->addStretch();
-    chartAndControls->addWidget(controlsPanel);
+    // набор прошлого запуска подставляется сразу после первого кадра
+    QTimer::singleShot(0, this, &MainWindow::restoreSession);
+}
 
-    QScrollArea *scrollArea = new QScrollArea;
-    scrollArea->setWidgetResizable(true);
-    scrollArea->setStyleSheet(R"(
-        QScrollArea { border: none; background: transparent; }
-    )");
+void MainWindow::initializeCities()
+{
+    struct CityDef { QString name; Coord pos; };
+    const CityDef cities[] = {
+        { u"Минск"_s,     {53.9045, 27.5615} },
+        { u"Гомель"_s,    {52.4412, 30.9878} },
+        { u"Могилёв"_s,   {53.9007, 30.3314} },
+        { u"Витебск"_s,   {55.1904, 30.2049} },
+        { u"Гродно"_s,    {53.6694, 23.8131} },
+        { u"Брест"_s,     {52.0976, 23.7341} },
+        { u"Брагин"_s,    {51.7876, 30.2670} },
+        { u"Славгород"_s, {53.4431, 31.0043} },
+    };
 
-    QWidget *chartsContainer = new QWidget;
-    QVBoxLayout *chartsContainerLayout = new QVBoxLayout(chartsContainer);
-    chartsContainerLayout->setSpacing(20);
+    stations = new StationRegistry(this);
+    for (const CityDef &c : cities)
+        stations->setCoord(stations->intern(c.name), c.pos);
 
-    QLabel *radLabel = new QLabel(u"☢️ Ионизирующее излучение (мкР/ч)"_s);
-    radLabel->setStyleSheet("QLabel { font-weight: bold; font-size: 16px; color: #2c3e50; }");
-    chartsContainerLayout->addWidget(radLabel);
+    // остальные станции добавляются в реестр по мере загрузки данных
+    cityModel = new StationListModel(stations, false, this);
+    overlayModel = new StationListModel(stations, true, this);
+    cityComboBox->setModel(cityModel);
+}
 
-    radiationChartView = new QChartView;
-    QSize chartSize(900, 420);
-    radiationChartView->setMinimumSize(chartSize);
-    radiationChartView->setRenderHint(QPainter::Antialiasing);
+MainWindow::~MainWindow()
+{
+    Trace::setOperationListener(nullptr);
+}
 
-    QHBoxLayout *chartRow = new QHBoxLayout;
-    chartRow->addLayout(chartAndControls);
-    chartRow->addWidget(radiationChartView, 1);
-    chartsContainerLayout->addLayout(chartRow);
+void MainWindow::ensureTabBuilt(QWidget *tab)
+{
+    const auto it = tabBuilders.constFind(tab);
+    if (it == tabBuilders.cend()) return;
+    const auto build = *it;
+    tabBuilders.erase(it);
+    TRACE_SCOPE("build tab");
+    (this->*build)();
+}
 
-    // Список городов для наложения
-    QGroupBox *overlayGroup = new QGroupBox(u"🔀 Наложение графиков по городам"_s);
-    QVBoxLayout *overlayLayout = new QVBoxLayout;
-    cityOverlayList = new QListWidget;
-    cityOverlayList->setSelectionMode(QAbstractItemView::NoSelection);
-    cityOverlayList->setStyleSheet(R"(
-        QListWidget { border: 2px solid #dfe6e9; border-radius: 8px; }
-        QListWidget::item { padding: 6px; }
-        QListWidget::indicator { width: 16px; height: 16px; }
-    )");
-    overlayLayout->addWidget(new QLabel(u"Выберите города для наложения:"_s));
-    overlayLayout->addWidget(cityOverlayList);
-    QHBoxLayout *overlayBtns = new QHBoxLayout;
-    btnSelectAllCities = new QPushButton(u"Выбрать все"_s);
-    btnClearAllCities = new QPushButton(u"Снять все"_s);
-    overlayBtns->addWidget(btnSelectAllCities);
-    overlayBtns->addWidget(btnClearAllCities);
-    overlayBtns->addStretch();
-    overlayGroup->setLayout(overlayLayout);
-    overlayLayout->addLayout(overlayBtns);
-    chartsContainerLayout->addWidget(overlayGroup);
+void MainWindow::forEachViewReading(const QVector<int> &ids, const std::function<void(const PackedReading &)> &fn) const
+{
+    if (pagedActive()) {
+        // страницы файла читаются окнами, в памяти нет копии записей
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        const bool ok = pagedModel->source().forEachReading(ids, fn);
+        QApplication::restoreOverrideCursor();
+        if (!ok) statusBar()->showMessage(u"Ошибка чтения файла: "_s + pagedModel->fileName(), 5000);
+        return;
+    }
+    if (sqlActive()) {
+        // строки станций — по индексу (станция, дата), с условием фильтра
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        const bool ok = sqlStore->forEachReading(ids, sqlWhere, fn);
+        QApplication::restoreOverrideCursor();
+        if (!ok) statusBar()->showMessage(u"Ошибка чтения базы: "_s + sqlStore->lastError(), 5000);
+        return;
+    }
+    if (ids.isEmpty()) {
+        filterModel->forEachReading(fn);
+        return;
+    }
+    std::vector<bool> want(size_t(stations->count()), false);
+    for (int id : ids)
+        if (id >= 0 && id < stations->count()) want[size_t(id)] = true;
+    filterModel->forEachReading([&](const PackedReading &r) {
+        if (r.station < want.size() && want[r.station]) fn(r);
+    });
+}
 
-    scrollArea->setWidget(chartsContainer);
-    chartsLayout->addWidget(scrollArea);
+QVector<StationReading> MainWindow::collectReadings(const QVector<int> &ids) const
+{
+    QVector<StationReading> out;
+    if (!pagedActive() && ids.isEmpty()) out.reserve(filterModel->matchCount());
+    forEachViewReading(ids, [&out](const PackedReading &r) {
+        out.append({int(r.station), r.day, int(r.rad)});
+    });
+    return out;
+}
 
-    setupCharts();
+MainWindow::ReadingsSnapshot MainWindow::readingsSnapshot() const
+{
+    ReadingsSnapshot snap;
+    snap.data = records->snapshot();
+    snap.filtered = filterModel->isActive();
+    if (snap.filtered) snap.rows = filterModel->selectedRows();
+    return snap;
+}
 
-    // чекбоксы городов
-    for (int i = 0; i < cityComboBox->count(); ++i) {
-        QListWidgetItem *item = new QListWidgetItem(cityComboBox->itemText(i));
-        item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
-        item->setCheckState(Qt::Unchecked);
-        cityOverlayList->addItem(item);
+QVector<StationReading> MainWindow::ReadingsSnapshot::readings() const
+{
+    QVector<StationReading> out;
+    auto add = [&out](const PackedReading &r) { out.append({int(r.station), r.day, int(r.rad)}); };
+    if (filtered) {
+        out.reserve(rows.size());
+        for (quint32 i : rows) add(data->at(i));
+    } else {
+        out.reserve(data->size());
+        for (const PackedReading &r : data->records) add(r);
     }
-    connect(btnSelectAllCities, &QPushButton::clicked, this, [this]() {
-        for (int i = 0; i < cityOverlayList->count(); ++i)
-            cityOverlayList->item(i)->setCheckState(Qt::Checked);
-    });
-    connect(btnClearAllCities, &QPushButton::clicked, this, [this]() {
-        for (int i = 0; i < cityOverlayList->count(); ++i)
-            cityOverlayList->item(i)->setCheckState(Qt::Unchecked);
-    });
+    return out;
+}
 
-    statusBar()->setStyleSheet(R"(
-        QStatusBar {
-            background: qlineargradient(x1: 0, y1: 0, x2: 0, y2: 1,
-                stop: 0 #2c3e50, stop: 1 #34495e);
-            color: white;
-            font-weight: bold;
-            padding: 5px;
-        }
-    )");
-    statusBar()->showMessage(u"✅ Готов к работе. Добавьте записи и постройте график."_s);
+// ============================
+// ПРАВКА
+// ============================
+
+void MainWindow::recordEdit(const QString &label)
+{
+    // постраничный файл и база не в records — их состояние в истории не хранится
+    if (sqlActive() || pagedActive()) return;
+    history->record(label);
+    updateEditActions();
 }
 
-void MainWindow::initializeCities()
+void MainWindow::updateEditActions()
 {
+    if (!undoAction) return;
+    undoAction->setEnabled(history->canUndo());
+    undoAction->setText(history->canUndo() ? u"Отменить: "_s + history->undoLabel() : u"Отменить"_s);
+    redoAction->setEnabled(history->canRedo());
+    redoAction->setText(history->canRedo() ? u"Повторить: "_s + history->redoLabel() : u"Повторить"_s);
+}
 
-    cityComboBox->addItem(u"Минск"_s,  "Minsk");
-    cityComboBox->addItem(u"Гомель"_s, "Gomel");
-    cityComboBox->addItem(u"Могилёв"_s,"Mogilev");
-    cityComboBox->addItem(u"Витебск"_s,"Vitebsk");
-    cityComboBox->addItem(u"Гродно"_s, "Grodno");
-    cityComboBox->addItem(u"Брест"_s,  "Brest");
-    cityComboBox->addItem(u"Брагин"_s, "Bragin");
-    cityComboBox->addItem(u"Славгород"_s,"Slavgorod");
+void MainWindow::undoEdit()
+{
+    // таблица показывает файл или базу — возврат к набору в памяти, повтора у такой отмены нет
+    const bool external = sqlActive() || pagedActive();
+    const QString label = history->undoLabel();
+    if (!history->undo(!external)) return;
+    if (external) {
+        if (pagedModel) {
+            pagedModel->deleteLater();
+            pagedModel = nullptr;
+        }
+        sessionSource = {};   // набор больше не копия файла
+    }
+    setTableModel(recordsView());
+    onDatasetChanged();
+    updateEditActions();
+    statusBar()->showMessage(QString(u"↩ Отменено: %1"_s).arg(label), 3000);
 }
 
-MainWindow::~MainWindow() = default;
+void MainWindow::redoEdit()
+{
+    if (sqlActive() || pagedActive()) return;
+    const QString label = history->redoLabel();
+    if (!history->redo()) return;
+    onDatasetChanged();
+    updateEditActions();
+    statusBar()->showMessage(QString(u"↪ Повторено: %1"_s).arg(label), 3000);
+}
 
 // ============================
 // ДАННЫЕ
@@ -494,131 +577,314 @@ MainWindow::~MainWindow() = default;
 
 void MainWindow::addRecord()
 {
-    const QString city = cityComboBox->currentText();
+    const QString city = cityComboBox->currentText().trimmed();
     if (city.isEmpty()) {
         QMessageBox::warning(this, u"Ошибка"_s, u"Пожалуйста, выберите город."_s);
         return;
     }
-
-    const int row = table->rowCount();
-    table->insertRow(row);
-
+    // введённое вручную имя регистрируется навсегда — новая станция только после подтверждения
+    if (stations->find(city) < 0) {
+        if (stations->count() >= RadiationModel::kMaxStations) {
+            QMessageBox::warning(this, u"Ошибка"_s,
+                                 QString(u"Превышено число станций (%1)."_s).arg(RadiationModel::kMaxStations));
+            return;
+        }
+        if (QMessageBox::question(this, u"Новая станция"_s,
+                                  QString(u"Станции «%1» нет в списке. Добавить её как новую станцию?"_s).arg(city))
+            != QMessageBox::Yes)
+            return;
+    }
     const int rad = radiationSpin->value();
-    auto *cityItem = new QTableWidgetItem(city);
-    cityItem->setData(Qt::UserRole, seqCounter);
-    table->setItem(row, 0, cityItem);
-
-    auto *dtItem = new QTableWidgetItem(dateTimeEdit->dateTime().date().toString("yyyy-MM-dd"));
-    table->setItem(row, 1, dtItem);
-
-    auto *radItem = new QTableWidgetItem(QString::number(rad) + u" мкР/ч"_s);
-
-    // Цвет по уровням, мкР/ч: <=15 зелёный, <=30 жёлтый, <=60 оранжевый, иначе красный
-    QColor bgColor;
-    if (rad <= 15)       bgColor = QColor("#d1fae5");
-    else if (rad <= 30)  bgColor = QColor("#fef3c7");
-    else if (rad <= 60)  bgColor = QColor("#ffedd5");
-    else                 bgColor = QColor("#fee2e2");
-
-    cityItem->setBackground(bgColor);
-    dtItem->setBackground(bgColor);
-    radItem->setBackground(bgColor);
+    const qint64 day = dateTimeEdit->dateTime().date().toJulianDay();
+    if (pagedActive()) {
+        // запись держится в памяти после записей файла и попадает в файл при сохранении
+        pagedModel->append(stations->intern(city), day, rad);
+        onDatasetChanged();
+        statusBar()->showMessage(QString(u"✅ Добавлена запись для города %1 (в файл — при сохранении)"_s).arg(city), 3000);
+        return;
+    }
+    if (sqlActive()) {
+        // запись сразу уходит в базу своей транзакцией; таблица перечитывает выборку запросом
+        QString error;
+        if (!sqlStore->append(stations->intern(city), day, rad, &error)) {
+            QMessageBox::warning(this, u"Ошибка"_s, QString(u"Не удалось записать в базу:\n%1"_s).arg(error));
+            statusBar()->showMessage(u"Ошибка записи в базу"_s, 5000);
+            return;
+        }
+        sqlModel->setQuery(sqlWhere, sqlModel->order());
+        onDatasetChanged();
+        statusBar()->showMessage(QString(u"✅ Добавлена запись для города %1 (записана в базу)"_s).arg(city), 3000);
+        return;
+    }
+    const int stationId = stations->intern(city);
 
-    table->setItem(row, 2, radItem);
-    seqCounter++;
+    recordEdit(u"добавление записи"_s);
+    records->append(stationId, day, rad);
+    onDatasetChanged();
 
     statusBar()->showMessage(QString(u"✅ Добавлена запись для города %1"_s).arg(city), 3000);
 }
 
 void MainWindow::analyzeData()
 {
-    const int rows = table->rowCount();
-    if (rows == 0) {
+    Trace::Operation traceOp("analyzeData");
+    // база: сводка считается агрегатом SQLite, постраничный файл — по индексу или проходом по страницам;
+    // записи в память не читаются
+    const bool sql = sqlActive();
+    const bool paged = pagedActive();
+    if ((sql ? sqlModel->recordCount() : paged ? pagedModel->recordCount() : records->size()) == 0) {
+        traceOp.finish();
         QMessageBox::information(this, u"Нет данных"_s, u"Сначала добавьте записи."_s);
         statusBar()->showMessage(u"Ошибка: нет данных для анализа"_s);
         return;
     }
 
-    const QString currentCity = cityComboBox->currentText();
-
-    QVector<int> rads; rads.reserve(rows);
-    int cityRecordCount = 0;
-
-    for (int i = 0; i < rows; ++i) {
-        const auto *cityIt = table->item(i, 0);
-        const auto *radIt  = table->item(i, 2);
-        if (!cityIt || !radIt) continue;
-        if (cityIt->text() == currentCity) {
-            const int rad = radIt->text().section(' ', 0, 0).toInt();
-            rads.append(rad);
-            cityRecordCount++;
-        }
+    const QString currentCity = cityComboBox->currentText().trimmed();
+    const int cityId = stations->find(currentCity);
+    const int metric = analysisMetricCombo->currentData().toInt();
+    if (metric >= 0) {
+        analyzeMetric(cityId, currentCity, metric);
+        return;
     }
 
+    // сводка берётся из кэша, пока набор записей города не менялся
+    const ReadingStats st = cityId >= 0 ? statsFor({cityId}) : ReadingStats();
+    const qint64 cityRecordCount = st.count;
+
     if (cityRecordCount == 0) {
+        traceOp.finish();
         QMessageBox::information(this, u"Нет данных"_s, QString(u"Нет записей для города %1"_s).arg(currentCity));
         statusBar()->showMessage(QString(u"Нет данных для города %1"_s).arg(currentCity));
         return;
     }
 
-    auto mean = [](const QVector<int>& v)->double {
-        if (v.isEmpty()) return 0.0;
-        long long s = 0;
-        for (int x : v) s += x;
-        return double(s) / v.size();
-    };
-    auto vmax = [](const QVector<int>& v)->int { int m=v[0]; for (int x:v) if (x>m) m=x; return m; };
-    auto vmin = [](const QVector<int>& v)->int { int m=v[0]; for (int x:v) if (x<m) m=x; return m; };
-    auto stddev = [&](const QVector<int>& v)->double {
-        if (v.isEmpty()) return 0.0;
-        double m = mean(v);
-        double s = 0;
-        for (int x : v) s += (x - m) * (x - m);
-        return std::sqrt(s / v.size());
-    };
-
+    TRACE_SCOPE("stats");
     QString result;
     result += QString(u"📊 АНАЛИЗ ИОНИЗИРУЮЩЕГО ИЗЛУЧЕНИЯ ДЛЯ %1\n"_s).arg(currentCity.toUpper());
     result += QString(u"═══════════════════════════════\n\n"_s);
     result += QString(u"🏙️  Город: %1\n"_s).arg(currentCity);
-    result += QString(u"📈 Количество записей: %1\n\n"_s).arg(cityRecordCount);
+    result += QString(u"📈 Количество записей: %1\n"_s).arg(cityRecordCount);
+    const QString filterText = sql ? sqlFilterText
+                               : paged ? pagedModel->filterText()
+                               : filterModel->isActive() ? filterModel->filterText() : QString();
+    if (!filterText.isEmpty()) result += QString(u"🔎 Фильтр: %1\n"_s).arg(filterText);
+    result += u'\n';
 
     result += QString(u"☢️  ИОНИЗИРУЮЩЕЕ ИЗЛУЧЕНИЕ (мкР/ч):\n"_s);
-    result += QString(u"   • Среднее: %1\n"_s).arg(mean(rads), 0, 'f', 2);
-    result += QString(u"   • Минимальное: %1\n"_s).arg(vmin(rads));
-    result += QString(u"   • Максимальное: %1\n"_s).arg(vmax(rads));
-    result += QString(u"   • Стандартное отклонение: %1\n"_s).arg(stddev(rads), 0, 'f', 2);
+    result += QString(u"   • Среднее: %1\n"_s).arg(st.mean(), 0, 'f', 2);
+    result += QString(u"   • Минимальное: %1\n"_s).arg(st.min);
+    result += QString(u"   • Максимальное: %1\n"_s).arg(st.max);
+    result += QString(u"   • Стандартное отклонение: %1\n"_s).arg(st.stddev(), 0, 'f', 2);
+
+    // индекс доз строится по записям в памяти
+    if (sql || paged) {
+        analysisText->setPlainText(result);
+        statusBar()->showMessage(QString(u"Анализ завершен для города %1 (%2). Обработано %3 записей"_s)
+                                     .arg(currentCity, sql ? u"запрос к базе"_s : u"постраничный файл"_s)
+                                     .arg(cityRecordCount), 5000);
+        return;
+    }
+
+    // доза — по всем показаниям станций, интеграл мощности по времени
+    TRACE_SCOPE("dose");
+    const QDate doseFrom = doseFromEdit->date();
+    const QDate doseTo = doseToEdit->date();
+    QVector<int> allIds(stations->count());
+    std::iota(allIds.begin(), allIds.end(), 0);
+    QElapsedTimer doseTimer;
+    doseTimer.start();
+    const double wholeSeries = doseIndex->dose(cityId, -ResultCache::kAllDays, ResultCache::kAllDays);
+    const double cityDose = doseIndex->dose(cityId, doseFrom.toJulianDay(), doseTo.toJulianDay());
+    const double networkDose = doseIndex->networkDose(allIds, doseFrom.toJulianDay(), doseTo.toJulianDay());
+    const qint64 doseUs = doseTimer.nsecsElapsed() / 1000;
+
+    result += u'\n';
+    result += QString(u"🧮 НАКОПЛЕННАЯ ДОЗА (мР, без учёта фильтра):\n"_s);
+    result += QString(u"   • За весь ряд станции: %1\n"_s).arg(DoseIndex::toMilliR(wholeSeries), 0, 'f', 3);
+    result += QString(u"   • С %1 по %2: %3\n"_s).arg(doseFrom.toString("dd.MM.yyyy"), doseTo.toString("dd.MM.yyyy"))
+                  .arg(DoseIndex::toMilliR(cityDose), 0, 'f', 3);
+    result += QString(u"   • Вся сеть за тот же период: %1 (%2 станций)\n"_s)
+                  .arg(DoseIndex::toMilliR(networkDose), 0, 'f', 3).arg(allIds.size());
+    result += QString(u"   • Время запроса: %1 мс\n"_s).arg(doseUs / 1000.0, 0, 'f', 2);
 
     analysisText->setPlainText(result);
     statusBar()->showMessage(QString(u"Анализ завершен для города %1. Обработано %2 записей"_s)
                                  .arg(currentCity).arg(cityRecordCount), 5000);
 }
 
+void MainWindow::analyzeMetric(int cityId, const QString &city, int metric)
+{
+    TRACE_SCOPE("metric stats");
+    const MetricColumns &mc = records->metricColumns();
+    const MetricInfo &info = mc.info(metric);
+
+    qint64 count = 0;
+    double sum = 0.0, sumSq = 0.0;
+    double lo = std::numeric_limits<double>::max(), hi = std::numeric_limits<double>::lowest();
+    filterModel->forEachRow([&](qsizetype row, const PackedReading &r) {
+        double v = 0.0;
+        if (int(r.station) != cityId || !records->metric(metric, row, &v)) return;
+        ++count;
+        sum += v;
+        sumSq += v * v;
+        lo = std::min(lo, v);
+        hi = std::max(hi, v);
+    });
+
+    if (count == 0) {
+        QMessageBox::information(this, u"Нет данных"_s,
+                                 QString(u"Нет значений «%1» для города %2"_s).arg(info.title, city));
+        statusBar()->showMessage(QString(u"Нет данных для города %1"_s).arg(city));
+        return;
+    }
+
+    const double mean = sum / count;
+    const double stddev = count > 1 ? std::sqrt(std::max(0.0, (sumSq - sum * mean) / (count - 1))) : 0.0;
+    const QString unit = info.unit.isEmpty() ? QString() : u" ("_s + info.unit + u')';
+
+    QString result;
+    result += QString(u"📊 АНАЛИЗ ПОКАЗАТЕЛЯ «%1» ДЛЯ %2\n"_s).arg(info.title.toUpper(), city.toUpper());
+    result += QString(u"═══════════════════════════════\n\n"_s);
+    result += QString(u"🏙️  Город: %1\n"_s).arg(city);
+    result += QString(u"📈 Количество значений: %1\n"_s).arg(count);
+    if (filterModel->isActive())
+        result += QString(u"🔎 Фильтр: %1\n"_s).arg(filterModel->filterText());
+    result += u'\n';
+    result += QString(u"%1%2:\n"_s).arg(info.title.toUpper(), unit);
+    result += QString(u"   • Среднее: %1\n"_s).arg(mean, 0, 'f', info.decimals + 1);
+    result += QString(u"   • Минимальное: %1\n"_s).arg(lo, 0, 'f', info.decimals);
+    result += QString(u"   • Максимальное: %1\n"_s).arg(hi, 0, 'f', info.decimals);
+    result += QString(u"   • Стандартное отклонение: %1\n"_s).arg(stddev, 0, 'f', info.decimals + 1);
+
+    analysisText->setPlainText(result);
+    statusBar()->showMessage(QString(u"Анализ завершен для города %1. Обработано %2 значений"_s).arg(city).arg(count), 5000);
+}
+
+void MainWindow::refreshMetricLists()
+{
+    const MetricColumns &mc = records->metricColumns();
+
+    // выбор сохраняется по ключу показателя
+    const int analysisMetric = analysisMetricCombo->currentData().toInt();
+    const QString analysisKey = analysisMetric >= 0 && analysisMetric < mc.count() ? mc.info(analysisMetric).key : QString();
+    analysisMetricCombo->clear();
+    analysisMetricCombo->addItem(u"☢️ Радиация"_s, -1);
+    for (int m = 0; m < mc.count(); ++m) {
+        analysisMetricCombo->addItem(mc.info(m).title, m);
+        if (mc.info(m).key == analysisKey) analysisMetricCombo->setCurrentIndex(analysisMetricCombo->count() - 1);
+    }
+
+    if (!chartMetricList) return;
+    QSet<QString> checked;
+    for (int i = 0; i < chartMetricList->count(); ++i)
+        if (chartMetricList->item(i)->checkState() == Qt::Checked) checked.insert(chartMetricList->item(i)->data(Qt::UserRole + 1).toString());
+    chartMetricList->clear();
+    for (int m = 0; m < mc.count(); ++m) {
+        auto *item = new QListWidgetItem(mc.info(m).title, chartMetricList);
+        item->setData(Qt::UserRole, m);
+        item->setData(Qt::UserRole + 1, mc.info(m).key);
+        item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+        item->setCheckState(checked.contains(mc.info(m).key) ? Qt::Checked : Qt::Unchecked);
+    }
+    chartMetricList->setVisible(mc.count() > 0);
+    chartMetricLabel->setVisible(mc.count() > 0);
+}
+
+QVector<int> MainWindow::checkedChartMetrics() const
+{
+    QVector<int> ids;
+    if (!chartMetricList) return ids;
+    for (int i = 0; i < chartMetricList->count(); ++i)
+        if (chartMetricList->item(i)->checkState() == Qt::Checked) ids.append(chartMetricList->item(i)->data(Qt::UserRole).toInt());
+    return ids;
+}
+
 void MainWindow::saveToJson()
 {
-    if (table->rowCount() == 0) {
+    if (pagedActive() || sqlActive()) {
+        saveExternal();
+        return;
+    }
+    if (records->size() == 0) {
         QMessageBox::warning(this, u"Нет данных"_s, u"Таблица пуста. Нечего сохранять."_s);
         statusBar()->showMessage(u"Ошибка: нет данных для сохранения"_s);
         return;
     }
 
-    const QString fileName = QFileDialog::getSaveFileName(this, u"Сохранить данные"_s, "", u"JSON файлы (*.json)"_s);
+    const QString fileName = QFileDialog::getSaveFileName(this, u"Сохранить данные"_s, "",
+                                                          u"JSON файлы (*.json);;Архив радиации (*.rada);;База SQLite (*.sqlite *.db)"_s);
     if (fileName.isEmpty()) return;
 
-    QJsonArray records;
-    for (int i = 0; i < table->rowCount(); i++) {
+    // компактный архив для долгого хранения: блоки по станциям, дельта-кодирование
+    if (Archive::isArchiveFile(fileName)) {
+        if (records->metricColumns().count() > 0
+            && QMessageBox::question(this, u"Архив радиации"_s,
+                                     u"Архив хранит только радиацию: дополнительные показатели (%1) не будут сохранены. Продолжить?"_s
+                                         .arg(records->metricColumns().count())) != QMessageBox::Yes)
+            return;
+        QString error;
+        if (!Archive::Writer::save(fileName, *records, *stations, &error)) {
+            QMessageBox::warning(this, u"Ошибка"_s, QString(u"Не удалось сохранить архив:\n%1"_s).arg(error));
+            statusBar()->showMessage(u"Ошибка сохранения файла"_s);
+            return;
+        }
+        const qint64 bytes = QFileInfo(fileName).size();
+        QMessageBox::information(this, u"Успех"_s, QString(u"Архив сохранён в файл:\n%1\n%2 КБ, %3 Б на запись"_s)
+                                     .arg(fileName).arg(bytes / 1024)
+                                     .arg(double(bytes) / qMax<qsizetype>(1, records->size()), 0, 'f', 2));
+        statusBar()->showMessage(QString(u"Данные сохранены в: %1"_s).arg(fileName), 5000);
+        return;
+    }
+
+    // база для наборов, которые не помещаются в память: пакетная вставка, индекс (станция, дата)
+    if (SqlStore::isDatabaseFile(fileName)) {
+        if (records->metricColumns().count() > 0
+            && QMessageBox::question(this, u"База SQLite"_s,
+                                     u"База хранит только радиацию: дополнительные показатели (%1) не будут сохранены. Продолжить?"_s
+                                         .arg(records->metricColumns().count())) != QMessageBox::Yes)
+            return;
+        // тот же файл, что открыт сейчас, пишется через уже открытое соединение
+        SqlStore fresh(stations);
+        SqlStore *target = sqlStore && sqlStore->fileName() == fileName ? sqlStore.get() : &fresh;
+        QString error;
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        const bool ok = (target->isOpen() || target->open(fileName, &error))
+                        && target->importModel(*records, true, &error);
+        QApplication::restoreOverrideCursor();
+        if (!ok) {
+            QMessageBox::warning(this, u"Ошибка"_s, QString(u"Не удалось сохранить базу:\n%1"_s).arg(error));
+            statusBar()->showMessage(u"Ошибка сохранения файла"_s);
+            return;
+        }
+        QMessageBox::information(this, u"Успех"_s, QString(u"%1 записей сохранено в базу:\n%2"_s)
+                                     .arg(records->size()).arg(fileName));
+        statusBar()->showMessage(QString(u"Данные сохранены в: %1"_s).arg(fileName), 5000);
+        return;
+    }
+
+    QJsonArray out;
+    const MetricColumns &mc = records->metricColumns();
+    for (qsizetype row = 0; row < records->size(); ++row) {
+        const PackedReading &r = records->at(row);
         QJsonObject obj;
-        obj["city"_L1] = table->item(i, 0)->text();
-        obj["datetime"_L1] = table->item(i, 1)->text();
+        obj["city"_L1] = stations->name(r.station);
+        obj["datetime"_L1] = QDate::fromJulianDay(r.day).toString("yyyy-MM-dd");
+        obj["radiation"_L1] = int(r.rad);
+        for (int m = 0; m < mc.count(); ++m) {
+            double v = 0.0;
+            if (mc.value(m, row, &v)) obj[mc.info(m).key] = mc.rounded(m, v);
+        }
 
-        // только число до пробела
-        const QString radText = table->item(i, 2)->text().section(' ', 0, 0);
-        obj["radiation"_L1] = radText.toInt();
+        Coord pos;
+        if (stations->coord(r.station, &pos)) {
+            obj["lat"_L1] = pos.lat;
+            obj["lon"_L1] = pos.lon;
+        }
 
-        records.append(obj);
+        out.append(obj);
     }
 
-    QJsonDocument doc(records);
+    QJsonDocument doc(out);
     QFile file(fileName);
     if (!file.open(QIODevice::WriteOnly)) {
         QMessageBox::warning(this, u"Ошибка"_s, u"Не удалось открыть файл для записи."_s);
@@ -632,78 +898,456 @@ void MainWindow::saveToJson()
     statusBar()->showMessage(QString(u"Данные сохранены в: %1"_s).arg(fileName), 5000);
 }
 
-void MainWindow::loadFromJson()
+void MainWindow::saveExternal()
 {
-    const QString fileName = QFileDialog::getOpenFileName(this, u"Загрузить данные"_s, "", u"JSON файлы (*.json)"_s);
-    if (fileName.isEmpty()) return;
-
-    QFile file(fileName);
-    if (!file.open(QIODevice::ReadOnly)) {
-        QMessageBox::warning(this, u"Ошибка"_s, u"Не удалось открыть файл."_s);
-        statusBar()->showMessage(u"Ошибка открытия файла"_s);
+    const bool sql = sqlActive();
+    const qint64 count = sql ? sqlStore->count() : pagedModel->recordCount();
+    if (count == 0) {
+        QMessageBox::warning(this, u"Нет данных"_s, u"Таблица пуста. Нечего сохранять."_s);
+        statusBar()->showMessage(u"Ошибка: нет данных для сохранения"_s);
         return;
     }
 
-    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
-    file.close();
+    const QString fileName = QFileDialog::getSaveFileName(this, u"Сохранить данные"_s, "",
+                                                          u"JSON файлы (*.json);;Архив радиации (*.rada);;База SQLite (*.sqlite *.db)"_s);
+    if (fileName.isEmpty()) return;
 
-    if (!doc.isArray()) {
-        QMessageBox::warning(this, u"Ошибка"_s, u"Формат файла неверный. Ожидался массив JSON."_s);
-        statusBar()->showMessage(u"Ошибка: неверный формат JSON"_s);
+    // в базе показателей нет — переносить нечего
+    const QStringList metrics = sql ? QStringList() : pagedModel->pageIndex().metricKeys;
+    if ((Archive::isArchiveFile(fileName) || SqlStore::isDatabaseFile(fileName)) && !metrics.isEmpty()
+        && QMessageBox::question(this, u"Сохранение"_s,
+                                 u"Архив и база хранят только радиацию: дополнительные показатели (%1) не будут сохранены. Продолжить?"_s
+                                     .arg(metrics.join(u", "_s))) != QMessageBox::Yes)
         return;
-    }
-
-    QJsonArray records = doc.array();
-    table->setRowCount(0);
-
-    for (auto v : records) {
-        QJsonObject obj = v.toObject();
-        const int row = table->rowCount();
-        table->insertRow(row);
-
-        const QString city = obj.value("city"_L1).toString();
-        const int rad = obj.value("radiation"_L1).toInt();
 
-        auto *cityItem = new QTableWidgetItem(city);
-        cityItem->setData(Qt::UserRole, seqCounter);
-        table->setItem(row, 0, cityItem);
-
-        auto *dtItem = new QTableWidgetItem(obj.value("datetime"_L1).toString());
-        table->setItem(row, 1, dtItem);
+    Trace::Operation traceOp("saveExternal");
+    QString error;
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    statusBar()->showMessage(sql ? u"⏳ Сохранение из базы..."_s : u"⏳ Сохранение постранично..."_s);
+    const bool ok = writeExternal(fileName, &error);
+    QApplication::restoreOverrideCursor();
+    traceOp.finish();
+    if (!ok) {
+        QMessageBox::warning(this, u"Ошибка"_s, QString(u"Не удалось сохранить файл:\n%1"_s).arg(error));
+        statusBar()->showMessage(u"Ошибка сохранения файла"_s);
+        return;
+    }
+    QMessageBox::information(this, u"Успех"_s, QString(u"%1 записей сохранено в файл:\n%2"_s).arg(count).arg(fileName));
+    statusBar()->showMessage(QString(u"Данные сохранены в: %1"_s).arg(fileName), 5000);
 
-        auto *radItem = new QTableWidgetItem(QString::number(rad) + u" мкР/ч"_s);
+    // открытый файл переписан: индекс устарел, добавленные записи теперь в самом файле
+    if (!sql && QFileInfo(fileName) == QFileInfo(pagedModel->fileName())) openLazy(fileName);
+}
 
-        QColor bgColor;
-        if (rad <= 15)       bgColor = QColor("#d1fae5");
-        else if (rad <= 30)  bgColor = QColor("#fef3c7");
-        else if (rad <= 60)  bgColor = QColor("#ffedd5");
-        else                 bgColor = QColor("#fee2e2");
+bool MainWindow::writeExternal(const QString &fileName, QString *error)
+{
+    TRACE_SCOPE("external save");
+    // все записи файла и добавленные в окне или все строки базы, без фильтра
+    const bool sql = sqlActive();
+    if (sql && SqlStore::isDatabaseFile(fileName) && QFileInfo(fileName) == QFileInfo(sqlStore->fileName()))
+        return true;   // добавленные записи уже в базе: переписывать её саму из себя нечего
+    const JsonPageSource all = sql ? JsonPageSource() : pagedModel->source().unfiltered();
+    auto readError = [this, sql, &all]() {
+        return sql ? u"Не удалось прочитать базу: "_s + sqlStore->lastError() : u"Не удалось прочитать файл "_s + all.fileName();
+    };
+    const SqlStore::ReadingSource scan = [this, sql, &all](const std::function<void(const PackedReading &)> &sink) {
+        return sql ? sqlStore->scanAll(sink) : all.forEachReading({}, sink);
+    };
 
-        cityItem->setBackground(bgColor);
-        dtItem->setBackground(bgColor);
-        radItem->setBackground(bgColor);
+    if (Archive::isArchiveFile(fileName)) {
+        Archive::Writer writer(fileName);
+        if (!writer.begin(Archive::Writer::stationsOf(*stations), error)) return false;
+        bool written = true;
+        const bool read = scan([&](const PackedReading &r) {
+            if (written && !writer.write(r.station, r.day, r.rad)) written = false;
+        });
+        if (!written || !read) {
+            if (error) *error = !written ? writer.errorString() : readError();
+            return false;
+        }
+        return writer.finish(error);
+    }
 
-        table->setItem(row, 2, radItem);
-        seqCounter++;
+    if (SqlStore::isDatabaseFile(fileName)) {
+        // тот же файл, что открыт сейчас, пишется через уже открытое соединение
+        SqlStore fresh(stations);
+        SqlStore *target = sqlStore && sqlStore->fileName() == fileName ? sqlStore.get() : &fresh;
+        return (target->isOpen() || target->open(fileName, error)) && target->importReadings(scan, true, error);
     }
 
-    QMessageBox::information(this, u"Успех"_s, QString(u"Загружено %1 записей из файла:\n%2"_s).arg(records.size()).arg(fileName));
-    statusBar()->showMessage(QString(u"Загружено %1 записей из %2"_s).arg(records.size()).arg(fileName), 5000);
+    // JSON: объекты файла переносятся как есть, вместе с показателями; строки базы и добавленные
+    // записи — объектом на запись; массив пишется по объекту
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    bool first = true;
+    auto put = [&](const QJsonObject &obj) {
+        QByteArray bytes = QJsonDocument(obj).toJson(QJsonDocument::Indented);
+        bytes.chop(1);   // toJson заканчивает документ переводом строки
+        file.write(first ? "[\n" : ",\n");
+        file.write(bytes);
+        first = false;
+    };
+    auto objectOf = [this](const PackedReading &r) {
+        QJsonObject obj;
+        obj["city"_L1] = stations->name(r.station);
+        obj["datetime"_L1] = QDate::fromJulianDay(r.day).toString("yyyy-MM-dd");
+        obj["radiation"_L1] = int(r.rad);
+        Coord pos;
+        if (stations->coord(r.station, &pos)) {
+            obj["lat"_L1] = pos.lat;
+            obj["lon"_L1] = pos.lon;
+        }
+        return obj;
+    };
+    const bool read = sql ? scan([&](const PackedReading &r) { put(objectOf(r)); }) : all.forEachObject(put);
+    if (!read) {
+        file.cancelWriting();
+        if (error) *error = readError();
+        return false;
+    }
+    for (const PackedReading &r : all.appendedRecords()) put(objectOf(r));
+    file.write(first ? "[]\n" : "\n]\n");
+    if (!file.commit()) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    return true;
 }
 
-// ============================
-// ЧАРТЫ
-// ============================
+void MainWindow::loadFromJson()
+{
+    const QString fileName = QFileDialog::getOpenFileName(this, u"Загрузить данные"_s, "",
+                                                          u"Данные (*.json *.rada *.sqlite *.db);;JSON файлы (*.json);;Архив радиации (*.rada);;База SQLite (*.sqlite *.db)"_s);
+    if (fileName.isEmpty()) return;
+    loadFile(fileName);
+}
 
-void MainWindow::setupCharts()
+bool MainWindow::askArchiveRange(const Archive::Reader &reader, const QString &fileName, qint64 *fromDay, qint64 *toDay)
 {
-    createRadiationChart();
+    QDialog dialog(this);
+    dialog.setWindowTitle(u"Период загрузки"_s);
+    auto *form = new QFormLayout(&dialog);
+    form->addRow(new QLabel(QString(u"%1: %2 записей. Загрузить весь архив или только период?"_s)
+                                .arg(QFileInfo(fileName).fileName()).arg(reader.recordCount())));
+    const QDate first = QDate::fromJulianDay(reader.firstDay());
+    const QDate last = QDate::fromJulianDay(reader.lastDay());
+    auto *fromEdit = new QDateEdit(first);
+    auto *toEdit = new QDateEdit(last);
+    for (QDateEdit *edit : {fromEdit, toEdit}) {
+        edit->setCalendarPopup(true);
+        edit->setDisplayFormat(u"dd.MM.yyyy"_s);
+        edit->setDateRange(first, last);
+    }
+    form->addRow(u"С:"_s, fromEdit);
+    form->addRow(u"По:"_s, toEdit);
+    auto *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+    form->addRow(buttons);
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    if (dialog.exec() != QDialog::Accepted) return false;
+
+    *fromDay = std::min(fromEdit->date(), toEdit->date()).toJulianDay();
+    *toDay = std::max(fromEdit->date(), toEdit->date()).toJulianDay();
+    return true;
 }
 
-void MainWindow::createRadiationChart()
+void MainWindow::loadFile(const QString &fileName)
 {
-    QChart *chart = new QChart();
-    chart->setTitle(u"☢️ Радиация по городам"_s);
+    Trace::Operation traceOp("loadFromJson");
+    if (SqlStore::isDatabaseFile(fileName)) {
+        traceOp.finish();
+        openDatabase(fileName);
+        return;
+    }
+    if (Archive::isArchiveFile(fileName)) {
+        Archive::Reader reader;
+        QString error;
+        // неоткрытый архив и отказ от выбора периода не трогают набор и не оставляют шага отмены
+        if (!reader.open(fileName, &error)) {
+            traceOp.finish();
+            QMessageBox::warning(this, u"Ошибка"_s, QString(u"Не удалось прочитать архив:\n%1"_s).arg(error));
+            statusBar()->showMessage(u"Ошибка открытия файла"_s);
+            return;
+        }
+        qint64 fromDay = reader.firstDay(), toDay = reader.lastDay();
+        if (reader.recordCount() >= kArchiveRangeRecords && !askArchiveRange(reader, fileName, &fromDay, &toDay)) {
+            traceOp.finish();
+            return;
+        }
+        // период — только блоки, попавшие в него, по индексу архива
+        const bool whole = fromDay <= reader.firstDay() && toDay >= reader.lastDay();
+        recordEdit(u"загрузка "_s + QFileInfo(fileName).fileName());
+        const bool ok = whole ? reader.loadInto(*records, *stations, &error)
+                              : reader.loadRange(*records, *stations, fromDay, toDay, &error);
+        setTableModel(recordsView());
+        onDatasetChanged();
+        traceOp.finish();
+        if (!ok) {
+            QMessageBox::warning(this, u"Ошибка"_s, QString(u"Не удалось прочитать архив:\n%1"_s).arg(error));
+            statusBar()->showMessage(u"Ошибка открытия файла"_s);
+            return;
+        }
+        sessionSource = SourceStamp::of(fileName);
+        QMessageBox::information(this, u"Успех"_s, QString(u"Загружено %1 записей из файла:\n%2"_s).arg(records->size()).arg(fileName));
+        statusBar()->showMessage(QString(u"Загружено %1 записей из %2"_s).arg(records->size()).arg(fileName), 5000);
+        return;
+    }
+
+    // большой файл открывается постранично: индекс смещений, строки — по мере прокрутки
+    if (QFileInfo(fileName).size() >= kLazyOpenBytes) {
+        traceOp.finish();
+        sessionSource = SourceStamp::of(fileName);
+        openLazy(fileName);
+        return;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        traceOp.finish();
+        QMessageBox::warning(this, u"Ошибка"_s, u"Не удалось открыть файл."_s);
+        statusBar()->showMessage(u"Ошибка открытия файла"_s);
+        return;
+    }
+
+    QByteArray raw;
+    {
+        TRACE_SCOPE("read");
+        raw = file.readAll();
+    }
+    file.close();
+    QJsonDocument doc;
+    {
+        TRACE_SCOPE("parse");
+        doc = QJsonDocument::fromJson(raw);
+    }
+
+    if (!doc.isArray()) {
+        traceOp.finish();
+        QMessageBox::warning(this, u"Ошибка"_s, u"Формат файла неверный. Ожидался массив JSON."_s);
+        statusBar()->showMessage(u"Ошибка: неверный формат JSON"_s);
+        return;
+    }
+
+    const QJsonArray rows = doc.array();
+    recordEdit(u"загрузка "_s + QFileInfo(fileName).fileName());
+    Trace::Scope insertSpan("insert");
+    const int skipped = records->loadJson(rows, true);
+    setTableModel(recordsView());
+    insertSpan.finish();
+    onDatasetChanged();
+    traceOp.finish();
+    sessionSource = SourceStamp::of(fileName);
+
+    if (skipped > 0)
+        QMessageBox::warning(this, u"Внимание"_s, QString(u"Пропущено %1 записей без города/даты, сверх лимита станций или с радиацией вне 0…%2."_s)
+                                                  .arg(skipped).arg(RadiationModel::kMaxRadiation));
+    QMessageBox::information(this, u"Успех"_s, QString(u"Загружено %1 записей из файла:\n%2"_s).arg(records->size()).arg(fileName));
+    statusBar()->showMessage(QString(u"Загружено %1 записей из %2"_s).arg(records->size()).arg(fileName), 5000);
+}
+
+// ============================
+// ЧАРТЫ
+// ============================
+
+void MainWindow::setupChartsTab()
+{
+    QVBoxLayout *chartsLayout = new QVBoxLayout(chartsTab);
+    chartsLayout->setSpacing(15);
+    chartsLayout->setContentsMargins(20, 20, 20, 20);
+
+    QHBoxLayout *chartsButtonLayout = new QHBoxLayout;
+    btnUpdateCharts = new QPushButton(u"🔄 Обновить график"_s);
+    btnUpdateCharts->setObjectName(u"btnUpdateCharts"_s);
+    connect(btnUpdateCharts, &QPushButton::clicked, this, &MainWindow::updateCharts);
+    chartsButtonLayout->addStretch();
+    chartsButtonLayout->addWidget(btnUpdateCharts);
+    chartsButtonLayout->addStretch();
+    chartsLayout->addLayout(chartsButtonLayout);
+
+    // Панель управления графиком
+    QHBoxLayout *chartAndControls = new QHBoxLayout;
+    QWidget *controlsPanel = new QWidget;
+    controlsPanel->setFixedWidth(260);
+    controlsPanel->setObjectName(u"chartControls"_s);
+    QVBoxLayout *controlsLayout = new QVBoxLayout(controlsPanel);
+    QLabel *chartTypeLbl = new QLabel(u"Тип графика:"_s);
+    chartTypeCombo = new QComboBox;
+    chartTypeCombo->addItems({u"Точки+линии"_s, u"Сглаженная"_s});
+    chartTypeCombo->setCurrentIndex(0);
+    controlsLayout->addWidget(chartTypeLbl);
+    controlsLayout->addWidget(chartTypeCombo);
+
+    btnFindMinMax = new QPushButton(u"MIN/MAX"_s);
+    controlsLayout->addWidget(btnFindMinMax);
+    connect(btnFindMinMax, &QPushButton::clicked, this, &MainWindow::findMinMax);
+    btnTrend = new QPushButton(u"Тенденция"_s);
+    controlsLayout->addWidget(btnTrend);
+    connect(btnTrend, &QPushButton::clicked, this, &MainWindow::computeTrend);
+    QLabel *periodLbl = new QLabel(u"Период сезонности:"_s);
+    seasonalPeriodCombo = new QComboBox;
+    seasonalPeriodCombo->addItem(u"Авто (периодограмма)"_s, SeasonalAnalysis::kAutoPeriod);
+    seasonalPeriodCombo->addItem(u"Неделя"_s, 7);
+    seasonalPeriodCombo->addItem(u"Месяц (30 дн.)"_s, 30);
+    seasonalPeriodCombo->addItem(u"Год (365 дн.)"_s, 365);
+    controlsLayout->addWidget(periodLbl);
+    controlsLayout->addWidget(seasonalPeriodCombo);
+    btnSeasonal = new QPushButton(u"Сезонность"_s);
+    controlsLayout->addWidget(btnSeasonal);
+    connect(btnSeasonal, &QPushButton::clicked, this, &MainWindow::computeSeasonal);
+    QLabel *gridLbl = new QLabel(u"Сетка времени:"_s);
+    gridStepCombo = new QComboBox;
+    gridStepCombo->addItem(u"Исходные точки"_s, -1);
+    gridStepCombo->addItem(u"День"_s, int(ResampleOptions::Step::Day));
+    gridStepCombo->addItem(u"Неделя"_s, int(ResampleOptions::Step::Week));
+    gridStepCombo->addItem(u"Месяц"_s, int(ResampleOptions::Step::Month));
+    gridAggCombo = new QComboBox;
+    gridAggCombo->addItem(u"Среднее в ячейке"_s, int(ResampleOptions::Aggregation::Mean));
+    gridAggCombo->addItem(u"Минимум в ячейке"_s, int(ResampleOptions::Aggregation::Min));
+    gridAggCombo->addItem(u"Максимум в ячейке"_s, int(ResampleOptions::Aggregation::Max));
+    gridAggCombo->addItem(u"Последнее в ячейке"_s, int(ResampleOptions::Aggregation::Last));
+    gridGapCombo = new QComboBox;
+    gridGapCombo->addItem(u"Пропуски — разрыв"_s, int(ResampleOptions::GapFill::None));
+    gridGapCombo->addItem(u"Пропуски — перенос значения"_s, int(ResampleOptions::GapFill::CarryForward));
+    gridGapCombo->addItem(u"Пропуски — линейно"_s, int(ResampleOptions::GapFill::Linear));
+    gridMaxGapSpin = new QSpinBox;
+    gridMaxGapSpin->setRange(1, 365);
+    gridMaxGapSpin->setValue(ResampleOptions().maxGap);
+    gridMaxGapSpin->setPrefix(u"не длиннее "_s);
+    gridMaxGapSpin->setSuffix(u" ячеек"_s);
+    controlsLayout->addWidget(gridLbl);
+    controlsLayout->addWidget(gridStepCombo);
+    controlsLayout->addWidget(gridAggCombo);
+    controlsLayout->addWidget(gridGapCombo);
+    controlsLayout->addWidget(gridMaxGapSpin);
+    auto syncGridControls = [this]() {
+        const bool on = gridStepCombo->currentData().toInt() >= 0;
+        gridAggCombo->setEnabled(on);
+        gridGapCombo->setEnabled(on);
+        gridMaxGapSpin->setEnabled(on && gridGapCombo->currentData().toInt() != int(ResampleOptions::GapFill::None));
+    };
+    syncGridControls();
+    for (QComboBox *combo : {gridStepCombo, gridAggCombo, gridGapCombo})
+        connect(combo, &QComboBox::currentIndexChanged, this, [this, syncGridControls]() {
+            syncGridControls();
+            if (!chartedStations.isEmpty()) updateCharts();
+        });
+    connect(gridMaxGapSpin, &QSpinBox::valueChanged, this, [this]() {
+        if (!chartedStations.isEmpty()) updateCharts();
+    });
+    doseCheck = new QCheckBox(u"Накопленная доза (мР)"_s);
+    controlsLayout->addWidget(doseCheck);
+    connect(doseCheck, &QCheckBox::toggled, this, [this]() {
+        if (!chartedStations.isEmpty()) updateCharts();
+    });
+    forecastCheck = new QCheckBox(u"Прогноз на %1 дн."_s.arg(Forecaster::kHorizon));
+    controlsLayout->addWidget(forecastCheck);
+    chartMetricLabel = new QLabel(u"Показатели (своя ось справа):"_s);
+    chartMetricList = new QListWidget;
+    chartMetricList->setMaximumHeight(120);
+    controlsLayout->addWidget(chartMetricLabel);
+    controlsLayout->addWidget(chartMetricList);
+    connect(chartMetricList, &QListWidget::itemChanged, this, [this]() {
+        if (!chartedStations.isEmpty()) updateCharts();
+    });
+    connect(forecastCheck, &QCheckBox::toggled, this, [this](bool on) {
+        if (on) refreshForecasts();
+        if (!chartedStations.isEmpty()) updateCharts();
+    });
+    controlsLayout->addStretch();
+    chartAndControls->addWidget(controlsPanel);
+
+    QScrollArea *scrollArea = new QScrollArea;
+    scrollArea->setWidgetResizable(true);
+    scrollArea->setObjectName(u"chartsScroll"_s);
+
+    QWidget *chartsContainer = new QWidget;
+    QVBoxLayout *chartsContainerLayout = new QVBoxLayout(chartsContainer);
+    chartsContainerLayout->setSpacing(20);
+
+    QLabel *radLabel = new QLabel(u"☢️ Ионизирующее излучение (мкР/ч)"_s);
+    radLabel->setObjectName(u"chartCaption"_s);
+    chartsContainerLayout->addWidget(radLabel);
+
+    radiationChartView = new QChartView;
+    QSize chartSize(900, 420);
+    radiationChartView->setMinimumSize(chartSize);
+    radiationChartView->setRenderHint(QPainter::Antialiasing);
+
+    QHBoxLayout *chartRow = new QHBoxLayout;
+    chartRow->addLayout(chartAndControls);
+    chartRow->addWidget(radiationChartView, 1);
+    chartsContainerLayout->addLayout(chartRow);
+
+    // Список городов для наложения
+    QGroupBox *overlayGroup = new QGroupBox(u"🔀 Наложение графиков по городам"_s);
+    QVBoxLayout *overlayLayout = new QVBoxLayout;
+    overlayProxy = new QSortFilterProxyModel(this);
+    overlayProxy->setSourceModel(overlayModel);
+    overlayProxy->setFilterCaseSensitivity(Qt::CaseInsensitive);
+
+    overlaySearchEdit = new QLineEdit;
+    overlaySearchEdit->setPlaceholderText(u"🔎 Начало названия станции..."_s);
+    overlaySearchEdit->setClearButtonEnabled(true);
+    connect(overlaySearchEdit, &QLineEdit::textChanged, this, [this](const QString &text) {
+        // фильтр по префиксу: «Выбрать все» затем отмечает только найденные станции
+        overlayProxy->setFilterRegularExpression(
+            QRegularExpression(u"^"_s + QRegularExpression::escape(text), QRegularExpression::CaseInsensitiveOption));
+    });
+
+    cityOverlayList = new QListView;
+    cityOverlayList->setModel(overlayProxy);
+    cityOverlayList->setUniformItemSizes(true);
+    cityOverlayList->setSelectionMode(QAbstractItemView::NoSelection);
+    cityOverlayList->setObjectName(u"overlayList"_s);
+    overlayLayout->addWidget(new QLabel(u"Выберите города для наложения:"_s));
+    overlayLayout->addWidget(overlaySearchEdit);
+    overlayLayout->addWidget(cityOverlayList);
+    QHBoxLayout *overlayBtns = new QHBoxLayout;
+    btnSelectAllCities = new QPushButton(u"Выбрать все"_s);
+    btnClearAllCities = new QPushButton(u"Снять все"_s);
+    overlayBtns->addWidget(btnSelectAllCities);
+    overlayBtns->addWidget(btnClearAllCities);
+    overlayBtns->addStretch();
+    overlayGroup->setLayout(overlayLayout);
+    overlayLayout->addLayout(overlayBtns);
+    chartsContainerLayout->addWidget(overlayGroup);
+
+    scrollArea->setWidget(chartsContainer);
+    chartsLayout->addWidget(scrollArea);
+
+    setupCharts();
+
+    // чекбоксы городов: «Выбрать все» действует на отфильтрованные строки
+    connect(btnSelectAllCities, &QPushButton::clicked, this, [this]() {
+        if (overlaySearchEdit->text().isEmpty()) {
+            overlayModel->setAllChecked(true);
+            return;
+        }
+        QVector<int> ids;
+        ids.reserve(overlayProxy->rowCount());
+        for (int i = 0; i < overlayProxy->rowCount(); ++i)
+            ids.append(overlayProxy->index(i, 0).data(StationIdRole).toInt());
+        overlayModel->setChecked(ids, true);
+    });
+    connect(btnClearAllCities, &QPushButton::clicked, this, [this]() {
+        overlayModel->setAllChecked(false);
+    });
+    refreshMetricLists();
+    if (!pendingChartSettings.isEmpty()) applyChartSettings(std::exchange(pendingChartSettings, {}));
+}
+
+void MainWindow::setupCharts()
+{
+    createRadiationChart();
+}
+
+void MainWindow::createRadiationChart()
+{
+    QChart *chart = new QChart();
+    chart->setTitle(u"☢️ Радиация по городам"_s);
     chart->setAnimationOptions(QChart::SeriesAnimations);
     chart->setTheme(QChart::ChartThemeLight);
     chart->legend()->setVisible(true);
@@ -744,26 +1388,106 @@ void MainWindow::createRadiationChart()
 
     radiationChartView->setChart(chart);
     radiationChartView->setRubberBand(QChartView::RectangleRubberBand);
+
+    // плотные облака точек — растровым слоем поверх графика
+    pointCloud = new PointCloudLayer(chart);
+    connect(pointCloud, &PointCloudLayer::hovered, this, &MainWindow::showChartTip);
+
+    // ✅ КРАСИВЫЙ ТУЛТИП (скруглённые углы, тень, не обрезает текст) — один на все точки графика
+    chartTipText = new QGraphicsTextItem();
+    QFont f; f.setPointSize(10);
+    chartTipText->setFont(f);
+    chartTipText->setDefaultTextColor(Qt::black);
+    chartTipText->setZValue(3001);
+    chartTipText->setVisible(false);
+    radiationChartView->scene()->addItem(chartTipText);
+
+    chartTipBg = new QGraphicsPathItem();
+    chartTipBg->setBrush(QColor(255,255,255));
+    chartTipBg->setPen(QPen(Qt::black, 1));
+    chartTipBg->setZValue(3000);
+    chartTipBg->setVisible(false);
+    radiationChartView->scene()->addItem(chartTipBg);
+}
+
+void MainWindow::showChartTip(const QString &city, const QPointF &p, bool state)
+{
+    if (!state) {
+        chartTipBg->setVisible(false);
+        chartTipText->setVisible(false);
+        return;
+    }
+    QString text = QString("<b>%1</b><br>Дата: %2<br>Радиация: %3 мкР/ч")
+                       .arg(city)
+                       .arg(QDateTime::fromMSecsSinceEpoch(qint64(p.x())).toString("dd.MM.yyyy"))
+                       .arg(int(std::lround(p.y())));
+
+    chartTipText->setHtml(text);
+
+    QPointF pos = radiationChartView->chart()->mapToPosition(p);
+
+    // позиция тултипа
+    QPointF tipPos = pos + QPointF(12, -10);
+    chartTipText->setPos(tipPos);
+
+    QRectF r = chartTipText->boundingRect();
+    r.adjust(-6, -6, 6, 6);
+
+    // скругленный фон
+    QPainterPath path;
+    path.addRoundedRect(r, 6, 6);
+    chartTipBg->setPath(path);
+    chartTipBg->setPos(tipPos);
+
+    // делаем видимым
+    chartTipBg->setVisible(true);
+    chartTipText->setVisible(true);
 }
 
-static void hideScatterLegend(QChart *chart, QScatterSeries *scatter) {
-    if (!chart || !scatter || !chart->legend()) return;
-    const auto markers = chart->legend()->markers(scatter);
+static void hideLegendMarker(QChart *chart, QAbstractSeries *series) {
+    if (!chart || !series || !chart->legend()) return;
+    const auto markers = chart->legend()->markers(series);
     for (QLegendMarker *m : markers) if (m) m->setVisible(false);
 }
 
-void MainWindow::updateCharts()
+bool MainWindow::chartGridOptions(ResampleOptions *out) const
+{
+    if (!gridStepCombo || gridStepCombo->currentData().toInt() < 0) return false;
+    out->step = ResampleOptions::Step(gridStepCombo->currentData().toInt());
+    out->aggregation = ResampleOptions::Aggregation(gridAggCombo->currentData().toInt());
+    out->gapFill = ResampleOptions::GapFill(gridGapCombo->currentData().toInt());
+    out->maxGap = gridMaxGapSpin->value();
+    return true;
+}
+
+QVector<int> MainWindow::chartStations(int *totalSelected) const
 {
-    QList<QString> selectedCities;
-    for (int i = 0; i < cityOverlayList->count(); ++i) {
-        if (cityOverlayList->item(i)->checkState() == Qt::Checked)
-            selectedCities.append(cityOverlayList->item(i)->text());
+    QVector<int> ids = overlayModel->checkedIds();
+    if (ids.isEmpty()) {
+        const int current = stations->find(cityComboBox->currentText().trimmed());
+        if (current >= 0) ids = { current };
     }
-    if (selectedCities.isEmpty())
-        selectedCities = { cityComboBox->currentText() };
+    if (totalSelected) *totalSelected = int(ids.size());
+    if (ids.size() > MaxOverlaySeries)
+        ids.resize(MaxOverlaySeries);
+    return ids;
+}
+
+void MainWindow::updateCharts()
+{
+    Trace::Operation traceOp("updateCharts");
+    const bool sql = sqlActive();
+    int totalSelected = 0;
+    const QVector<int> selectedCities = chartStations(&totalSelected);
 
     QChart *chart = radiationChartView->chart();
     chart->removeAllSeries();
+    chartedStations.clear();
+    // правые оси (показатели, компоненты разложения) строятся заново
+    while (QValueAxis *right = valueAxisAt(chart, Qt::AlignRight)) {
+        chart->removeAxis(right);
+        delete right;
+    }
 
     QDateTimeAxis *axisX = nullptr;
     QValueAxis *axisY = nullptr;
@@ -779,8 +1503,7 @@ void MainWindow::updateCharts()
         chart->addAxis(axisX, Qt::AlignBottom);
     }
 
-    for (auto *ay : chart->axes(Qt::Vertical))
-        axisY = qobject_cast<QValueAxis*>(ay);
+    axisY = valueAxisAt(chart, Qt::AlignLeft);
 
     if (!axisY) {
         axisY = new QValueAxis;
@@ -803,7 +1526,51 @@ void MainWindow::updateCharts()
     int colorIndex = 0;
     bool useSpline = (chartTypeCombo && chartTypeCombo->currentText().startsWith("Сглаж"));
 
-    for (const QString &city : selectedCities) {
+    ResampleOptions grid;
+    const bool resampled = chartGridOptions(&grid);
+
+    // один проход по записям раскладывает точки по выбранным станциям
+    Trace::Scope collectSpan("collect");
+    QHash<int, QVector<std::pair<qint64, int>>> pointsByStation;
+    QVector<StationReading> gridInput;
+    for (int cityId : selectedCities) pointsByStation.insert(cityId, {});
+    auto collect = [&](const PackedReading &r) {
+        auto it = pointsByStation.find(r.station);
+        if (it == pointsByStation.end()) return;
+        if (resampled) {
+            gridInput.append({int(r.station), r.day, int(r.rad)});
+            return;
+        }
+        const qint64 ts = QDateTime(QDate::fromJulianDay(r.day), QTime(0,0)).toMSecsSinceEpoch();
+        it->push_back({ts, int(r.rad)});
+    };
+    // из базы читаются только строки выбранных станций — по индексу (станция, дата),
+    // из постраничного файла — страницы потоком, без загрузки записей в память
+    if (!selectedCities.isEmpty()) {
+        if (sql) sqlStore->forEachReading(selectedCities, sqlWhere, collect);
+        else forEachViewReading(selectedCities, collect);
+    }
+    collectSpan.finish();
+
+    // регулярная сетка: пустые ячейки становятся разрывами линии
+    QHash<int, ResampledSeries> gridByStation;
+    if (resampled) {
+        for (ResampledSeries &g : Resampler::resampleAll(gridInput, selectedCities, grid))
+            gridByStation.insert(g.station, std::move(g));
+    }
+
+    // десятки тысяч маркеров — растровый слой с плитками вместо элемента сцены на точку
+    qsizetype markerCount = 0;
+    for (int cityId : selectedCities) {
+        if (!resampled) markerCount += pointsByStation.value(cityId).size();
+        else if (const auto it = gridByStation.constFind(cityId); it != gridByStation.cend()) markerCount += it->size();
+    }
+    const bool rasterMarkers = markerCount >= kRasterScatterPoints;
+    QVector<PointCloudLayer::Layer> cloud;
+    const int maxSegments = std::max(2, kLineSegmentBudget / int(std::max<qsizetype>(1, selectedCities.size())));
+
+    for (int cityId : selectedCities) {
+        const QString city = stations->name(cityId);
         QColor color = palette[colorIndex % palette.size()];
         QPen pen(color);
         pen.setWidth(3);
@@ -823,117 +1590,297 @@ void MainWindow::updateCharts()
             curve = l;
         }
 
-        auto *scatter = new QScatterSeries();
-        scatter->setMarkerSize(8);
-        scatter->setColor(color);
-
-        QVector<std::pair<qint64, int>> pts;
-        pts.reserve(table->rowCount());
-
-        for (int r = 0; r < table->rowCount(); r++) {
-            if (!table->item(r,0) || !table->item(r,1) || !table->item(r,2)) continue;
-
-            if (table->item(r,0)->text() == city) {
-                QString ds = table->item(r,1)->text();
-                QDate d = QDate::fromString(ds, "yyyy-MM-dd");
-                if (!d.isValid()) continue;
-
-                qint64 ts = QDateTime(d, QTime(0,0)).toMSecsSinceEpoch();
-                int rad = table->item(r,2)->text().section(' ', 0, 0).toInt();
-                pts.push_back({ts, rad});
-            }
+        QScatterSeries *scatter = nullptr;
+        if (!rasterMarkers) {
+            scatter = new QScatterSeries();
+            scatter->setMarkerSize(8);
+            scatter->setColor(color);
         }
+        QList<QPointF> markers;
 
-        if (pts.isEmpty()) {
+        QVector<std::pair<qint64, int>> &pts = pointsByStation[cityId];
+        const auto gridIt = gridByStation.constFind(cityId);
+        if (resampled ? gridIt == gridByStation.cend() : pts.isEmpty()) {
             delete scatter;
             delete curve;
             colorIndex++;
             continue;
         }
 
-        std::sort(pts.begin(), pts.end(),
-                  [](auto &a, auto &b){ return a.first < b.first; });
+        TRACE_SCOPE("series build");
+        QList<QXYSeries*> segments;   // куски линии после разрывов, без своей записи в легенде
+        if (resampled) {
+            // точки — только наблюдённые ячейки, заполненные пропуски видны лишь на линии
+            const ResampledSeries &g = *gridIt;
+            // куски без NaN; их число ограничено — короткие пропуски сливают соседние куски
+            QVector<std::pair<int, int>> runs;   // [начало, конец) по ячейкам
+            for (int i = 0; i < g.size(); ++i) {
+                if (std::isnan(g.values[i])) continue;
+                if (runs.isEmpty() || runs.last().second != i) runs.append({i, i + 1});
+                else runs.last().second = i + 1;
+            }
+            if (runs.size() > maxSegments) {
+                QVector<int> gaps;
+                for (int k = 1; k < runs.size(); ++k) gaps.append(runs[k].first - runs[k - 1].second);
+                std::nth_element(gaps.begin(), gaps.begin() + (maxSegments - 2), gaps.end(), std::greater<int>());
+                const int cut = gaps[maxSegments - 2];   // разрывы не короче этого остаются
+                int keepEqual = int(std::count_if(gaps.cbegin(), gaps.cbegin() + (maxSegments - 1),
+                                                  [cut](int gap) { return gap == cut; }));
+                QVector<std::pair<int, int>> merged{runs.first()};
+                for (int k = 1; k < runs.size(); ++k) {
+                    const int gap = runs[k].first - runs[k - 1].second;
+                    const bool keep = gap > cut || (gap == cut && keepEqual-- > 0);
+                    if (keep) merged.append(runs[k]);
+                    else merged.last().second = runs[k].second;
+                }
+                runs = std::move(merged);
+            }
+
+            for (int k = 0; k < runs.size(); ++k) {
+                QXYSeries *segment = curve;
+                if (k > 0) {
+                    segment = useSpline ? static_cast<QXYSeries*>(new QSplineSeries()) : new QLineSeries();
+                    segment->setPen(pen);
+                    segments.append(segment);
+                }
+                QList<QPointF> line;
+                for (int i = runs[k].first; i < runs[k].second; ++i) {
+                    const float v = g.values[i];
+                    if (std::isnan(v)) continue;
+                    const qint64 ts = toMs(QDate::fromJulianDay(grid.bucketStart(g.firstBucket + i)));
+                    line.append(QPointF(ts, v));
+                    if (g.observed[i]) markers.append(QPointF(ts, v));
+
+                    minTs = std::min(minTs, ts);
+                    maxTs = std::max(maxTs, ts);
+                    minY = std::min(minY, double(v));
+                    maxY = std::max(maxY, double(v));
+                }
+                segment->replace(line);
+            }
+        } else {
+            std::sort(pts.begin(), pts.end(),
+                      [](auto &a, auto &b){ return a.first < b.first; });
 
-        for (auto &p : pts) {
-            curve->append(p.first, p.second);
-            scatter->append(p.first, p.second);
+            for (auto &p : pts) {
+                curve->append(p.first, p.second);
+                markers.append(QPointF(p.first, p.second));
 
-            minTs = std::min(minTs, p.first);
-            maxTs = std::max(maxTs, p.first);
-            minY = std::min(minY, double(p.second));
-            maxY = std::max(maxY, double(p.second));
+                minTs = std::min(minTs, p.first);
+                maxTs = std::max(maxTs, p.first);
+                minY = std::min(minY, double(p.second));
+                maxY = std::max(maxY, double(p.second));
+            }
         }
 
         chart->addSeries(curve);
-        chart->addSeries(scatter);
+        chartedStations.append(cityId);
         curve->attachAxis(axisX);
         curve->attachAxis(axisY);
-        scatter->attachAxis(axisX);
-        scatter->attachAxis(axisY);
-
-        // ✅ КРАСИВЫЙ ТУЛТИП (скруглённые углы, тень, не обрезает текст)
-        auto *tipText = new QGraphicsTextItem();
-        QFont f; f.setPointSize(10);
-        tipText->setFont(f);
-        tipText->setDefaultTextColor(Qt::black);
-        tipText->setZValue(3001);
-        tipText->setVisible(false);
-        radiationChartView->scene()->addItem(tipText);
-
-        auto *tipBg = new QGraphicsPathItem();
-        tipBg->setBrush(QColor(255,255,255));
-        tipBg->setPen(QPen(Qt::black, 1));
-        tipBg->setZValue(3000);
-        tipBg->setVisible(false);
-        radiationChartView->scene()->addItem(tipBg);
-
-        QObject::connect(
-            scatter, &QScatterSeries::hovered,
-            this,
-            [this, tipText, tipBg, city](const QPointF &p, bool state)
-            {
-                if (state) {
-                    QString text = QString("<b>%1</b><br>Дата: %2<br>Радиация: %3 мкР/ч")
-                                       .arg(city)
-                                       .arg(QDateTime::fromMSecsSinceEpoch(qint64(p.x())).toString("dd.MM.yyyy"))
-                                       .arg(int(std::lround(p.y())));
-
-                    tipText->setHtml(text);
-
-                    QPointF pos = radiationChartView->chart()->mapToPosition(p);
-
-                    // позиция тултипа
-                    QPointF tipPos = pos + QPointF(12, -10);
-                    tipText->setPos(tipPos);
-
-                    QRectF r = tipText->boundingRect();
-                    r.adjust(-6, -6, 6, 6);
-
-                    // скругленный фон
-                    QPainterPath path;
-                    path.addRoundedRect(r, 6, 6);
-                    tipBg->setPath(path);
-                    tipBg->setPos(tipPos);
-
-                    // делаем видимым
-                    tipBg->setVisible(true);
-                    tipText->setVisible(true);
+        for (QXYSeries *segment : std::as_const(segments)) {
+            chart->addSeries(segment);
+            segment->attachAxis(axisX);
+            segment->attachAxis(axisY);
+            hideLegendMarker(chart, segment);
+        }
+
+        if (rasterMarkers) {
+            cloud.append({city, color, markers});
+        } else {
+            scatter->replace(markers);
+            chart->addSeries(scatter);
+            scatter->attachAxis(axisX);
+            scatter->attachAxis(axisY);
+            connect(scatter, &QScatterSeries::hovered, this, [this, city](const QPointF &p, bool state) {
+                showChartTip(city, p, state);
+            });
+        }
+
+        colorIndex++;
+    }
+    pointCloud->setAxes(axisX, axisY);
+    pointCloud->setLayers(cloud);
+
+    // дополнительные показатели: у каждого своя ось справа, линии — в цвете станции
+    const QVector<int> metricIds = checkedChartMetrics();
+    if (!metricIds.isEmpty() && minTs != LLONG_MAX) {
+        TRACE_SCOPE("metric series");
+        const MetricColumns &mc = records->metricColumns();
+        QHash<int, int> stationSlot;
+        for (int i = 0; i < chartedStations.size(); ++i) stationSlot.insert(chartedStations[i], i);
+
+        for (int k = 0; k < metricIds.size(); ++k) {
+            const int m = metricIds[k];
+            const MetricInfo &info = mc.info(m);
+            // один проход по записям: читается только столбец этого показателя
+            QVector<QList<QPointF>> pts(chartedStations.size());
+            double lo = std::numeric_limits<double>::max(), hi = std::numeric_limits<double>::lowest();
+            filterModel->forEachRow([&](qsizetype row, const PackedReading &r) {
+                const auto slot = stationSlot.constFind(r.station);
+                double v = 0.0;
+                if (slot == stationSlot.cend() || !records->metric(m, row, &v)) return;
+                pts[*slot].append(QPointF(double(toMs(QDate::fromJulianDay(r.day))), v));
+                lo = std::min(lo, v);
+                hi = std::max(hi, v);
+            });
+            if (lo > hi) continue;
+
+            auto *axisM = new QValueAxis;
+            axisM->setObjectName(u"metric:"_s + info.key);
+            axisM->setTitleText(info.unit.isEmpty() ? info.title : info.title + u", "_s + info.unit);
+            axisM->setLabelFormat(info.decimals > 0 ? "%.1f" : "%.0f");
+            const double mpad = std::max((hi - lo) * 0.1, 0.5);
+            axisM->setRange(lo - mpad, hi + mpad);
+            chart->addAxis(axisM, Qt::AlignRight);
+
+            static const Qt::PenStyle styles[] = {Qt::DashLine, Qt::DashDotLine, Qt::DotLine, Qt::DashDotDotLine};
+            for (int i = 0; i < chartedStations.size(); ++i) {
+                if (pts[i].isEmpty()) continue;
+                std::sort(pts[i].begin(), pts[i].end(), [](const QPointF &a, const QPointF &b) { return a.x() < b.x(); });
+                const QString city = stations->name(chartedStations[i]);
+                QPen pen(seriesColor(chart, city, palette[i % palette.size()]));
+                pen.setWidth(2);
+                pen.setStyle(styles[k % 4]);
+                pen.setCosmetic(true);
+                auto *line = new QLineSeries();
+                line->setName(city + u": "_s + info.title);
+                line->setPen(pen);
+                line->replace(pts[i]);
+                chart->addSeries(line);
+                line->attachAxis(axisX);
+                line->attachAxis(axisM);
+            }
+        }
+    }
+
+    // накопленная доза с начала видимого периода: по станциям и суммарно по сети
+    if (doseCheck && doseCheck->isChecked() && !sql && !pagedActive() && minTs != LLONG_MAX) {
+        TRACE_SCOPE("dose series");
+        const qint64 firstDay = QDateTime::fromMSecsSinceEpoch(minTs).date().toJulianDay();
+        const qint64 lastDay = QDateTime::fromMSecsSinceEpoch(maxTs).date().toJulianDay();
+        double top = 0.0;
+        QList<QLineSeries*> doseSeries;
+
+        for (int i = 0; i < chartedStations.size(); ++i) {
+            const int cityId = chartedStations[i];
+            const QString city = stations->name(cityId);
+            const double base = doseIndex->cumulative(cityId, firstDay);
+            auto *line = new QLineSeries();
+            line->setName(city + u": доза"_s);
+            QPen pen(seriesColor(chart, city, palette[i % palette.size()]));
+            pen.setWidth(2);
+            pen.setStyle(Qt::DotLine);
+            pen.setCosmetic(true);
+            line->setPen(pen);
+            const QVector<qint64> days = doseIndex->days(cityId);
+            qint64 prev = firstDay - 1;
+            for (qint64 day : days) {
+                if (day < firstDay || day > lastDay) continue;
+                // перерыв в показаниях: доза стоит на месте до начала следующего дня ряда
+                if (day - prev > 1 && line->count() > 0)
+                    line->append(double(toMs(QDate::fromJulianDay(day - 1))),
+                                 DoseIndex::toMilliR(doseIndex->cumulative(cityId, day) - base));
+                prev = day;
+                const double v = DoseIndex::toMilliR(doseIndex->cumulative(cityId, day + 1) - base);
+                line->append(double(toMs(QDate::fromJulianDay(day))), v);
+                top = std::max(top, v);
+            }
+            doseSeries.append(line);
+        }
+
+        // сеть: сумма по станциям графика, не больше ~1500 точек на период; последний день —
+        // всегда отдельной точкой, даже если шаг через него перешагнул
+        const double networkBase = doseIndex->networkCumulative(chartedStations, firstDay);
+        auto *network = new QLineSeries();
+        network->setName(u"Станции графика: накопленная доза"_s);
+        QPen netPen(QColor("#111827"));
+        netPen.setWidth(3);
+        netPen.setCosmetic(true);
+        network->setPen(netPen);
+        const qint64 step = std::max<qint64>(1, (lastDay - firstDay) / 1500);
+        for (qint64 day = firstDay;; day = std::min(day + step, lastDay)) {
+            const double v = DoseIndex::toMilliR(doseIndex->networkCumulative(chartedStations, day + 1) - networkBase);
+            network->append(double(toMs(QDate::fromJulianDay(day))), v);
+            top = std::max(top, v);
+            if (day == lastDay) break;
+        }
+        doseSeries.append(network);
+
+        auto *axisD = new QValueAxis;
+        axisD->setObjectName(u"dose"_s);
+        axisD->setTitleText(u"Накопленная доза, мР"_s);
+        axisD->setLabelFormat("%.1f");
+        axisD->setRange(0.0, std::max(top * 1.05, 0.001));
+        chart->addAxis(axisD, Qt::AlignRight);
+        for (QLineSeries *line : std::as_const(doseSeries)) {
+            chart->addSeries(line);
+            line->attachAxis(axisX);
+            line->attachAxis(axisD);
+        }
+    }
+
+    // прогноз — пунктирное продолжение каждой линии и полоса 95%-го интервала
+    if (forecastCheck && forecastCheck->isChecked() && minTs != LLONG_MAX) {
+        if (!forecastsCurrent()) {
+            refreshForecasts();   // по готовности график перестроится
+        } else {
+            TRACE_SCOPE("forecast series");
+            for (int cityId : std::as_const(chartedStations)) {
+                const auto fit = forecasts.constFind(cityId);
+                if (fit == forecasts.cend()) continue;
+                const Forecast &fc = *fit;
+                const QString city = stations->name(cityId);
+                const QColor color = seriesColor(chart, city, palette[chartedStations.indexOf(cityId) % palette.size()]);
+
+                auto *mean = new QLineSeries();
+                auto *upper = new QLineSeries();
+                auto *lower = new QLineSeries();
+                mean->setName(city + u": прогноз"_s);
+                const qint64 joinTs = toMs(QDate::fromJulianDay(fc.firstDay - 1));
+                mean->append(joinTs, fc.lastValue);
+                upper->append(joinTs, fc.lastValue);
+                lower->append(joinTs, fc.lastValue);
+                for (int h = 0; h < fc.horizon(); ++h) {
+                    const qint64 ts = toMs(QDate::fromJulianDay(fc.firstDay + h));
+                    mean->append(ts, fc.mean[h]);
+                    upper->append(ts, fc.upper[h]);
+                    lower->append(ts, fc.lower[h]);
+                    maxTs = std::max(maxTs, ts);
+                    minY = std::min(minY, double(fc.lower[h]));
+                    maxY = std::max(maxY, double(fc.upper[h]));
                 }
-                else {
-                    tipBg->setVisible(false);
-                    tipText->setVisible(false);
+
+                auto *band = new QAreaSeries(upper, lower);
+                upper->setParent(band);   // QAreaSeries не владеет своими границами
+                lower->setParent(band);
+                band->setName(city + u": интервал 95%"_s);
+                QColor fill = color;
+                fill.setAlpha(50);
+                band->setBrush(fill);
+                band->setPen(Qt::NoPen);
+                QPen pen(color);
+                pen.setWidth(2);
+                pen.setStyle(Qt::DashLine);
+                pen.setCosmetic(true);
+                mean->setPen(pen);
+
+                chart->addSeries(band);
+                chart->addSeries(mean);
+                for (QAbstractSeries *s : {static_cast<QAbstractSeries*>(band), static_cast<QAbstractSeries*>(mean)}) {
+                    s->attachAxis(axisX);
+                    s->attachAxis(axisY);
                 }
             }
-            );
-
-        colorIndex++;
+        }
     }
 
     if (minTs == LLONG_MAX) {
+        traceOp.finish();
         QMessageBox::information(this, "Нет данных", "Нет данных для выбранных городов");
         return;
     }
 
+    Trace::Scope axisSpan("axis layout");
     double pad = (maxY - minY) * 0.15;
     if (pad <= 0) pad = 1.0;
     axisY->setRange(std::max(0.0, minY - pad), maxY + pad);
@@ -959,8 +1906,19 @@ void MainWindow::updateCharts()
             .arg(QDateTime::fromMSecsSinceEpoch(minTs).toString("dd.MM.yyyy"))
             .arg(QDateTime::fromMSecsSinceEpoch(maxTs).toString("dd.MM.yyyy"))
         );
+    axisSpan.finish();
+
+    if (Trace::isEnabled()) {
+        // синхронная перерисовка, чтобы время отрисовки попало в разбивку операции
+        TRACE_SCOPE("render");
+        radiationChartView->viewport()->repaint();
+    }
 
-    statusBar()->showMessage("✅ График обновлен", 2000);
+    if (totalSelected > MaxOverlaySeries)
+        statusBar()->showMessage(QString(u"✅ График обновлен: показаны первые %1 из %2 выбранных станций"_s)
+                                     .arg(MaxOverlaySeries).arg(totalSelected), 5000);
+    else
+        statusBar()->showMessage("✅ График обновлен", 2000);
 }
 
 
@@ -988,8 +1946,8 @@ void MainWindow::findMinMax()
     }
 
     // --- Находим минимум и максимум ---
-    double minY = std::numeric_limits<double>::max();
-    double maxY = std::numeric_limits<double>::lowest();
+    double minY = 0.0;
+    double maxY = 0.0;
 
     QDateTimeAxis *axisX = nullptr;
     QValueAxis *axisY  = nullptr;
@@ -998,25 +1956,21 @@ void MainWindow::findMinMax()
     for (auto *ax : chart->axes(Qt::Horizontal))
         axisX = qobject_cast<QDateTimeAxis*>(ax);
 
-    for (auto *ay : chart->axes(Qt::Vertical))
-        axisY = qobject_cast<QValueAxis*>(ay);
+    axisY = valueAxisAt(chart, Qt::AlignLeft);
 
     if (!axisX || !axisY) {
         QMessageBox::warning(this, "Ошибка", "Оси графика не найдены");
         return;
     }
 
-    // Обход всех серий, включая line + spline
-    for (auto *s : chart->series()) {
-        if (auto xy = qobject_cast<QXYSeries*>(s)) {
-            for (const QPointF &p : xy->points()) {
-                minY = std::min(minY, p.y());
-                maxY = std::max(maxY, p.y());
-            }
-        }
+    // уровни считаются по записям станций на графике (из кэша), а не по точкам серий
+    const ReadingStats st = statsFor(chartedStations);
+    if (st.count > 0) {
+        minY = st.min;
+        maxY = st.max;
     }
 
-    if (!std::isfinite(minY)) {
+    if (st.count == 0) {
         QMessageBox::information(this, "MIN/MAX", "На графике нет точек");
         return;
     }
@@ -1065,32 +2019,20 @@ void MainWindow::computeTrend()
         return;
     }
 
-    // собираем точки только из линий/сплайнов (scatter не нужен)
-    QVector<QPointF> pts;
-    for (QAbstractSeries *s : chart->series()) {
-        if (s->name() == u"MIN линия"_s || s->name() == u"MAX линия"_s) continue;
-        if (auto xy = qobject_cast<QXYSeries*>(s)) {
-            const auto v = xy->pointsVector();
-            pts += v;
-        }
-    }
-    if (pts.size() < 2) {
+    // регрессия по записям станций на графике; суммы по станциям берутся из кэша
+    const ReadingStats st = statsFor(chartedStations);
+    if (st.count < 2) {
         QMessageBox::information(this, u"Тенденция"_s, u"Недостаточно точек для расчёта тенденции."_s);
         return;
     }
+    double a = 0.0, b = 0.0;   // y = a * (день - kDayOrigin) + b
+    if (!st.trend(&a, &b)) return;
 
-    // регрессия y = a*x + b
-    double sx = 0, sy = 0, sxx = 0, sxy = 0; const int n = pts.size();
-    for (const QPointF &p : pts) {
-        sx  += p.x();
-        sy  += p.y();
-        sxx += p.x()*p.x();
-        sxy += p.x()*p.y();
-    }
-    const double denom = (n * sxx - sx * sx);
-    if (denom == 0) return;
-    const double a = (n * sxy - sx * sy) / denom;
-    const double b = (sy - a * sx) / n;
+    // ось X графика в мс, регрессия — в днях
+    auto dayOf = [](double ms) {
+        const QDateTime dt = QDateTime::fromMSecsSinceEpoch(qint64(ms));
+        return double(dt.date().toJulianDay() - ReadingStats::kDayOrigin) + dt.time().msecsSinceStartOfDay() / 86400000.0;
+    };
 
     // диапазон X (поддержка QDateTimeAxis и QValueAxis)
     double xMin = 0.0, xMax = 0.0;
@@ -1107,67 +2049,1585 @@ void MainWindow::computeTrend()
     auto *trend = new QLineSeries();
     trend->setName(u"Тенденция"_s);
     QPen pen(QColor("#111827")); pen.setWidth(2); pen.setStyle(Qt::DotLine); pen.setCosmetic(true); trend->setPen(pen);
-    trend->append(xMin, a * xMin + b);
-    trend->append(xMax, a * xMax + b);
+    trend->append(xMin, a * dayOf(xMin) + b);
+    trend->append(xMax, a * dayOf(xMax) + b);
     chart->addSeries(trend);
     if (auto *ax = chart->axes(Qt::Horizontal).value(0)) trend->attachAxis(ax);
-    if (auto *ay = chart->axes(Qt::Vertical).value(0))   trend->attachAxis(ay);
+    if (auto *ay = valueAxisAt(chart, Qt::AlignLeft))    trend->attachAxis(ay);
 }
 
-void MainWindow::applySort()
+void MainWindow::computeSeasonal()
 {
-    if (!table) return;
+    if (!radiationChartView || !radiationChartView->chart()) return;
+    QChart *chart = radiationChartView->chart();
+
+    // toggle: компоненты уже на графике — убрать их вместе с правой осью
+    QList<QAbstractSeries*> toRemove;
+    for (QAbstractSeries *s : chart->series()) {
+        if (s->objectName() == "seasonal"_L1) toRemove.append(s);
+    }
+    if (!toRemove.isEmpty()) {
+        for (QAbstractSeries *s : toRemove) { chart->removeSeries(s); s->deleteLater(); }
+        if (QValueAxis *components = valueAxisNamed(chart, u"components"_s)) {
+            chart->removeAxis(components);
+            delete components;
+        }
+        statusBar()->showMessage(u"Сезонное разложение скрыто"_s, 2000);
+        return;
+    }
 
-    struct Row { QString city; QDate dt; int rad; int originalSeq; };
-    QVector<Row> rows; rows.reserve(table->rowCount());
+    auto *axisX = qobject_cast<QDateTimeAxis*>(chart->axes(Qt::Horizontal).value(0));
+    QValueAxis *axisY = valueAxisAt(chart, Qt::AlignLeft);
+    if (!axisX || !axisY || chartedStations.isEmpty()) {
+        QMessageBox::information(this, u"Сезонность"_s, u"Сначала постройте график по выбранным станциям."_s);
+        return;
+    }
+
+    Trace::Operation traceOp("seasonal");
+    const int period = seasonalPeriodCombo ? seasonalPeriodCombo->currentData().toInt() : SeasonalAnalysis::kAutoPeriod;
+    const QVector<Decomposition> parts = SeasonalAnalysis::compute(collectReadings(chartedStations), chartedStations, period);
+    if (parts.isEmpty()) return;
+
+    auto *axisC = new QValueAxis;
+    axisC->setObjectName(u"components"_s);
+    axisC->setTitleText(u"Компоненты, мкР/ч"_s);
+    axisC->setLabelFormat("%.0f");
+    chart->addAxis(axisC, Qt::AlignRight);
+
+    double cMin = 0.0, cMax = 0.0;
+    auto addComponent = [&](const Decomposition &d, const QVector<float> &values, const QString &name,
+                            const QPen &pen, QValueAxis *axis) {
+        QList<QPointF> pts;
+        pts.reserve(values.size());
+        for (int t = 0; t < values.size(); ++t)
+            pts.append(QPointF(double(toMs(QDate::fromJulianDay(d.firstDay + t))), values[t]));
+        auto *line = new QLineSeries();
+        line->setObjectName(u"seasonal"_s);
+        line->setName(name);
+        line->setPen(pen);
+        line->replace(pts);
+        chart->addSeries(line);
+        line->attachAxis(axisX);
+        line->attachAxis(axis);
+    };
 
-    for (int i = 0; i < table->rowCount(); ++i) {
-        QTableWidgetItem *cityIt = table->item(i,0);
-        QTableWidgetItem *dtIt   = table->item(i,1);
-        QTableWidgetItem *radIt  = table->item(i,2);
-        if (!cityIt || !dtIt || !radIt) continue;
+    QStringList report;
+    report << u"Сезонное разложение (тренд + сезонность + остаток):"_s;
+    for (const Decomposition &d : parts) {
+        const QString city = stations->name(d.station);
+        // цвет компонент — как у основной линии станции
+        const QColor color = seriesColor(chart, city, QColor("#111827"));
+
+        QPen trendPen(color); trendPen.setWidth(2); trendPen.setStyle(Qt::DashLine); trendPen.setCosmetic(true);
+        addComponent(d, d.trend, city + u": тренд"_s, trendPen, axisY);
+        if (d.period > 0) {
+            QPen seasonPen(color.darker(130)); seasonPen.setWidth(1); seasonPen.setCosmetic(true);
+            addComponent(d, d.seasonal, city + u": сезонность"_s, seasonPen, axisC);
+        }
+        QPen residualPen(color.lighter(140)); residualPen.setWidth(1); residualPen.setStyle(Qt::DotLine); residualPen.setCosmetic(true);
+        addComponent(d, d.residual, city + u": остаток"_s, residualPen, axisC);
+
+        for (const QVector<float> *v : {&d.seasonal, &d.residual}) {
+            const auto [lo, hi] = std::minmax_element(v->cbegin(), v->cend());
+            if (lo != v->cend()) { cMin = std::min(cMin, double(*lo)); cMax = std::max(cMax, double(*hi)); }
+        }
 
-        const int rad = radIt->text().section(' ', 0, 0).toInt();
-        Row r{ cityIt->text(), QDate::fromString(dtIt->text(), "yyyy-MM-dd"), rad, cityIt->data(Qt::UserRole).toInt() };
-        rows.push_back(r);
+        QStringList peaks;
+        for (const auto &pk : d.peaks)
+            peaks << u"%1 дн. (%2%)"_s.arg(pk.first, 0, 'f', 1).arg(pk.second * 100.0, 0, 'f', 1);
+        report << u"  %1: период %2, пики спектра: %3"_s
+                      .arg(city,
+                           d.period > 0 ? u"%1 дн."_s.arg(d.period) : u"— (ряд короче двух циклов)"_s,
+                           peaks.isEmpty() ? u"нет"_s : peaks.join(u", "_s));
     }
+    const double pad = std::max(1.0, (cMax - cMin) * 0.05);
+    axisC->setRange(cMin - pad, cMax + pad);
 
-    const QString mode = sortCombo ? sortCombo->currentText() : QString();
-    auto byCityAsc = [](const Row &a, const Row &b){ return a.city.localeAwareCompare(b.city) < 0; };
-    auto byCityDesc = [](const Row &a, const Row &b){ return a.city.localeAwareCompare(b.city) > 0; };
-    auto byOldNew = [](const Row &a, const Row &b){ return a.dt < b.dt; };
-    auto byNewOld = [](const Row &a, const Row &b){ return a.dt > b.dt; };
-    auto byRadDesc = [](const Row &a, const Row &b){ return a.rad > b.rad; };
-    auto byRadAsc  = [](const Row &a, const Row &b){ return a.rad < b.rad; };
-
-    if (mode.startsWith(u"Город A"_s))             std::sort(rows.begin(), rows.end(), byCityAsc);
-    else if (mode.startsWith(u"Город Я"_s))        std::sort(rows.begin(), rows.end(), byCityDesc);
-    else if (mode.startsWith(u"Дата: старые"_s))   std::sort(rows.begin(), rows.end(), byOldNew);
-    else if (mode.startsWith(u"Дата: новые"_s))    std::sort(rows.begin(), rows.end(), byNewOld);
-    else if (mode.startsWith(u"Радиация: больше"_s)) std::sort(rows.begin(), rows.end(), byRadDesc);
-    else if (mode.startsWith(u"Радиация: меньше"_s)) std::sort(rows.begin(), rows.end(), byRadAsc);
-
-    table->setRowCount(0);
-    for (const Row &r : rows) {
-        const int row = table->rowCount(); table->insertRow(row);
-        auto *cityItem = new QTableWidgetItem(r.city);
-        cityItem->setData(Qt::UserRole, r.originalSeq);
-        table->setItem(row, 0, cityItem);
-        auto *dtItem = new QTableWidgetItem(r.dt.toString("yyyy-MM-dd"));
-        table->setItem(row, 1, dtItem);
-
-        auto *radItem = new QTableWidgetItem(QString::number(r.rad) + u" мкР/ч"_s);
-
-        QColor bgColor;
-        if (r.rad <= 15)       bgColor = QColor("#d1fae5");
-        else if (r.rad <= 30)  bgColor = QColor("#fef3c7");
-        else if (r.rad <= 60)  bgColor = QColor("#ffedd5");
-        else                   bgColor = QColor("#fee2e2");
-
-        cityItem->setBackground(bgColor);
-        dtItem->setBackground(bgColor);
-        radItem->setBackground(bgColor);
-
-        table->setItem(row, 2, radItem);
+    analysisText->setPlainText(report.join(u'\n'));
+    statusBar()->showMessage(u"Сезонное разложение: станций %1"_s.arg(parts.size()), 3000);
+}
+
+bool MainWindow::forecastsCurrent() const
+{
+    if (forecastVersion != readingsVersion()) return false;
+    if (!sqlActive() && !pagedActive()) return true;
+    for (int id : chartedStations)
+        if (!forecastIds.contains(id)) return false;
+    return true;
+}
+
+void MainWindow::refreshForecasts()
+{
+    // идущий пересчёт по завершении сам сверит версию и при необходимости запустится снова
+    if (forecastRunning || forecastsCurrent()) return;
+
+    QVector<int> ids;
+    if (sqlActive() || pagedActive()) {
+        ids = chartedStations;
+    } else {
+        ids.resize(stations->count());
+        std::iota(ids.begin(), ids.end(), 0);
+    }
+    const auto version = readingsVersion();
+    forecastRunning = true;
+    statusBar()->showMessage(u"Прогноз: подгонка моделей по %1 станциям…"_s.arg(ids.size()));
+
+    QElapsedTimer timer;
+    timer.start();
+    auto *watcher = new QFutureWatcher<QVector<Forecast>>(this);
+    connect(watcher, &QFutureWatcher<QVector<Forecast>>::finished, this, [this, watcher, version, ids, timer]() {
+        watcher->deleteLater();
+        forecastRunning = false;
+        const QVector<Forecast> result = watcher->result();
+        forecasts.clear();
+        for (const Forecast &fc : result) forecasts.insert(fc.station, fc);
+        forecastIds = QSet<int>(ids.cbegin(), ids.cend());
+        forecastVersion = version;
+        statusBar()->showMessage(u"Прогноз готов: %1 станций за %2 мс"_s.arg(result.size()).arg(timer.elapsed()), 4000);
+
+        if (!forecastCheck->isChecked()) return;
+        if (!forecastsCurrent()) refreshForecasts();
+        else if (!chartedStations.isEmpty()) updateCharts();
+    });
+    if (pagedActive()) {
+        // страницы файла читаются в рабочем потоке, только станции графика
+        watcher->setFuture(QtConcurrent::run([src = pagedModel->source(), ids]() {
+            QVector<StationReading> readings;
+            if (!ids.isEmpty()) {
+                src.forEachReading(ids, [&readings](const PackedReading &r) {
+                    readings.append({int(r.station), r.day, int(r.rad)});
+                });
+            }
+            return Forecaster::forecastAll(readings, ids);
+        }));
+        return;
+    }
+    if (sqlActive()) {
+        // база читается в рабочем потоке через своё соединение, только станции графика
+        watcher->setFuture(QtConcurrent::run([src = sqlStore->source(sqlWhere), ids]() {
+            QVector<StationReading> readings;
+            if (!ids.isEmpty()) {
+                src.forEachReading(ids, [&readings](const PackedReading &r) {
+                    readings.append({int(r.station), r.day, int(r.rad)});
+                });
+            }
+            return Forecaster::forecastAll(readings, ids);
+        }));
+        return;
+    }
+    watcher->setFuture(QtConcurrent::run([snap = readingsSnapshot(), ids]() {
+        return Forecaster::forecastAll(snap.readings(), ids);
+    }));
+}
+
+void MainWindow::exportReports()
+{
+    if (exportRunning) {
+        statusBar()->showMessage(u"Экспорт отчётов уже идёт"_s, 3000);
+        return;
+    }
+    const bool paged = pagedActive();
+    const bool sql = sqlActive();
+    if ((sql ? sqlModel->recordCount() : paged ? pagedModel->recordCount() : records->size()) == 0) {
+        QMessageBox::information(this, u"Нет данных"_s, u"Сначала загрузите данные."_s);
+        return;
+    }
+
+    ReportOptions options;
+    options.outDir = QFileDialog::getExistingDirectory(this, u"Каталог для отчётов"_s);
+    if (options.outDir.isEmpty()) return;
+    bool ok = false;
+    const QString format = QInputDialog::getItem(this, u"Экспорт отчётов"_s, u"Формат:"_s,
+                                                 {u"PNG"_s, u"SVG"_s, u"PDF"_s}, 0, false, &ok);
+    if (!ok || !ReportOptions::parseFormat(format, &options.format)) return;
+    options.withStats = QMessageBox::question(this, u"Экспорт отчётов"_s,
+                                              u"Добавить в отчёт сводную статистику по станции?"_s) == QMessageBox::Yes;
+
+    QVector<int> ids(stations->count());
+    std::iota(ids.begin(), ids.end(), 0);
+    // постраничный файл и база: станции делятся на партии по числу записей (из индекса файла
+    // или одним GROUP BY), на партию — один проход, в памяти показания только текущей партии
+    QVector<QVector<int>> batches;
+    if (paged || sql) {
+        QVector<qint64> perStation(ids.size(), 0);
+        if (sql) {
+            for (const auto &[id, n] : sqlStore->stationCounts(sqlWhere))
+                if (id < perStation.size()) perStation[id] = n;
+        }
+        qint64 inBatch = 0;
+        for (int id : std::as_const(ids)) {
+            const qint64 n = sql ? perStation[id] : pagedModel->stationRecords(id);
+            if (n == 0) continue;
+            if (batches.isEmpty() || (inBatch > 0 && inBatch + n > kExportBatchReadings)) {
+                batches.append({});
+                inBatch = 0;
+            }
+            batches.last().append(id);
+            inBatch += n;
+        }
+    }
+    statusBar()->showMessage(u"Экспорт отчётов: %1 станций…"_s.arg(ids.size()));
+
+    // рисование идёт в рабочих потоках; окно остаётся отзывчивым
+    struct ExportResult { int written = 0; QStringList errors; qint64 ms = 0; };
+    auto *watcher = new QFutureWatcher<ExportResult>(this);
+    exportRunning = true;
+    connect(watcher, &QFutureWatcher<ExportResult>::finished, this, [this, watcher, dir = options.outDir]() {
+        watcher->deleteLater();
+        exportRunning = false;
+        const ExportResult result = watcher->result();
+        if (!result.errors.isEmpty())
+            QMessageBox::warning(this, u"Ошибка"_s, QString(u"Часть отчётов не записана:\n%1"_s)
+                                                        .arg(result.errors.mid(0, 10).join(u'\n')));
+        statusBar()->showMessage(QString(u"✅ Отчётов: %1 в %2 (%3 мс)"_s).arg(result.written).arg(dir).arg(result.ms), 8000);
+    });
+    const QStringList names = ReportRenderer::stationNames(*stations);
+    if (paged || sql) {
+        // у обхода свой дескриптор файла или своё соединение с базой — партии читаются в рабочем потоке
+        watcher->setFuture(QtConcurrent::run([src = paged ? pagedModel->source() : JsonPageSource(),
+                                              db = sql ? sqlStore->source(sqlWhere) : SqlReadingSource(),
+                                              sql, names, batches, options]() {
+            QElapsedTimer timer;
+            timer.start();
+            ExportResult result;
+            for (const QVector<int> &batch : batches) {
+                QVector<StationReading> readings;
+                auto add = [&readings](const PackedReading &r) { readings.append({int(r.station), r.day, int(r.rad)}); };
+                QString readError;
+                const bool ok = sql ? db.forEachReading(batch, add, &readError) : src.forEachReading(batch, add);
+                if (!ok) {
+                    result.errors.append(sql ? u"Не удалось прочитать базу "_s + db.fileName() + u": "_s + readError
+                                             : u"Не удалось прочитать файл "_s + src.fileName());
+                    break;
+                }
+                result.written += ReportRenderer::exportAll(readings, names, batch, options, &result.errors);
+            }
+            result.ms = timer.elapsed();
+            return result;
+        }));
+        return;
+    }
+    watcher->setFuture(QtConcurrent::run([snap = readingsSnapshot(), names, ids, options]() {
+        QElapsedTimer timer;
+        timer.start();
+        ExportResult result;
+        result.written = ReportRenderer::exportAll(snap.readings(), names, ids, options, &result.errors);
+        result.ms = timer.elapsed();
+        return result;
+    }));
+}
+
+ReadingStats MainWindow::statsFor(const QVector<int> &ids) const
+{
+    // без фильтра сводки берутся из кэша, с фильтром — одним проходом по выборке, из базы — запросом
+    if (sqlActive()) return sqlStore->stats(ids, sqlWhere);
+    if (pagedActive()) {
+        // постраничный файл без фильтра — сводки индекса, с фильтром — проход по страницам выборки
+        if (!pagedModel->isFiltered()) return pagedModel->stationStats(ids);
+        ReadingStats st;
+        forEachViewReading(ids, [&st](const PackedReading &r) { st.add(r.day, r.rad); });
+        return st;
+    }
+    if (filterModel->isActive()) return filterModel->stats(ids);
+    return ids.size() == 1 ? resultCache->station(ids.first()) : resultCache->query(ids);
+}
+
+QAbstractItemModel *MainWindow::recordsView() const
+{
+    return filterModel->isActive() ? static_cast<QAbstractItemModel*>(filterModel) : records;
+}
+
+void MainWindow::applyFilter()
+{
+    Trace::Operation traceOp("applyFilter");
+    const QString text = filterEdit->text().trimmed();
+    if (sqlActive() || pagedActive()) {
+        FilterExpression expr;
+        QString error;
+        if (!text.isEmpty() && !FilterExpression::compile(text, *stations, &expr, &error)) {
+            traceOp.finish();
+            QMessageBox::warning(this, u"Ошибка фильтра"_s, error);
+            statusBar()->showMessage(u"Ошибка фильтра: "_s + error, 5000);
+            return;
+        }
+        if (pagedActive()) {
+            // постраничный файл: выборка одним проходом по страницам, в памяти только номера строк
+            QApplication::setOverrideCursor(Qt::WaitCursor);
+            const bool ok = pagedModel->setFilter(expr, &error);
+            QApplication::restoreOverrideCursor();
+            if (!ok) {
+                traceOp.finish();
+                QMessageBox::warning(this, u"Ошибка фильтра"_s, error);
+                statusBar()->showMessage(u"Ошибка фильтра: "_s + error, 5000);
+                return;
+            }
+            ++externalVersion;
+            updateFilterInfo();
+            invalidateHistogram();
+            invalidateSummary();
+            invalidateHeatmap();
+            traceOp.finish();
+            if (!chartedStations.isEmpty()) updateCharts();
+            return;
+        }
+        // база: фильтр уходит в WHERE, таблица перечитывает окна по новому условию
+        QElapsedTimer timer;
+        timer.start();
+        sqlWhere = sqlStore->whereFor(expr);
+        sqlFilterText = text;
+        sqlModel->setQuery(sqlWhere, sqlModel->order());
+        ++externalVersion;
+        filterInfo->setText(sqlWhere.isEmpty() ? u"Фильтр не задан"_s
+                                               : QString(u"Найдено %1 записей в базе за %2 мс"_s)
+                                                     .arg(sqlModel->recordCount()).arg(timer.elapsed()));
+        traceOp.finish();
+        if (!chartedStations.isEmpty()) updateCharts();
+        return;
+    }
+    QString error;
+    if (!filterModel->setFilter(text, &error)) {
+        traceOp.finish();
+        QMessageBox::warning(this, u"Ошибка фильтра"_s, error);
+        statusBar()->showMessage(u"Ошибка фильтра: "_s + error, 5000);
+        return;
+    }
+    setTableModel(recordsView());
+    traceOp.finish();
+
+    if (!chartedStations.isEmpty()) updateCharts();
+}
+
+void MainWindow::updateFilterInfo()
+{
+    if (pagedActive()) {
+        filterInfo->setText(!pagedModel->isFiltered() ? u"Фильтр не задан"_s
+                                                      : QString(u"Найдено %1 из %2 записей файла за %3 мс"_s)
+                                                            .arg(pagedModel->matchCount()).arg(pagedModel->recordCount())
+                                                            .arg(pagedModel->lastSelectUs() / 1000.0, 0, 'f', 1));
+        return;
+    }
+    if (!filterModel->isActive()) {
+        filterInfo->setText(u"Фильтр не задан"_s);
+        return;
+    }
+    filterInfo->setText(QString(u"Найдено %1 из %2 записей за %3 мс"_s)
+                            .arg(filterModel->matchCount()).arg(records->size())
+                            .arg(filterModel->lastSelectUs() / 1000.0, 0, 'f', 1));
+}
+
+void MainWindow::applySort()
+{
+    if (!records) return;
+    Trace::Operation traceOp("applySort");
+    const QString mode = sortCombo ? sortCombo->currentText() : QString();
+    if (sqlActive()) {
+        // ORDER BY по индексу; индексы по дате и радиации строятся при первой такой сортировке
+        const SqlStore::Order order = sqlOrderFor(mode);
+        QString error;
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        const bool ok = sqlStore->ensureIndex(order, &error);
+        if (ok) sqlModel->setQuery(sqlWhere, order);
+        QApplication::restoreOverrideCursor();
+        if (!ok) statusBar()->showMessage(u"Ошибка сортировки в базе: "_s + error, 5000);
+        return;
+    }
+    if (pagedActive()) {
+        // порядок файла не меняется: сортировка — ORDER BY по индексу базы, набор переносится в SQLite
+        if (QMessageBox::question(this, u"Сортировка"_s,
+                                  u"Постраничный файл показывается в порядке записей. Для сортировки набор переносится "
+                                  "в базу SQLite (потоком, без загрузки в память). Перенести?"_s) != QMessageBox::Yes)
+            return;
+        const QString dbName = QFileDialog::getSaveFileName(this, u"База для сортировки"_s,
+                                                            QFileInfo(pagedModel->fileName()).completeBaseName() + u".sqlite"_s,
+                                                            u"База SQLite (*.sqlite *.db)"_s);
+        if (dbName.isEmpty()) return;
+        const QString filter = pagedModel->filterText();
+        QString error;
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        const bool ok = writeExternal(dbName, &error);
+        QApplication::restoreOverrideCursor();
+        if (!ok) {
+            QMessageBox::warning(this, u"Ошибка"_s, QString(u"Не удалось перенести набор в базу:\n%1"_s).arg(error));
+            statusBar()->showMessage(u"Ошибка сортировки"_s, 5000);
+            return;
+        }
+        openDatabase(dbName);
+        if (!sqlActive()) return;
+        if (!filter.isEmpty()) {
+            filterEdit->setText(filter);
+            applyFilter();
+        }
+        applySort();
+        return;
+    }
+
+    // сравнение городов по заранее посчитанному порядку в реестре, без localeAwareCompare на каждую пару
+    const StationRegistry *reg = stations;
+    auto byCityAsc = [reg](const PackedReading &a, const PackedReading &b){ return reg->collationRank(a.station) < reg->collationRank(b.station); };
+    auto byCityDesc = [reg](const PackedReading &a, const PackedReading &b){ return reg->collationRank(a.station) > reg->collationRank(b.station); };
+    auto byOldNew = [](const PackedReading &a, const PackedReading &b){ return a.day < b.day; };
+    auto byNewOld = [](const PackedReading &a, const PackedReading &b){ return a.day > b.day; };
+    auto byRadDesc = [](const PackedReading &a, const PackedReading &b){ return a.rad > b.rad; };
+    auto byRadAsc  = [](const PackedReading &a, const PackedReading &b){ return a.rad < b.rad; };
+
+    // записи сортируются на месте, представление получает один сброс модели
+    recordEdit(u"сортировка"_s);
+    TRACE_SCOPE("sort");
+    if (mode.startsWith(u"Город A"_s))             records->sortRecords(byCityAsc);
+    else if (mode.startsWith(u"Город Я"_s))        records->sortRecords(byCityDesc);
+    else if (mode.startsWith(u"Дата: старые"_s))   records->sortRecords(byOldNew);
+    else if (mode.startsWith(u"Дата: новые"_s))    records->sortRecords(byNewOld);
+    else if (mode.startsWith(u"Радиация: больше"_s)) records->sortRecords(byRadDesc);
+    else if (mode.startsWith(u"Радиация: меньше"_s)) records->sortRecords(byRadAsc);
+}
+
+// ============================
+// КАРТА
+// ============================
+
+void MainWindow::setupMapTab()
+{
+    QVBoxLayout *mapLayout = new QVBoxLayout(mapTab);
+    mapLayout->setSpacing(12);
+    mapLayout->setContentsMargins(20, 20, 20, 20);
+
+    QHBoxLayout *mapControls = new QHBoxLayout;
+    mapControls->addWidget(new QLabel(u"📅 Дата:"_s));
+    mapDateSlider = new QSlider(Qt::Horizontal);
+    mapDateSlider->setRange(0, 0);
+    mapControls->addWidget(mapDateSlider, 1);
+
+    mapControls->addWidget(new QLabel(u"Окно, дней:"_s));
+    mapWindowSpin = new QSpinBox;
+    mapWindowSpin->setRange(1, 3660);
+    mapWindowSpin->setValue(1);
+    mapControls->addWidget(mapWindowSpin);
+
+    mapDateLabel = new QLabel;
+    mapDateLabel->setMinimumWidth(220);
+    mapControls->addWidget(mapDateLabel);
+    mapLayout->addLayout(mapControls);
+
+    heatmapView = new HeatmapWidget;
+    mapLayout->addWidget(heatmapView, 1);
+
+    connect(mapDateSlider, &QSlider::valueChanged, this, &MainWindow::updateHeatmap);
+    connect(mapWindowSpin, &QSpinBox::valueChanged, this, &MainWindow::updateHeatmap);
+}
+
+void MainWindow::onDatasetChanged()
+{
+    ++externalVersion;
+    if (forecastCheck && forecastCheck->isChecked()) refreshForecasts();
+    invalidateHeatmap();
+    invalidateHistogram();
+    invalidateSummary();
+    updateMemoryReadout();
+}
+
+void MainWindow::invalidateHeatmap()
+{
+    mapIndexDirty = true;
+    heatmapCache.clear();
+    if (tabWidget && tabWidget->currentWidget() == mapTab) updateHeatmap();
+}
+
+void MainWindow::rebuildMapIndex()
+{
+    mapIndex.clear();
+    if (sqlActive()) {
+        // база отдаёт уже сложенные станция-дни, а не показания
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        if (!sqlStore->forEachDay({}, sqlWhere, [this](int station, qint64 day, double sum, qint64 count) {
+                mapIndex.add(station, day, sum, count);
+            }))
+            statusBar()->showMessage(u"Ошибка чтения базы: "_s + sqlStore->lastError(), 5000);
+        QApplication::restoreOverrideCursor();
+    } else {
+        forEachViewReading({}, [this](const PackedReading &r) { mapIndex.add(r.station, r.day, r.rad); });
+    }
+    mapIndex.finalize();
+    mapIndexDirty = false;
+
+    const QSignalBlocker blocker(mapDateSlider);
+    mapDateSlider->setRange(0, mapIndex.isEmpty() ? 0 : int(mapIndex.lastDay() - mapIndex.firstDay()));
+}
+
+GeoBounds MainWindow::mapBounds() const
+{
+    // границы по всем известным станциям, чтобы карта не «прыгала» при прокрутке дат
+    GeoBounds b;
+    bool first = true;
+    for (int id = 0; id < stations->count(); ++id) {
+        Coord c;
+        if (!stations->coord(id, &c)) continue;
+        if (first) { b = {c.lat, c.lat, c.lon, c.lon}; first = false; continue; }
+        b.minLat = std::min(b.minLat, c.lat); b.maxLat = std::max(b.maxLat, c.lat);
+        b.minLon = std::min(b.minLon, c.lon); b.maxLon = std::max(b.maxLon, c.lon);
+    }
+    b.minLat -= 0.5; b.maxLat += 0.5;
+    b.minLon -= 0.5; b.maxLon += 0.5;
+    return b;
+}
+
+void MainWindow::updateHeatmap()
+{
+    if (!heatmapView) return;
+    if (mapIndexDirty) rebuildMapIndex();
+
+    if (mapIndex.isEmpty()) {
+        heatmapView->clear();
+        mapDateLabel->setText(u"Нет данных"_s);
+        return;
+    }
+
+    const qint64 fromDay = mapIndex.firstDay() + mapDateSlider->value();
+    const qint64 toDay = fromDay + mapWindowSpin->value() - 1;
+    const QDate from = QDate::fromJulianDay(fromDay);
+    const QDate to = QDate::fromJulianDay(toDay);
+    mapDateLabel->setText(fromDay == toDay ? from.toString("dd.MM.yyyy")
+                                           : QString(u"%1 — %2"_s).arg(from.toString("dd.MM.yyyy"), to.toString("dd.MM.yyyy")));
+
+    QVector<StationSample> samples;
+    for (int id : mapIndex.stations()) {
+        Coord pos;
+        double v = 0.0;
+        if (stations->coord(id, &pos) && mapIndex.mean(id, fromDay, toDay, &v))
+            samples.append({stations->name(id), pos, v});
+    }
+    if (samples.isEmpty()) {
+        heatmapView->clear();
+        return;
+    }
+
+    const quint64 key = (quint64(quint32(fromDay)) << 32) | quint32(toDay);
+    HeatmapGrid *grid = heatmapCache.object(key);
+    if (!grid) {
+        const GeoBounds bounds = mapBounds();
+        const double aspect = (bounds.maxLat - bounds.minLat)
+                              / ((bounds.maxLon - bounds.minLon) * std::cos(qDegreesToRadians((bounds.minLat + bounds.maxLat) / 2)));
+        const QSize gridSize(480, std::max(1, int(480 * aspect)));
+        grid = new HeatmapGrid(IdwInterpolator::compute(samples, bounds, gridSize));
+        heatmapCache.insert(key, grid);
+    }
+    heatmapView->setHeatmap(*grid, samples);
+}
+
+// ============================
+// СРАВНЕНИЕ ПЕРИОДОВ
+// ============================
+
+void MainWindow::setupCompareTab()
+{
+    QVBoxLayout *compareLayout = new QVBoxLayout(compareTab);
+    compareLayout->setSpacing(12);
+    compareLayout->setContentsMargins(20, 20, 20, 20);
+
+    QHBoxLayout *top = new QHBoxLayout;
+
+    QGroupBox *optionsGroup = new QGroupBox(u"⚙️ Параметры сравнения"_s);
+    QVBoxLayout *optionsLayout = new QVBoxLayout(optionsGroup);
+    compareModeCombo = new QComboBox;
+    compareModeCombo->addItems({u"Год к году (по дню года)"_s, u"Месяц к месяцу (по дню месяца)"_s});
+    optionsLayout->addWidget(new QLabel(u"Режим:"_s));
+    optionsLayout->addWidget(compareModeCombo);
+    optionsLayout->addWidget(new QLabel(u"Периоды (первый отмеченный — базовый):"_s));
+    comparePeriodList = new QListWidget;
+    comparePeriodList->setSelectionMode(QAbstractItemView::NoSelection);
+    comparePeriodList->setUniformItemSizes(true);
+    optionsLayout->addWidget(comparePeriodList, 1);
+    btnCompare = new QPushButton(u"📆 Сравнить"_s);
+    optionsLayout->addWidget(btnCompare);
+    optionsGroup->setFixedWidth(280);
+    top->addWidget(optionsGroup);
+
+    compareChartView = new QChartView;
+    compareChartView->setRenderHint(QPainter::Antialiasing);
+    compareChartView->setMinimumHeight(380);
+    QChart *chart = new QChart();
+    chart->setTheme(QChart::ChartThemeLight);
+    chart->legend()->setAlignment(Qt::AlignBottom);
+    compareChartView->setChart(chart);
+    top->addWidget(compareChartView, 1);
+    compareLayout->addLayout(top, 3);
+
+    compareTable = new QTableWidget(0, 7);
+    compareTable->setHorizontalHeaderLabels({u"🏙️ Город"_s, u"Период"_s, u"Записей"_s, u"Среднее"_s,
+                                             u"Мин"_s, u"Макс"_s, u"Δ к базовому"_s});
+    compareTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    compareTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    compareTable->setAlternatingRowColors(true);
+    compareLayout->addWidget(compareTable, 2);
+
+    connect(compareModeCombo, &QComboBox::currentIndexChanged, this, &MainWindow::refreshComparePeriods);
+    connect(btnCompare, &QPushButton::clicked, this, &MainWindow::comparePeriods);
+}
+
+void MainWindow::refreshComparePeriods()
+{
+    const PeriodMode mode = compareModeCombo->currentIndex() == 0 ? PeriodMode::YearOverYear
+                                                                  : PeriodMode::MonthOverMonth;
+
+    // сохраняем отметки, если периоды остались прежними
+    QSet<int> wasChecked;
+    for (int i = 0; i < comparePeriodList->count(); ++i)
+        if (comparePeriodList->item(i)->checkState() == Qt::Checked)
+            wasChecked.insert(comparePeriodList->item(i)->data(Qt::UserRole).toInt());
+
+    comparePeriodList->clear();
+    PeriodSet periods(mode);
+    if (sqlActive())
+        sqlStore->forEachDay({}, sqlWhere, [&periods](int, qint64 day, double, qint64) { periods.add(day); });
+    else
+        forEachViewReading({}, [&periods](const PackedReading &r) { periods.add(r.day); });
+    for (int key : periods.sorted()) {
+        auto *item = new QListWidgetItem(PeriodComparison::periodLabel(mode, key));
+        item->setData(Qt::UserRole, key);
+        item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+        item->setCheckState(wasChecked.contains(key) ? Qt::Checked : Qt::Unchecked);
+        comparePeriodList->addItem(item);
+    }
+}
+
+void MainWindow::comparePeriods()
+{
+    const PeriodMode mode = compareModeCombo->currentIndex() == 0 ? PeriodMode::YearOverYear
+                                                                  : PeriodMode::MonthOverMonth;
+
+    QVector<int> periodKeys;
+    for (int i = 0; i < comparePeriodList->count(); ++i)
+        if (comparePeriodList->item(i)->checkState() == Qt::Checked)
+            periodKeys.append(comparePeriodList->item(i)->data(Qt::UserRole).toInt());
+    if (periodKeys.size() < 2) {
+        QMessageBox::information(this, u"Сравнение периодов"_s, u"Отметьте хотя бы два периода."_s);
+        return;
+    }
+
+    int totalSelected = 0;
+    const QVector<int> ids = chartStations(&totalSelected);
+    if (ids.isEmpty()) {
+        QMessageBox::information(this, u"Сравнение периодов"_s, u"Выберите город или отметьте станции для наложения."_s);
+        return;
+    }
+
+    const QVector<CityComparison> result = PeriodComparison::compute(mode, collectReadings(ids), ids, periodKeys);
+
+    // ===== Сводная таблица =====
+    compareTable->setRowCount(0);
+    for (const CityComparison &cmp : result) {
+        const PeriodAggregate &base = cmp.periods.first();
+        for (int p = 0; p < periodKeys.size(); ++p) {
+            const PeriodAggregate &agg = cmp.periods[p];
+            const int row = compareTable->rowCount();
+            compareTable->insertRow(row);
+            compareTable->setItem(row, 0, new QTableWidgetItem(stations->name(cmp.station)));
+            compareTable->setItem(row, 1, new QTableWidgetItem(PeriodComparison::periodLabel(mode, periodKeys[p])));
+            compareTable->setItem(row, 2, new QTableWidgetItem(QString::number(agg.count)));
+            if (agg.count == 0) continue;
+            compareTable->setItem(row, 3, new QTableWidgetItem(QString::number(agg.mean(), 'f', 2)));
+            compareTable->setItem(row, 4, new QTableWidgetItem(QString::number(agg.min)));
+            compareTable->setItem(row, 5, new QTableWidgetItem(QString::number(agg.max)));
+            if (p > 0 && base.count > 0) {
+                const double diff = agg.mean() - base.mean();
+                QString text = QString(u"%1%2"_s).arg(diff >= 0 ? u"+"_s : QString()).arg(diff, 0, 'f', 2);
+                if (base.mean() != 0.0)
+                    text += QString(u" (%1%2%)"_s).arg(diff >= 0 ? u"+"_s : QString()).arg(100.0 * diff / base.mean(), 0, 'f', 1);
+                compareTable->setItem(row, 6, new QTableWidgetItem(text));
+            }
+        }
+    }
+
+    // ===== Наложение кривых на общей оси =====
+    QChart *chart = compareChartView->chart();
+    chart->removeAllSeries();
+    for (QAbstractAxis *ax : chart->axes()) { chart->removeAxis(ax); delete ax; }
+
+    auto *axisX = new QValueAxis;
+    axisX->setTitleText(mode == PeriodMode::YearOverYear ? u"День года"_s : u"День месяца"_s);
+    axisX->setRange(1, PeriodComparison::alignedLength(mode));
+    axisX->setLabelFormat("%d");
+    auto *axisY = new QValueAxis;
+    axisY->setTitleText(u"мкР/ч"_s);
+    axisY->setLabelFormat("%.0f");
+    chart->addAxis(axisX, Qt::AlignBottom);
+    chart->addAxis(axisY, Qt::AlignLeft);
+
+    const QList<QColor> palette = {
+        QColor("#2563eb"), QColor("#10b981"), QColor("#f59e0b"),
+        QColor("#8b5cf6"), QColor("#ef4444"), QColor("#14b8a6"),
+        QColor("#f97316")
+    };
+    const QList<Qt::PenStyle> periodStyles = { Qt::SolidLine, Qt::DashLine, Qt::DotLine, Qt::DashDotLine };
+
+    double minY = std::numeric_limits<double>::max();
+    double maxY = std::numeric_limits<double>::lowest();
+    int seriesCount = 0;
+    int curvesSkipped = 0;
+    for (int c = 0; c < result.size(); ++c) {
+        for (int p = 0; p < periodKeys.size(); ++p) {
+            const QVector<QPointF> &curve = result[c].curves[p];
+            if (curve.isEmpty()) continue;
+            if (seriesCount >= MaxOverlaySeries) {
+                ++curvesSkipped;
+                continue;
+            }
+
+            auto *line = new QLineSeries();
+            line->setName(QString(u"%1 · %2"_s).arg(stations->name(result[c].station),
+                                                    PeriodComparison::periodLabel(mode, periodKeys[p])));
+            QPen pen(palette[c % palette.size()]);
+            pen.setWidth(2);
+            pen.setCosmetic(true);
+            pen.setStyle(periodStyles[p % periodStyles.size()]);
+            line->setPen(pen);
+            line->replace(curve);
+            for (const QPointF &pt : curve) {
+                minY = std::min(minY, pt.y());
+                maxY = std::max(maxY, pt.y());
+            }
+
+            chart->addSeries(line);
+            line->attachAxis(axisX);
+            line->attachAxis(axisY);
+            ++seriesCount;
+        }
+    }
+
+    if (seriesCount == 0) {
+        QMessageBox::information(this, u"Сравнение периодов"_s, u"Нет данных для выбранных периодов"_s);
+        return;
+    }
+    double pad = (maxY - minY) * 0.15;
+    if (pad <= 0) pad = 1.0;
+    axisY->setRange(std::max(0.0, minY - pad), maxY + pad);
+    chart->setTitle(mode == PeriodMode::YearOverYear ? u"Сравнение год к году"_s : u"Сравнение месяц к месяцу"_s);
+
+    // таблица и график ограничены: пользователь должен видеть, что часть выбора не показана
+    QStringList truncated;
+    if (totalSelected > ids.size())
+        truncated << QString(u"в сравнении первые %1 из %2 станций"_s).arg(ids.size()).arg(totalSelected);
+    if (curvesSkipped > 0)
+        truncated << QString(u"на графике %1 из %2 кривых"_s).arg(seriesCount).arg(seriesCount + curvesSkipped);
+    if (!truncated.isEmpty()) {
+        const QString text = truncated.join(u"; "_s);
+        QMessageBox::information(this, u"Сравнение периодов"_s,
+                                 QString(u"Показана только часть выбора (не более %1 кривых): %2."_s)
+                                     .arg(MaxOverlaySeries).arg(text));
+        statusBar()->showMessage(u"✅ Сравнение: "_s + text, 8000);
+        return;
+    }
+    statusBar()->showMessage(QString(u"✅ Сравнение: %1 станций × %2 периодов"_s)
+                                 .arg(result.size()).arg(periodKeys.size()), 5000);
+}
+
+// ============================
+// КОРРЕЛЯЦИЯ СТАНЦИЙ
+// ============================
+
+void MainWindow::setupCorrelationTab()
+{
+    QVBoxLayout *layout = new QVBoxLayout(correlationTab);
+    layout->setSpacing(12);
+    layout->setContentsMargins(20, 20, 20, 20);
+
+    QHBoxLayout *controls = new QHBoxLayout;
+    controls->addWidget(new QLabel(u"Макс. лаг, дней:"_s));
+    correlationLagSpin = new QSpinBox;
+    correlationLagSpin->setRange(0, 60);
+    correlationLagSpin->setToolTip(u"0 — обычная корреляция Пирсона; иначе для каждой пары ищется сдвиг с максимальной |r|"_s);
+    controls->addWidget(correlationLagSpin);
+    btnCorrelation = new QPushButton(u"🔗 Рассчитать"_s);
+    controls->addWidget(btnCorrelation);
+    correlationInfo = new QLabel;
+    controls->addWidget(correlationInfo, 1);
+    layout->addLayout(controls);
+
+    correlationView = new CorrelationHeatmap;
+    layout->addWidget(correlationView, 1);
+
+    connect(btnCorrelation, &QPushButton::clicked, this, &MainWindow::computeCorrelation);
+}
+
+void MainWindow::computeCorrelation()
+{
+    auto noData = [this]() {
+        QMessageBox::information(this, u"Корреляция"_s, u"Сначала добавьте или загрузите записи."_s);
+    };
+
+    QElapsedTimer timer;
+    CorrelationMatrix m;
+    if (pagedActive() || sqlActive()) {
+        // суточная сетка копится прямо из страниц файла или из GROUP BY базы: сумма и счётчик
+        // на станцию-день; диапазон дат — из индекса и добавленных записей или одним агрегатом
+        const bool sql = sqlActive();
+        qint64 firstDay = 0;
+        qint64 lastDay = -1;
+        if (sql) {
+            sqlStore->dayRange(sqlWhere, &firstDay, &lastDay);
+        } else {
+            const JsonPageIndex &index = pagedModel->pageIndex();
+            firstDay = index.firstDay;
+            lastDay = index.lastDay;
+            for (const PackedReading &r : pagedModel->source().appendedRecords()) {
+                if (lastDay < firstDay) {
+                    firstDay = lastDay = r.day;
+                    continue;
+                }
+                firstDay = std::min<qint64>(firstDay, r.day);
+                lastDay = std::max<qint64>(lastDay, r.day);
+            }
+        }
+        if (lastDay < firstDay) {
+            noData();
+            return;
+        }
+        timer.start();
+        DailyGridBuilder grid(firstDay, lastDay);
+        if (sql) {
+            sqlStore->forEachDay({}, sqlWhere, [&grid](int station, qint64 day, double sum, qint64 count) {
+                grid.add(station, day, float(sum), quint32(count));
+            });
+        } else {
+            forEachViewReading({}, [&grid](const PackedReading &r) { grid.add(r.station, r.day, float(r.rad)); });
+        }
+        m = CorrelationEngine::compute(grid.series(), correlationLagSpin->value());
+        if (m.n == 0) {
+            noData();
+            return;
+        }
+    } else {
+        const QVector<StationReading> readings = collectReadings();
+        if (readings.isEmpty()) {
+            noData();
+            return;
+        }
+        timer.start();
+        m = CorrelationEngine::compute(readings, correlationLagSpin->value());
+    }
+    const qint64 elapsed = timer.elapsed();
+
+    QStringList names;
+    names.reserve(m.n);
+    for (int id : m.stations) names.append(stations->name(id));
+    correlationView->setMatrix(m, names);
+
+    qint64 undefined = 0;
+    for (float v : m.r) undefined += std::isnan(v);
+    QString info = QString(u"%1 станций × %2 дней, %3 мс"_s).arg(m.n).arg(m.days).arg(elapsed);
+    if (undefined > 0) info += QString(u"; не определено %1 ячеек (серые): мало общих дней или постоянный ряд"_s).arg(undefined);
+    correlationInfo->setText(info);
+    statusBar()->showMessage(u"✅ Матрица корреляций построена"_s, 3000);
+}
+
+// ============================
+// СВОДКА ПО СТАНЦИЯМ
+// ============================
+
+void MainWindow::setupSummaryTab()
+{
+    QVBoxLayout *layout = new QVBoxLayout(summaryTab);
+    layout->setSpacing(12);
+    layout->setContentsMargins(20, 20, 20, 20);
+
+    QHBoxLayout *controls = new QHBoxLayout;
+    summaryInfo = new QLabel;
+    controls->addWidget(summaryInfo, 1);
+    QPushButton *btnExport = new QPushButton(u"💾 Экспорт CSV"_s);
+    controls->addWidget(btnExport);
+    layout->addLayout(controls);
+
+    QStringList headers = {u"🏙️ Станция"_s, u"Показаний"_s, u"Среднее"_s, u"Мин"_s, u"Макс"_s,
+                           u"σ"_s, u"Последняя дата"_s, u"Последнее"_s};
+    for (int limit : RadiationModel::kBandLimits) headers.append(QString(u"> %1"_s).arg(limit));
+    summaryTable = new QTableWidget(0, int(headers.size()));
+    summaryTable->setHorizontalHeaderLabels(headers);
+    summaryTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    summaryTable->verticalHeader()->setVisible(false);
+    summaryTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    summaryTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    summaryTable->setAlternatingRowColors(true);
+    summaryTable->setSortingEnabled(true);
+    layout->addWidget(summaryTable, 1);
+
+    connect(btnExport, &QPushButton::clicked, this, &MainWindow::exportSummary);
+}
+
+void MainWindow::invalidateSummary()
+{
+    summaryDirty = true;
+    if (tabWidget && tabWidget->currentWidget() == summaryTab) updateSummary();
+}
+
+void MainWindow::updateSummary()
+{
+    if (!summaryDirty || !summaryTable) return;
+    Trace::Operation traceOp("summary");
+
+    QElapsedTimer timer;
+    timer.start();
+    const bool filtered = sqlActive() ? !sqlWhere.isEmpty()
+                          : pagedActive() ? pagedModel->isFiltered() : filterModel->isActive();
+    if (sqlActive()) {
+        // база: агрегаты GROUP BY station по покрывающему индексу
+        summaryRows = sqlStore->summaries(sqlWhere);
+    } else if (pagedActive()) {
+        // постраничный файл: сводки копятся по страницам в массив по id станции
+        QVector<StationSummary> acc(stations->count());
+        forEachViewReading({}, [&acc](const PackedReading &r) {
+            if (r.station < acc.size()) acc[r.station].add(r.day, r.rad);
+        });
+        summaryRows.clear();
+        for (int id = 0; id < acc.size(); ++id) {
+            if (acc[id].count == 0) continue;
+            acc[id].station = id;
+            summaryRows.append(acc[id]);
+        }
+    } else {
+        summaryRows = GroupBy::byStation(records->arena(), filterModel->isActive() ? &filterModel->selectedRows() : nullptr,
+                                         stations->count());
+    }
+    const qint64 elapsedUs = timer.nsecsElapsed() / 1000;
+    summaryDirty = false;
+
+    // числа кладутся как числа, чтобы сортировка по столбцу была числовой
+    auto number = [](const QVariant &v) {
+        auto *item = new QTableWidgetItem;
+        item->setData(Qt::DisplayRole, v);
+        item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+        return item;
+    };
+    auto rounded = [](double v) { return std::round(v * 100.0) / 100.0; };
+
+    TRACE_SCOPE("summary table");
+    summaryTable->setSortingEnabled(false);
+    summaryTable->setRowCount(int(summaryRows.size()));
+    for (int row = 0; row < summaryRows.size(); ++row) {
+        const StationSummary &s = summaryRows[row];
+        int col = 0;
+        summaryTable->setItem(row, col++, new QTableWidgetItem(stations->name(s.station)));
+        summaryTable->setItem(row, col++, number(s.count));
+        summaryTable->setItem(row, col++, number(rounded(s.mean())));
+        summaryTable->setItem(row, col++, number(s.min));
+        summaryTable->setItem(row, col++, number(s.max));
+        summaryTable->setItem(row, col++, number(rounded(s.stddev())));
+        summaryTable->setItem(row, col++, new QTableWidgetItem(QDate::fromJulianDay(s.lastDay).toString("yyyy-MM-dd")));
+        summaryTable->setItem(row, col++, number(s.lastRad));
+        for (qint64 n : s.above) summaryTable->setItem(row, col++, number(n));
+    }
+    summaryTable->setSortingEnabled(true);
+    traceOp.finish();
+
+    qint64 total = 0;
+    for (const StationSummary &s : std::as_const(summaryRows)) total += s.count;
+    summaryInfo->setText(QString(u"%1 станций, %2 показаний%3 — %4 мс"_s)
+                             .arg(summaryRows.size()).arg(total)
+                             .arg(filtered ? u" (с фильтром)"_s : QString())
+                             .arg(elapsedUs / 1000.0, 0, 'f', 1));
+}
+
+void MainWindow::exportSummary()
+{
+    updateSummary();
+    if (summaryRows.isEmpty()) {
+        QMessageBox::information(this, u"Сводка"_s, u"Сначала добавьте или загрузите записи."_s);
+        return;
+    }
+    const QString fileName = QFileDialog::getSaveFileName(this, u"Экспорт сводки"_s, u"summary.csv"_s, u"CSV (*.csv)"_s);
+    if (fileName.isEmpty()) return;
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        QMessageBox::warning(this, u"Ошибка"_s, u"Не удалось открыть файл для записи: "_s + file.errorString());
+        return;
+    }
+    // строки в порядке текущей сортировки таблицы
+    QTextStream out(&file);
+    QStringList header;
+    for (int c = 0; c < summaryTable->columnCount(); ++c) header.append(summaryTable->horizontalHeaderItem(c)->text());
+    header.first() = u"station"_s;
+    out << header.join(u',') << '\n';
+    for (int row = 0; row < summaryTable->rowCount(); ++row) {
+        QStringList cells;
+        for (int c = 0; c < summaryTable->columnCount(); ++c) {
+            const QString text = summaryTable->item(row, c)->data(Qt::DisplayRole).toString();
+            cells.append(c == 0 ? u"\""_s + QString(text).replace(u'"', u"\"\""_s) + u"\""_s : text);
+        }
+        out << cells.join(u',') << '\n';
+    }
+    out.flush();
+    if (!file.commit()) {
+        QMessageBox::warning(this, u"Ошибка"_s, u"Не удалось записать файл: "_s + file.errorString());
+        return;
+    }
+    statusBar()->showMessage(QString(u"✅ Сводка по %1 станциям сохранена в %2"_s).arg(summaryTable->rowCount()).arg(fileName), 5000);
+}
+
+// ============================
+// РАСПРЕДЕЛЕНИЕ
+// ============================
+
+void MainWindow::setupHistogramTab()
+{
+    QVBoxLayout *layout = new QVBoxLayout(histogramTab);
+    layout->setSpacing(12);
+    layout->setContentsMargins(20, 20, 20, 20);
+
+    QHBoxLayout *controls = new QHBoxLayout;
+    controls->addWidget(new QLabel(u"Станции:"_s));
+    histScopeCombo = new QComboBox;
+    histScopeCombo->addItems({u"Все станции"_s, u"Отмеченные на вкладке графиков"_s, u"Текущий город"_s});
+    controls->addWidget(histScopeCombo);
+    controls->addWidget(new QLabel(u"Ширина корзины:"_s));
+    histBinSlider = new QSlider(Qt::Horizontal);
+    histBinSlider->setRange(1, 50);
+    histBinSlider->setValue(2);
+    controls->addWidget(histBinSlider, 1);
+    histBinLabel = new QLabel;
+    histBinLabel->setMinimumWidth(90);
+    controls->addWidget(histBinLabel);
+    layout->addLayout(controls);
+
+    auto *chart = new QChart;
+    chart->setTitle(u"Распределение показаний"_s);
+    chart->legend()->setAlignment(Qt::AlignBottom);
+    histogramChartView = new QChartView(chart);
+    histogramChartView->setRenderHint(QPainter::Antialiasing);
+    layout->addWidget(histogramChartView, 1);
+
+    histBandsLabel = new QLabel;
+    histBandsLabel->setTextFormat(Qt::RichText);
+    layout->addWidget(histBandsLabel);
+
+    // ширина корзины перестраивает только график, записи заново не считаются
+    connect(histBinSlider, &QSlider::valueChanged, this, &MainWindow::drawHistogram);
+    connect(histScopeCombo, &QComboBox::currentIndexChanged, this, &MainWindow::invalidateHistogram);
+    connect(overlayModel, &QAbstractItemModel::dataChanged, this, [this]() {
+        if (histScopeCombo->currentIndex() == 1) invalidateHistogram();
+    });
+    connect(cityComboBox, &QComboBox::currentIndexChanged, this, [this]() {
+        if (histScopeCombo->currentIndex() == 2) invalidateHistogram();
+    });
+}
+
+void MainWindow::invalidateHistogram()
+{
+    histogramDirty = true;
+    if (tabWidget && tabWidget->currentWidget() == histogramTab) updateHistogram();
+}
+
+void MainWindow::updateHistogram()
+{
+    if (!histogramDirty) return;
+    Trace::Operation traceOp("histogram");
+
+    QVector<int> ids;
+    if (histScopeCombo->currentIndex() == 1) {
+        ids = chartStations();
+        if (ids.isEmpty()) ids = {-1};   // ничего не отмечено — пустое распределение
+    } else if (histScopeCombo->currentIndex() == 2) {
+        ids = {stations->find(cityComboBox->currentText().trimmed())};
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    if (pagedActive() || sqlActive()) {
+        // файл или база: счётчики копятся потоком по страницам или строкам выборки, нет станций — нечего читать
+        histCounts = ValueCounts();
+        if (!(ids.size() == 1 && ids.first() < 0))
+            forEachViewReading(ids, [this](const PackedReading &r) { histCounts.add(r.rad); });
+    } else {
+        histCounts = HistogramBuilder::count(records->arena(),
+                                             filterModel->isActive() ? &filterModel->selectedRows() : nullptr, ids);
+    }
+    histCountUs = timer.nsecsElapsed() / 1000;
+    histogramDirty = false;
+    traceOp.finish();
+    drawHistogram();
+}
+
+void MainWindow::drawHistogram()
+{
+    const int width = histBinSlider->value();
+    histBinLabel->setText(QString(u"%1 мкР/ч"_s).arg(width));
+
+    QChart *chart = histogramChartView->chart();
+    chart->removeAllSeries();
+    QValueAxis *axisX = nullptr;
+    QValueAxis *axisY = nullptr;
+    for (auto *ax : chart->axes(Qt::Horizontal)) axisX = qobject_cast<QValueAxis*>(ax);
+    for (auto *ay : chart->axes(Qt::Vertical)) axisY = qobject_cast<QValueAxis*>(ay);
+    if (!axisX) {
+        axisX = new QValueAxis;
+        axisX->setTitleText(u"мкР/ч"_s);
+        axisX->setLabelFormat("%.0f");
+        chart->addAxis(axisX, Qt::AlignBottom);
+    }
+    if (!axisY) {
+        axisY = new QValueAxis;
+        axisY->setTitleText(u"Показаний"_s);
+        axisY->setLabelFormat("%.0f");
+        chart->addAxis(axisY, Qt::AlignLeft);
+    }
+
+    if (histCounts.isEmpty()) {
+        histBandsLabel->setText(u"Нет показаний для выбранных станций"_s);
+        return;
+    }
+
+    // ступенчатый контур корзин, залитый до оси
+    const QVector<qint64> bins = histCounts.bins(width);
+    QList<QPointF> steps;
+    steps.reserve(bins.size() * 2);
+    qint64 peak = 0;
+    for (int k = 0; k < bins.size(); ++k) {
+        steps.append(QPointF(double(k) * width, double(bins[k])));
+        steps.append(QPointF(double(k + 1) * width, double(bins[k])));
+        peak = std::max(peak, bins[k]);
+    }
+    auto *upper = new QLineSeries;
+    upper->replace(steps);
+    auto *area = new QAreaSeries(upper);
+    upper->setParent(area);
+    area->setName(QString(u"Показаний в корзине (%1 мкР/ч)"_s).arg(width));
+    area->setBrush(QColor(37, 99, 235, 140));
+    area->setPen(QPen(QColor("#2563eb"), 1));
+    chart->addSeries(area);
+    area->attachAxis(axisX);
+    area->attachAxis(axisY);
+
+    const double xMax = double(bins.size()) * width;
+    const double yMax = double(peak) * 1.08 + 1.0;
+
+    // пороги уровней — вертикальные отметки в цвете полос таблицы
+    for (int k = 0; k < RadiationModel::kBandCount - 1; ++k) {
+        const int limit = RadiationModel::kBandLimits[k];
+        if (limit > xMax) break;
+        auto *mark = new QLineSeries;
+        mark->setName(QString(u"%1 мкР/ч"_s).arg(limit));
+        QPen pen(RadiationModel::bandColor(limit + 1).darker(160));
+        pen.setWidth(2);
+        pen.setStyle(Qt::DashLine);
+        pen.setCosmetic(true);
+        mark->setPen(pen);
+        mark->append(limit, 0.0);
+        mark->append(limit, yMax);
+        chart->addSeries(mark);
+        mark->attachAxis(axisX);
+        mark->attachAxis(axisY);
+    }
+    axisX->setRange(0.0, xMax);
+    axisY->setRange(0.0, yMax);
+
+    // сводка по полосам
+    const auto bands = histCounts.bands();
+    static const char *const names[RadiationModel::kBandCount] = {"≤15", "16–30", "31–60", "&gt;60"};
+    static const int samples[RadiationModel::kBandCount] = {0, 16, 31, 61};
+    QStringList parts;
+    for (int k = 0; k < RadiationModel::kBandCount; ++k) {
+        parts << QString(u"<span style='background:%1'>&nbsp;%2 мкР/ч&nbsp;</span> %3 (%4%)"_s)
+                     .arg(RadiationModel::bandColor(samples[k]).name(), QString::fromUtf8(names[k]))
+                     .arg(bands[k]).arg(100.0 * double(bands[k]) / double(histCounts.total), 0, 'f', 1);
+    }
+    histBandsLabel->setText(QString(u"Всего %1, медиана %2 мкР/ч, 95% ниже %3 мкР/ч — %4 &nbsp; <i>(подсчёт %5 мс)</i>"_s)
+                                .arg(histCounts.total).arg(histCounts.quantile(0.5)).arg(histCounts.quantile(0.95))
+                                .arg(parts.join(u" &nbsp; "_s)).arg(histCountUs / 1000.0, 0, 'f', 1));
+}
+
+// ============================
+// БОЛЬШИЕ ФАЙЛЫ
+// ============================
+
+void MainWindow::setTableModel(QAbstractItemModel *model)
+{
+    if (table->model() == model) return;
+    QItemSelectionModel *oldSelection = table->selectionModel();
+    table->setModel(model);
+    delete oldSelection;
+}
+
+void MainWindow::openLazy(const QString &fileName)
+{
+    JsonPageIndex index;
+    if (index.loadSidecar(fileName)) {
+        showLazy(fileName, index);
+        return;
+    }
+
+    // индекс строится в фоне одним последовательным проходом и сохраняется рядом с файлом
+    struct IndexResult { JsonPageIndex index; QString error; bool ok = false; };
+    auto *watcher = new QFutureWatcher<IndexResult>(this);
+    connect(watcher, &QFutureWatcher<IndexResult>::finished, this, [this, watcher, fileName]() {
+        watcher->deleteLater();
+        btnLoad->setEnabled(true);
+        const IndexResult result = watcher->result();
+        if (!result.ok) {
+            QMessageBox::warning(this, u"Ошибка"_s, QString(u"Не удалось проиндексировать файл:\n%1"_s).arg(result.error));
+            statusBar()->showMessage(u"Ошибка открытия файла"_s);
+            return;
+        }
+        result.index.saveSidecar(fileName);
+        showLazy(fileName, result.index);
+    });
+
+    btnLoad->setEnabled(false);
+    statusBar()->showMessage(QString(u"⏳ Индексация %1..."_s).arg(fileName));
+    watcher->setFuture(QtConcurrent::run([fileName]() {
+        IndexResult r;
+        r.ok = JsonPageIndex::build(fileName, &r.index, &r.error);
+        return r;
+    }));
+}
+
+void MainWindow::showLazy(const QString &fileName, const JsonPageIndex &index)
+{
+    if (!pagedModel) pagedModel = new PagedJsonModel(stations, this);
+    QString error;
+    if (!pagedModel->open(fileName, index, &error)) {
+        QMessageBox::warning(this, u"Ошибка"_s, QString(u"Не удалось открыть файл:\n%1"_s).arg(error));
+        return;
+    }
+
+    recordEdit(u"открытие "_s + QFileInfo(fileName).fileName());
+    records->clear();
+    setTableModel(pagedModel);
+    onDatasetChanged();
+    // введённый фильтр (в том числе из прошлого сеанса — индекс мог строиться в фоне) действует и на файл
+    if (!filterEdit->text().trimmed().isEmpty()) applyFilter();
+    else updateFilterInfo();
+    statusBar()->showMessage(QString(u"📄 %1: %2 записей, открыт постранично — строки читаются при прокрутке"_s)
+                                 .arg(fileName).arg(index.records), 8000);
+}
+
+void MainWindow::openDatabase(const QString &fileName)
+{
+    if (!sqlStore) sqlStore = std::make_unique<SqlStore>(stations);
+    QString error;
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    const bool ok = sqlStore->open(fileName, &error);
+    QApplication::restoreOverrideCursor();
+    if (!ok) {
+        QMessageBox::warning(this, u"Ошибка"_s, QString(u"Не удалось открыть базу:\n%1"_s).arg(error));
+        statusBar()->showMessage(u"Ошибка открытия файла"_s);
+        return;
+    }
+    if (!sqlModel) sqlModel = new SqlRecordsModel(sqlStore.get(), stations, this);
+    if (pagedModel) {
+        pagedModel->deleteLater();
+        pagedModel = nullptr;
+    }
+
+    sqlWhere.clear();
+    sqlFilterText.clear();
+    filterEdit->clear();
+    QString unused;
+    filterModel->setFilter(QString(), &unused);
+    recordEdit(u"открытие "_s + QFileInfo(fileName).fileName());
+    records->clear();
+    sqlModel->setQuery(QString(), SqlStore::Order::Insertion);
+    setTableModel(sqlModel);
+    onDatasetChanged();
+    sessionSource = SourceStamp::of(fileName);
+    filterInfo->setText(u"Фильтр не задан"_s);
+    statusBar()->showMessage(QString(u"🗄 %1: %2 записей, фильтр, сортировка и сводки выполняются в SQLite"_s)
+                                 .arg(fileName).arg(sqlModel->recordCount()), 8000);
+}
+
+// ============================
+// ОБЩАЯ ПАМЯТЬ
+// ============================
+
+void MainWindow::setSharedPublishing(bool on)
+{
+    if (!on) {
+        shmPublisher.reset();
+        statusBar()->showMessage(u"Публикация в общую память остановлена"_s, 3000);
+        return;
+    }
+    shmPublisher = std::make_unique<ShmPublisher>();
+    shmFullPending = true;
+    publishShared();
+    if (shmPublisher && pagedActive())
+        statusBar()->showMessage(u"Постраничный файл не публикуется: его записи не загружаются в память"_s, 5000);
+    else if (shmPublisher && sqlActive())
+        statusBar()->showMessage(u"База публикуется после полной загрузки записей"_s, 5000);
+}
+
+void MainWindow::schedulePublish()
+{
+    if (!shmPublisher || shmScheduled) return;
+    shmScheduled = true;
+    QTimer::singleShot(0, this, &MainWindow::publishShared);
+}
+
+void MainWindow::publishShared()
+{
+    shmScheduled = false;
+    if (!shmPublisher) return;
+    QString error;
+    if (!shmPublisher->publish(*records, *stations, std::exchange(shmFullPending, false), &error)) {
+        shmPublisher.reset();
+        QMessageBox::warning(this, u"Общая память"_s, QString(u"Не удалось опубликовать набор:\n%1"_s).arg(error));
+        statusBar()->showMessage(u"Ошибка публикации в общую память"_s, 5000);
+        return;
+    }
+    statusBar()->showMessage(QString(u"📡 %1: %2 записей опубликовано за %3 мс"_s)
+                                 .arg(shmPublisher->name()).arg(records->size())
+                                 .arg(shmPublisher->lastPublishUs() / 1000.0, 0, 'f', 2), 2000);
+}
+
+// ============================
+// СЕАНС
+// ============================
+
+void MainWindow::restoreSession()
+{
+    SessionState state;
+    if (!Session::loadState(Session::statePath(), &state)) return;
+
+    Trace::Operation traceOp("restoreSession");
+    QElapsedTimer timer;
+    timer.start();
+    sessionSource = state.source;
+    if (state.paged) {
+        // постраничный набор и база не копировались: файл открывается заново
+        if (QFileInfo::exists(state.source.fileName)) {
+            if (SqlStore::isDatabaseFile(state.source.fileName)) openDatabase(state.source.fileName);
+            else openLazy(state.source.fileName);
+        }
+    } else if (state.datasetId != 0) {
+        QString error;
+        if (Session::loadDataset(Session::datasetPath(), state.datasetId, records, stations, &error)) {
+            sessionDatasetId = state.datasetId;
+            sessionSavedVersion = records->dataVersion();
+        } else {
+            records->clear();
+            sessionSource = {};
+            statusBar()->showMessage(u"Набор прошлого сеанса не восстановлен: "_s + error, 8000);
+        }
+        setTableModel(recordsView());
+        onDatasetChanged();
+    }
+
+    // записи уже лежат в сохранённом порядке — пересортировка не нужна
+    if (state.sortMode >= 0 && state.sortMode < sortCombo->count()) sortCombo->setCurrentIndex(state.sortMode);
+    const int city = cityComboBox->findText(state.currentCity);
+    if (city >= 0) cityComboBox->setCurrentIndex(city);
+
+    QVector<int> overlay;
+    for (const QString &name : std::as_const(state.overlayCities)) {
+        const int id = stations->find(name);
+        if (id >= 0) overlay.append(id);
+    }
+    overlayModel->setAllChecked(false);
+    overlayModel->setChecked(overlay, true);
+
+    if (!state.filterText.isEmpty()) {
+        filterEdit->setText(state.filterText);
+        applyFilter();
+    }
+
+    if (radiationChartView) applyChartSettings(state.chart);
+    else pendingChartSettings = state.chart;
+    if (state.currentTab > 0 && state.currentTab < tabWidget->count()) tabWidget->setCurrentIndex(state.currentTab);
+    traceOp.finish();
+
+    if (!state.paged && records->size() > 0)
+        statusBar()->showMessage(QString(u"♻️ Восстановлен прошлый сеанс: %1 записей за %2 мс"_s)
+                                     .arg(records->size()).arg(timer.elapsed()), 5000);
+    checkSessionSource();
+}
+
+void MainWindow::saveSession()
+{
+    SessionState state;
+    state.source = sessionSource;
+    state.paged = pagedActive() || sqlActive();
+
+    // файл набора переписывается, только если данные менялись с прошлой записи/восстановления
+    if (!state.paged && records->dataVersion() != sessionSavedVersion) {
+        sessionDatasetId = 0;
+        if (records->size() > 0) {
+            const quint64 id = quint64(QDateTime::currentMSecsSinceEpoch());
+            QString error;
+            if (Session::saveDataset(Session::datasetPath(), id, *records, *stations, &error)) sessionDatasetId = id;
+            else qWarning("session: %s", qPrintable(error));
+        } else {
+            QFile::remove(Session::datasetPath());
+        }
+        sessionSavedVersion = records->dataVersion();
+    }
+    state.datasetId = state.paged ? 0 : sessionDatasetId;
+
+    state.sortMode = sortCombo->currentIndex();
+    state.filterText = sqlActive() ? sqlFilterText
+                       : pagedActive() ? pagedModel->filterText()
+                       : filterModel->isActive() ? filterEdit->text().trimmed() : QString();
+    state.currentCity = cityComboBox->currentText();
+    for (int id : overlayModel->checkedIds()) state.overlayCities.append(stations->name(id));
+    state.currentTab = tabWidget->currentIndex();
+    state.chart = chartSettings();
+    Session::saveState(Session::statePath(), state);
+}
+
+void MainWindow::checkSessionSource()
+{
+    if (!sessionSource.isValid() || pagedActive() || sqlActive()) return;
+
+    // файл может лежать на медленном диске или в сети: проверка не задерживает показ таблицы
+    const SourceStamp cached = sessionSource;
+    auto *watcher = new QFutureWatcher<SourceStamp>(this);
+    connect(watcher, &QFutureWatcher<SourceStamp>::finished, this, [this, watcher, cached]() {
+        watcher->deleteLater();
+        const SourceStamp current = watcher->result();
+        if (sessionSource != cached || current == cached) return;   // за время проверки загружен другой набор
+        if (current.size < 0) {
+            statusBar()->showMessage(QString(u"Исходный файл %1 недоступен — показаны данные прошлого сеанса"_s)
+                                         .arg(cached.fileName), 8000);
+            return;
+        }
+        statusBar()->showMessage(QString(u"⚠️ Файл %1 изменился после прошлого сеанса"_s).arg(cached.fileName));
+        const auto answer = QMessageBox::question(this, u"Исходный файл изменился"_s,
+                                                  QString(u"Файл\n%1\nизменился после прошлого сеанса.\n"
+                                                          u"Перезагрузить данные из него? Изменения в таблице будут потеряны."_s)
+                                                      .arg(cached.fileName));
+        if (answer == QMessageBox::Yes) loadFile(cached.fileName);
+        else sessionSource = current;   // пользователь остаётся с данными сеанса — больше не спрашивать
+    });
+    watcher->setFuture(QtConcurrent::run([fileName = cached.fileName]() { return SourceStamp::of(fileName); }));
+}
+
+QVariantMap MainWindow::chartSettings() const
+{
+    if (!radiationChartView) return pendingChartSettings;   // вкладка не открывалась — настройки прошлого сеанса
+
+    QStringList metricKeys;
+    for (int i = 0; i < chartMetricList->count(); ++i)
+        if (chartMetricList->item(i)->checkState() == Qt::Checked)
+            metricKeys.append(chartMetricList->item(i)->data(Qt::UserRole + 1).toString());
+    return {
+        {u"chartType"_s, chartTypeCombo->currentIndex()},
+        {u"seasonalPeriod"_s, seasonalPeriodCombo->currentIndex()},
+        {u"gridStep"_s, gridStepCombo->currentIndex()},
+        {u"gridAggregation"_s, gridAggCombo->currentIndex()},
+        {u"gridGapFill"_s, gridGapCombo->currentIndex()},
+        {u"gridMaxGap"_s, gridMaxGapSpin->value()},
+        {u"dose"_s, doseCheck->isChecked()},
+        {u"forecast"_s, forecastCheck->isChecked()},
+        {u"metrics"_s, metricKeys},
+    };
+}
+
+void MainWindow::applyChartSettings(const QVariantMap &settings)
+{
+    const auto restoreIndex = [&settings](QComboBox *combo, const QString &key) {
+        const int index = settings.value(key, -1).toInt();
+        if (index >= 0 && index < combo->count()) combo->setCurrentIndex(index);
+    };
+    restoreIndex(chartTypeCombo, u"chartType"_s);
+    restoreIndex(seasonalPeriodCombo, u"seasonalPeriod"_s);
+    restoreIndex(gridStepCombo, u"gridStep"_s);
+    restoreIndex(gridAggCombo, u"gridAggregation"_s);
+    restoreIndex(gridGapCombo, u"gridGapFill"_s);
+    if (settings.contains(u"gridMaxGap"_s)) gridMaxGapSpin->setValue(settings.value(u"gridMaxGap"_s).toInt());
+    doseCheck->setChecked(settings.value(u"dose"_s).toBool());
+    forecastCheck->setChecked(settings.value(u"forecast"_s).toBool());
+
+    const QStringList metricKeys = settings.value(u"metrics"_s).toStringList();
+    for (int i = 0; i < chartMetricList->count(); ++i) {
+        QListWidgetItem *item = chartMetricList->item(i);
+        item->setCheckState(metricKeys.contains(item->data(Qt::UserRole + 1).toString()) ? Qt::Checked : Qt::Unchecked);
+    }
+}
+
+void MainWindow::closeEvent(QCloseEvent *event)
+{
+    saveSession();
+    QMainWindow::closeEvent(event);
+}
+
+// ============================
+// ДИАГНОСТИКА
+// ============================
+
+void MainWindow::showTraceSummary(const Trace::OperationSummary &summary)
+{
+    QStringList parts;
+    QString details = QString(u"%1: %2 мс"_s).arg(summary.name).arg(summary.totalUs / 1000.0, 0, 'f', 1);
+    for (const auto &part : summary.parts) {
+        if (parts.size() < 4)
+            parts.append(QString(u"%1 %2"_s).arg(part.first).arg(part.second / 1000.0, 0, 'f', 1));
+        details += QString(u"\n  %1: %2 мс"_s).arg(part.first).arg(part.second / 1000.0, 0, 'f', 1);
+    }
+
+    QString text = QString(u"⏱ %1 %2 мс"_s).arg(summary.name).arg(summary.totalUs / 1000.0, 0, 'f', 1);
+    if (!parts.isEmpty()) text += u": "_s + parts.join(u" · "_s);
+    perfLabel->setText(text);
+    perfLabel->setToolTip(details);
+}
+
+void MainWindow::exportTrace()
+{
+    const QString fileName = QFileDialog::getSaveFileName(this, u"Экспорт трассировки"_s, u"trace.json"_s,
+                                                          u"Chrome trace (*.json)"_s);
+    if (fileName.isEmpty()) return;
+
+    QString error;
+    if (!Trace::exportChromeJson(fileName, &error)) {
+        QMessageBox::warning(this, u"Ошибка"_s, QString(u"Не удалось записать трассировку:\n%1"_s).arg(error));
+        return;
+    }
+    statusBar()->showMessage(QString(u"Трассировка сохранена в: %1 (откройте в ui.perfetto.dev)"_s).arg(fileName), 5000);
+}
+
+void MainWindow::updateMemoryReadout()
+{
+    const double mb = records->bytesUsed() / (1024.0 * 1024.0);
+    memLabel->setText(QString(u"💾 %1 записей · %2 МБ выделено · %3 Б/запись"_s)
+                          .arg(records->size())
+                          .arg(mb, 0, 'f', 1)
+                          .arg(records->bytesPerRecord(), 0, 'f', 1));
+}
+
+void MainWindow::showMemoryReport()
+{
+    auto kb = [](qsizetype bytes) { return QString::number(bytes / 1024.0, 'f', 1) + u" КБ"_s; };
+
+    const qsizetype payload = records->size() * qsizetype(sizeof(PackedReading));
+    QString text;
+    text += QString(u"Записей: %1 (%2 Б на запись в упакованном виде)\n"_s).arg(records->size()).arg(sizeof(PackedReading));
+    text += QString(u"Данные записей: %1\n"_s).arg(kb(payload));
+    text += QString(u"Данные с показателями: %1 (%2 Б/запись)\n"_s)
+                .arg(kb(records->payloadBytes())).arg(records->bytesPerRecord(), 0, 'f', 1);
+    text += QString(u"Выделено блоков: %1 (из них резерв незаполненных блоков %2)\n"_s)
+                .arg(kb(records->bytesUsed())).arg(kb(records->bytesUsed() - records->payloadBytes()));
+    text += QString(u"Пул свободных блоков: %1\n"_s).arg(kb(records->bytesPooled()));
+    if (records->metricColumns().count() > 0)
+        text += QString(u"Столбцы показателей (%1): %2\n"_s).arg(records->metricColumns().count()).arg(kb(records->metricColumns().bytesUsed()));
+    if (pagedModel)
+        text += QString(u"Постраничный файл: %1 страниц в кэше, %2\n"_s).arg(pagedModel->cachedPages()).arg(kb(pagedModel->residentBytes()));
+    text += QString(u"Реестр станций (%1): ~%2\n"_s).arg(stations->count()).arg(kb(stations->memoryUsage()));
+    text += QString(u"Кэш тепловой карты: %1 из %2 сеток\n"_s).arg(heatmapCache.count()).arg(heatmapCache.maxCost());
+    text += QString(u"Кэш результатов: %1 сводок, попаданий %2%"_s)
+                .arg(resultCache->entries()).arg(resultCache->hitRate() * 100.0, 0, 'f', 1);
+    text += QString(u"\nИстория правок: %1 версий, сверх текущего набора %2 (предел %3 версий, %4)"_s)
+                .arg(history->versions()).arg(kb(history->overheadBytes()))
+                .arg(DatasetHistory::kMaxVersions).arg(kb(DatasetHistory::kMaxOverheadBytes));
+
+    QMessageBox::information(this, u"Память"_s, text);
+}
+
+void MainWindow::showCacheReport()
+{
+    QString text;
+    text += QString(u"Версия данных: %1\n"_s).arg(records->dataVersion());
+    text += QString(u"Записей в кэше: %1\n"_s).arg(resultCache->entries());
+    text += QString(u"Попаданий: %1, промахов: %2\n"_s).arg(resultCache->hits()).arg(resultCache->misses());
+    text += QString(u"Доля попаданий: %1%"_s).arg(resultCache->hitRate() * 100.0, 0, 'f', 1);
+
+    QMessageBox box(QMessageBox::Information, u"Кэш результатов"_s, text, QMessageBox::Ok | QMessageBox::Reset, this);
+    box.button(QMessageBox::Reset)->setText(u"Сбросить кэш"_s);
+    if (box.exec() == QMessageBox::Reset) {
+        resultCache->clear();
+        statusBar()->showMessage(u"Кэш результатов сброшен"_s, 2000);
     }
 }
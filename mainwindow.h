@@ -10,6 +10,28 @@
 #include <QSpinBox>
 #include <QTableWidget>
 #include <QPlainTextEdit>
+#include <QCache>
+#include <QSet>
+#include <functional>
+#include <memory>
+#include "stationmap.h"
+#include "stationregistry.h"
+#include "periodcompare.h"
+#include "correlation.h"
+#include "tracing.h"
+#include "radiationmodel.h"
+#include "resultcache.h"
+#include "jsonpager.h"
+#include "forecast.h"
+#include "filterexpr.h"
+#include "histogram.h"
+#include "groupby.h"
+#include "resample.h"
+#include "dose.h"
+#include "session.h"
+#include "sqlstore.h"
+#include "shmpublish.h"
+#include "history.h"
 // ✅ добавлено
 
 QT_BEGIN_NAMESPACE
@@ -22,15 +44,26 @@ class QScatterSeries;
 class QValueAxis;
 class QComboBox;
 class QDateTimeEdit;
+class QDateEdit;
+class QListView;
 class QListWidget;
+class QLineEdit;
+class QSortFilterProxyModel;
 class QPushButton;
 class QGroupBox;
 class QFormLayout;
 class QAbstractSeries;
 class QLegendMarker;
+class QSlider;
+class QLabel;
+class QCheckBox;
+class QCloseEvent;
+class QGraphicsTextItem;
+class QGraphicsPathItem;
 QT_END_NAMESPACE
 
-struct Coord { double lat; double lon; };
+class PointCloudLayer;
+namespace Archive { class Reader; }
 
 class MainWindow : public QMainWindow
 {
@@ -39,6 +72,9 @@ public:
     explicit MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+protected:
+    void closeEvent(QCloseEvent *event) override;
+
 private slots:
     void addRecord();
     void saveToJson();
@@ -47,26 +83,144 @@ private slots:
     void analyzeData();
     void findMinMax();
     void computeTrend();
+    void computeSeasonal();
     void applySort();
+    void updateHeatmap();
+    void comparePeriods();
+    void computeCorrelation();
+    void exportTrace();
+    void showMemoryReport();
+    void showCacheReport();
+    void exportReports();
+    void applyFilter();
+    void exportSummary();
+    void undoEdit();
+    void redoEdit();
 
 private:
     void initializeCities();
+    void ensureTabBuilt(QWidget *tab);   // вкладка строится при первом обращении
+    void setupChartsTab();
     void setupCharts();
     void createRadiationChart();
+    void showChartTip(const QString &city, const QPointF &value, bool state);
+    void setupMapTab();
+    void rebuildMapIndex();
+    void invalidateHeatmap();
+    GeoBounds mapBounds() const;
+    void setupCompareTab();
+    void refreshComparePeriods();
+    void setupCorrelationTab();
+    void setupHistogramTab();
+    void setupSummaryTab();
+    void invalidateSummary();
+    void updateSummary();     // сводка по всем станциям одним проходом, если данные/фильтр менялись
+    void invalidateHistogram();
+    void updateHistogram();   // пересчёт счётчиков, если набор/фильтр/станции менялись
+    void drawHistogram();     // только корзины и график из готовых счётчиков
+    void showTraceSummary(const Trace::OperationSummary &summary);
+    void updateMemoryReadout();
+    void onDatasetChanged();
+    void setTableModel(QAbstractItemModel *model);
+    void loadFile(const QString &fileName);
+    // Период для частичной загрузки большого архива; false — загрузка отменена
+    bool askArchiveRange(const Archive::Reader &reader, const QString &fileName, qint64 *fromDay, qint64 *toDay);
+    void openLazy(const QString &fileName);
+    void showLazy(const QString &fileName, const JsonPageIndex &index);
+    void openDatabase(const QString &fileName);
+    bool sqlActive() const { return sqlModel && table->model() == sqlModel; }
+    bool pagedActive() const { return pagedModel && table->model() == pagedModel; }
+    // Сохранение постраничного файла или базы потоком, без загрузки записей в память
+    void saveExternal();
+    bool writeExternal(const QString &fileName, QString *error);
+    void setSharedPublishing(bool on);
+    void schedulePublish();   // публикация в общую память после текущего события, одна на серию изменений
+    void publishShared();
+    QVector<int> chartStations(int *totalSelected = nullptr) const;
+    bool chartGridOptions(ResampleOptions *out) const;   // false — график по исходным точкам
+    // Показания текущего представления с учётом фильтра: records, страницы файла или запрос к базе;
+    // stations — только эти станции (пусто — все)
+    void forEachViewReading(const QVector<int> &stations, const std::function<void(const PackedReading &)> &fn) const;
+    QVector<StationReading> collectReadings(const QVector<int> &stations = {}) const;
+    // Показания для фоновой задачи: снимок набора и выборка фильтра на момент вызова,
+    // сами StationReading собираются уже в рабочем потоке — правки в окне их не меняют
+    struct ReadingsSnapshot {
+        std::shared_ptr<const DatasetSnapshot> data;
+        QVector<quint32> rows;
+        bool filtered = false;
+        QVector<StationReading> readings() const;
+    };
+    ReadingsSnapshot readingsSnapshot() const;
+    void recordEdit(const QString &label);   // снимок набора перед правкой — для отмены
+    void updateEditActions();
+    ReadingStats statsFor(const QVector<int> &ids) const;   // с учётом фильтра
+    QAbstractItemModel *recordsView() const;                // records или отфильтрованная выборка
+    void updateFilterInfo();
+    void analyzeMetric(int cityId, const QString &city, int metric);
+    void refreshMetricLists();                 // списки показателей после смены схемы
+    QVector<int> checkedChartMetrics() const;
+    // файл и база не в records: их версия — счётчик смен набора и фильтра в окне
+    std::pair<quint64, quint64> readingsVersion() const
+    {
+        if (sqlActive() || pagedActive()) return {~0ull - 1, externalVersion};
+        return {records->dataVersion(), filterModel->generation()};
+    }
+    // фоновая подгонка прогнозов, если данные изменились: набор в памяти — все станции,
+    // файл и база — только станции графика, чтобы не читать все записи
+    void refreshForecasts();
+    bool forecastsCurrent() const;
+    void restoreSession();       // набор и состояние прошлого запуска
+    void saveSession();
+    void checkSessionSource();   // в фоне: не изменился ли исходный файл восстановленного набора
+    QVariantMap chartSettings() const;
+    void applyChartSettings(const QVariantMap &settings);
 
     QTabWidget *tabWidget = nullptr;
     QWidget *dataTab = nullptr;
     QWidget *chartsTab = nullptr;
+    QWidget *mapTab = nullptr;
+    QWidget *compareTab = nullptr;
+    QWidget *correlationTab = nullptr;
+    QWidget *histogramTab = nullptr;
+    QWidget *summaryTab = nullptr;
+    QHash<QWidget*, void (MainWindow::*)()> tabBuilders;   // ещё не построенные вкладки
     QChartView *radiationChartView = nullptr;
+    PointCloudLayer *pointCloud = nullptr;
+    QGraphicsTextItem *chartTipText = nullptr;
+    QGraphicsPathItem *chartTipBg = nullptr;
 
     QComboBox *cityComboBox = nullptr;
     QDateTimeEdit *dateTimeEdit = nullptr;
 
     QSpinBox *radiationSpin = nullptr;   // ✅ исправлено
 
-    QListWidget *cityOverlayList = nullptr;
+    QListView *cityOverlayList = nullptr;
+    QLineEdit *overlaySearchEdit = nullptr;
+    QSortFilterProxyModel *overlayProxy = nullptr;
     QComboBox *chartTypeCombo = nullptr;
-    QTableWidget *table = nullptr;
+    QTableView *table = nullptr;
+    RadiationModel *records = nullptr;
+    std::unique_ptr<ResultCache> resultCache;
+    std::unique_ptr<DoseIndex> doseIndex;
+    QDateEdit *doseFromEdit = nullptr;
+    QDateEdit *doseToEdit = nullptr;
+    FilterModel *filterModel = nullptr;
+    QLineEdit *filterEdit = nullptr;
+    QLabel *filterInfo = nullptr;
+    PagedJsonModel *pagedModel = nullptr;   // не nullptr, пока таблица показывает большой файл постранично
+    // база SQLite: таблица, фильтр, сортировка, сводки и добавление идут запросами, records пуст
+    std::unique_ptr<SqlStore> sqlStore;
+    SqlRecordsModel *sqlModel = nullptr;
+    QString sqlWhere;                       // фильтр в SQL
+    QString sqlFilterText;                  // его исходный текст
+    // публикация записей в общую память для соседних процессов
+    std::unique_ptr<ShmPublisher> shmPublisher;
+    bool shmFullPending = true;             // был сброс модели — область переписывается целиком
+    bool shmScheduled = false;
+    // отмена и повтор правок набора в памяти
+    std::unique_ptr<DatasetHistory> history;
+    QAction *undoAction = nullptr;
+    QAction *redoAction = nullptr;
     QPlainTextEdit *analysisText = nullptr;
 
     QPushButton *btnAdd = nullptr;
@@ -78,10 +232,82 @@ private:
     QPushButton *btnClearAllCities = nullptr;
     QPushButton *btnFindMinMax = nullptr;
     QPushButton *btnTrend = nullptr;
+    QComboBox *seasonalPeriodCombo = nullptr;
+    QPushButton *btnSeasonal = nullptr;
+    QComboBox *gridStepCombo = nullptr;
+    QComboBox *gridAggCombo = nullptr;
+    QComboBox *gridGapCombo = nullptr;
+    QSpinBox *gridMaxGapSpin = nullptr;
+    QCheckBox *doseCheck = nullptr;
+    QCheckBox *forecastCheck = nullptr;
+    QLabel *chartMetricLabel = nullptr;
+    QListWidget *chartMetricList = nullptr;
+    QComboBox *analysisMetricCombo = nullptr;
     QComboBox *sortCombo = nullptr;
     QPushButton *btnApplySort = nullptr;
 
-    int seqCounter = 0;
+    // Реестр станций и модели для выпадающего списка / списка наложения
+    StationRegistry *stations = nullptr;
+    StationListModel *cityModel = nullptr;
+    StationListModel *overlayModel = nullptr;
+
+    // Карта: индекс по дням и кэш сеток по периоду
+    HeatmapWidget *heatmapView = nullptr;
+    QSlider *mapDateSlider = nullptr;
+    QSpinBox *mapWindowSpin = nullptr;
+    QLabel *mapDateLabel = nullptr;
+    StationRangeIndex mapIndex;
+    bool mapIndexDirty = true;
+    QCache<quint64, HeatmapGrid> heatmapCache{64};
+
+    // Сравнение периодов
+    QComboBox *compareModeCombo = nullptr;
+    QListWidget *comparePeriodList = nullptr;
+    QPushButton *btnCompare = nullptr;
+    QChartView *compareChartView = nullptr;
+    QTableWidget *compareTable = nullptr;
+
+    // Корреляция станций
+    CorrelationHeatmap *correlationView = nullptr;
+    QSpinBox *correlationLagSpin = nullptr;
+    QPushButton *btnCorrelation = nullptr;
+    QLabel *correlationInfo = nullptr;
+
+    // Распределение показаний
+    QChartView *histogramChartView = nullptr;
+    QComboBox *histScopeCombo = nullptr;
+    QSlider *histBinSlider = nullptr;
+    QLabel *histBinLabel = nullptr;
+    QLabel *histBandsLabel = nullptr;
+    ValueCounts histCounts;
+    qint64 histCountUs = 0;
+    bool histogramDirty = true;
+
+    // Сводка по станциям
+    QTableWidget *summaryTable = nullptr;
+    QLabel *summaryInfo = nullptr;
+    QVector<StationSummary> summaryRows;
+    bool summaryDirty = true;
+
+    QLabel *perfLabel = nullptr;
+    QLabel *memLabel = nullptr;
+
+    // станции, чьи серии сейчас на графике (для MIN/MAX и тенденции)
+    QVector<int> chartedStations;
+
+    // прогнозы станций forecastIds для версии данных forecastVersion
+    QHash<int, Forecast> forecasts;
+    QSet<int> forecastIds;
+    std::pair<quint64, quint64> forecastVersion{~0ull, ~0ull};   // readingsVersion() на момент расчёта
+    quint64 externalVersion = 0;
+    bool forecastRunning = false;
+    bool exportRunning = false;   // экспорт отчётов идёт в фоне — второй не запускается
+
+    // кэш сеанса: источник набора и версия данных, уже записанная в файл набора
+    SourceStamp sessionSource;
+    quint64 sessionDatasetId = 0;
+    quint64 sessionSavedVersion = ~0ull;
+    QVariantMap pendingChartSettings;   // до первого открытия вкладки графиков
 };
 
 #endif
@@ -0,0 +1,126 @@
+#include "metrics.h"
+
+using namespace Qt::StringLiterals;
+
+namespace {
+
+// Сколько знаков после запятой нужно, чтобы после хранения во float значение не изменилось
+int decimalsOf(double v)
+{
+    if (!std::isfinite(v)) return 0;
+    double scale = 1.0;
+    for (int d = 0; d < MetricColumns::kMaxDecimals; ++d, scale *= 10.0)
+        if (float(std::round(v * scale) / scale) == float(v)) return d;
+    return MetricColumns::kMaxDecimals;
+}
+
+bool isWholeInt(double v)
+{
+    return v == std::floor(v) && v > double(MetricColumns::kMissingInt) && v <= double(std::numeric_limits<qint32>::max());
+}
+
+} // namespace
+
+MetricInfo MetricColumns::describe(const QString &key)
+{
+    struct Known { const char *key; QString title; QString unit; MetricType type; int decimals; };
+    static const Known known[] = {
+        { "temperature", u"Температура"_s, u"°C"_s, MetricType::Float32, 1 },
+        { "humidity", u"Влажность"_s, u"%"_s, MetricType::Int32, 0 },
+        { "pressure", u"Давление"_s, u"гПа"_s, MetricType::Float32, 1 },
+        { "dose", u"Доза"_s, u"мкЗв"_s, MetricType::Float32, 3 },
+        { "wind", u"Ветер"_s, u"м/с"_s, MetricType::Float32, 1 },
+        { "precipitation", u"Осадки"_s, u"мм"_s, MetricType::Float32, 1 },
+    };
+    for (const Known &k : known)
+        if (key == QLatin1StringView(k.key)) return { key, k.title, k.unit, k.type, k.decimals };
+    // неизвестный числовой ключ — дробный показатель без единиц
+    return { key, key, QString(), MetricType::Float32, 2 };
+}
+
+int MetricColumns::find(const QString &key) const
+{
+    for (int m = 0; m < count(); ++m)
+        if (columns[size_t(m)].info.key == key) return m;
+    return -1;
+}
+
+int MetricColumns::ensure(const QString &key)
+{
+    const int existing = find(key);
+    if (existing >= 0) return existing;
+    columns.emplace_back();
+    columns.back().info = describe(key);
+    return count() - 1;
+}
+
+void MetricColumns::set(int m, qsizetype row, double v)
+{
+    Column &c = columns[size_t(m)];
+    c.info.decimals = std::max(c.info.decimals, decimalsOf(v));
+    if (c.info.type == MetricType::Int32 && !isWholeInt(v)) {
+        // первое дробное значение: целые значения переезжают в столбец float
+        ColumnArena<float> floats;
+        floats.resize(c.ints.size(), std::numeric_limits<float>::quiet_NaN());
+        for (qsizetype i = 0; i < c.ints.size(); ++i) {
+            const qint32 x = std::as_const(c.ints)[i];
+            if (x != kMissingInt) floats[i] = float(x);
+        }
+        c.floats = std::move(floats);
+        c.ints.clear();
+        c.info.type = MetricType::Float32;
+    }
+    // пропущенные строки до row заполняются пропусками
+    if (c.info.type == MetricType::Int32) {
+        c.ints.resize(row + 1, kMissingInt);
+        c.ints[row] = qint32(v);
+    } else {
+        c.floats.resize(row + 1, std::numeric_limits<float>::quiet_NaN());
+        c.floats[row] = float(v);
+    }
+}
+
+QString MetricColumns::format(int m, double v) const
+{
+    const MetricInfo &i = info(m);
+    const QString number = QString::number(v, 'f', i.decimals);
+    return i.unit.isEmpty() ? number : number + u' ' + i.unit;
+}
+
+double MetricColumns::rounded(int m, double v) const
+{
+    const MetricInfo &i = info(m);
+    if (i.type == MetricType::Int32) return v;
+    const double scale = std::pow(10.0, i.decimals);
+    return std::round(v * scale) / scale;
+}
+
+void MetricColumns::permute(const std::vector<quint32> &order)
+{
+    const qsizetype n = qsizetype(order.size());
+    auto apply = [&](auto &column, auto missing) {
+        if (column.size() == 0) return;
+        column.resize(n, missing);
+        std::vector<decltype(missing)> old(size_t(n));
+        for (qsizetype i = 0; i < n; ++i) old[size_t(i)] = std::as_const(column)[i];
+        for (qsizetype i = 0; i < n; ++i) column[i] = old[order[size_t(i)]];
+    };
+    for (Column &c : columns) {
+        apply(c.floats, std::numeric_limits<float>::quiet_NaN());
+        apply(c.ints, kMissingInt);
+    }
+}
+
+qsizetype MetricColumns::payloadBytes() const
+{
+    qsizetype total = 0;
+    for (const Column &c : columns) total += c.floats.size() * qsizetype(sizeof(float)) + c.ints.size() * qsizetype(sizeof(qint32));
+    return total;
+}
+
+qsizetype MetricColumns::bytesUsed() const
+{
+    qsizetype total = 0;
+    for (const Column &c : columns) total += c.floats.allocatedBytes() + c.ints.allocatedBytes();
+    return total;
+}
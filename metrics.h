@@ -0,0 +1,144 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QString>
+#include <QVector>
+#include <memory>
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+// ============================
+// Столбец одного типа
+// ============================
+// Значения лежат блоками по kChunkSize, как записи в RecordArena: рост не копирует
+// старые данные. Столбец может быть короче таблицы — хвост считается пропуском.
+// Блоки общие между копиями столбца, запись в общий блок сначала копирует его.
+template <typename T>
+class ColumnArena
+{
+public:
+    static constexpr int kChunkShift = 16;
+    static constexpr qsizetype kChunkSize = qsizetype(1) << kChunkShift;
+    static constexpr qsizetype kChunkMask = kChunkSize - 1;
+
+    qsizetype size() const { return count; }
+
+    T operator[](qsizetype i) const { return chunks[size_t(i >> kChunkShift)][i & kChunkMask]; }
+    T &operator[](qsizetype i)
+    {
+        auto &c = chunks[size_t(i >> kChunkShift)];
+        if (c.use_count() != 1) {
+            std::shared_ptr<T[]> own(new T[kChunkSize]);
+            std::copy_n(c.get(), kChunkSize, own.get());
+            c = std::move(own);
+        }
+        return c[i & kChunkMask];
+    }
+
+    // Дорастить до n значений, новые — fill
+    void resize(qsizetype n, T fill)
+    {
+        while (qsizetype(chunks.size()) * kChunkSize < n) chunks.emplace_back(new T[kChunkSize]);
+        for (qsizetype i = count; i < n; ++i) (*this)[i] = fill;
+        count = std::max(count, n);
+    }
+
+    void clear()
+    {
+        chunks.clear();
+        count = 0;
+    }
+
+    qsizetype allocatedBytes() const { return qsizetype(chunks.size()) * kChunkSize * qsizetype(sizeof(T)); }
+
+    template <typename Fn>
+    void forEachChunk(Fn fn) const
+    {
+        for (const auto &c : chunks) fn(static_cast<const void *>(c.get()), kChunkSize * qsizetype(sizeof(T)));
+    }
+
+private:
+    std::vector<std::shared_ptr<T[]>> chunks;
+    qsizetype count = 0;
+};
+
+enum class MetricType { Float32, Int32 };
+
+struct MetricInfo {
+    QString key;        // ключ в JSON
+    QString title;      // подпись в таблице и на осях
+    QString unit;
+    MetricType type = MetricType::Float32;   // Int32 — пока все значения столбца целые
+    int decimals = 1;                        // не меньше, чем во входных значениях
+};
+
+// ============================
+// Дополнительные показатели записей
+// ============================
+// Радиация остаётся в упакованной записи; остальные показатели (температура,
+// влажность, давление, доза и любые числовые ключи JSON) хранятся каждый в своём
+// столбце, выровненном по номеру записи. Расчёт по одному показателю читает
+// только его столбец. Пропуск — NaN для Float32 и kMissingInt для Int32.
+// Целый столбец становится Float32 при первом дробном значении, а число знаков
+// растёт до нужного входным значениям: сохранение возвращает их в прежнем виде.
+class MetricColumns
+{
+public:
+    static constexpr qint32 kMissingInt = std::numeric_limits<qint32>::min();
+    static constexpr int kMaxDecimals = 6;   // float различает ~7 значащих цифр
+
+    int count() const { return int(columns.size()); }
+    const MetricInfo &info(int m) const { return columns[size_t(m)].info; }
+    int find(const QString &key) const;
+    // Индекс показателя; новый регистрируется с подписью и типом из справочника известных ключей
+    int ensure(const QString &key);
+
+    // false — в записи row значения нет
+    bool value(int m, qsizetype row, double *out) const
+    {
+        const Column &c = columns[size_t(m)];
+        if (c.info.type == MetricType::Int32) {
+            if (row >= c.ints.size() || c.ints[row] == kMissingInt) return false;
+            *out = c.ints[row];
+            return true;
+        }
+        if (row >= c.floats.size() || std::isnan(c.floats[row])) return false;
+        *out = c.floats[row];
+        return true;
+    }
+    void set(int m, qsizetype row, double v);
+
+    QString format(int m, double v) const;
+    // Значение для записи в файл: округлено до info.decimals, без хвоста двоичного float
+    double rounded(int m, double v) const;
+
+    // Переставить значения вслед за записями: новая строка i — прежняя order[i]
+    void permute(const std::vector<quint32> &order);
+    void clear() { columns.clear(); }
+
+    qsizetype bytesUsed() const;
+    qsizetype payloadBytes() const;   // только заполненные значения, без резерва блоков
+
+    template <typename Fn>
+    void forEachChunk(Fn fn) const
+    {
+        for (const Column &c : columns) {
+            c.floats.forEachChunk(fn);
+            c.ints.forEachChunk(fn);
+        }
+    }
+
+    static MetricInfo describe(const QString &key);
+
+private:
+    struct Column {
+        MetricInfo info;
+        ColumnArena<float> floats;
+        ColumnArena<qint32> ints;
+    };
+    std::vector<Column> columns;
+};
+
+#endif
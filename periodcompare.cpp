@@ -0,0 +1,107 @@
+#include "periodcompare.h"
+#include "tracing.h"
+#include <QHash>
+#include <QLocale>
+#include <QtConcurrent>
+#include <algorithm>
+#include <numeric>
+
+using namespace Qt::StringLiterals;
+
+int PeriodComparison::periodKey(PeriodMode mode, const QDate &d)
+{
+    return mode == PeriodMode::YearOverYear ? d.year() : d.year() * 12 + (d.month() - 1);
+}
+
+QString PeriodComparison::periodLabel(PeriodMode mode, int key)
+{
+    if (mode == PeriodMode::YearOverYear) return QString::number(key);
+    const int year = key / 12;
+    const int month = key % 12 + 1;
+    return QLocale().standaloneMonthName(month, QLocale::ShortFormat) + u" "_s + QString::number(year);
+}
+
+int PeriodComparison::alignedIndex(PeriodMode mode, const QDate &d)
+{
+    if (mode == PeriodMode::MonthOverMonth) return d.day();
+    // день года по (месяц, число) в високосном календаре: 1 марта — всегда 61-й день,
+    // 29 февраля — свой 60-й день, который в невисокосных годах просто пуст
+    return QDate(2000, d.month(), d.day()).dayOfYear();
+}
+
+QVector<int> PeriodSet::sorted() const
+{
+    QVector<int> out(keys.cbegin(), keys.cend());
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+QVector<CityComparison> PeriodComparison::compute(PeriodMode mode, const QVector<StationReading> &readings,
+                                                  const QVector<int> &stationIds, const QVector<int> &periodKeys)
+{
+    TRACE_SCOPE("period compare");
+    if (stationIds.isEmpty() || periodKeys.isEmpty()) return {};
+
+    QHash<int, int> slotOfStation;
+    for (int i = 0; i < stationIds.size(); ++i) slotOfStation.insert(stationIds[i], i);
+    QHash<int, int> slotOfPeriod;
+    for (int i = 0; i < periodKeys.size(); ++i) slotOfPeriod.insert(periodKeys[i], i);
+
+    // раскладка показаний по станциям (подсчёт + префиксные смещения), без копий строк
+    QVector<int> offsets(stationIds.size() + 1, 0);
+    for (const StationReading &r : readings) {
+        const auto it = slotOfStation.constFind(r.station);
+        if (it != slotOfStation.constEnd()) ++offsets[it.value() + 1];
+    }
+    for (int i = 0; i < stationIds.size(); ++i) offsets[i + 1] += offsets[i];
+
+    QVector<const StationReading*> bucketed(offsets.last());
+    QVector<int> fill = offsets;
+    for (const StationReading &r : readings) {
+        const auto it = slotOfStation.constFind(r.station);
+        if (it != slotOfStation.constEnd()) bucketed[fill[it.value()]++] = &r;
+    }
+
+    QVector<CityComparison> result(stationIds.size());
+    QVector<int> stationSlots(stationIds.size());
+    std::iota(stationSlots.begin(), stationSlots.end(), 0);
+    const int alignedLen = alignedLength(mode);
+
+    QtConcurrent::blockingMap(stationSlots, [&](int slot) {
+        CityComparison &cmp = result[slot];
+        cmp.station = stationIds[slot];
+        cmp.periods.resize(periodKeys.size());
+
+        // сумма и количество по (период, выровненный день) — одна плоская таблица
+        QVector<double> daySum(periodKeys.size() * alignedLen, 0.0);
+        QVector<int> dayCount(periodKeys.size() * alignedLen, 0);
+
+        for (int i = offsets[slot]; i < offsets[slot + 1]; ++i) {
+            const StationReading &r = *bucketed[i];
+            const QDate d = QDate::fromJulianDay(r.day);
+            const auto p = slotOfPeriod.constFind(periodKey(mode, d));
+            if (p == slotOfPeriod.constEnd()) continue;
+
+            PeriodAggregate &agg = cmp.periods[p.value()];
+            agg.count++;
+            agg.sum += r.rad;
+            agg.min = std::min(agg.min, r.rad);
+            agg.max = std::max(agg.max, r.rad);
+
+            const int cell = p.value() * alignedLen + alignedIndex(mode, d) - 1;
+            daySum[cell] += r.rad;
+            dayCount[cell]++;
+        }
+
+        cmp.curves.resize(periodKeys.size());
+        for (int p = 0; p < periodKeys.size(); ++p) {
+            QVector<QPointF> &curve = cmp.curves[p];
+            for (int k = 0; k < alignedLen; ++k) {
+                const int cell = p * alignedLen + k;
+                if (dayCount[cell]) curve.append(QPointF(k + 1, daySum[cell] / dayCount[cell]));
+            }
+        }
+    });
+
+    return result;
+}
@@ -0,0 +1,77 @@
+#ifndef PERIODCOMPARE_H
+#define PERIODCOMPARE_H
+
+#include <QVector>
+#include <QString>
+#include <QPointF>
+#include <QDate>
+#include <QSet>
+#include <climits>
+
+// Одно показание в компактном виде: id станции, юлианский день, мкР/ч
+struct StationReading {
+    int station;
+    qint64 day;
+    int rad;
+};
+
+enum class PeriodMode { YearOverYear, MonthOverMonth };
+
+struct PeriodAggregate {
+    int count = 0;
+    double sum = 0.0;
+    int min = INT_MAX;
+    int max = INT_MIN;
+
+    double mean() const { return count ? sum / count : 0.0; }
+};
+
+// Результат сравнения для одной станции: агрегаты и выровненные кривые по каждому периоду
+struct CityComparison {
+    int station = -1;
+    QVector<PeriodAggregate> periods;   // в порядке periodKeys
+    QVector<QVector<QPointF>> curves;   // (день года / день месяца, среднее за этот день)
+};
+
+// ============================
+// Сравнение периодов
+// ============================
+// Периоды выравниваются по общей оси: день года (год к году) или день месяца
+// (месяц к месяцу). День года берётся по месяцу и числу в високосном
+// календаре, чтобы даты после февраля совпадали в любых годах. Показания
+// один раз раскладываются по станциям, после чего каждая станция считается
+// за один проход независимо и параллельно.
+class PeriodComparison
+{
+public:
+    static int periodKey(PeriodMode mode, const QDate &d);
+    static QString periodLabel(PeriodMode mode, int key);
+    static int alignedIndex(PeriodMode mode, const QDate &d);
+    static int alignedLength(PeriodMode mode) { return mode == PeriodMode::YearOverYear ? 366 : 31; }
+
+    static QVector<CityComparison> compute(PeriodMode mode, const QVector<StationReading> &readings,
+                                           const QVector<int> &stationIds, const QVector<int> &periodKeys);
+};
+
+// Периоды, для которых есть хотя бы одно показание: дни подаются по одному из любого
+// обхода записей (в памяти, по страницам файла), копия показаний не нужна
+class PeriodSet
+{
+public:
+    explicit PeriodSet(PeriodMode mode) : mode(mode) {}
+
+    void add(qint64 day)
+    {
+        if (day == lastDay) return;   // показания обычно идут подряд по датам
+        lastDay = day;
+        keys.insert(PeriodComparison::periodKey(mode, QDate::fromJulianDay(day)));
+    }
+    QVector<int> sorted() const;
+
+private:
+    PeriodMode mode;
+    qint64 lastDay = LLONG_MIN;
+    QSet<int> keys;
+};
+
+#endif
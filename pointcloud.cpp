@@ -0,0 +1,348 @@
+#include "pointcloud.h"
+#include "tracing.h"
+#include <QChart>
+#include <QDateTimeAxis>
+#include <QValueAxis>
+#include <QPainter>
+#include <QGraphicsSceneHoverEvent>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+constexpr int kLevelsPerOctave = 64;   // масштабы внутри 1/64 октавы (~1%) рисуются одной плиткой
+constexpr int kMaxPendingTiles = 64;
+
+// Перекрытие отрезков по обеим осям; в отличие от QRectF::intersects годится и для вырожденных прямоугольников
+bool overlaps(const QRectF &a, const QRectF &b)
+{
+    return a.left() <= b.right() && b.left() <= a.right() && a.top() <= b.bottom() && b.top() <= a.bottom();
+}
+
+QImage markerSprite(const QColor &color)
+{
+    const int side = PointCloudLayer::kMarkerSize + 2;
+    QImage sprite(side, side, QImage::Format_ARGB32_Premultiplied);
+    sprite.fill(Qt::transparent);
+    QPainter p(&sprite);
+    p.setRenderHint(QPainter::Antialiasing);
+    p.setPen(QPen(color.darker(130), 1));
+    p.setBrush(color);
+    p.drawEllipse(QRectF(1, 1, PointCloudLayer::kMarkerSize, PointCloudLayer::kMarkerSize));
+    return sprite;
+}
+
+} // namespace
+
+// ============================
+// CloudData
+// ============================
+
+int CloudData::cellX(double v) const
+{
+    if (maxX <= minX) return 0;
+    return std::clamp(int((v - minX) / (maxX - minX) * gx), 0, gx - 1);
+}
+
+int CloudData::cellY(double v) const
+{
+    if (maxY <= minY) return 0;
+    return std::clamp(int((v - minY) / (maxY - minY) * gy), 0, gy - 1);
+}
+
+void CloudData::buildIndex()
+{
+    TRACE_SCOPE("point cloud index");
+    const qsizetype n = size();
+    if (n > 0) {
+        const auto [lo, hi] = std::minmax_element(x.cbegin(), x.cend());
+        minX = *lo;
+        maxX = *hi;
+        const auto [ylo, yhi] = std::minmax_element(y.cbegin(), y.cend());
+        minY = *ylo;
+        maxY = *yhi;
+    }
+    // в среднем ~8 точек на ячейку
+    gx = gy = std::clamp(int(std::sqrt(double(n) / 8.0)), 1, 1024);
+
+    cellStart.fill(0, gx * gy + 1);
+    QVector<quint32> cellOf(n);
+    for (qsizetype i = 0; i < n; ++i) {
+        cellOf[i] = quint32(cellY(y[i]) * gx + cellX(x[i]));
+        ++cellStart[cellOf[i] + 1];
+    }
+    for (int c = 0; c < gx * gy; ++c) cellStart[c + 1] += cellStart[c];
+
+    cellPoints.resize(n);
+    QVector<quint32> fill(cellStart.cbegin(), cellStart.cend() - 1);
+    for (qsizetype i = 0; i < n; ++i) cellPoints[fill[cellOf[i]]++] = quint32(i);
+}
+
+// ============================
+// PointCloudLayer
+// ============================
+
+PointCloudLayer::PointCloudLayer(QChart *chart)
+    : QGraphicsObject(chart), chart(chart)
+{
+    setZValue(8);   // над линиями, на уровне точечных серий
+    setAcceptHoverEvents(true);
+    setAcceptedMouseButtons(Qt::NoButton);   // выделение рамкой и прокрутка остаются за QChartView
+    connect(chart, &QChart::plotAreaChanged, this, &PointCloudLayer::onViewChanged);
+}
+
+PointCloudLayer::~PointCloudLayer() = default;
+
+void PointCloudLayer::setAxes(QDateTimeAxis *x, QValueAxis *y)
+{
+    if (axisX == x && axisY == y) return;
+    if (axisX) disconnect(axisX, nullptr, this, nullptr);
+    if (axisY) disconnect(axisY, nullptr, this, nullptr);
+    axisX = x;
+    axisY = y;
+    if (axisX) connect(axisX, &QDateTimeAxis::rangeChanged, this, &PointCloudLayer::onViewChanged);
+    if (axisY) connect(axisY, &QValueAxis::rangeChanged, this, &PointCloudLayer::onViewChanged);
+    onViewChanged();
+}
+
+void PointCloudLayer::setLayers(const QVector<Layer> &next)
+{
+    TRACE_SCOPE("point cloud");
+    auto cloud = std::make_shared<CloudData>();
+    qsizetype total = 0;
+    for (const Layer &l : next) total += l.points.size();
+    cloud->x.reserve(total);
+    cloud->y.reserve(total);
+    cloud->layer.reserve(total);
+    for (int k = 0; k < next.size(); ++k) {
+        cloud->names.append(next[k].name);
+        cloud->colors.append(next[k].color);
+        for (const QPointF &p : next[k].points) {
+            cloud->x.append(p.x());
+            cloud->y.append(float(p.y()));
+            cloud->layer.append(quint16(k));
+        }
+    }
+    cloud->buildIndex();
+
+    // начало координат плиток прежнее — из кэша уходят только плитки изменившихся слоёв
+    const bool sameOrigin = data && data->size() > 0 && cloud->size() > 0
+                            && data->minX == cloud->minX && data->maxY == cloud->maxY;
+    if (!sameOrigin) {
+        tiles.clear();
+    } else {
+        const auto bounds = [](const QVector<QPointF> &pts) {
+            if (pts.isEmpty()) return QRectF(0, 0, -1, -1);
+            double x0 = pts.first().x(), x1 = x0, y0 = pts.first().y(), y1 = y0;
+            for (const QPointF &p : pts) {
+                x0 = std::min(x0, p.x());
+                x1 = std::max(x1, p.x());
+                y0 = std::min(y0, p.y());
+                y1 = std::max(y1, p.y());
+            }
+            return QRectF(QPointF(x0, y0), QPointF(x1, y1));
+        };
+        QHash<QString, const Layer *> previous;
+        for (const Layer &l : std::as_const(layers)) previous.insert(l.name, &l);
+        QVector<QRectF> dirty;
+        for (const Layer &l : next) {
+            const Layer *old = previous.take(l.name);
+            if (old && old->color == l.color && old->points == l.points) continue;
+            dirty.append(bounds(l.points));
+            if (old) dirty.append(bounds(old->points));
+        }
+        for (const Layer *old : std::as_const(previous)) dirty.append(bounds(old->points));
+        for (const QRectF &r : std::as_const(dirty)) invalidate(r);
+    }
+
+    layers = next;
+    sprites.clear();
+    for (const Layer &l : next) sprites.append(markerSprite(l.color));
+    data = std::move(cloud);
+    originX = data->minX;
+    originY = data->maxY;
+    ++generation;   // плитки, которые ещё рисуются по прежним данным, будут отброшены
+    pending.clear();
+    hoveredPoint = -1;
+    update();
+}
+
+PointCloudLayer::View PointCloudLayer::currentView() const
+{
+    View v;
+    if (!axisX || !axisY) return v;
+    v.plot = chart->plotArea();
+    v.minX = double(axisX->min().toMSecsSinceEpoch());
+    v.maxX = double(axisX->max().toMSecsSinceEpoch());
+    v.minY = axisY->min();
+    v.maxY = axisY->max();
+    if (v.maxX > v.minX) v.sx = v.plot.width() / (v.maxX - v.minX);
+    if (v.maxY > v.minY) v.sy = v.plot.height() / (v.maxY - v.minY);
+    return v;
+}
+
+int PointCloudLayer::levelOf(double scale)
+{
+    return int(std::lround(std::log2(scale) * kLevelsPerOctave));
+}
+
+double PointCloudLayer::scaleOf(int level)
+{
+    return std::exp2(double(level) / kLevelsPerOctave);
+}
+
+QRectF PointCloudLayer::tileDataRect(const TileKey &key) const
+{
+    const double qx = scaleOf(key.levelX), qy = scaleOf(key.levelY);
+    const double margin = kMarkerSize / 2.0 + 1.0;
+    const double x0 = originX + (key.tx * kTileSize - margin) / qx;
+    const double x1 = originX + ((key.tx + 1) * kTileSize + margin) / qx;
+    const double yTop = originY - (key.ty * kTileSize - margin) / qy;
+    const double yBottom = originY - ((key.ty + 1) * kTileSize + margin) / qy;
+    return QRectF(QPointF(x0, yBottom), QPointF(x1, yTop));
+}
+
+void PointCloudLayer::invalidate(const QRectF &dataRect)
+{
+    if (dataRect.width() < 0 || dataRect.height() < 0) return;   // пустой слой
+    const QList<TileKey> keys = tiles.keys();
+    for (const TileKey &key : keys)
+        if (overlaps(tileDataRect(key), dataRect)) tiles.remove(key);
+}
+
+void PointCloudLayer::onViewChanged()
+{
+    prepareGeometryChange();
+    update();
+}
+
+QRectF PointCloudLayer::boundingRect() const
+{
+    return chart->plotArea();
+}
+
+void PointCloudLayer::paint(QPainter *painter, const QStyleOptionGraphicsItem *, QWidget *)
+{
+    const View v = currentView();
+    if (!data || data->size() == 0 || !v.valid()) return;
+
+    // плитки уровня, ближайшего к текущему масштабу, растягиваются до него (разница < 1%)
+    const TileKey level{levelOf(v.sx), levelOf(v.sy), 0, 0};
+    const double qx = scaleOf(level.levelX), qy = scaleOf(level.levelY);
+    const int tx0 = int(std::floor((v.minX - originX) * qx / kTileSize));
+    const int tx1 = int(std::floor((v.maxX - originX) * qx / kTileSize));
+    const int ty0 = int(std::floor((originY - v.maxY) * qy / kTileSize));
+    const int ty1 = int(std::floor((originY - v.minY) * qy / kTileSize));
+
+    painter->save();
+    painter->setClipRect(v.plot);
+    painter->setRenderHint(QPainter::SmoothPixmapTransform);
+    for (int ty = ty0; ty <= ty1; ++ty) {
+        for (int tx = tx0; tx <= tx1; ++tx) {
+            const TileKey key{level.levelX, level.levelY, tx, ty};
+            const QImage *tile = tiles.object(key);
+            if (!tile) {
+                requestTile(key);
+                continue;
+            }
+            const QRectF target(v.plot.left() + (tx * kTileSize / qx + originX - v.minX) * v.sx,
+                                v.plot.top() + (v.maxY - originY + ty * kTileSize / qy) * v.sy,
+                                kTileSize * v.sx / qx, kTileSize * v.sy / qy);
+            painter->drawImage(target, *tile);
+        }
+    }
+    painter->restore();
+}
+
+void PointCloudLayer::requestTile(const TileKey &key)
+{
+    if (pending.contains(key) || pending.size() >= kMaxPendingTiles) return;
+    pending.insert(key);
+
+    auto *watcher = new QFutureWatcher<QImage>(this);
+    const quint64 gen = generation;
+    connect(watcher, &QFutureWatcher<QImage>::finished, this, [this, watcher, key, gen]() {
+        watcher->deleteLater();
+        if (gen != generation) return;   // данные сменились, пока плитка рисовалась
+        pending.remove(key);
+        const QImage image = watcher->result();
+        tiles.insert(key, new QImage(image), int(image.sizeInBytes() / 1024));
+        update();   // заодно запрашиваются плитки, не поместившиеся в очередь
+    });
+    watcher->setFuture(QtConcurrent::run(&PointCloudLayer::renderTile, data, sprites, originX, originY, key));
+}
+
+QImage PointCloudLayer::renderTile(const std::shared_ptr<const CloudData> &data, const QVector<QImage> &sprites,
+                                   double originX, double originY, const TileKey &key)
+{
+    TRACE_SCOPE("point cloud tile");
+    QImage image(kTileSize, kTileSize, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+
+    const double qx = scaleOf(key.levelX), qy = scaleOf(key.levelY);
+    const double margin = kMarkerSize / 2.0 + 1.0;
+    const double x0 = originX + (key.tx * kTileSize - margin) / qx;
+    const double x1 = originX + ((key.tx + 1) * kTileSize + margin) / qx;
+    const double y0 = originY - ((key.ty + 1) * kTileSize + margin) / qy;
+    const double y1 = originY - (key.ty * kTileSize - margin) / qy;
+
+    std::vector<quint32> hits;
+    data->forEachCandidate(x0, x1, y0, y1, [&](quint32 i) {
+        if (data->x[i] >= x0 && data->x[i] <= x1 && data->y[i] >= y0 && data->y[i] <= y1) hits.push_back(i);
+    });
+    // порядок точек — порядок слоёв: поверх рисуется последний слой, как у серий на графике
+    std::sort(hits.begin(), hits.end());
+
+    // в плотном облаке точки слоя, попавшие в один пиксель, рисуются один раз
+    std::vector<int> stamped(size_t(kTileSize) * kTileSize, -1);
+    const int half = sprites.isEmpty() ? 0 : sprites.first().width() / 2;
+    QPainter p(&image);
+    for (quint32 i : hits) {
+        const int layer = data->layer[i];
+        // целые пиксели общей для уровня системы координат — маркеры на стыке плиток совпадают
+        const qint64 gx = qint64(std::floor((data->x[i] - originX) * qx)) - qint64(key.tx) * kTileSize;
+        const qint64 gy = qint64(std::floor((originY - data->y[i]) * qy)) - qint64(key.ty) * kTileSize;
+        if (gx >= 0 && gx < kTileSize && gy >= 0 && gy < kTileSize) {
+            int &owner = stamped[size_t(gy * kTileSize + gx)];
+            if (owner == layer) continue;
+            owner = layer;
+        }
+        p.drawImage(QPoint(int(gx) - half, int(gy) - half), sprites[layer]);
+    }
+    return image;
+}
+
+void PointCloudLayer::hoverMoveEvent(QGraphicsSceneHoverEvent *event)
+{
+    const View v = currentView();
+    const QPointF pos = event->pos();
+    qint64 best = -1;
+    if (data && v.valid() && v.plot.contains(pos)) {
+        const double x = v.minX + (pos.x() - v.plot.left()) / v.sx;
+        const double y = v.maxY - (pos.y() - v.plot.top()) / v.sy;
+        const double rx = kHoverRadius / v.sx, ry = kHoverRadius / v.sy;
+        double bestDist = double(kHoverRadius) * kHoverRadius;
+        data->forEachCandidate(x - rx, x + rx, y - ry, y + ry, [&](quint32 i) {
+            const double dx = (data->x[i] - x) * v.sx, dy = (data->y[i] - y) * v.sy;
+            const double d = dx * dx + dy * dy;
+            if (d <= bestDist) {
+                bestDist = d;
+                best = i;
+            }
+        });
+    }
+    if (best == hoveredPoint) return;
+    hoveredPoint = best;
+    if (best < 0) emit hovered(QString(), QPointF(), false);
+    else emit hovered(data->names[data->layer[best]], QPointF(data->x[best], data->y[best]), true);
+}
+
+void PointCloudLayer::hoverLeaveEvent(QGraphicsSceneHoverEvent *)
+{
+    if (hoveredPoint < 0) return;
+    hoveredPoint = -1;
+    emit hovered(QString(), QPointF(), false);
+}
@@ -0,0 +1,143 @@
+#ifndef POINTCLOUD_H
+#define POINTCLOUD_H
+
+#include <QGraphicsObject>
+#include <QCache>
+#include <QColor>
+#include <QImage>
+#include <QPointer>
+#include <QSet>
+#include <QVector>
+#include <memory>
+
+class QChart;
+class QDateTimeAxis;
+class QValueAxis;
+
+// ============================
+// Сетка точек облака
+// ============================
+// Точки всех слоёв в одном массиве, индекс — равномерная сетка по области данных
+// (CSR: начало ячейки + номера точек ячейки по возрастанию). Выборка прямоугольника —
+// только ячейки, которые он задевает. После сборки не меняется и читается из потоков.
+struct CloudData {
+    QVector<double> x;        // мс от эпохи
+    QVector<float> y;
+    QVector<quint16> layer;   // номер слоя; точки слоя идут подряд
+    QVector<QColor> colors;
+    QVector<QString> names;
+
+    double minX = 0, maxX = 0, minY = 0, maxY = 0;
+    int gx = 1, gy = 1;
+    QVector<quint32> cellStart;   // gx*gy + 1
+    QVector<quint32> cellPoints;
+
+    qsizetype size() const { return x.size(); }
+    void buildIndex();
+    // Номера точек из ячеек, задетых прямоугольником (точки могут лежать чуть за его границей)
+    template <typename Fn>
+    void forEachCandidate(double x0, double x1, double y0, double y1, Fn fn) const
+    {
+        if (x.isEmpty() || x1 < minX || x0 > maxX || y1 < minY || y0 > maxY) return;
+        const int cx0 = cellX(x0), cx1 = cellX(x1), cy0 = cellY(y0), cy1 = cellY(y1);
+        for (int cy = cy0; cy <= cy1; ++cy)
+            for (int cx = cx0; cx <= cx1; ++cx) {
+                const int c = cy * gx + cx;
+                for (quint32 k = cellStart[c]; k < cellStart[c + 1]; ++k) fn(cellPoints[k]);
+            }
+    }
+
+private:
+    int cellX(double v) const;
+    int cellY(double v) const;
+};
+
+// ============================
+// Растровый слой точек графика
+// ============================
+// Вместо QScatterSeries с отдельным элементом сцены на каждую точку слой рисует
+// облако плитками 256×256. Плитки привязаны к уровню масштаба (масштаб по осям,
+// округлённый до 1/64 октавы), так что при прокрутке и возврате к прежнему
+// масштабу берутся из кэша; недостающие рисуются в пуле потоков. При смене данных
+// из кэша удаляются только плитки, задетые изменившимися слоями. Наведение ищет
+// ближайшую точку по сетке CloudData, без проверки попадания в каждый элемент.
+class PointCloudLayer : public QGraphicsObject
+{
+    Q_OBJECT
+public:
+    struct Layer {
+        QString name;
+        QColor color;
+        QVector<QPointF> points;   // x — мс от эпохи, y — значение оси axisY
+    };
+
+    static constexpr int kTileSize = 256;
+    static constexpr int kMarkerSize = 8;
+    static constexpr int kHoverRadius = 6;   // пикселей
+
+    explicit PointCloudLayer(QChart *chart);
+    ~PointCloudLayer() override;
+
+    void setAxes(QDateTimeAxis *axisX, QValueAxis *axisY);
+    void setLayers(const QVector<Layer> &layers);
+    void clear() { setLayers({}); }
+    qsizetype pointCount() const { return data ? data->size() : 0; }
+
+    QRectF boundingRect() const override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
+signals:
+    // Точка под курсором: имя слоя и значение (x — мс); state=false — курсор ушёл с точек
+    void hovered(const QString &layer, const QPointF &value, bool state);
+
+protected:
+    void hoverMoveEvent(QGraphicsSceneHoverEvent *event) override;
+    void hoverLeaveEvent(QGraphicsSceneHoverEvent *event) override;
+
+private:
+    struct TileKey {
+        int levelX, levelY, tx, ty;
+        bool operator==(const TileKey &o) const
+        {
+            return levelX == o.levelX && levelY == o.levelY && tx == o.tx && ty == o.ty;
+        }
+    };
+    friend size_t qHash(const TileKey &k, size_t seed) noexcept
+    {
+        return qHashMulti(seed, k.levelX, k.levelY, k.tx, k.ty);
+    }
+
+    // Текущее отображение данных в пиксели области построения
+    struct View {
+        QRectF plot;
+        double minX = 0, maxX = 0, minY = 0, maxY = 0;
+        double sx = 0, sy = 0;   // пикселей на единицу по осям
+        bool valid() const { return sx > 0 && sy > 0 && plot.isValid(); }
+    };
+    View currentView() const;
+    static int levelOf(double scale);
+    static double scaleOf(int level);
+    QRectF tileDataRect(const TileKey &key) const;   // область данных плитки с полем под маркер
+
+    void requestTile(const TileKey &key);
+    static QImage renderTile(const std::shared_ptr<const CloudData> &data, const QVector<QImage> &sprites,
+                             double originX, double originY, const TileKey &key);
+    void invalidate(const QRectF &dataRect);
+    void onViewChanged();
+
+    QChart *chart;
+    QPointer<QDateTimeAxis> axisX;
+    QPointer<QValueAxis> axisY;
+
+    std::shared_ptr<const CloudData> data;
+    QVector<Layer> layers;          // для сравнения при следующем setLayers
+    QVector<QImage> sprites;        // маркер каждого слоя
+    double originX = 0, originY = 0;   // левый верхний угол области данных — начало координат плиток
+    quint64 generation = 0;
+
+    QCache<TileKey, QImage> tiles{64 * 1024};   // стоимость — КБ, 64 МБ
+    QSet<TileKey> pending;
+    qint64 hoveredPoint = -1;
+};
+
+#endif
@@ -0,0 +1,280 @@
+#include "radiationmodel.h"
+#include "stationregistry.h"
+#include <QDate>
+#include <QJsonArray>
+#include <QJsonObject>
+
+using namespace Qt::StringLiterals;
+
+// ============================
+// RecordArena
+// ============================
+
+RecordArena::Chunk RecordArena::takeChunk()
+{
+    if (pool.empty()) return Chunk(new PackedReading[kChunkSize]);
+    Chunk c = std::move(pool.back());
+    pool.pop_back();
+    return c;
+}
+
+void RecordArena::grow()
+{
+    chunks.push_back(takeChunk());
+}
+
+void RecordArena::detach(size_t c, bool keepContents)
+{
+    Chunk own = takeChunk();
+    if (keepContents) std::copy_n(chunks[c].get(), kChunkSize, own.get());
+    chunks[c] = std::move(own);
+}
+
+void RecordArena::detachAll(bool keepContents)
+{
+    for (size_t c = 0; c < chunks.size(); ++c)
+        if (chunks[c].use_count() != 1) detach(c, keepContents);
+}
+
+void RecordArena::append(const PackedReading &r)
+{
+    if ((count >> kChunkShift) >= qsizetype(chunks.size())) grow();
+    (*this)[count++] = r;   // хвостовой блок, общий со снимком, копируется один раз
+}
+
+void RecordArena::reserve(qsizetype n)
+{
+    while (qsizetype(chunks.size()) * kChunkSize < n) grow();
+}
+
+void RecordArena::clear()
+{
+    for (auto &chunk : chunks)
+        if (chunk.use_count() == 1) pool.push_back(std::move(chunk));
+    chunks.clear();
+    count = 0;
+}
+
+void RecordArena::permute(const std::vector<quint32> &order)
+{
+    const RecordArena &self = *this;
+    std::vector<PackedReading> old(self.begin(), self.end());
+    detachAll(false);   // все записи переписываются — общие блоки не копируются
+    for (qsizetype i = 0; i < count; ++i) (*this)[i] = old[order[size_t(i)]];
+}
+
+void RecordArena::releasePool()
+{
+    pool.clear();
+    pool.shrink_to_fit();
+}
+
+// ============================
+// RadiationModel
+// ============================
+
+RadiationModel::RadiationModel(StationRegistry *registry, QObject *parent)
+    : QAbstractTableModel(parent), registry(registry)
+{
+}
+
+int RadiationModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(records.size());
+}
+
+int RadiationModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : 3 + metrics.count();
+}
+
+QColor RadiationModel::bandColor(int rad)
+{
+    // Цвет по уровням, мкР/ч: <=15 зелёный, <=30 жёлтый, <=60 оранжевый, иначе красный
+    static const QColor colors[kBandCount] = { QColor("#d1fae5"), QColor("#fef3c7"), QColor("#ffedd5"), QColor("#fee2e2") };
+    return colors[band(rad)];
+}
+
+QVariant RadiationModel::cellData(const StationRegistry *registry, const PackedReading &r, int column, int role)
+{
+    switch (role) {
+    case Qt::DisplayRole:
+        switch (column) {
+        case 0: return registry->name(r.station);
+        case 1: return QDate::fromJulianDay(r.day).toString("yyyy-MM-dd");
+        case 2: return QString::number(r.rad) + u" мкР/ч"_s;
+        }
+        break;
+    case Qt::BackgroundRole:
+        return bandColor(r.rad);
+    case StationIdRole:
+        return int(r.station);
+    case DayRole:
+        return qint64(r.day);
+    case RadiationRole:
+        return int(r.rad);
+    default:
+        break;
+    }
+    return QVariant();
+}
+
+QVariant RadiationModel::headerText(int section, Qt::Orientation orientation, int role)
+{
+    if (role != Qt::DisplayRole) return QVariant();
+    if (orientation == Qt::Vertical) return section + 1;
+
+    switch (section) {
+    case 0: return u"🏙️ Город"_s;
+    case 1: return u"📅 Дата"_s;
+    case 2: return u"☢️ Ионизирующее излучение (мкР/ч)"_s;
+    }
+    return QVariant();
+}
+
+QVariant RadiationModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= records.size()) return QVariant();
+    const int m = index.column() - 3;
+    if (m < 0 || role == Qt::BackgroundRole) return cellData(registry, records[index.row()], index.column(), role);
+
+    double v = 0.0;
+    if (!metrics.value(m, index.row(), &v)) return QVariant();
+    if (role == Qt::DisplayRole) return metrics.format(m, v);
+    if (role == MetricRole) return v;
+    return QVariant();
+}
+
+QVariant RadiationModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    const int m = section - 3;
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole && m >= 0 && m < metrics.count()) {
+        const MetricInfo &info = metrics.info(m);
+        return info.unit.isEmpty() ? info.title : info.title + u", "_s + info.unit;
+    }
+    return headerText(section, orientation, role);
+}
+
+PackedReading RadiationModel::pack(int station, qint64 day, int rad)
+{
+    Q_ASSERT(isStorable(station, rad));
+    return PackedReading{ quint16(station), quint16(rad), qint32(day) };
+}
+
+void RadiationModel::touchStation(int station)
+{
+    if (station >= stationVersions.size()) stationVersions.resize(station + 1, 0);
+    stationVersions[station] = ++version;
+}
+
+bool RadiationModel::append(int station, qint64 day, int rad)
+{
+    if (!isStorable(station, rad)) return false;
+
+    const int row = int(records.size());
+    beginInsertRows(QModelIndex(), row, row);
+    records.append(pack(station, day, rad));
+    touchStation(station);
+    endInsertRows();
+    return true;
+}
+
+void RadiationModel::beginBulkLoad(bool replace, qsizetype expected)
+{
+    beginResetModel();
+    bulkLoading = true;
+    if (replace) {
+        records.clear();
+        metrics.clear();
+    }
+    if (expected > 0) records.reserve(records.size() + expected);
+}
+
+bool RadiationModel::bulkAppend(int station, qint64 day, int rad)
+{
+    Q_ASSERT(bulkLoading);
+    if (!isStorable(station, rad)) return false;   // значение не обрезается: запись отклоняется
+    records.append(pack(station, day, rad));
+    return true;
+}
+
+void RadiationModel::endBulkLoad()
+{
+    bulkLoading = false;
+    touchAll();
+    endResetModel();
+}
+
+bool RadiationModel::readJsonRow(const QJsonObject &obj, StationRegistry *registry, PackedReading *out)
+{
+    const QString city = obj.value("city"_L1).toString();
+    const QDate date = QDate::fromString(obj.value("datetime"_L1).toString(), "yyyy-MM-dd");
+    if (city.isEmpty() || !date.isValid()) return false;
+
+    const int stationId = registry->intern(city);
+    if (obj.contains("lat"_L1) && obj.contains("lon"_L1))
+        registry->setCoord(stationId, { obj.value("lat"_L1).toDouble(), obj.value("lon"_L1).toDouble() });
+    const int rad = obj.value("radiation"_L1).toInt();
+    if (!isStorable(stationId, rad)) return false;
+
+    *out = pack(stationId, date.toJulianDay(), rad);
+    return true;
+}
+
+bool RadiationModel::bulkAppendJson(const QJsonObject &obj)
+{
+    PackedReading r;
+    if (!readJsonRow(obj, registry, &r) || !bulkAppend(r.station, r.day, r.rad)) return false;
+
+    // все прочие числовые ключи — показатели этой записи
+    const qsizetype row = records.size() - 1;
+    for (auto it = obj.constBegin(); it != obj.constEnd(); ++it) {
+        if (!it.value().isDouble()) continue;
+        const QString key = it.key();
+        if (key == "radiation"_L1 || key == "lat"_L1 || key == "lon"_L1) continue;
+        metrics.set(metrics.ensure(key), row, it.value().toDouble());
+    }
+    return true;
+}
+
+int RadiationModel::loadJson(const QJsonArray &rows, bool replace)
+{
+    registry->beginUpdate();
+    beginBulkLoad(replace, rows.size());
+
+    int skipped = 0;
+    for (const QJsonValue &v : rows) {
+        if (!bulkAppendJson(v.toObject())) ++skipped;
+    }
+
+    endBulkLoad();
+    registry->endUpdate();
+    return skipped;
+}
+
+void RadiationModel::clear()
+{
+    beginResetModel();
+    records.clear();
+    metrics.clear();
+    touchAll();
+    endResetModel();
+}
+
+std::shared_ptr<const DatasetSnapshot> RadiationModel::snapshot() const
+{
+    auto snap = std::make_shared<DatasetSnapshot>();
+    snap->records = records;
+    snap->metrics = metrics;
+    snap->version = version;
+    return snap;
+}
+
+void RadiationModel::restore(const DatasetSnapshot &snap)
+{
+    beginResetModel();
+    records = snap.records;
+    metrics = snap.metrics;
+    touchAll();   // новая версия: кэши сводок и доз пересчитываются по восстановленному набору
+    endResetModel();
+}
@@ -0,0 +1,294 @@
+#ifndef RADIATIONMODEL_H
+#define RADIATIONMODEL_H
+
+#include <QAbstractTableModel>
+#include <QColor>
+#include <QVector>
+#include <memory>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <type_traits>
+#include <numeric>
+#include "metrics.h"
+#include "stationregistry.h"
+
+class QJsonArray;
+class QJsonObject;
+
+// Одно показание — 8 байт: id станции, мкР/ч, юлианский день
+struct PackedReading {
+    quint16 station;
+    quint16 rad;
+    qint32 day;
+};
+static_assert(sizeof(PackedReading) == 8, "PackedReading must stay 8 bytes");
+
+// ============================
+// Арена записей
+// ============================
+// Записи лежат в блоках по kChunkSize штук: рост не копирует уже загруженные
+// данные, а освобождённые блоки остаются в пуле и переиспользуются следующей загрузкой.
+//
+// Блоки общие между копиями арены (копирование при записи): копия — это вектор
+// указателей, O(число блоков). Запись в общий блок сначала копирует только его,
+// поэтому снимки для отмены и фоновых задач не видят последующих правок.
+class RecordArena
+{
+public:
+    static constexpr int kChunkShift = 16;
+    static constexpr qsizetype kChunkSize = qsizetype(1) << kChunkShift;   // 65536 записей, 512 КБ
+    static constexpr qsizetype kChunkMask = kChunkSize - 1;
+
+    template <typename Arena, typename Ref>
+    class Iterator
+    {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = PackedReading;
+        using difference_type = qsizetype;
+        using pointer = std::remove_reference_t<Ref> *;
+        using reference = Ref;
+
+        Iterator() = default;
+        Iterator(Arena *arena, qsizetype i) : arena(arena), i(i) {}
+
+        reference operator*() const { return (*arena)[i]; }
+        pointer operator->() const { return &(*arena)[i]; }
+        reference operator[](difference_type n) const { return (*arena)[i + n]; }
+
+        Iterator &operator++() { ++i; return *this; }
+        Iterator operator++(int) { Iterator t = *this; ++i; return t; }
+        Iterator &operator--() { --i; return *this; }
+        Iterator operator--(int) { Iterator t = *this; --i; return t; }
+        Iterator &operator+=(difference_type n) { i += n; return *this; }
+        Iterator &operator-=(difference_type n) { i -= n; return *this; }
+        Iterator operator+(difference_type n) const { return Iterator(arena, i + n); }
+        Iterator operator-(difference_type n) const { return Iterator(arena, i - n); }
+        friend Iterator operator+(difference_type n, const Iterator &it) { return it + n; }
+        difference_type operator-(const Iterator &o) const { return i - o.i; }
+
+        bool operator==(const Iterator &o) const { return i == o.i; }
+        bool operator!=(const Iterator &o) const { return i != o.i; }
+        bool operator<(const Iterator &o) const { return i < o.i; }
+        bool operator>(const Iterator &o) const { return i > o.i; }
+        bool operator<=(const Iterator &o) const { return i <= o.i; }
+        bool operator>=(const Iterator &o) const { return i >= o.i; }
+
+    private:
+        Arena *arena = nullptr;
+        qsizetype i = 0;
+    };
+    using iterator = Iterator<RecordArena, PackedReading &>;
+    using const_iterator = Iterator<const RecordArena, const PackedReading &>;
+
+    RecordArena() = default;
+    // Копия делит блоки с оригиналом; пул остаётся своим у каждой арены
+    RecordArena(const RecordArena &o) : chunks(o.chunks), count(o.count) {}
+    RecordArena &operator=(const RecordArena &o)
+    {
+        chunks = o.chunks;
+        count = o.count;
+        return *this;
+    }
+    RecordArena(RecordArena &&) = default;
+    RecordArena &operator=(RecordArena &&) = default;
+
+    qsizetype size() const { return count; }
+    bool isEmpty() const { return count == 0; }
+
+    // Запись через неконстантный доступ отделяет общий блок; перед проходом по всем
+    // записям (сортировка) — detachAll(), чтобы ссылки не вели в старые блоки
+    PackedReading &operator[](qsizetype i)
+    {
+        const size_t c = size_t(i >> kChunkShift);
+        if (chunks[c].use_count() != 1) detach(c, true);
+        return chunks[c][i & kChunkMask];
+    }
+    const PackedReading &operator[](qsizetype i) const { return chunks[size_t(i >> kChunkShift)][i & kChunkMask]; }
+
+    void append(const PackedReading &r);
+    void reserve(qsizetype n);
+    void clear();          // свои блоки уходят в пул, общие остаются у других копий
+    void permute(const std::vector<quint32> &order);   // новая запись i — прежняя order[i]
+    void releasePool();    // вернуть пул системе
+    void detachAll(bool keepContents = true);
+
+    // fn(адрес блока, байт) — для учёта памяти, общей между версиями
+    template <typename Fn>
+    void forEachChunk(Fn fn) const
+    {
+        for (const auto &c : chunks) fn(static_cast<const void *>(c.get()), kChunkSize * qsizetype(sizeof(PackedReading)));
+    }
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, count); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, count); }
+
+    qsizetype allocatedBytes() const { return qsizetype(chunks.size()) * kChunkSize * qsizetype(sizeof(PackedReading)); }
+    qsizetype pooledBytes() const { return qsizetype(pool.size()) * kChunkSize * qsizetype(sizeof(PackedReading)); }
+
+private:
+    using Chunk = std::shared_ptr<PackedReading[]>;
+
+    void grow();
+    Chunk takeChunk();
+    void detach(size_t c, bool keepContents);
+
+    std::vector<Chunk> chunks;
+    std::vector<Chunk> pool;
+    qsizetype count = 0;
+};
+
+// ============================
+// Снимок набора
+// ============================
+// Неизменяемая версия записей и показателей. Блоки общие с моделью, поэтому снимок
+// стоит O(число блоков), а память растёт только на блоки, изменённые после него.
+// Читается из любого потока, пока модель продолжает меняться.
+struct DatasetSnapshot {
+    RecordArena records;
+    MetricColumns metrics;
+    quint64 version = 0;   // dataVersion модели на момент снимка
+
+    qsizetype size() const { return records.size(); }
+    const PackedReading &at(qsizetype row) const { return records[row]; }
+
+    // fn(адрес блока, байт) по записям и столбцам показателей
+    template <typename Fn>
+    void forEachChunk(Fn fn) const
+    {
+        records.forEachChunk(fn);
+        metrics.forEachChunk(fn);
+    }
+};
+
+// ============================
+// Модель таблицы измерений
+// ============================
+// Текст, цвет и id ячеек вычисляются при отображении из упакованной записи —
+// в памяти нет ни QTableWidgetItem, ни строк на каждое показание. За тремя
+// основными столбцами идут дополнительные показатели из MetricColumns.
+class RadiationModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    enum Roles { DayRole = StationIdRole + 1, RadiationRole, MetricRole };
+
+    static constexpr int kMaxStations = 65536;   // id хранится в 16 битах
+    static constexpr int kMaxRadiation = 65535;  // значение хранится в 16 битах
+
+    explicit RadiationModel(StationRegistry *registry, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    qsizetype size() const { return records.size(); }
+    const PackedReading &at(qsizetype row) const { return records[row]; }
+    const RecordArena &arena() const { return records; }
+
+    // Запись помещается в упаковку: станция и радиация — 16 бит без знака
+    static bool isStorable(int station, int rad)
+    {
+        return station >= 0 && station < kMaxStations && rad >= 0 && rad <= kMaxRadiation;
+    }
+
+    // Одна запись с уведомлением представлений; false — станция или радиация вне 16-битного диапазона
+    bool append(int station, qint64 day, int rad);
+
+    // Массовая загрузка: представления получают один сброс модели в endBulkLoad()
+    void beginBulkLoad(bool replace, qsizetype expected = 0);
+    bool bulkAppend(int station, qint64 day, int rad);
+    void endBulkLoad();
+    // Показатель key и его значение в записи row внутри beginBulkLoad/endBulkLoad (кэш сеанса)
+    int bulkMetric(const QString &key) { return metrics.ensure(key); }
+    void bulkSetMetric(int m, qsizetype row, double v) { metrics.set(m, row, v); }
+
+    // Разбор массива в формате saveToJson (city, datetime, radiation, lat/lon и числовые
+    // показатели): станции регистрируются в реестре, возвращается число пропущенных записей
+    int loadJson(const QJsonArray &rows, bool replace);
+    // Одна запись JSON внутри beginBulkLoad/endBulkLoad, вместе с показателями
+    bool bulkAppendJson(const QJsonObject &obj);
+    // Одна запись того же формата; false — нет города/даты, станция или радиация вне диапазона
+    static bool readJsonRow(const QJsonObject &obj, StationRegistry *registry, PackedReading *out);
+
+    template <typename Less>
+    void sortRecords(Less less)
+    {
+        beginResetModel();
+        if (metrics.count() == 0) {
+            records.detachAll();   // блоки снимков остаются в прежнем порядке
+            std::sort(records.begin(), records.end(), less);
+        } else {
+            // столбцы показателей переставляются вслед за записями
+            std::vector<quint32> order(size_t(records.size()));
+            std::iota(order.begin(), order.end(), 0u);
+            std::sort(order.begin(), order.end(), [&](quint32 a, quint32 b) { return less(std::as_const(records)[a], std::as_const(records)[b]); });
+            records.permute(order);
+            metrics.permute(order);
+        }
+        ++version;   // меняется только порядок: версии станций остаются прежними
+        endResetModel();
+    }
+
+    void clear();
+
+    // Снимок текущего набора (для отмены и фоновых задач) и возврат к нему — один сброс модели
+    std::shared_ptr<const DatasetSnapshot> snapshot() const;
+    void restore(const DatasetSnapshot &snap);
+
+    const MetricColumns &metricColumns() const { return metrics; }
+    // Значение показателя m в записи row; false — пропуск
+    bool metric(int m, qsizetype row, double *out) const { return metrics.value(m, row, out); }
+
+    // Версии данных: общая растёт при любом изменении (включая сортировку),
+    // версия станции — только когда меняется её набор показаний
+    quint64 dataVersion() const { return version; }
+    quint64 stationVersion(int station) const
+    {
+        const quint64 own = (station >= 0 && station < stationVersions.size()) ? stationVersions[station] : 0;
+        return std::max(resetVersion, own);
+    }
+    quint64 lastResetVersion() const { return resetVersion; }   // версия последнего сброса всех станций
+
+    // Учёт памяти: payload — сами записи и значения показателей, bytesUsed — все выделенные блоки
+    qsizetype payloadBytes() const { return records.size() * qsizetype(sizeof(PackedReading)) + metrics.payloadBytes(); }
+    qsizetype bytesUsed() const { return records.allocatedBytes() + metrics.bytesUsed(); }
+    qsizetype bytesPooled() const { return records.pooledBytes(); }
+    // sizeof(PackedReading) плюс показатели записи; незаполненный резерв блоков сюда не входит
+    double bytesPerRecord() const { return records.isEmpty() ? 0.0 : double(payloadBytes()) / records.size(); }
+
+    // Уровни радиации, мкР/ч: полоса k — значения не выше kBandLimits[k], последняя — выше 60
+    static constexpr int kBandLimits[] = {15, 30, 60};
+    static constexpr int kBandCount = 4;
+    static int band(int rad)
+    {
+        int k = 0;
+        while (k < kBandCount - 1 && rad > kBandLimits[k]) ++k;
+        return k;
+    }
+    static QColor bandColor(int rad);
+
+    // Общая отрисовка ячейки и заголовков — также для постраничной модели больших файлов
+    static QVariant cellData(const StationRegistry *registry, const PackedReading &r, int column, int role);
+    static QVariant headerText(int section, Qt::Orientation orientation, int role);
+
+private:
+    static PackedReading pack(int station, qint64 day, int rad);   // только для isStorable
+    void touchStation(int station);
+    void touchAll() { resetVersion = ++version; }
+
+    StationRegistry *registry;
+    RecordArena records;
+    MetricColumns metrics;
+    bool bulkLoading = false;
+
+    quint64 version = 0;
+    quint64 resetVersion = 0;          // все станции изменились не раньше этой версии
+    QVector<quint64> stationVersions;
+};
+
+#endif
@@ -0,0 +1,318 @@
+#include "report.h"
+#include "stationregistry.h"
+#include "tracing.h"
+#include <QDir>
+#include <QHash>
+#include <QImage>
+#include <QPainter>
+#include <QPainterPath>
+#include <QPdfWriter>
+#include <QPageSize>
+#include <QSvgGenerator>
+#include <QDate>
+#include <QLocale>
+#include <QRegularExpression>
+#include <QtConcurrent>
+#include <QMutex>
+#include <QFontMetricsF>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+using namespace Qt::StringLiterals;
+
+namespace {
+
+const QColor kLineColor("#2563eb");
+const QColor kGridColor("#e5e7eb");
+const QColor kTextColor("#1f2937");
+constexpr double kStatsWidth = 280.0;
+
+// «Круглый» шаг делений оси: 1, 2 или 5 × 10^k
+double niceStep(double span, int ticks)
+{
+    const double raw = span / std::max(1, ticks);
+    const double mag = std::pow(10.0, std::floor(std::log10(raw)));
+    const double norm = raw / mag;
+    return (norm <= 1.0 ? 1.0 : norm <= 2.0 ? 2.0 : norm <= 5.0 ? 5.0 : 10.0) * mag;
+}
+
+QStringList statsLines(const StationReportData &d)
+{
+    const ReadingStats &st = d.stats;
+    QStringList lines;
+    lines << u"Город: %1"_s.arg(d.name)
+          << u"Количество записей: %1"_s.arg(st.count)
+          << QString()
+          << u"Ионизирующее излучение (мкР/ч):"_s
+          << u"  • Среднее: %1"_s.arg(st.mean(), 0, 'f', 2)
+          << u"  • Минимальное: %1"_s.arg(st.min)
+          << u"  • Максимальное: %1"_s.arg(st.max)
+          << u"  • Стандартное отклонение: %1"_s.arg(st.stddev(), 0, 'f', 2);
+    double slope = 0.0, intercept = 0.0;
+    if (st.trend(&slope, &intercept))
+        lines << u"  • Тенденция: %1 за год"_s.arg(slope * 365.25, 0, 'f', 2);
+    return lines;
+}
+
+} // namespace
+
+bool ReportOptions::parseFormat(const QString &name, Format *out)
+{
+    const QString n = name.trimmed().toLower();
+    if (n == "png"_L1) *out = Png;
+    else if (n == "svg"_L1) *out = Svg;
+    else if (n == "pdf"_L1) *out = Pdf;
+    else return false;
+    return true;
+}
+
+QString ReportOptions::suffix() const
+{
+    switch (format) {
+    case Svg: return u"svg"_s;
+    case Pdf: return u"pdf"_s;
+    case Png: break;
+    }
+    return u"png"_s;
+}
+
+QString ReportRenderer::fileNameFor(const StationReportData &data, const ReportOptions &options)
+{
+    static const QRegularExpression unsafe(u"[^\\w\\-]+"_s, QRegularExpression::UseUnicodePropertiesOption);
+    QString base = data.name;
+    base.replace(unsafe, u"_"_s);
+    if (base.isEmpty()) base = u"station"_s;
+    return QDir(options.outDir).filePath(u"%1_%2.%3"_s.arg(base).arg(data.station).arg(options.suffix()));
+}
+
+void ReportRenderer::paint(QPainter &p, const QRectF &rect, const StationReportData &d, bool withStats)
+{
+    p.save();
+    p.setRenderHint(QPainter::Antialiasing);
+    p.fillRect(rect, Qt::white);
+
+    QFont font = p.font();
+    font.setPixelSize(13);
+    p.setFont(font);
+    const QFontMetricsF fm(font);
+
+    const double first = d.points.isEmpty() ? 0.0 : d.points.first().x();
+    const double last = d.points.isEmpty() ? 1.0 : d.points.last().x();
+
+    // ===== заголовок =====
+    QFont titleFont = font;
+    titleFont.setPixelSize(18);
+    titleFont.setBold(true);
+    p.setFont(titleFont);
+    p.setPen(kTextColor);
+    const QString title = u"Ионизирующее излучение — %1, %2 — %3"_s
+                              .arg(d.name,
+                                   QDate::fromJulianDay(qint64(first)).toString(u"dd.MM.yyyy"_s),
+                                   QDate::fromJulianDay(qint64(last)).toString(u"dd.MM.yyyy"_s));
+    p.drawText(QRectF(rect.left() + 16, rect.top() + 8, rect.width() - 32, 36), Qt::AlignLeft | Qt::AlignVCenter, title);
+    p.setFont(font);
+
+    QRectF plot = rect.adjusted(70, 56, -24, -64);
+    if (withStats) plot.setRight(plot.right() - kStatsWidth);
+
+    // ===== сводка =====
+    if (withStats) {
+        const QRectF box(plot.right() + 24, plot.top(), kStatsWidth - 24, plot.height());
+        p.setPen(QPen(kGridColor, 1));
+        p.setBrush(QColor("#f8fafc"));
+        p.drawRoundedRect(box, 8, 8);
+        p.setPen(kTextColor);
+        double y = box.top() + 12;
+        for (const QString &line : statsLines(d)) {
+            p.drawText(QRectF(box.left() + 12, y, box.width() - 24, fm.height()), Qt::AlignLeft | Qt::AlignVCenter, line);
+            y += fm.height() * 1.4;
+        }
+    }
+
+    if (d.points.isEmpty()) {
+        p.drawText(plot, Qt::AlignCenter, u"Нет данных"_s);
+        p.restore();
+        return;
+    }
+
+    // ===== оси: те же поля, что у графика на вкладке =====
+    double minY = d.stats.min, maxY = d.stats.max;
+    double pad = (maxY - minY) * 0.15;
+    if (pad <= 0) pad = 1.0;
+    minY = std::max(0.0, minY - pad);
+    maxY += pad;
+    const double spanX = std::max(1.0, last - first);
+    auto toX = [&](double day) { return plot.left() + (day - first) / spanX * plot.width(); };
+    auto toY = [&](double v) { return plot.bottom() - (v - minY) / (maxY - minY) * plot.height(); };
+
+    const double stepY = niceStep(maxY - minY, 6);
+    for (double v = std::ceil(minY / stepY) * stepY; v <= maxY; v += stepY) {
+        const double y = toY(v);
+        p.setPen(QPen(kGridColor, 1));
+        p.drawLine(QPointF(plot.left(), y), QPointF(plot.right(), y));
+        p.setPen(kTextColor);
+        p.drawText(QRectF(rect.left(), y - 10, plot.left() - rect.left() - 8, 20), Qt::AlignRight | Qt::AlignVCenter,
+                   QString::number(v, 'f', 0));
+    }
+
+    // подписи месяцев: шаг подбирается, чтобы их было не больше восьми
+    const QDate d0 = QDate::fromJulianDay(qint64(first));
+    const QDate d1 = QDate::fromJulianDay(qint64(last));
+    const int months = (d1.year() - d0.year()) * 12 + d1.month() - d0.month() + 1;
+    const int stepMonths = std::max(1, (months + 7) / 8);
+    const QLocale locale;
+    for (QDate m(d0.year(), d0.month(), 1); m <= d1; m = m.addMonths(stepMonths)) {
+        const double x = toX(double(m.toJulianDay()));
+        if (x < plot.left()) continue;
+        p.setPen(QPen(kGridColor, 1));
+        p.drawLine(QPointF(x, plot.top()), QPointF(x, plot.bottom()));
+        p.setPen(kTextColor);
+        p.drawText(QRectF(x - 50, plot.bottom() + 6, 100, 20), Qt::AlignHCenter | Qt::AlignTop,
+                   locale.toString(m, u"MMM yyyy"_s));
+    }
+    p.setPen(QPen(kTextColor, 1));
+    p.drawRect(plot);
+    p.drawText(QRectF(plot.left(), plot.bottom() + 30, plot.width(), 20), Qt::AlignHCenter, u"Дата"_s);
+    p.save();
+    p.translate(rect.left() + 16, plot.center().y());
+    p.rotate(-90);
+    p.drawText(QRectF(-60, -10, 120, 20), Qt::AlignCenter, u"мкР/ч"_s);
+    p.restore();
+
+    // ===== линия: по столбцу пикселей — первая, min, max и последняя точка =====
+    QPainterPath path;
+    const int columns = std::max(1, int(plot.width()));
+    int i = 0;
+    bool started = false;
+    while (i < d.points.size()) {
+        const int col = std::min(columns - 1, int((d.points[i].x() - first) / spanX * columns));
+        const QPointF &head = d.points[i];
+        QPointF lo = head, hi = head, tail = head;
+        for (; i < d.points.size(); ++i) {
+            const QPointF &pt = d.points[i];
+            if (std::min(columns - 1, int((pt.x() - first) / spanX * columns)) != col) break;
+            if (pt.y() < lo.y()) lo = pt;
+            if (pt.y() > hi.y()) hi = pt;
+            tail = pt;
+        }
+        const QPointF mapped(toX(head.x()), toY(head.y()));
+        if (!started) { path.moveTo(mapped); started = true; }
+        else path.lineTo(mapped);
+        const QPointF &a = lo.x() <= hi.x() ? lo : hi;
+        const QPointF &b = lo.x() <= hi.x() ? hi : lo;
+        path.lineTo(toX(a.x()), toY(a.y()));
+        path.lineTo(toX(b.x()), toY(b.y()));
+        path.lineTo(toX(tail.x()), toY(tail.y()));
+    }
+    QPen linePen(kLineColor);
+    linePen.setWidthF(2.0);
+    p.setClipRect(plot);
+    p.setPen(linePen);
+    p.setBrush(Qt::NoBrush);
+    p.drawPath(path);
+
+    p.restore();
+}
+
+bool ReportRenderer::renderStation(const StationReportData &data, const ReportOptions &options, QString *error)
+{
+    TRACE_SCOPE("report station");
+    const QString fileName = fileNameFor(data, options);
+    const QRectF rect(QPointF(0, 0), QSizeF(options.size));
+
+    switch (options.format) {
+    case ReportOptions::Png: {
+        QImage image(options.size, QImage::Format_ARGB32_Premultiplied);
+        {
+            QPainter p(&image);
+            paint(p, rect, data, options.withStats);
+        }
+        if (!image.save(fileName, "PNG")) {
+            if (error) *error = u"%1: не удалось записать файл"_s.arg(fileName);
+            return false;
+        }
+        return true;
+    }
+    case ReportOptions::Svg: {
+        QSvgGenerator svg;
+        svg.setFileName(fileName);
+        svg.setSize(options.size);
+        svg.setViewBox(rect);
+        svg.setTitle(data.name);
+        QPainter p;
+        if (!p.begin(&svg)) {
+            if (error) *error = u"%1: не удалось записать файл"_s.arg(fileName);
+            return false;
+        }
+        paint(p, rect, data, options.withStats);
+        return p.end();
+    }
+    case ReportOptions::Pdf: {
+        QPdfWriter pdf(fileName);
+        pdf.setResolution(96);
+        pdf.setPageSize(QPageSize(QSizeF(options.size) * 72.0 / 96.0, QPageSize::Point));
+        pdf.setPageMargins(QMarginsF());
+        pdf.setTitle(data.name);
+        QPainter p;
+        if (!p.begin(&pdf)) {
+            if (error) *error = u"%1: не удалось записать файл"_s.arg(fileName);
+            return false;
+        }
+        paint(p, rect, data, options.withStats);
+        return p.end();
+    }
+    }
+    return false;
+}
+
+QStringList ReportRenderer::stationNames(const StationRegistry &registry)
+{
+    QStringList names;
+    names.reserve(registry.count());
+    for (int id = 0; id < registry.count(); ++id) names.append(registry.name(id));
+    return names;
+}
+
+int ReportRenderer::exportAll(const QVector<StationReading> &readings, const QStringList &names,
+                              const QVector<int> &stations, const ReportOptions &options, QStringList *errors)
+{
+    TRACE_SCOPE("report export");
+    if (!QDir().mkpath(options.outDir)) {
+        if (errors) errors->append(u"Не удалось создать каталог %1"_s.arg(options.outDir));
+        return 0;
+    }
+
+    // один проход по показаниям раскладывает их по станциям отчёта
+    QVector<StationReportData> jobs(stations.size());
+    QHash<int, int> slot;
+    for (int i = 0; i < stations.size(); ++i) {
+        jobs[i].station = stations[i];
+        jobs[i].name = names.value(stations[i]);
+        slot.insert(stations[i], i);
+    }
+    for (const StationReading &r : readings) {
+        const auto it = slot.constFind(r.station);
+        if (it == slot.cend()) continue;
+        StationReportData &job = jobs[*it];
+        job.points.append(QPointF(double(r.day), r.rad));
+        job.stats.add(r.day, r.rad);
+    }
+    jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [](const StationReportData &d) { return d.points.isEmpty(); }),
+               jobs.end());
+
+    QMutex errorLock;
+    std::atomic<int> written{0};
+    QtConcurrent::blockingMap(jobs, [&](StationReportData &job) {
+        std::sort(job.points.begin(), job.points.end(), [](const QPointF &a, const QPointF &b) { return a.x() < b.x(); });
+        QString error;
+        if (renderStation(job, options, &error)) {
+            written.fetch_add(1, std::memory_order_relaxed);
+        } else if (errors) {
+            QMutexLocker lock(&errorLock);
+            errors->append(error);
+        }
+        job.points = {};   // память отдаётся сразу, не дожидаясь конца пакета
+    });
+    return written.load();
+}
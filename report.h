@@ -0,0 +1,59 @@
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QPointF>
+#include <QSize>
+#include <QRectF>
+#include "periodcompare.h"
+#include "resultcache.h"
+
+class QPainter;
+class StationRegistry;
+
+struct ReportOptions {
+    enum Format { Png, Svg, Pdf };
+
+    QString outDir;
+    Format format = Png;
+    QSize size{1200, 700};        // px; для PDF — при 96 dpi
+    bool withStats = true;        // сводка как в «Анализировать данные» справа от графика
+
+    static bool parseFormat(const QString &name, Format *out);
+    QString suffix() const;
+};
+
+// Всё, что нужно для отчёта одной станции; собирается в GUI-потоке, рисуется в рабочем
+struct StationReportData {
+    int station = -1;
+    QString name;
+    QVector<QPointF> points;      // (юлианский день, мкР/ч), по возрастанию дня
+    ReadingStats stats;
+};
+
+// ============================
+// Пакетный экспорт отчётов
+// ============================
+// График станции рисуется QPainter'ом прямо в QImage / QSvgGenerator / QPdfWriter —
+// без QChart и сцены, поэтому станции раскладываются по рабочим потокам.
+// Линия прореживается до четырёх точек на столбец пикселей (первая, min, max, последняя):
+// время отрисовки не зависит от длины ряда.
+class ReportRenderer
+{
+public:
+    // Один файл на станцию в options.outDir; names — имена по id станции (снимок реестра,
+    // чтобы не читать его из рабочих потоков). Возвращает число записанных файлов.
+    static int exportAll(const QVector<StationReading> &readings, const QStringList &names,
+                         const QVector<int> &stations, const ReportOptions &options, QStringList *errors);
+    static QStringList stationNames(const StationRegistry &registry);
+
+    static bool renderStation(const StationReportData &data, const ReportOptions &options, QString *error);
+    static void paint(QPainter &p, const QRectF &rect, const StationReportData &data, bool withStats);
+
+    // <имя>_<id>: имена вроде «A B» и «A_B» дают одну основу, id станции их различает
+    static QString fileNameFor(const StationReportData &data, const ReportOptions &options);
+};
+
+#endif
@@ -0,0 +1,210 @@
+#include "resample.h"
+#include "tracing.h"
+#include <QDate>
+#include <QHash>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// ============================
+// ResampleOptions
+// ============================
+
+qint64 ResampleOptions::bucketOf(qint64 day) const
+{
+    switch (step) {
+    case Step::Day: return day;
+    case Step::Week: return day >= 0 ? day / 7 : (day - 6) / 7;   // юлианский день 0 — понедельник
+    case Step::Month: {
+        const QDate d = QDate::fromJulianDay(day);
+        return qint64(d.year()) * 12 + (d.month() - 1);
+    }
+    }
+    return day;
+}
+
+qint64 ResampleOptions::bucketStart(qint64 bucket) const
+{
+    switch (step) {
+    case Step::Day: return bucket;
+    case Step::Week: return bucket * 7;
+    case Step::Month: {
+        const qint64 year = bucket >= 0 ? bucket / 12 : (bucket - 11) / 12;
+        return QDate(int(year), int(bucket - year * 12) + 1, 1).toJulianDay();
+    }
+    }
+    return bucket;
+}
+
+// ============================
+// ResampleStream
+// ============================
+
+ResampleStream::ResampleStream(const ResampleOptions &options, ResampledSeries *out)
+    : options(options), out(out)
+{
+    out->values.clear();
+    out->observed.clear();
+}
+
+void ResampleStream::add(qint64 day, float value)
+{
+    const qint64 bucket = options.bucketOf(day);
+    if (open && bucket != openBucket) closeBucket();
+    if (!open) {
+        open = true;
+        openBucket = bucket;
+        accCount = 0;
+    }
+
+    using Agg = ResampleOptions::Aggregation;
+    if (accCount == 0) acc = value;
+    else if (options.aggregation == Agg::Mean) acc += value;
+    else if (options.aggregation == Agg::Min) acc = std::min(acc, double(value));
+    else if (options.aggregation == Agg::Max) acc = std::max(acc, double(value));
+    else acc = value;
+    ++accCount;
+}
+
+void ResampleStream::finish()
+{
+    if (open) closeBucket();
+}
+
+void ResampleStream::closeBucket()
+{
+    open = false;
+    const float value = float(options.aggregation == ResampleOptions::Aggregation::Mean ? acc / accCount : acc);
+
+    if (out->values.isEmpty()) {
+        out->firstBucket = openBucket;
+    } else {
+        // пустые ячейки между прошлой наблюдённой и текущей
+        const qint64 gap = openBucket - lastObserved - 1;
+        using Fill = ResampleOptions::GapFill;
+        const bool fill = options.gapFill != Fill::None && gap <= options.maxGap;
+        for (qint64 k = 1; k <= gap; ++k) {
+            if (!fill) push(std::numeric_limits<float>::quiet_NaN(), false);
+            else if (options.gapFill == Fill::CarryForward) push(lastValue, false);
+            else push(float(lastValue + (value - lastValue) * double(k) / double(gap + 1)), false);
+        }
+    }
+    push(value, true);
+    lastObserved = openBucket;
+    lastValue = value;
+}
+
+void ResampleStream::push(float value, bool isObserved)
+{
+    out->values.append(value);
+    out->observed.append(isObserved);
+}
+
+// ============================
+// Resampler
+// ============================
+
+QVector<ResampledSeries> Resampler::resampleAll(const QVector<StationReading> &readings,
+                                                const QVector<int> &stations, const ResampleOptions &options)
+{
+    TRACE_SCOPE("resample");
+
+    QHash<int, QVector<StationReading>> byStation;
+    for (int id : stations) byStation.insert(id, {});
+    for (const StationReading &r : readings) {
+        auto it = byStation.find(r.station);
+        if (it != byStation.end()) it->append(r);
+    }
+
+    QVector<ResampledSeries> result(stations.size());
+    for (int i = 0; i < stations.size(); ++i) result[i].station = stations[i];
+
+    const auto &groups = byStation;   // только чтение из потоков
+    QtConcurrent::blockingMap(result, [&groups, &options](ResampledSeries &s) {
+        TRACE_SCOPE("resample station");
+        QVector<StationReading> rows = groups.constFind(s.station).value();
+        if (rows.isEmpty()) return;
+        // устойчивая сортировка: «последнее» в ячейке — последнее в порядке записей
+        std::stable_sort(rows.begin(), rows.end(), [](const StationReading &a, const StationReading &b) { return a.day < b.day; });
+
+        ResampleStream stream(options, &s);
+        for (const StationReading &r : std::as_const(rows)) stream.add(r.day, float(r.rad));
+        stream.finish();
+    });
+
+    result.erase(std::remove_if(result.begin(), result.end(), [](const ResampledSeries &s) { return s.values.isEmpty(); }),
+                 result.end());
+    return result;
+}
+
+void Resampler::align(QVector<ResampledSeries> &series)
+{
+    if (series.isEmpty()) return;
+    qint64 first = std::numeric_limits<qint64>::max();
+    qint64 last = std::numeric_limits<qint64>::min();
+    for (const ResampledSeries &s : std::as_const(series)) {
+        first = std::min(first, s.firstBucket);
+        last = std::max(last, s.firstBucket + s.size() - 1);
+    }
+    const int n = int(last - first + 1);
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    for (ResampledSeries &s : series) {
+        const int head = int(s.firstBucket - first);
+        QVector<float> values(n, nan);
+        QVector<bool> observed(n, false);
+        std::copy(s.values.cbegin(), s.values.cend(), values.begin() + head);
+        std::copy(s.observed.cbegin(), s.observed.cend(), observed.begin() + head);
+        s.values = std::move(values);
+        s.observed = std::move(observed);
+        s.firstBucket = first;
+    }
+}
+
+// ============================
+// DailyGridBuilder
+// ============================
+
+DailyGridBuilder::DailyGridBuilder(qint64 firstDay, qint64 lastDay)
+    : firstDay(firstDay), days(int(std::max<qint64>(0, lastDay - firstDay + 1)))
+{
+}
+
+void DailyGridBuilder::add(int station, qint64 day, float sum, quint32 count)
+{
+    const qint64 t = day - firstDay;
+    if (t < 0 || t >= days) return;
+    auto it = rowOf.constFind(station);
+    if (it == rowOf.cend()) {
+        it = rowOf.insert(station, int(rowOf.size()));
+        sums.resize(sums.size() + days, 0.0f);
+        counts.resize(counts.size() + days, 0);
+    }
+    const qsizetype at = qsizetype(*it) * days + t;
+    sums[at] += sum;
+    counts[at] += count;
+}
+
+QVector<ResampledSeries> DailyGridBuilder::series() const
+{
+    QVector<int> ids = rowOf.keys();
+    std::sort(ids.begin(), ids.end());
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    QVector<ResampledSeries> out;
+    out.reserve(ids.size());
+    for (int id : std::as_const(ids)) {
+        const qsizetype base = qsizetype(rowOf.value(id)) * days;
+        ResampledSeries s;
+        s.station = id;
+        s.firstBucket = firstDay;
+        s.values.resize(days);
+        s.observed.resize(days);
+        for (int t = 0; t < days; ++t) {
+            const quint32 c = counts[base + t];
+            s.observed[t] = c > 0;
+            s.values[t] = c > 0 ? sums[base + t] / float(c) : nan;
+        }
+        out.append(std::move(s));
+    }
+    return out;
+}
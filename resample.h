@@ -0,0 +1,100 @@
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+#include <QVector>
+#include <QHash>
+#include "periodcompare.h"
+
+// Параметры приведения ряда к регулярной сетке
+struct ResampleOptions {
+    enum class Step { Day, Week, Month };                 // неделя — с понедельника
+    enum class Aggregation { Mean, Min, Max, Last };      // значение ячейки по её показаниям
+    enum class GapFill { None, CarryForward, Linear };    // что ставить в пустые ячейки
+
+    Step step = Step::Day;
+    Aggregation aggregation = Aggregation::Mean;
+    GapFill gapFill = GapFill::None;
+    int maxGap = 3;   // пропуски длиннее maxGap ячеек не заполняются ни при какой политике
+
+    // Номер ячейки, в которую попадает день, и первый день ячейки
+    qint64 bucketOf(qint64 day) const;
+    qint64 bucketStart(qint64 bucket) const;
+};
+
+// Ряд одной станции на сетке: ячейки подряд, пропуск — NaN
+struct ResampledSeries {
+    int station = -1;
+    qint64 firstBucket = 0;
+    QVector<float> values;
+    QVector<bool> observed;   // в ячейке были показания (а не заполнение пропуска)
+
+    int size() const { return int(values.size()); }
+};
+
+// ============================
+// Потоковое приведение к сетке
+// ============================
+// Показания одной станции подаются по неубыванию дня; закрытая ячейка сразу уходит
+// в выходной ряд. Пропуск между двумя наблюдёнными ячейками заполняется, когда
+// приходит вторая из них, поэтому состояние — одна открытая ячейка и последнее значение.
+class ResampleStream
+{
+public:
+    ResampleStream(const ResampleOptions &options, ResampledSeries *out);
+
+    void add(qint64 day, float value);
+    void finish();
+
+private:
+    void closeBucket();
+    void push(float value, bool isObserved);
+
+    ResampleOptions options;
+    ResampledSeries *out;
+    qint64 openBucket = 0;
+    bool open = false;
+    double acc = 0.0;   // сумма, минимум, максимум или последнее — по виду агрегирования
+    int accCount = 0;
+    qint64 lastObserved = 0;   // номер последней наблюдённой ячейки
+    float lastValue = 0.0f;
+};
+
+// ============================
+// Сетка по всем станциям
+// ============================
+class Resampler
+{
+public:
+    // Станции обрабатываются параллельно; в результате только станции с показаниями
+    static QVector<ResampledSeries> resampleAll(const QVector<StationReading> &readings,
+                                                const QVector<int> &stations, const ResampleOptions &options);
+    // Дополняет ряды NaN до общего диапазона ячеек: series[k].values[i] — одна и та же ячейка
+    static void align(QVector<ResampledSeries> &series);
+};
+
+// ============================
+// Суточная сетка без копии показаний
+// ============================
+// Показания подаются в любом порядке (например, по страницам файла): на станцию
+// заводится строка сумм и счётчиков по дням диапазона — 8 байт на станцию-день
+// вместо 16 на показание. series() даёт средние за сутки, пропуск — NaN; ряды уже
+// выровнены друг с другом.
+class DailyGridBuilder
+{
+public:
+    DailyGridBuilder(qint64 firstDay, qint64 lastDay);
+
+    void add(int station, qint64 day, float value) { add(station, day, value, 1); }
+    // Уже сложенные count показаний дня (например, GROUP BY в базе)
+    void add(int station, qint64 day, float sum, quint32 count);
+    QVector<ResampledSeries> series() const;   // по возрастанию id станции
+
+private:
+    qint64 firstDay;
+    int days;
+    QHash<int, int> rowOf;   // id станции → строка сетки
+    QVector<float> sums;
+    QVector<quint32> counts;
+};
+
+#endif
@@ -0,0 +1,99 @@
+#include "resultcache.h"
+#include "radiationmodel.h"
+#include "tracing.h"
+#include <QtMath>
+#include <algorithm>
+
+// ============================
+// ReadingStats
+// ============================
+
+void ReadingStats::add(qint64 day, int rad)
+{
+    const double x = double(day - kDayOrigin);
+    ++count;
+    sum += rad;
+    sumSq += double(rad) * rad;
+    min = std::min(min, rad);
+    max = std::max(max, rad);
+    sx += x;
+    sxx += x * x;
+    sxy += x * rad;
+}
+
+void ReadingStats::merge(const ReadingStats &o)
+{
+    count += o.count;
+    sum += o.sum;
+    sumSq += o.sumSq;
+    min = std::min(min, o.min);
+    max = std::max(max, o.max);
+    sx += o.sx;
+    sxx += o.sxx;
+    sxy += o.sxy;
+}
+
+double ReadingStats::stddev() const
+{
+    if (count == 0) return 0.0;
+    const double m = mean();
+    return std::sqrt(std::max(0.0, sumSq / count - m * m));
+}
+
+bool ReadingStats::trend(double *slope, double *intercept) const
+{
+    // регрессия y = a*x + b
+    const double denom = count * sxx - sx * sx;
+    if (count < 2 || qFuzzyIsNull(denom)) return false;
+    *slope = (count * sxy - sx * sum) / denom;
+    *intercept = (sum - *slope * sx) / count;
+    return true;
+}
+
+// ============================
+// ResultCache
+// ============================
+
+ResultCache::ResultCache(const RadiationModel *records, int maxEntries)
+    : records(records), cache(maxEntries)
+{
+}
+
+ReadingStats ResultCache::query(const QVector<int> &stations, qint64 fromDay, qint64 toDay)
+{
+    ReadingStats total;
+    QHash<int, ReadingStats> missing;   // станции без актуальной записи в кэше
+
+    for (int id : stations) {
+        const Entry *e = cache.object(Key{id, fromDay, toDay});
+        if (e && e->version == records->stationVersion(id)) {
+            ++nHits;
+            total.merge(e->stats);
+        } else {
+            ++nMisses;
+            missing.insert(id, ReadingStats());
+        }
+    }
+    if (missing.isEmpty()) return total;
+
+    {
+        TRACE_SCOPE("result cache fill");
+        for (const PackedReading &r : records->arena()) {
+            if (r.day < fromDay || r.day > toDay) continue;
+            auto it = missing.find(r.station);
+            if (it != missing.end()) it->add(r.day, r.rad);
+        }
+    }
+
+    for (auto it = missing.cbegin(); it != missing.cend(); ++it) {
+        cache.insert(Key{it.key(), fromDay, toDay}, new Entry{records->stationVersion(it.key()), it.value()});
+        total.merge(it.value());
+    }
+    return total;
+}
+
+void ResultCache::clear()
+{
+    cache.clear();
+    nHits = nMisses = 0;
+}
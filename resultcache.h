@@ -0,0 +1,79 @@
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include <QVector>
+#include <QHash>
+#include <QCache>
+#include <QtGlobal>
+#include <limits>
+
+class RadiationModel;
+
+// Сворачиваемая сводка по показаниям: из неё получаются и анализ (среднее, min/max,
+// отклонение), и линия тенденции, а сводки нескольких станций просто складываются.
+struct ReadingStats {
+    static constexpr qint64 kDayOrigin = 2451545;   // J2000, чтобы суммы x² оставались небольшими
+
+    qint64 count = 0;
+    double sum = 0, sumSq = 0;
+    int min = std::numeric_limits<int>::max();
+    int max = std::numeric_limits<int>::min();
+    double sx = 0, sxx = 0, sxy = 0;                // x — юлианский день минус kDayOrigin
+
+    void add(qint64 day, int rad);
+    void merge(const ReadingStats &o);
+
+    double mean() const { return count ? sum / count : 0.0; }
+    double stddev() const;
+    // y = slope * (день - kDayOrigin) + intercept; false, если все точки в один день
+    bool trend(double *slope, double *intercept) const;
+};
+
+// ============================
+// Кэш результатов запросов
+// ============================
+// Ключ — (станция, диапазон дней), запись помнит версию станции на момент расчёта.
+// Добавление записи меняет версию одной станции, поэтому пересчитывается только она;
+// сортировка версий станций не трогает — сводки от порядка не зависят.
+// Промахи по нескольким станциям досчитываются одним проходом по записям.
+class ResultCache
+{
+public:
+    static constexpr qint64 kAllDays = std::numeric_limits<qint64>::max();
+
+    explicit ResultCache(const RadiationModel *records, int maxEntries = 4096);
+
+    // Сумма сводок по станциям за [fromDay, toDay]
+    ReadingStats query(const QVector<int> &stations, qint64 fromDay = -kAllDays, qint64 toDay = kAllDays);
+    ReadingStats station(int station, qint64 fromDay = -kAllDays, qint64 toDay = kAllDays)
+    {
+        return query({station}, fromDay, toDay);
+    }
+
+    void clear();
+
+    quint64 hits() const { return nHits; }
+    quint64 misses() const { return nMisses; }
+    double hitRate() const { return nHits + nMisses ? double(nHits) / double(nHits + nMisses) : 0.0; }
+    int entries() const { return int(cache.size()); }
+
+private:
+    struct Key {
+        int station;
+        qint64 fromDay, toDay;
+        bool operator==(const Key &o) const { return station == o.station && fromDay == o.fromDay && toDay == o.toDay; }
+        friend size_t qHash(const Key &k, size_t seed) { return qHashMulti(seed, k.station, k.fromDay, k.toDay); }
+    };
+
+    struct Entry {
+        quint64 version;
+        ReadingStats stats;
+    };
+
+    const RadiationModel *records;
+    QCache<Key, Entry> cache;
+    quint64 nHits = 0;
+    quint64 nMisses = 0;
+};
+
+#endif
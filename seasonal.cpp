@@ -0,0 +1,200 @@
+#include "seasonal.h"
+#include "tracing.h"
+#include <QHash>
+#include <QtConcurrent>
+#include <complex>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr double kPi = 3.141592653589793;
+
+// Центрированное скользящее среднее нечётной ширины; у краёв окно усекается
+void movingAverage(const float *x, int n, int width, float *out)
+{
+    const int half = width / 2;
+    QVector<double> prefix(n + 1, 0.0);
+    for (int t = 0; t < n; ++t) prefix[t + 1] = prefix[t] + x[t];
+    for (int t = 0; t < n; ++t) {
+        const int a = std::max(0, t - half);
+        const int b = std::min(n, t + half + 1);
+        out[t] = float((prefix[b] - prefix[a]) / (b - a));
+    }
+}
+
+// Итеративное БПФ по основанию 2, на месте
+void fft(std::vector<std::complex<double>> &a)
+{
+    const size_t n = a.size();
+    for (size_t i = 1, j = 0; i < n; ++i) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) std::swap(a[i], a[j]);
+    }
+    for (size_t len = 2; len <= n; len <<= 1) {
+        const double ang = -2.0 * kPi / double(len);
+        const std::complex<double> wl(std::cos(ang), std::sin(ang));
+        for (size_t i = 0; i < n; i += len) {
+            std::complex<double> w(1.0, 0.0);
+            for (size_t k = 0; k < len / 2; ++k) {
+                const std::complex<double> u = a[i + k];
+                const std::complex<double> v = a[i + k + len / 2] * w;
+                a[i + k] = u + v;
+                a[i + k + len / 2] = u - v;
+                w *= wl;
+            }
+        }
+    }
+}
+
+} // namespace
+
+QVector<float> SeasonalAnalysis::dailyGrid(QVector<StationReading> rows, qint64 *firstDay)
+{
+    std::sort(rows.begin(), rows.end(), [](const StationReading &a, const StationReading &b) { return a.day < b.day; });
+    *firstDay = rows.first().day;
+    const int days = int(rows.last().day - rows.first().day + 1);
+
+    QVector<float> y(days, 0.0f);
+    QVector<int> known;
+    for (int i = 0; i < rows.size(); ) {
+        const qint64 day = rows[i].day;
+        double sum = 0.0;
+        int cnt = 0;
+        for (; i < rows.size() && rows[i].day == day; ++i) { sum += rows[i].rad; ++cnt; }
+        const int t = int(day - *firstDay);
+        y[t] = float(sum / cnt);
+        known.append(t);
+    }
+    for (int k = 1; k < known.size(); ++k) {
+        const int a = known[k - 1], b = known[k];
+        for (int t = a + 1; t < b; ++t)
+            y[t] = y[a] + (y[b] - y[a]) * float(t - a) / float(b - a);
+    }
+    return y;
+}
+
+QVector<QPair<double, double>> SeasonalAnalysis::periodogram(const float *y, int n, int maxPeaks)
+{
+    QVector<QPair<double, double>> peaks;
+    if (n < 8) return peaks;
+
+    // линейный тренд убирается, иначе он забивает низкие частоты
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (int t = 0; t < n; ++t) { sx += t; sy += y[t]; sxx += double(t) * t; sxy += double(t) * y[t]; }
+    const double slope = (n * sxy - sx * sy) / (n * sxx - sx * sx);
+    const double intercept = (sy - slope * sx) / n;
+
+    // дополнение нулями до ≥4n уплотняет сетку частот
+    size_t size = 1;
+    while (size < 4 * size_t(n)) size <<= 1;
+    std::vector<std::complex<double>> a(size);
+    for (int t = 0; t < n; ++t) {
+        const double hann = 0.5 - 0.5 * std::cos(2.0 * kPi * t / (n - 1));
+        a[t] = (y[t] - (slope * t + intercept)) * hann;
+    }
+    fft(a);
+
+    const int half = int(size / 2);
+    QVector<double> power(half + 1);
+    double total = 0.0;
+    for (int k = 1; k <= half; ++k) {
+        power[k] = std::norm(a[k]);
+        total += power[k];
+    }
+    if (total <= 0.0) return peaks;
+
+    // локальные максимумы с периодом от 2 дней до половины длины ряда
+    for (int k = 2; k < half; ++k) {
+        const double period = double(size) / k;
+        if (period > n / 2.0 || period < 2.0) continue;
+        if (power[k] > power[k - 1] && power[k] >= power[k + 1]) {
+            // уточнение положения пика параболой по трём соседним точкам
+            const double denom = power[k - 1] - 2.0 * power[k] + power[k + 1];
+            const double shift = denom != 0.0 ? 0.5 * (power[k - 1] - power[k + 1]) / denom : 0.0;
+            peaks.append({double(size) / (k + shift), (power[k - 1] + power[k] + power[k + 1]) / total});
+        }
+    }
+    std::sort(peaks.begin(), peaks.end(), [](const auto &a, const auto &b) { return a.second > b.second; });
+    if (peaks.size() > maxPeaks) peaks.resize(maxPeaks);
+    return peaks;
+}
+
+void SeasonalAnalysis::decompose(const float *y, int n, int period, float *trend, float *seasonal, float *residual)
+{
+    std::fill(seasonal, seasonal + n, 0.0f);
+    QVector<float> work(n);
+
+    for (int pass = 0; pass < kInnerPasses; ++pass) {
+        // тренд по ряду без текущей оценки сезонности
+        for (int t = 0; t < n; ++t) work[t] = y[t] - seasonal[t];
+        const int width = period > 1 ? (period | 1) : 1;
+        if (width > 1) movingAverage(work.constData(), n, width, trend);
+        else std::copy(work.cbegin(), work.cend(), trend);
+        if (period < 2) break;
+
+        // сезонность: среднее отклонения от тренда по каждой фазе цикла, с нулевой суммой
+        QVector<double> phaseSum(period, 0.0);
+        QVector<int> phaseCount(period, 0);
+        for (int t = 0; t < n; ++t) {
+            phaseSum[t % period] += y[t] - trend[t];
+            ++phaseCount[t % period];
+        }
+        QVector<float> cycle(period);
+        double mean = 0.0;
+        for (int k = 0; k < period; ++k) {
+            cycle[k] = phaseCount[k] ? float(phaseSum[k] / phaseCount[k]) : 0.0f;
+            mean += cycle[k];
+        }
+        mean /= period;
+        // лёгкое сглаживание по соседним фазам (цикл замкнут)
+        QVector<float> smooth(period);
+        for (int k = 0; k < period; ++k)
+            smooth[k] = float((cycle[(k + period - 1) % period] + 2.0 * cycle[k] + cycle[(k + 1) % period]) / 4.0 - mean);
+        for (int t = 0; t < n; ++t) seasonal[t] = smooth[t % period];
+    }
+
+    for (int t = 0; t < n; ++t) residual[t] = y[t] - trend[t] - seasonal[t];
+}
+
+QVector<Decomposition> SeasonalAnalysis::compute(const QVector<StationReading> &readings,
+                                                 const QVector<int> &stations, int period)
+{
+    TRACE_SCOPE("seasonal");
+
+    QHash<int, QVector<StationReading>> byStation;
+    for (int id : stations) byStation.insert(id, {});
+    for (const StationReading &r : readings) {
+        auto it = byStation.find(r.station);
+        if (it != byStation.end()) it->append(r);
+    }
+
+    QVector<Decomposition> result(stations.size());
+    for (int i = 0; i < stations.size(); ++i) result[i].station = stations[i];
+
+    const auto &groups = byStation;   // только чтение из потоков
+    QtConcurrent::blockingMap(result, [&groups, period](Decomposition &d) {
+        TRACE_SCOPE("seasonal station");
+        const QVector<StationReading> &rows = groups.constFind(d.station).value();
+        if (rows.isEmpty()) return;
+
+        const QVector<float> y = dailyGrid(rows, &d.firstDay);
+        const int n = int(y.size());
+        d.peaks = periodogram(y.constData(), n);
+
+        int p = period;
+        if (p == kAutoPeriod && !d.peaks.isEmpty()) p = int(std::lround(d.peaks.first().first));
+        d.period = (p >= 2 && n >= 2 * p) ? p : 0;
+
+        d.trend.resize(n);
+        d.seasonal.resize(n);
+        d.residual.resize(n);
+        decompose(y.constData(), n, d.period, d.trend.data(), d.seasonal.data(), d.residual.data());
+    });
+
+    result.erase(std::remove_if(result.begin(), result.end(), [](const Decomposition &d) { return d.trend.isEmpty(); }),
+                 result.end());
+    return result;
+}
@@ -0,0 +1,43 @@
+#ifndef SEASONAL_H
+#define SEASONAL_H
+
+#include <QVector>
+#include <QPair>
+#include "periodcompare.h"
+
+// Разложение ряда станции на суточной сетке: y = тренд + сезонность + остаток
+struct Decomposition {
+    int station = -1;
+    qint64 firstDay = 0;                 // день первой точки сетки
+    int period = 0;                      // период сезонной составляющей, дни (0 — ряд слишком короткий)
+    QVector<float> trend, seasonal, residual;
+    QVector<QPair<double, double>> peaks;   // (период в днях, доля мощности спектра), по убыванию
+
+    int days() const { return int(trend.size()); }
+};
+
+// ============================
+// Сезонное разложение и периодограмма
+// ============================
+// Ряд приводится к суточной сетке (среднее за день, пропуски — линейно). Периодограмма —
+// БПФ ряда без линейного тренда с окном Ханна; в качестве сезонного периода по умолчанию
+// берётся её главный пик. Разложение — в духе STL: скользящее среднее даёт тренд,
+// средние по фазам цикла — сезонность, два внутренних прохода уточняют обе части.
+// Станции обрабатываются параллельно.
+class SeasonalAnalysis
+{
+public:
+    static constexpr int kAutoPeriod = 0;
+    static constexpr int kInnerPasses = 2;
+    static constexpr int kMaxPeaks = 3;
+
+    static QVector<Decomposition> compute(const QVector<StationReading> &readings,
+                                          const QVector<int> &stations, int period = kAutoPeriod);
+
+    // Суточная сетка одной станции: среднее за день, пропуски — линейная интерполяция
+    static QVector<float> dailyGrid(QVector<StationReading> rows, qint64 *firstDay);
+    static QVector<QPair<double, double>> periodogram(const float *y, int n, int maxPeaks = kMaxPeaks);
+    static void decompose(const float *y, int n, int period, float *trend, float *seasonal, float *residual);
+};
+
+#endif
@@ -0,0 +1,285 @@
+#include "session.h"
+#include "radiationmodel.h"
+#include "stationregistry.h"
+#include "tracing.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QVector>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+using namespace Qt::StringLiterals;
+
+namespace {
+
+constexpr quint32 kDatasetMagic = 0x53455352;   // "RSES"
+constexpr quint32 kDatasetVersion = 1;
+constexpr quint32 kStateMagic = 0x54535352;     // "RSST"
+constexpr quint32 kStateVersion = 1;
+constexpr qsizetype kWriteBatch = 65536;        // значений за одну запись в файл
+
+constexpr bool kLittleEndian = Q_BYTE_ORDER == Q_LITTLE_ENDIAN;
+
+void prepare(QDataStream &ds)
+{
+    ds.setVersion(QDataStream::Qt_6_0);
+    ds.setByteOrder(QDataStream::LittleEndian);
+    ds.setFloatingPointPrecision(QDataStream::DoublePrecision);
+}
+
+QString sessionDir()
+{
+    const QString dir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+    QDir().mkpath(dir);
+    return dir;
+}
+
+bool writeRaw(QSaveFile &file, const void *data, qsizetype bytes)
+{
+    return file.write(static_cast<const char *>(data), bytes) == bytes;
+}
+
+} // namespace
+
+SourceStamp SourceStamp::of(const QString &fileName)
+{
+    SourceStamp s;
+    s.fileName = fileName;
+    const QFileInfo info(fileName);
+    if (!fileName.isEmpty() && info.exists()) {
+        s.size = info.size();
+        s.modifiedMs = info.lastModified().toMSecsSinceEpoch();
+    }
+    return s;
+}
+
+namespace Session {
+
+QString datasetPath() { return sessionDir() + u"/session.rses"_s; }
+QString statePath() { return sessionDir() + u"/session.state"_s; }
+
+// ============================
+// Набор
+// ============================
+
+bool saveDataset(const QString &fileName, quint64 id, const RadiationModel &records,
+                 const StationRegistry &registry, QString *error)
+{
+    TRACE_SCOPE("session save");
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+
+    const MetricColumns &mc = records.metricColumns();
+    const qsizetype n = records.size();
+    {
+        QDataStream ds(&file);
+        prepare(ds);
+        ds << kDatasetMagic << kDatasetVersion << quint8(kLittleEndian) << id;
+        ds << quint32(registry.count());
+        for (int s = 0; s < registry.count(); ++s) {
+            Coord pos{0.0, 0.0};
+            const bool has = registry.coord(s, &pos);
+            ds << registry.name(s) << quint8(has) << pos.lat << pos.lon;
+        }
+        ds << quint32(mc.count());
+        for (int m = 0; m < mc.count(); ++m) ds << mc.info(m).key << quint8(mc.info(m).type);
+        ds << quint64(n);
+        if (ds.status() != QDataStream::Ok) {
+            if (error) *error = file.errorString();
+            file.cancelWriting();
+            return false;
+        }
+    }
+
+    // записи начинаются с границы 8 байт: после отображения их можно читать на месте
+    static const char zeros[8] = {};
+    bool ok = writeRaw(file, zeros, (8 - file.pos() % 8) % 8);
+
+    QVector<PackedReading> batch;
+    batch.reserve(kWriteBatch);
+    for (qsizetype row = 0; ok && row < n; ++row) {
+        batch.append(records.at(row));
+        if (batch.size() == kWriteBatch || row == n - 1) {
+            ok = writeRaw(file, batch.constData(), batch.size() * qsizetype(sizeof(PackedReading)));
+            batch.clear();
+        }
+    }
+
+    // столбец показателя — n значений по 4 байта, пропуски как в MetricColumns
+    QVector<float> floats;
+    QVector<qint32> ints;
+    for (int m = 0; ok && m < mc.count(); ++m) {
+        const bool isInt = mc.info(m).type == MetricType::Int32;
+        for (qsizetype row = 0; ok && row < n; ++row) {
+            double v = 0.0;
+            const bool has = records.metric(m, row, &v);
+            if (isInt) ints.append(has ? qint32(v) : MetricColumns::kMissingInt);
+            else floats.append(has ? float(v) : std::numeric_limits<float>::quiet_NaN());
+            if (ints.size() == kWriteBatch || floats.size() == kWriteBatch || row == n - 1) {
+                ok = isInt ? writeRaw(file, ints.constData(), ints.size() * qsizetype(sizeof(qint32)))
+                           : writeRaw(file, floats.constData(), floats.size() * qsizetype(sizeof(float)));
+                ints.clear();
+                floats.clear();
+            }
+        }
+    }
+
+    if (!ok || !file.commit()) {
+        if (error) *error = file.errorString();
+        if (!ok) file.cancelWriting();
+        return false;
+    }
+    return true;
+}
+
+bool loadDataset(const QString &fileName, quint64 id, RadiationModel *records,
+                 StationRegistry *registry, QString *error)
+{
+    TRACE_SCOPE("session restore");
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    const qint64 size = file.size();
+    const uchar *data = size > 0 ? file.map(0, size) : nullptr;
+    if (!data) {
+        if (error) *error = u"Файл сеанса пуст или не отображается в память"_s;
+        return false;
+    }
+
+    const QByteArray header = QByteArray::fromRawData(reinterpret_cast<const char *>(data), size);
+    QDataStream ds(header);
+    prepare(ds);
+
+    quint32 magic = 0, version = 0;
+    quint8 little = 0;
+    quint64 fileId = 0;
+    ds >> magic >> version >> little >> fileId;
+    if (ds.status() != QDataStream::Ok || magic != kDatasetMagic || version != kDatasetVersion
+        || bool(little) != kLittleEndian || fileId != id) {
+        if (error) *error = u"Файл сеанса устарел или записан другой версией"_s;
+        return false;
+    }
+
+    struct Station { QString name; bool hasCoord; Coord pos; };
+    quint32 nStations = 0;
+    ds >> nStations;
+    QVector<Station> table;
+    for (quint32 i = 0; i < nStations && ds.status() == QDataStream::Ok; ++i) {
+        Station st;
+        quint8 has = 0;
+        ds >> st.name >> has >> st.pos.lat >> st.pos.lon;
+        st.hasCoord = has != 0;
+        table.append(st);
+    }
+    quint32 nMetrics = 0;
+    ds >> nMetrics;
+    QVector<std::pair<QString, MetricType>> keys;
+    for (quint32 i = 0; i < nMetrics && ds.status() == QDataStream::Ok; ++i) {
+        QString key;
+        quint8 type = 0;
+        ds >> key >> type;
+        keys.append({key, MetricType(type)});
+    }
+    quint64 n = 0;
+    ds >> n;
+
+    const qint64 recordsOffset = (ds.device()->pos() + 7) / 8 * 8;
+    const qint64 expected = recordsOffset + qint64(n) * qint64(sizeof(PackedReading) + 4 * keys.size());
+    if (ds.status() != QDataStream::Ok || table.size() != qsizetype(nStations) || expected != size) {
+        if (error) *error = u"Файл сеанса повреждён"_s;
+        return false;
+    }
+
+    // id станций сеанса → id реестра (совпадают, если реестр заполнен в том же порядке)
+    registry->beginUpdate();
+    QVector<int> remap(table.size());
+    for (int s = 0; s < table.size(); ++s) {
+        remap[s] = registry->intern(table[s].name);
+        if (table[s].hasCoord) registry->setCoord(remap[s], table[s].pos);
+    }
+
+    const auto *rows = reinterpret_cast<const PackedReading *>(data + recordsOffset);
+    records->beginBulkLoad(true, qsizetype(n));
+    qsizetype loaded = 0;
+    for (quint64 i = 0; i < n; ++i) {
+        const PackedReading &r = rows[i];
+        if (r.station < remap.size() && records->bulkAppend(remap[r.station], r.day, r.rad)) ++loaded;
+    }
+
+    // показатели пишутся только при полном совпадении строк
+    const uchar *column = data + recordsOffset + qint64(n) * qint64(sizeof(PackedReading));
+    for (int k = 0; loaded == qsizetype(n) && k < keys.size(); ++k, column += 4 * n) {
+        const int m = records->bulkMetric(keys[k].first);
+        for (quint64 row = 0; row < n; ++row) {
+            if (keys[k].second == MetricType::Int32) {
+                qint32 v;
+                std::memcpy(&v, column + 4 * row, 4);
+                if (v != MetricColumns::kMissingInt) records->bulkSetMetric(m, qsizetype(row), v);
+            } else {
+                float v;
+                std::memcpy(&v, column + 4 * row, 4);
+                if (!std::isnan(v)) records->bulkSetMetric(m, qsizetype(row), v);
+            }
+        }
+    }
+    records->endBulkLoad();
+    registry->endUpdate();
+
+    if (loaded != qsizetype(n) && error) *error = u"Часть записей сеанса пропущена"_s;
+    return loaded == qsizetype(n);
+}
+
+// ============================
+// Состояние интерфейса
+// ============================
+
+bool saveState(const QString &fileName, const SessionState &state)
+{
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+
+    QDataStream ds(&file);
+    prepare(ds);
+    ds << kStateMagic << kStateVersion
+       << state.source.fileName << state.source.size << state.source.modifiedMs
+       << state.paged << state.datasetId << qint32(state.sortMode) << state.filterText
+       << state.currentCity << state.overlayCities << qint32(state.currentTab) << state.chart;
+    return ds.status() == QDataStream::Ok && file.commit();
+}
+
+bool loadState(const QString &fileName, SessionState *state)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    QDataStream ds(&file);
+    prepare(ds);
+    quint32 magic = 0, version = 0;
+    ds >> magic >> version;
+    if (ds.status() != QDataStream::Ok || magic != kStateMagic || version != kStateVersion) return false;
+
+    SessionState st;
+    qint32 sortMode = 0, currentTab = 0;
+    ds >> st.source.fileName >> st.source.size >> st.source.modifiedMs
+       >> st.paged >> st.datasetId >> sortMode >> st.filterText
+       >> st.currentCity >> st.overlayCities >> currentTab >> st.chart;
+    if (ds.status() != QDataStream::Ok) return false;
+
+    st.sortMode = sortMode;
+    st.currentTab = currentTab;
+    *state = st;
+    return true;
+}
+
+} // namespace Session
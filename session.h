@@ -0,0 +1,68 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <QString>
+#include <QStringList>
+#include <QVariantMap>
+
+class RadiationModel;
+class StationRegistry;
+
+// Файл, из которого загружен набор: по размеру и времени изменения видно, что он поменялся
+struct SourceStamp {
+    QString fileName;
+    qint64 size = -1;          // -1 — файла нет
+    qint64 modifiedMs = 0;
+
+    static SourceStamp of(const QString &fileName);
+    bool isValid() const { return !fileName.isEmpty(); }
+    bool operator==(const SourceStamp &o) const
+    {
+        return fileName == o.fileName && size == o.size && modifiedMs == o.modifiedMs;
+    }
+    bool operator!=(const SourceStamp &o) const { return !(*this == o); }
+};
+
+// Состояние интерфейса на момент закрытия
+struct SessionState {
+    SourceStamp source;
+    bool paged = false;          // источник был открыт постранично: записи не кэшируются, файл открывается заново
+    quint64 datasetId = 0;       // файл набора, записанный вместе с этим состоянием (0 — нет)
+    int sortMode = 0;
+    QString filterText;
+    QString currentCity;
+    QStringList overlayCities;
+    int currentTab = 0;
+    QVariantMap chart;           // настройки вкладки графиков
+};
+
+// ============================
+// Кэш сеанса
+// ============================
+// Два файла в AppLocalDataLocation:
+//   session.rses  — записи набора как они лежат в памяти (PackedReading подряд, в текущем
+//                   порядке сортировки), затем столбцы показателей; перед ними заголовок
+//                   с таблицей станций. При старте файл отображается в память и копируется
+//                   в модель без разбора, так что время до готовой таблицы не зависит от
+//                   размера исходного JSON. Перезаписывается, только если данные менялись.
+//   session.state — небольшое состояние интерфейса, пишется при каждом закрытии.
+//
+//   u32 "RSES" | u32 версия | u8 little-endian | u64 id | станции | ключи показателей |
+//   u64 число записей | выравнивание до 8 | записи | столбцы показателей по 4 байта
+namespace Session {
+
+QString datasetPath();
+QString statePath();
+
+bool saveDataset(const QString &fileName, quint64 id, const RadiationModel &records,
+                 const StationRegistry &registry, QString *error);
+// Заменяет набор модели; false — файла нет, он повреждён или записан не для состояния id
+bool loadDataset(const QString &fileName, quint64 id, RadiationModel *records,
+                 StationRegistry *registry, QString *error);
+
+bool saveState(const QString &fileName, const SessionState &state);
+bool loadState(const QString &fileName, SessionState *state);
+
+} // namespace Session
+
+#endif
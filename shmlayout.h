@@ -0,0 +1,69 @@
+#ifndef SHMLAYOUT_H
+#define SHMLAYOUT_H
+
+// Без Qt: заголовок подключают и приложение, и сторонние читатели (shmreader.cpp)
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// ============================
+// Набор в общей памяти
+// ============================
+// Приложение публикует текущие записи в области POSIX shm (по умолчанию
+// /weatheranalyzer-readings, на Linux — файл /dev/shm/weatheranalyzer-readings).
+// Читатели открывают её только для чтения и работают со столбцами на месте.
+//
+//   [0, 128)            Header
+//   stationsOffset      таблица станций: stationCount записей { u16 длина; UTF-8 имя }, индекс — id станции
+//   stationColumn       u16[capacity] — id станции
+//   dayColumn           i32[capacity] — юлианский день
+//   radColumn           u16[capacity] — мкР/ч
+//
+// Все числа little-endian, смещения — от начала области, столбцы выровнены на 64 байта.
+// Действительны строки [0, count).
+//
+// Согласованность — seqlock: писатель делает sequence нечётным, пишет и делает
+// чётным. Читатель запоминает чётное sequence, читает, и если после чтения
+// sequence другое — повторяет. Новые строки дописываются в конец столбцов, так что
+// уже прочитанные [0, старый count) остаются верными, если dataVersion не сменился
+// скачком (сортировка и загрузка переписывают всё).
+//
+// Если набору не хватает места, область создаётся заново под тем же именем, а в
+// старой выставляется флаг kStale: читатель должен закрыть её и открыть имя снова.
+namespace ShmLayout {
+
+constexpr char kMagic[8] = {'R', 'A', 'D', 'S', 'H', 'M', '0', '1'};
+constexpr uint32_t kVersion = 1;
+constexpr const char *kDefaultName = "/weatheranalyzer-readings";
+
+constexpr uint32_t kStale = 1u << 0;   // область заменена новой — переоткрыть по имени
+
+struct Header {
+    char magic[8];
+    uint32_t layoutVersion;
+    uint32_t headerBytes;              // sizeof(Header)
+    std::atomic<uint64_t> sequence;    // seqlock: нечётное — идёт запись
+    uint64_t regionBytes;
+    uint64_t capacity;                 // строк в каждом столбце
+    uint64_t count;                    // опубликовано строк
+    uint64_t dataVersion;              // версия набора в приложении на момент публикации
+    uint64_t fullVersion;              // растёт при полной перезаписи (сортировка, загрузка)
+    uint64_t publishedNs;              // CLOCK_MONOTONIC в момент публикации
+    uint64_t stationsOffset;
+    uint64_t stationsCapacity;         // байт под таблицу станций
+    uint32_t stationCount;
+    uint32_t flags;
+    uint64_t stationColumn;
+    uint64_t dayColumn;
+    uint64_t radColumn;
+    uint8_t reserved[8];
+};
+static_assert(sizeof(Header) == 128, "ShmLayout::Header is part of the published format");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "sequence must be lock-free to live in shared memory");
+
+constexpr uint64_t alignUp(uint64_t v) { return (v + 63) / 64 * 64; }
+
+} // namespace ShmLayout
+
+#endif
@@ -0,0 +1,278 @@
+#include "shmpublish.h"
+#include "radiationmodel.h"
+#include "soak.h"
+#include "stationregistry.h"
+#include "tracing.h"
+#include <QDate>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QThread>
+#include <QVector>
+#include <QtEndian>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+using namespace Qt::StringLiterals;
+
+namespace {
+
+#ifdef Q_OS_UNIX
+quint64 monotonicNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return quint64(ts.tv_sec) * 1000000000ull + quint64(ts.tv_nsec);
+}
+#endif
+
+// Имена станций в формате таблицы: u16 длина + UTF-8
+QVector<QByteArray> encodeStations(const StationRegistry &registry, int from, quint64 *bytes)
+{
+    QVector<QByteArray> names;
+    *bytes = 0;
+    for (int s = from; s < registry.count(); ++s) {
+        names.append(registry.name(s).toUtf8().left(0xFFFF));
+        *bytes += 2 + quint64(names.last().size());
+    }
+    return names;
+}
+
+} // namespace
+
+ShmPublisher::ShmPublisher(const QString &name) : shmName(name)
+{
+}
+
+ShmPublisher::~ShmPublisher()
+{
+    close();
+}
+
+bool ShmPublisher::isSupported()
+{
+#ifdef Q_OS_UNIX
+    return true;
+#else
+    return false;
+#endif
+}
+
+void ShmPublisher::close()
+{
+    release(true);
+}
+
+void ShmPublisher::release(bool unlink)
+{
+#ifdef Q_OS_UNIX
+    if (base) {
+        // читатели, которые держат область открытой, узнают, что её больше не обновляют
+        ShmLayout::Header *h = header();
+        const quint64 s = h->sequence.load(std::memory_order_relaxed);
+        h->sequence.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        h->flags |= ShmLayout::kStale;
+        h->sequence.store(s + 2, std::memory_order_release);
+        munmap(base, size_t(bytes));
+    }
+    if (fd >= 0) ::close(fd);
+    if (unlink && base) shm_unlink(shmName.toLocal8Bit().constData());
+#else
+    Q_UNUSED(unlink);
+#endif
+    base = nullptr;
+    bytes = 0;
+    fd = -1;
+    publishedRows = 0;
+    publishedStations = 0;
+    stationBytesUsed = 0;
+}
+
+bool ShmPublisher::create(quint64 capacity, quint64 stationBytes, QString *error)
+{
+#ifdef Q_OS_UNIX
+    using namespace ShmLayout;
+    release(true);
+
+    const quint64 stationsOffset = alignUp(sizeof(Header));
+    const quint64 stationColumn = alignUp(stationsOffset + stationBytes);
+    const quint64 dayColumn = alignUp(stationColumn + 2 * capacity);
+    const quint64 radColumn = alignUp(dayColumn + 4 * capacity);
+    const quint64 total = alignUp(radColumn + 2 * capacity);
+
+    // прежний объект с тем же именем (например, после аварийного выхода) заменяется
+    const QByteArray name = shmName.toLocal8Bit();
+    shm_unlink(name.constData());
+    fd = shm_open(name.constData(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        if (error) *error = u"shm_open: "_s + QString::fromLocal8Bit(strerror(errno));
+        return false;
+    }
+    fchmod(fd, 0644);   // umask не должна закрыть область от читателей
+    if (ftruncate(fd, off_t(total)) != 0) {
+        if (error) *error = u"ftruncate: "_s + QString::fromLocal8Bit(strerror(errno));
+        ::close(fd);
+        fd = -1;
+        shm_unlink(name.constData());
+        return false;
+    }
+    void *p = mmap(nullptr, size_t(total), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        if (error) *error = u"mmap: "_s + QString::fromLocal8Bit(strerror(errno));
+        ::close(fd);
+        fd = -1;
+        shm_unlink(name.constData());
+        return false;
+    }
+    base = static_cast<uchar *>(p);
+    bytes = total;
+
+    // новый объект заполнен нулями: sequence = 0, count = 0
+    Header *h = header();
+    std::memcpy(h->magic, kMagic, sizeof(kMagic));
+    h->layoutVersion = kVersion;
+    h->headerBytes = sizeof(Header);
+    h->regionBytes = total;
+    h->capacity = capacity;
+    h->stationsOffset = stationsOffset;
+    h->stationsCapacity = stationBytes;
+    h->stationColumn = stationColumn;
+    h->dayColumn = dayColumn;
+    h->radColumn = radColumn;
+    return true;
+#else
+    Q_UNUSED(capacity);
+    Q_UNUSED(stationBytes);
+    if (error) *error = u"Общая память POSIX недоступна на этой платформе"_s;
+    return false;
+#endif
+}
+
+bool ShmPublisher::publish(const RadiationModel &records, const StationRegistry &registry, bool full, QString *error)
+{
+    TRACE_SCOPE("shm publish");
+    QElapsedTimer timer;
+    timer.start();
+#ifdef Q_OS_UNIX
+    const qint64 n = records.size();
+    bool rewrite = full || !base || n < publishedRows;
+    quint64 nameBytes = 0;
+    QVector<QByteArray> names = encodeStations(registry, rewrite ? 0 : publishedStations, &nameBytes);
+    quint64 stationNeed = (rewrite ? 0 : stationBytesUsed) + nameBytes;
+
+    // не хватает места — новая область с запасом, старая помечается kStale
+    if (!base || quint64(n) > header()->capacity || stationNeed > header()->stationsCapacity) {
+        if (!rewrite) {
+            names = encodeStations(registry, 0, &nameBytes);
+            stationNeed = nameBytes;
+            rewrite = true;
+        }
+        const quint64 capacity = std::max<quint64>(kMinCapacity, quint64(n) + quint64(n) / 2);
+        if (!create(capacity, std::max<quint64>(kMinStationBytes, stationNeed * 2), error)) return false;
+    }
+
+    ShmLayout::Header *h = header();
+    const quint64 seq = h->sequence.load(std::memory_order_relaxed);
+    h->sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    if (rewrite) {
+        publishedRows = 0;
+        publishedStations = 0;
+        stationBytesUsed = 0;
+        ++h->fullVersion;
+    }
+
+    uchar *table = base + h->stationsOffset + stationBytesUsed;
+    for (const QByteArray &name : std::as_const(names)) {
+        qToLittleEndian<quint16>(quint16(name.size()), table);
+        std::memcpy(table + 2, name.constData(), size_t(name.size()));
+        table += 2 + name.size();
+    }
+    stationBytesUsed += nameBytes;
+
+    auto *stationCol = reinterpret_cast<quint16 *>(base + h->stationColumn);
+    auto *dayCol = reinterpret_cast<qint32 *>(base + h->dayColumn);
+    auto *radCol = reinterpret_cast<quint16 *>(base + h->radColumn);
+    for (qint64 row = publishedRows; row < n; ++row) {
+        const PackedReading &r = records.at(row);
+        stationCol[row] = qToLittleEndian(r.station);
+        dayCol[row] = qToLittleEndian(r.day);
+        radCol[row] = qToLittleEndian(r.rad);
+    }
+
+    h->stationCount = quint32(registry.count());
+    h->count = quint64(n);
+    h->dataVersion = records.dataVersion();
+    h->publishedNs = monotonicNs();
+    h->sequence.store(seq + 2, std::memory_order_release);
+
+    publishedRows = n;
+    publishedStations = registry.count();
+    publishUs = timer.nsecsElapsed() / 1000;
+    return true;
+#else
+    Q_UNUSED(records);
+    Q_UNUSED(registry);
+    Q_UNUSED(full);
+    if (error) *error = u"Общая память POSIX недоступна на этой платформе"_s;
+    return false;
+#endif
+}
+
+// ============================
+// Консольный поставщик
+// ============================
+
+int ShmPublisher::runFeed(const QString &file, int ticks, int intervalMs, QTextStream &out)
+{
+    StationRegistry registry;
+    RadiationModel model(&registry);
+    QString error;
+    if (!file.isEmpty() && !SoakHarness::loadDataset(file, model, registry, &error)) {
+        out << "error: " << error << "\n";
+        return 1;
+    }
+    if (registry.count() == 0) registry.intern(u"Станция 0001"_s);
+
+    ShmPublisher publisher;
+    if (!publisher.publish(model, registry, true, &error)) {
+        out << "error: " << error << "\n";
+        return 1;
+    }
+    out << "published " << model.size() << " readings to " << publisher.name()
+        << " in " << publisher.lastPublishUs() / 1000.0 << " ms\n";
+    out.flush();
+
+    qint64 lastDay = 0;
+    for (const PackedReading &r : model.arena()) lastDay = std::max<qint64>(lastDay, r.day);
+    if (lastDay == 0) lastDay = QDate::currentDate().toJulianDay();
+
+    // по одной новой записи на тик: читатель видит её через publishedNs и sequence
+    QVector<qint64> us;
+    us.reserve(ticks);
+    for (int t = 0; t < ticks; ++t) {
+        QThread::msleep(ulong(intervalMs));
+        const int station = t % registry.count();
+        model.append(station, lastDay + 1 + t / registry.count(), 10 + (t * 7) % 40);
+        if (!publisher.publish(model, registry, false, &error)) {
+            out << "error: " << error << "\n";
+            return 1;
+        }
+        us.append(publisher.lastPublishUs());
+    }
+
+    if (!us.isEmpty()) {
+        std::sort(us.begin(), us.end());
+        out << ticks << " appends: publish median " << us[us.size() / 2] << " us, max " << us.last() << " us\n";
+    }
+    return 0;
+}
@@ -0,0 +1,58 @@
+#ifndef SHMPUBLISH_H
+#define SHMPUBLISH_H
+
+#include <QString>
+#include "shmlayout.h"
+
+class QTextStream;
+class RadiationModel;
+class StationRegistry;
+
+// ============================
+// Публикация набора в общую память
+// ============================
+// Пишет записи RadiationModel в область POSIX shm по формату ShmLayout, чтобы
+// соседние процессы (демон оповещений, ноутбук Python) читали те же показания
+// без разбора JSON. Добавленные записи дописываются в хвост столбцов, сброс
+// модели (загрузка, сортировка) переписывает область целиком. Только Unix; на
+// прочих платформах publish возвращает ошибку.
+class ShmPublisher
+{
+public:
+    static constexpr quint64 kMinCapacity = 1 << 16;          // строк при создании области
+    static constexpr quint64 kMinStationBytes = 64 * 1024;
+
+    explicit ShmPublisher(const QString &name = QString::fromLatin1(ShmLayout::kDefaultName));
+    ~ShmPublisher();   // область удаляется, у открытых читателей остаётся с флагом kStale
+
+    static bool isSupported();
+
+    // full — записи переставлены или заменены; иначе дописываются строки после последней публикации
+    bool publish(const RadiationModel &records, const StationRegistry &registry, bool full, QString *error);
+    void close();
+
+    QString name() const { return shmName; }
+    bool isOpen() const { return base != nullptr; }
+    qint64 lastPublishUs() const { return publishUs; }
+
+    // Консольный поставщик: публикует набор file и дописывает по записи каждые intervalMs,
+    // ticks раз — нагрузка для замера задержки читателем (shmreader --latency)
+    static int runFeed(const QString &file, int ticks, int intervalMs, QTextStream &out);
+
+private:
+    bool create(quint64 capacity, quint64 stationBytes, QString *error);
+    void release(bool unlink);
+    ShmLayout::Header *header() const { return reinterpret_cast<ShmLayout::Header *>(base); }
+
+    QString shmName;
+    uchar *base = nullptr;
+    quint64 bytes = 0;
+    int fd = -1;
+
+    qint64 publishedRows = 0;
+    int publishedStations = 0;
+    quint64 stationBytesUsed = 0;
+    qint64 publishUs = 0;
+};
+
+#endif
@@ -0,0 +1,209 @@
+// Пример читателя набора, опубликованного в общей памяти (см. shmlayout.h).
+// Без Qt, только POSIX: столбцы читаются на месте, без копирования и разбора.
+//
+//   shmreader                  сводка: число записей, станции, средняя радиация
+//   shmreader --latency 100    ждёт 100 публикаций и печатает задержку от публикации до чтения
+//   shmreader --name /other    другое имя области
+
+#include "shmlayout.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+
+uint64_t monotonicNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000ull + uint64_t(ts.tv_nsec);
+}
+
+// Область только для чтения; после kStale открывается заново
+class Region
+{
+public:
+    ~Region() { close(); }
+
+    bool open(const char *name)
+    {
+        close();
+        const int fd = shm_open(name, O_RDONLY, 0);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(ShmLayout::Header)) {
+            ::close(fd);
+            return false;
+        }
+        void *p = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);   // отображение остаётся действительным
+        if (p == MAP_FAILED) return false;
+        base = static_cast<const uint8_t *>(p);
+        bytes = size_t(st.st_size);
+
+        const ShmLayout::Header *h = header();
+        if (std::memcmp(h->magic, ShmLayout::kMagic, sizeof(ShmLayout::kMagic)) != 0
+            || h->layoutVersion != ShmLayout::kVersion || h->regionBytes != bytes) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+        if (base) munmap(const_cast<uint8_t *>(base), bytes);
+        base = nullptr;
+        bytes = 0;
+    }
+
+    const ShmLayout::Header *header() const { return reinterpret_cast<const ShmLayout::Header *>(base); }
+    const uint16_t *stations() const { return reinterpret_cast<const uint16_t *>(base + header()->stationColumn); }
+    const int32_t *days() const { return reinterpret_cast<const int32_t *>(base + header()->dayColumn); }
+    const uint16_t *rads() const { return reinterpret_cast<const uint16_t *>(base + header()->radColumn); }
+
+    // Имя станции id из таблицы (линейный проход — для примера достаточно)
+    std::string stationName(uint32_t id) const
+    {
+        const uint8_t *p = base + header()->stationsOffset;
+        for (uint32_t i = 0; i < header()->stationCount; ++i) {
+            uint16_t len;
+            std::memcpy(&len, p, 2);
+            if (i == id) return std::string(reinterpret_cast<const char *>(p + 2), len);
+            p += 2 + len;
+        }
+        return std::string();
+    }
+
+    // fn() под seqlock: повторяется, пока во время чтения шла запись. false — область заменена
+    template <typename Fn>
+    bool read(Fn fn) const
+    {
+        const ShmLayout::Header *h = header();
+        for (;;) {
+            const uint64_t s1 = h->sequence.load(std::memory_order_acquire);
+            if (s1 & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+            if (h->flags & ShmLayout::kStale) return false;
+            fn(*h);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (h->sequence.load(std::memory_order_relaxed) == s1) return true;
+        }
+    }
+
+private:
+    const uint8_t *base = nullptr;
+    size_t bytes = 0;
+};
+
+int summary(Region &region)
+{
+    uint64_t count = 0, version = 0;
+    double sum = 0.0;
+    uint16_t maxRad = 0;
+    uint64_t maxRow = 0;
+    if (!region.read([&](const ShmLayout::Header &h) {
+            count = h.count;
+            version = h.dataVersion;
+            sum = 0.0;
+            maxRad = 0;
+            maxRow = 0;
+            const uint16_t *rad = region.rads();
+            for (uint64_t i = 0; i < count; ++i) {
+                sum += rad[i];
+                if (rad[i] > maxRad) { maxRad = rad[i]; maxRow = i; }
+            }
+        })) {
+        std::fprintf(stderr, "region was replaced, run again\n");
+        return 1;
+    }
+    std::printf("readings: %llu, stations: %u, data version: %llu\n",
+                (unsigned long long)count, region.header()->stationCount, (unsigned long long)version);
+    if (count > 0)
+        std::printf("mean radiation: %.2f, max %u at %s (JD %d)\n", sum / double(count), maxRad,
+                    region.stationName(region.stations()[maxRow]).c_str(), region.days()[maxRow]);
+    return 0;
+}
+
+// Ждёт samples новых публикаций; задержка — от publishedNs писателя до момента, когда читатель увидел запись
+int latency(Region &region, const char *name, int samples)
+{
+    std::vector<double> us;
+    uint64_t lastSeq = region.header()->sequence.load(std::memory_order_acquire);
+    while (int(us.size()) < samples) {
+        const uint64_t seq = region.header()->sequence.load(std::memory_order_acquire);
+        if (seq == lastSeq || (seq & 1)) {
+            std::this_thread::yield();
+            continue;
+        }
+        uint64_t publishedNs = 0, count = 0;
+        int32_t lastDay = 0;
+        const bool ok = region.read([&](const ShmLayout::Header &h) {
+            publishedNs = h.publishedNs;
+            count = h.count;
+            lastDay = count ? region.days()[count - 1] : 0;
+        });
+        const uint64_t seen = monotonicNs();
+        if (!ok) {
+            // писатель пересоздал область (набор вырос) — переоткрыть и продолжить
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            if (!region.open(name)) {
+                std::fprintf(stderr, "region closed after %zu samples\n", us.size());
+                break;
+            }
+            lastSeq = region.header()->sequence.load(std::memory_order_acquire);
+            continue;
+        }
+        lastSeq = region.header()->sequence.load(std::memory_order_acquire);
+        us.push_back(double(seen - publishedNs) / 1000.0);
+        std::printf("seq %llu: %llu readings, last JD %d, latency %.1f us\n", (unsigned long long)lastSeq,
+                    (unsigned long long)count, lastDay, us.back());
+    }
+    if (us.empty()) return 1;
+
+    std::sort(us.begin(), us.end());
+    std::printf("latency over %zu publications: median %.1f us, p99 %.1f us, max %.1f us\n", us.size(),
+                us[us.size() / 2], us[std::min(us.size() - 1, us.size() * 99 / 100)], us.back());
+    return us.back() < 10000.0 ? 0 : 2;   // новые записи должны быть видны за миллисекунды
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const char *name = ShmLayout::kDefaultName;
+    int samples = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--name") && i + 1 < argc) name = argv[++i];
+        else if (!std::strcmp(argv[i], "--latency") && i + 1 < argc) samples = std::max(1, std::atoi(argv[++i]));
+        else {
+            std::fprintf(stderr, "usage: %s [--name /region] [--latency n]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // в режиме задержки поставщик может ещё загружать набор — область ждём до 60 с
+    Region region;
+    bool opened = region.open(name);
+    for (int i = 0; !opened && samples > 0 && i < 6000; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        opened = region.open(name);
+    }
+    if (!opened) {
+        std::fprintf(stderr, "cannot open shared memory %s (is publication enabled?)\n", name);
+        return 1;
+    }
+    return samples > 0 ? latency(region, name, samples) : summary(region);
+}
@@ -0,0 +1,178 @@
+#include "soak.h"
+#include "radiationmodel.h"
+#include "stationregistry.h"
+#include "resultcache.h"
+#include "tracing.h"
+#include "archive.h"
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QPointF>
+#include <QDateTime>
+#include <algorithm>
+#include <numeric>
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+using namespace Qt::StringLiterals;
+
+qint64 SoakHarness::residentBytes()
+{
+#ifdef Q_OS_LINUX
+    QFile statm(u"/proc/self/statm"_s);
+    if (!statm.open(QIODevice::ReadOnly)) return -1;
+    const QList<QByteArray> fields = statm.readAll().simplified().split(' ');
+    if (fields.size() < 2) return -1;
+    return fields[1].toLongLong() * sysconf(_SC_PAGESIZE);
+#else
+    return -1;
+#endif
+}
+
+bool SoakHarness::loadDataset(const QString &file, RadiationModel &model, StationRegistry &registry, QString *error)
+{
+    if (Archive::isArchiveFile(file)) {
+        Archive::Reader reader;
+        return reader.open(file, error) && reader.loadInto(model, registry, error);
+    }
+
+    QFile in(file);
+    if (!in.open(QIODevice::ReadOnly)) {
+        if (error) *error = in.errorString();
+        return false;
+    }
+    const QJsonDocument doc = QJsonDocument::fromJson(in.readAll());
+    if (!doc.isArray()) {
+        if (error) *error = u"expected a JSON array"_s;
+        return false;
+    }
+    model.loadJson(doc.array(), true);
+    return true;
+}
+
+static qint64 median(QVector<qint64> v)
+{
+    if (v.isEmpty()) return 0;
+    std::nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+    return v[v.size() / 2];
+}
+
+int SoakHarness::run(const SoakOptions &options, QTextStream &out)
+{
+    StationRegistry registry;
+    RadiationModel model(&registry);
+    ResultCache cache(&model);
+
+    out << "cycle,records,load_ms,sort_ms,analyze_ms,chart_ms,arena_mb,rss_mb\n";
+
+    QVector<SoakCycle> cycles;
+    for (int c = 1; c <= options.cycles; ++c) {
+        SoakCycle cycle;
+        cycle.cycle = c;
+        QElapsedTimer timer;
+
+        // ===== загрузка: как loadFromJson, без диалогов =====
+        timer.start();
+        {
+            TRACE_SCOPE("soak load");
+            QString error;
+            if (!loadDataset(options.file, model, registry, &error)) {
+                out << "error: " << error << "\n";
+                return 1;
+            }
+        }
+        cycle.loadUs = timer.nsecsElapsed() / 1000;
+
+        // ===== сортировка: по городу, затем по дате =====
+        timer.restart();
+        {
+            TRACE_SCOPE("soak sort");
+            model.sortRecords([&registry](const PackedReading &a, const PackedReading &b) {
+                return registry.collationRank(a.station) < registry.collationRank(b.station);
+            });
+            model.sortRecords([](const PackedReading &a, const PackedReading &b) { return a.day < b.day; });
+        }
+        cycle.sortUs = timer.nsecsElapsed() / 1000;
+
+        // ===== анализ: сводка по каждой станции и по всем сразу =====
+        timer.restart();
+        {
+            TRACE_SCOPE("soak analyze");
+            QVector<int> all(registry.count());
+            std::iota(all.begin(), all.end(), 0);
+            for (int id : all) cache.station(id);
+            cache.query(all);
+        }
+        cycle.analyzeUs = timer.nsecsElapsed() / 1000;
+
+        // ===== подготовка графика: точки выбранных станций, отсортированные по времени =====
+        timer.restart();
+        {
+            TRACE_SCOPE("soak chart");
+            QHash<int, QVector<QPointF>> series;
+            for (int id = 0; id < std::min(options.chartStations, registry.count()); ++id)
+                series.insert(id, {});
+            for (const PackedReading &r : model.arena()) {
+                auto it = series.find(r.station);
+                if (it == series.end()) continue;
+                it->append(QPointF(double(QDateTime(QDate::fromJulianDay(r.day), QTime(0, 0)).toMSecsSinceEpoch()), r.rad));
+            }
+            for (auto &pts : series)
+                std::sort(pts.begin(), pts.end(), [](const QPointF &a, const QPointF &b) { return a.x() < b.x(); });
+        }
+        cycle.chartUs = timer.nsecsElapsed() / 1000;
+
+        cycle.records = model.size();
+        cycle.arenaBytes = model.bytesUsed();
+        cycle.rssBytes = residentBytes();
+        cycles.append(cycle);
+
+        out << c << ',' << cycle.records << ','
+            << cycle.loadUs / 1000.0 << ',' << cycle.sortUs / 1000.0 << ','
+            << cycle.analyzeUs / 1000.0 << ',' << cycle.chartUs / 1000.0 << ','
+            << cycle.arenaBytes / 1048576.0 << ',' << (cycle.rssBytes >= 0 ? cycle.rssBytes / 1048576.0 : -1.0) << "\n";
+        out.flush();
+    }
+
+    // ===== сводка =====
+    auto column = [&cycles](qint64 SoakCycle::*field) {
+        QVector<qint64> v;
+        for (const SoakCycle &c : cycles) v.append(c.*field);
+        return v;
+    };
+    auto report = [&](const char *name, qint64 SoakCycle::*field) {
+        const QVector<qint64> v = column(field);
+        out << name << ": median " << median(v) / 1000.0 << " ms, max "
+            << *std::max_element(v.begin(), v.end()) / 1000.0 << " ms\n";
+    };
+    out << "\n";
+    report("load", &SoakCycle::loadUs);
+    report("sort", &SoakCycle::sortUs);
+    report("analyze", &SoakCycle::analyzeUs);
+    report("chart", &SoakCycle::chartUs);
+
+    // наклон RSS по циклам (МНК), первый цикл — прогревочный
+    double drift = 0.0;
+    if (cycles.size() >= 3 && cycles.last().rssBytes >= 0) {
+        double sx = 0, sy = 0, sxx = 0, sxy = 0;
+        const int n = int(cycles.size()) - 1;
+        for (int i = 1; i < cycles.size(); ++i) {
+            const double x = i, y = cycles[i].rssBytes / 1048576.0;
+            sx += x; sy += y; sxx += x * x; sxy += x * y;
+        }
+        drift = (n * sxy - sx * sy) / (n * sxx - sx * sx);
+        out << "rss drift: " << drift << " MB/cycle\n";
+    } else {
+        out << "rss drift: n/a\n";
+    }
+
+    if (drift > options.maxDriftMbPerCycle) {
+        out << "FAIL: memory drift above " << options.maxDriftMbPerCycle << " MB/cycle\n";
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,48 @@
+#ifndef SOAK_H
+#define SOAK_H
+
+#include <QString>
+#include <QVector>
+
+class QTextStream;
+class RadiationModel;
+class StationRegistry;
+
+struct SoakOptions {
+    QString file;                 // набор в формате saveToJson
+    int cycles = 20;
+    int chartStations = 24;       // столько станций «рисуется» в каждом цикле
+    double maxDriftMbPerCycle = 1.0;
+};
+
+// Замеры одного цикла
+struct SoakCycle {
+    int cycle = 0;
+    qint64 loadUs = 0;
+    qint64 sortUs = 0;
+    qint64 analyzeUs = 0;
+    qint64 chartUs = 0;
+    qint64 records = 0;
+    qint64 arenaBytes = 0;
+    qint64 rssBytes = -1;         // -1, если платформа не сообщает
+};
+
+// ============================
+// Нагрузочный прогон
+// ============================
+// Без окна гоняет цикл загрузка → сортировка → анализ → подготовка графика на
+// тех же классах, что и интерфейс, и печатает CSV по циклам и сводку: медиану и
+// максимум задержек, дрейф памяти (наклон RSS по циклам после прогревочного).
+class SoakHarness
+{
+public:
+    // Код возврата для main(): 0 — успех, 1 — ошибка загрузки, 2 — дрейф памяти выше порога
+    static int run(const SoakOptions &options, QTextStream &out);
+
+    static qint64 residentBytes();
+
+    // Загрузка набора (JSON или архив .rada) с заменой записей модели — как loadFromJson, без диалогов
+    static bool loadDataset(const QString &file, RadiationModel &model, StationRegistry &registry, QString *error);
+};
+
+#endif
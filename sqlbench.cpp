@@ -0,0 +1,226 @@
+#include "sqlbench.h"
+#include "datagen.h"
+#include "filterexpr.h"
+#include "radiationmodel.h"
+#include "resultcache.h"
+#include "soak.h"
+#include "sqlstore.h"
+#include "stationregistry.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QTextStream>
+#include <numeric>
+
+using namespace Qt::StringLiterals;
+
+namespace {
+
+// Генератор пишет прямо в модель, как bulkAppend при загрузке файла
+class ModelReadingWriter : public ReadingWriter
+{
+public:
+    ModelReadingWriter(RadiationModel *model, StationRegistry *registry, qint64 expected)
+        : model(model), registry(registry), expected(expected) {}
+
+    bool begin(const QVector<GeneratedStation> &stations, QString *) override
+    {
+        registry->beginUpdate();
+        ids.clear();
+        for (const GeneratedStation &st : stations) {
+            ids.append(registry->intern(st.name));
+            registry->setCoord(ids.last(), st.pos);
+        }
+        model->beginBulkLoad(true, qsizetype(expected));
+        return true;
+    }
+    bool write(int station, qint64 day, int rad) override { return model->bulkAppend(ids[station], day, rad); }
+    bool finish(QString *) override
+    {
+        model->endBulkLoad();
+        registry->endUpdate();
+        return true;
+    }
+
+private:
+    RadiationModel *model;
+    StationRegistry *registry;
+    qint64 expected;
+    QVector<int> ids;
+};
+
+struct BenchRow {
+    qint64 loadUs = 0, statsUs = 0, stationUs = 0, filterUs = 0, sortUs = 0;
+    qint64 matches = 0;
+    qint64 rssBytes = -1;
+};
+
+void printRow(QTextStream &out, const char *backend, qint64 n, const BenchRow &r)
+{
+    out << backend << ',' << n << ','
+        << r.loadUs / 1000.0 << ',' << r.statsUs / 1000.0 << ',' << r.stationUs / 1000.0 << ','
+        << r.filterUs / 1000.0 << ',' << r.sortUs / 1000.0 << ',' << r.matches << ','
+        << (r.rssBytes >= 0 ? r.rssBytes / 1048576.0 : -1.0) << "\n";
+    out.flush();
+}
+
+void removeDatabase(const QString &file)
+{
+    QFile::remove(file);
+    QFile::remove(file + u"-wal"_s);
+    QFile::remove(file + u"-shm"_s);
+}
+
+GeneratorOptions generatorFor(qint64 n, int stations)
+{
+    GeneratorOptions opts;
+    opts.stations = stations;
+    opts.days = int(std::max<qint64>(1, n / stations));
+    return opts;
+}
+
+// Один прогон хранилища в отдельном процессе: RSS не несёт память предыдущего прогона
+bool runChild(const SqlBenchOptions &options, qint64 n, const QString &backend, QTextStream &out)
+{
+    QStringList args = {u"--benchmark-sqlite"_s, options.file, u"--sizes"_s, QString::number(n),
+                        u"--stations"_s, QString::number(options.stations), u"--backend"_s, backend};
+    if (options.keepFiles) args.append(u"--keep"_s);
+    QProcess child;
+    child.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    child.start(QCoreApplication::applicationFilePath(), args);
+    if (!child.waitForFinished(-1) || child.exitStatus() != QProcess::NormalExit) {
+        out << "error: " << backend << " run failed: " << child.errorString() << "\n";
+        return false;
+    }
+    out << QString::fromUtf8(child.readAllStandardOutput());
+    out.flush();
+    return child.exitCode() == 0;
+}
+
+} // namespace
+
+int SqlBenchmark::run(const SqlBenchOptions &options, QTextStream &out)
+{
+    if (options.backend.isEmpty()) {
+        out << "backend,records,load_ms,stats_ms,station_ms,filter_ms,sort_ms,matches,rss_mb\n";
+        for (qint64 n : options.sizes)
+            for (const QString &backend : {u"memory"_s, u"sqlite"_s})
+                if (!runChild(options, n, backend, out)) return 1;
+        return 0;
+    }
+
+    const QFileInfo base(options.file);
+    const bool memory = options.backend == "memory"_L1;
+    if (!memory && options.backend != "sqlite"_L1) {
+        out << "error: unknown --backend " << options.backend << "\n";
+        return 1;
+    }
+    for (qint64 n : options.sizes) {
+        const GeneratorOptions gen = generatorFor(n, options.stations);
+        const qint64 total = gen.totalRecords();
+        QString error;
+        QElapsedTimer timer;
+
+        // ===== в памяти =====
+        if (memory) {
+            StationRegistry registry;
+            RadiationModel model(&registry);
+            ResultCache cache(&model);
+            BenchRow row;
+
+            timer.start();
+            SyntheticGenerator generator(gen);
+            ModelReadingWriter writer(&model, &registry, total);
+            if (!generator.run(writer, &error)) {
+                out << "error: " << error << "\n";
+                return 1;
+            }
+            row.loadUs = timer.nsecsElapsed() / 1000;
+
+            QVector<int> all(registry.count());
+            std::iota(all.begin(), all.end(), 0);
+            timer.restart();
+            cache.query(all);
+            row.statsUs = timer.nsecsElapsed() / 1000;
+
+            timer.restart();
+            cache.station(0);
+            row.stationUs = timer.nsecsElapsed() / 1000;
+
+            FilterExpression expr;
+            const QString text = u"city = \"%1\" and radiation > 15"_s.arg(registry.name(0));
+            if (!FilterExpression::compile(text, registry, &expr, &error)) {
+                out << "error: " << error << "\n";
+                return 1;
+            }
+            timer.restart();
+            row.matches = expr.select(model.arena(), 0, model.size()).size();
+            row.filterUs = timer.nsecsElapsed() / 1000;
+
+            timer.restart();
+            model.sortRecords([](const PackedReading &a, const PackedReading &b) { return a.rad > b.rad; });
+            row.sortUs = timer.nsecsElapsed() / 1000;
+
+            row.rssBytes = SoakHarness::residentBytes();
+            printRow(out, "memory", total, row);
+            continue;
+        }
+
+        // ===== SQLite =====
+        const QString file = base.path() + u'/' + base.completeBaseName() + u"-%1.sqlite"_s.arg(n);
+        removeDatabase(file);
+        {
+            StationRegistry registry;
+            SqlStore store(&registry);
+            BenchRow row;
+
+            timer.start();
+            SyntheticGenerator generator(gen);
+            SqlReadingWriter writer(&store, file);
+            if (!generator.run(writer, &error)) {
+                out << "error: " << error << "\n";
+                return 1;
+            }
+            row.loadUs = timer.nsecsElapsed() / 1000;
+
+            if (!store.open(file, &error)) {
+                out << "error: " << error << "\n";
+                return 1;
+            }
+            timer.restart();
+            store.stats({});
+            row.statsUs = timer.nsecsElapsed() / 1000;
+
+            timer.restart();
+            store.stats({0});
+            row.stationUs = timer.nsecsElapsed() / 1000;
+
+            FilterExpression expr;
+            const QString text = u"city = \"%1\" and radiation > 15"_s.arg(registry.name(0));
+            if (!FilterExpression::compile(text, registry, &expr, &error)) {
+                out << "error: " << error << "\n";
+                return 1;
+            }
+            timer.restart();
+            row.matches = store.count(store.whereFor(expr));
+            row.filterUs = timer.nsecsElapsed() / 1000;
+
+            // сортировка в SQLite — индекс по rad и первая страница таблицы
+            timer.restart();
+            if (!store.ensureIndex(SqlStore::Order::RadDesc, &error)) {
+                out << "error: " << error << "\n";
+                return 1;
+            }
+            store.rows(SqlStore::Order::RadDesc, -1, QString(), nullptr, SqlRecordsModel::kPageRows, nullptr);
+            row.sortUs = timer.nsecsElapsed() / 1000;
+
+            row.rssBytes = SoakHarness::residentBytes();
+            printRow(out, "sqlite", total, row);
+            store.close();
+        }
+        if (!options.keepFiles) removeDatabase(file);
+    }
+    return 0;
+}
@@ -0,0 +1,34 @@
+#ifndef SQLBENCH_H
+#define SQLBENCH_H
+
+#include <QString>
+#include <QVector>
+
+class QTextStream;
+
+struct SqlBenchOptions {
+    QString file;                                            // база; для каждого размера — file-<n>.sqlite
+    QVector<qint64> sizes{1000000, 10000000, 100000000};     // число показаний
+    int stations = 500;
+    bool keepFiles = false;                                  // не удалять базы после прогона
+    QString backend;                                         // memory или sqlite — один прогон в этом процессе
+};
+
+// ============================
+// Сравнение хранилищ
+// ============================
+// Для каждого размера генерирует один и тот же синтетический набор в память
+// (RadiationModel) и в SQLite (SqlStore) и замеряет одинаковые операции:
+// загрузку, сводку по всем станциям и по одной, фильтр «город и порог» и
+// сортировку по радиации до первой страницы таблицы. Печатает CSV по строке
+// на размер и хранилище. Каждое хранилище каждого размера замеряется в своём
+// процессе (тот же исполняемый файл с --backend), поэтому rss_mb — память именно
+// этого прогона, а не остаток предыдущего.
+class SqlBenchmark
+{
+public:
+    // 0 — успех, 1 — ошибка генерации или SQLite
+    static int run(const SqlBenchOptions &options, QTextStream &out);
+};
+
+#endif
@@ -0,0 +1,830 @@
+#include "sqlstore.h"
+#include "filterexpr.h"
+#include "stationregistry.h"
+#include "tracing.h"
+#include <QAtomicInteger>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QVariant>
+#include <algorithm>
+#include <limits>
+
+using namespace Qt::StringLiterals;
+
+namespace {
+
+QAtomicInteger<int> connectionCounter;
+
+QString sqlError(const QSqlError &e)
+{
+    return e.text().isEmpty() ? u"Ошибка SQLite"_s : e.text();
+}
+
+// ORDER BY окна и условие «после ключа» в тех же столбцах: оба идут по одному индексу.
+// rowid в конце делает ключ однозначным; убывающие порядки проходят индекс в обратную
+// сторону целиком, поэтому равные в них — от поздних записей к ранним
+QString windowOrder(SqlStore::Order order, int station, QString *after)
+{
+    if (station >= 0) {
+        *after = u"(day, rad, rowid) > (?, ?, ?)"_s;   // порядок индекса (station, day, rad)
+        return u" ORDER BY day, rad, rowid"_s;
+    }
+    switch (order) {
+    case SqlStore::Order::DayAsc:
+        *after = u"(day, rowid) > (?, ?)"_s;
+        return u" ORDER BY day, rowid"_s;
+    case SqlStore::Order::DayDesc:
+        *after = u"(day, rowid) < (?, ?)"_s;
+        return u" ORDER BY day DESC, rowid DESC"_s;
+    case SqlStore::Order::RadDesc:
+        *after = u"(rad, rowid) < (?, ?)"_s;
+        return u" ORDER BY rad DESC, rowid DESC"_s;
+    case SqlStore::Order::RadAsc:
+        *after = u"(rad, rowid) > (?, ?)"_s;
+        return u" ORDER BY rad, rowid"_s;
+    default:
+        *after = u"rowid > ?"_s;
+        return u" ORDER BY rowid"_s;
+    }
+}
+
+// Параметры условия windowOrder в том же порядке столбцов
+void bindAfter(QSqlQuery &q, SqlStore::Order order, int station, const SqlStore::RowKey &key)
+{
+    if (station >= 0) {
+        q.addBindValue(key.day);
+        q.addBindValue(key.rad);
+    } else if (order == SqlStore::Order::DayAsc || order == SqlStore::Order::DayDesc) {
+        q.addBindValue(key.day);
+    } else if (order == SqlStore::Order::RadAsc || order == SqlStore::Order::RadDesc) {
+        q.addBindValue(key.rad);
+    }
+    q.addBindValue(key.rowid);
+}
+
+QString whereSql(const QHash<int, int> &registryToDb, const QVector<int> &stations, const QString &where,
+                 qint64 fromDay, qint64 toDay)
+{
+    QStringList parts;
+    if (!stations.isEmpty()) {
+        QStringList ids;
+        for (int s : stations) {
+            const auto it = registryToDb.constFind(s);
+            if (it != registryToDb.cend()) ids.append(QString::number(*it));
+        }
+        parts.append(ids.isEmpty() ? u"0"_s : u"station IN (%1)"_s.arg(ids.join(u',')));
+    }
+    if (fromDay > -ResultCache::kAllDays) parts.append(u"day >= %1"_s.arg(fromDay));
+    if (toDay < ResultCache::kAllDays) parts.append(u"day <= %1"_s.arg(toDay));
+    if (!where.isEmpty()) parts.append(u"(%1)"_s.arg(where));
+    return parts.isEmpty() ? QString() : u" WHERE "_s + parts.join(u" AND "_s);
+}
+
+// Столбцы station, day, rad → запись с id реестра
+PackedReading readingOf(const QSqlQuery &q, const QVector<int> &dbToRegistry)
+{
+    const int dbStation = q.value(0).toInt();
+    const int regId = dbStation >= 0 && dbStation < dbToRegistry.size() ? dbToRegistry[dbStation] : -1;
+    return PackedReading{ quint16(std::max(regId, 0)),
+                          quint16(std::clamp(q.value(2).toInt(), 0, RadiationModel::kMaxRadiation)),
+                          qint32(q.value(1).toLongLong()) };
+}
+
+} // namespace
+
+// ============================
+// SqlStore
+// ============================
+
+SqlStore::SqlStore(StationRegistry *registry)
+    : registry(registry), connection(u"sqlstore-%1"_s.arg(connectionCounter.fetchAndAddRelaxed(1)))
+{
+}
+
+SqlStore::~SqlStore()
+{
+    close();
+}
+
+QSqlDatabase SqlStore::database() const
+{
+    return QSqlDatabase::database(connection, false);
+}
+
+bool SqlStore::exec(const QString &sql, QString *err)
+{
+    QSqlQuery q(database());
+    if (q.exec(sql)) return true;
+    error = sqlError(q.lastError());
+    if (err) *err = error;
+    return false;
+}
+
+bool SqlStore::open(const QString &fileName, QString *err)
+{
+    TRACE_SCOPE("sqlite open");
+    close();
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase(u"QSQLITE"_s, connection);
+        db.setDatabaseName(fileName);
+        if (!db.open()) {
+            error = sqlError(db.lastError());
+            if (err) *err = error;
+            db = QSqlDatabase();
+            QSqlDatabase::removeDatabase(connection);
+            return false;
+        }
+    }
+    opened = true;
+    path = fileName;
+
+    // WAL и отображение файла в память: чтение окон таблицы не копирует страницы через read()
+    const bool ok = exec(u"PRAGMA journal_mode=WAL"_s, err)
+                    && exec(u"PRAGMA synchronous=NORMAL"_s, err)
+                    && exec(u"PRAGMA temp_store=MEMORY"_s, err)
+                    && exec(u"PRAGMA cache_size=-65536"_s, err)
+                    && exec(u"PRAGMA mmap_size=1073741824"_s, err)
+                    && exec(u"CREATE TABLE IF NOT EXISTS stations (id INTEGER PRIMARY KEY, name TEXT NOT NULL UNIQUE,"
+                            " lat REAL, lon REAL)"_s, err)
+                    && exec(u"CREATE TABLE IF NOT EXISTS readings (station INTEGER NOT NULL, day INTEGER NOT NULL,"
+                            " rad INTEGER NOT NULL)"_s, err)
+                    && exec(u"CREATE INDEX IF NOT EXISTS readings_station_day ON readings(station, day, rad)"_s, err);
+    if (!ok) {
+        close();
+        return false;
+    }
+
+    // станции базы → реестр
+    dbToRegistry.clear();
+    registryToDb.clear();
+    QSqlQuery q(database());
+    q.setForwardOnly(true);
+    if (!q.exec(u"SELECT id, name, lat, lon FROM stations"_s)) {
+        error = sqlError(q.lastError());
+        if (err) *err = error;
+        close();
+        return false;
+    }
+    registry->beginUpdate();
+    while (q.next()) {
+        const int dbId = q.value(0).toInt();
+        const int regId = registry->intern(q.value(1).toString());
+        if (!q.value(2).isNull() && !q.value(3).isNull())
+            registry->setCoord(regId, Coord{q.value(2).toDouble(), q.value(3).toDouble()});
+        if (dbId >= dbToRegistry.size()) dbToRegistry.resize(dbId + 1, -1);
+        dbToRegistry[dbId] = regId;
+        registryToDb.insert(regId, dbId);
+    }
+    registry->endUpdate();
+    return true;
+}
+
+void SqlStore::close()
+{
+    if (importing) abortImport();   // незавершённый импорт (сбой генератора) не оставляет следов
+    insertQuery.reset();
+    stationQuery.reset();
+    if (QSqlDatabase::contains(connection)) {
+        {
+            QSqlDatabase db = database();
+            if (db.isOpen()) db.close();
+        }
+        QSqlDatabase::removeDatabase(connection);
+    }
+    opened = false;
+    path.clear();
+    dbToRegistry.clear();
+    registryToDb.clear();
+}
+
+// ============================
+// Массовая вставка
+// ============================
+
+bool SqlStore::beginImport(bool replace, QString *err)
+{
+    if (!opened) {
+        if (err) *err = u"База не открыта"_s;
+        return false;
+    }
+    // записи идут в промежуточную таблицу без индексов — её дешевле наполнять, а readings
+    // не меняется до endImport: сбой посередине импорта оставляет базу прежней
+    importing = true;
+    replacing = replace;
+    if (!exec(u"DROP TABLE IF EXISTS readings_import"_s, err)
+        || !exec(u"CREATE TABLE readings_import (station INTEGER NOT NULL, day INTEGER NOT NULL,"
+                 " rad INTEGER NOT NULL)"_s, err)
+        || !exec(u"PRAGMA synchronous=OFF"_s, err)
+        || !prepareInserts(u"readings_import"_s, err)) {
+        abortImport();
+        return false;
+    }
+    QSqlDatabase db = database();
+    if (!db.transaction()) {
+        error = sqlError(db.lastError());
+        if (err) *err = error;
+        abortImport();
+        return false;
+    }
+    return true;
+}
+
+void SqlStore::abortImport()
+{
+    // отдельный запрос, а не exec: текст первой ошибки в error не затирается
+    insertQuery.reset();
+    stationQuery.reset();
+    QSqlDatabase db = database();
+    db.rollback();   // без открытой транзакции просто ничего не делает
+    QSqlQuery q(db);
+    q.exec(u"DROP TABLE IF EXISTS readings_import"_s);
+    q.exec(u"PRAGMA synchronous=NORMAL"_s);
+    q.exec(u"CREATE INDEX IF NOT EXISTS readings_station_day ON readings(station, day, rad)"_s);
+    importing = false;
+}
+
+bool SqlStore::prepareInserts(const QString &table, QString *err)
+{
+    insertQuery = std::make_unique<QSqlQuery>(database());
+    stationQuery = std::make_unique<QSqlQuery>(database());
+    if (!insertQuery->prepare(u"INSERT INTO "_s + table + u" (station, day, rad) VALUES (?, ?, ?)"_s)
+        || !stationQuery->prepare(u"INSERT OR IGNORE INTO stations (name, lat, lon) VALUES (?, ?, ?)"_s)) {
+        error = sqlError(insertQuery->lastError());
+        if (err) *err = error;
+        insertQuery.reset();
+        stationQuery.reset();
+        return false;
+    }
+    pendingRows = 0;
+    return true;
+}
+
+int SqlStore::addStation(const QString &name, const Coord *pos)
+{
+    const int regId = registry->intern(name);
+    if (pos) registry->setCoord(regId, *pos);
+    const auto known = registryToDb.constFind(regId);
+    if (known != registryToDb.cend()) return *known;
+    if (!stationQuery) return -1;
+
+    stationQuery->addBindValue(name);
+    stationQuery->addBindValue(pos ? QVariant(pos->lat) : QVariant());
+    stationQuery->addBindValue(pos ? QVariant(pos->lon) : QVariant());
+    if (!stationQuery->exec()) {
+        error = sqlError(stationQuery->lastError());
+        return -1;
+    }
+    QSqlQuery q(database());
+    q.prepare(u"SELECT id FROM stations WHERE name = ?"_s);
+    q.addBindValue(name);
+    if (!q.exec() || !q.next()) return -1;
+
+    const int dbId = q.value(0).toInt();
+    if (dbId >= dbToRegistry.size()) dbToRegistry.resize(dbId + 1, -1);
+    dbToRegistry[dbId] = regId;
+    registryToDb.insert(regId, dbId);
+    return dbId;
+}
+
+bool SqlStore::insertRaw(int dbStation, qint64 day, int rad)
+{
+    if (!insertQuery || dbStation < 0) return false;
+    insertQuery->bindValue(0, dbStation);
+    insertQuery->bindValue(1, day);
+    insertQuery->bindValue(2, rad);
+    if (!insertQuery->exec()) {
+        error = sqlError(insertQuery->lastError());
+        return false;
+    }
+    if (++pendingRows == kInsertBatch) {
+        QSqlDatabase db = database();
+        if (!db.commit() || !db.transaction()) {
+            error = sqlError(db.lastError());
+            return false;
+        }
+        pendingRows = 0;
+    }
+    return true;
+}
+
+bool SqlStore::insert(int station, qint64 day, int rad)
+{
+    auto it = registryToDb.constFind(station);
+    if (it != registryToDb.cend()) return insertRaw(*it, day, rad);
+
+    Coord pos{0.0, 0.0};
+    const bool has = registry->coord(station, &pos);
+    return insertRaw(addStation(registry->name(station), has ? &pos : nullptr), day, rad);
+}
+
+bool SqlStore::endImport(QString *err)
+{
+    TRACE_SCOPE("sqlite index");
+    insertQuery.reset();
+    stationQuery.reset();
+    // промежуточная таблица переносится в readings одной транзакцией вместе с индексом:
+    // база видна либо прежней, либо с полным импортом. Прочие индексы при замене пропадают
+    // вместе со старой таблицей и строятся заново по требованию (ensureIndex)
+    error.clear();
+    QSqlDatabase db = database();
+    bool ok = db.commit() && exec(u"PRAGMA synchronous=NORMAL"_s) && db.transaction();
+    if (ok && replacing)
+        ok = exec(u"DROP TABLE readings"_s) && exec(u"ALTER TABLE readings_import RENAME TO readings"_s);
+    else if (ok)
+        ok = exec(u"INSERT INTO readings (station, day, rad) SELECT station, day, rad FROM readings_import"
+                  " ORDER BY rowid"_s)
+             && exec(u"DROP TABLE readings_import"_s);
+    ok = ok && exec(u"CREATE INDEX IF NOT EXISTS readings_station_day ON readings(station, day, rad)"_s)
+         && db.commit();
+    if (!ok) {
+        if (error.isEmpty()) error = sqlError(db.lastError());   // сбой commit/transaction, не запроса
+        if (err) *err = error;
+        abortImport();
+        return false;
+    }
+    importing = false;
+    return exec(u"ANALYZE"_s, err);
+}
+
+bool SqlStore::importModel(const RadiationModel &records, bool replace, QString *err)
+{
+    return importReadings([&records](const std::function<void(const PackedReading &)> &sink) {
+        for (qsizetype row = 0; row < records.size(); ++row) sink(records.at(row));
+        return true;
+    }, replace, err);
+}
+
+bool SqlStore::importReadings(const ReadingSource &source, bool replace, QString *err)
+{
+    TRACE_SCOPE("sqlite import");
+    if (!beginImport(replace, err)) return false;
+    bool failed = false;
+    const bool read = source([&](const PackedReading &r) {
+        if (!failed && !insert(r.station, r.day, r.rad)) failed = true;   // остаток источника пропускается
+    });
+    if (failed || !read) {
+        if (err) *err = failed ? error : u"Не удалось прочитать исходные записи"_s;
+        abortImport();
+        return false;
+    }
+    return endImport(err);
+}
+
+bool SqlStore::append(int station, qint64 day, int rad, QString *err)
+{
+    if (!opened) {
+        if (err) *err = u"База не открыта"_s;
+        return false;
+    }
+    // без промежуточной таблицы и ANALYZE, как в импорте: одна строка дописывается в готовые индексы
+    QSqlDatabase db = database();
+    if (!db.transaction()) {
+        error = sqlError(db.lastError());
+        if (err) *err = error;
+        return false;
+    }
+    const bool inserted = prepareInserts(u"readings"_s, err) && insert(station, day, rad);
+    insertQuery.reset();
+    stationQuery.reset();
+    if (!inserted || !db.commit()) {
+        if (inserted) error = sqlError(db.lastError());
+        if (err) *err = error;
+        db.rollback();
+        return false;
+    }
+    return true;
+}
+
+// ============================
+// Запросы
+// ============================
+
+QString SqlStore::whereFor(const FilterExpression &expr) const
+{
+    return expr.toSql(registryToDb);
+}
+
+QString SqlStore::whereClause(const QVector<int> &stations, const QString &where, qint64 fromDay, qint64 toDay) const
+{
+    return whereSql(registryToDb, stations, where, fromDay, toDay);
+}
+
+QString SqlStore::windowSql(const QString &columns, Order order, int station, const QString &where, bool after) const
+{
+    QString afterCondition;
+    const QString orderSql = windowOrder(order, station, &afterCondition);
+    const QString clause = whereClause(station >= 0 ? QVector<int>{station} : QVector<int>(), where);
+    QString sql = u"SELECT "_s + columns + u" FROM readings"_s + clause;
+    if (after) sql += (clause.isEmpty() ? u" WHERE "_s : u" AND "_s) + afterCondition;
+    return sql + orderSql;
+}
+
+PackedReading SqlStore::readRow(const QSqlQuery &q) const
+{
+    return readingOf(q, dbToRegistry);
+}
+
+qint64 SqlStore::count(const QString &where) const
+{
+    QSqlQuery q(database());
+    if (!q.exec(u"SELECT COUNT(*) FROM readings"_s + whereClause({}, where)) || !q.next()) {
+        error = sqlError(q.lastError());
+        return 0;
+    }
+    return q.value(0).toLongLong();
+}
+
+ReadingStats SqlStore::stats(const QVector<int> &stations, const QString &where, qint64 fromDay, qint64 toDay) const
+{
+    TRACE_SCOPE("sqlite stats");
+    // те же суммы, что ReadingStats::add, но агрегатами SQLite по покрывающему индексу
+    const QString x = u"(day - %1)"_s.arg(ReadingStats::kDayOrigin);
+    QSqlQuery q(database());
+    q.setForwardOnly(true);
+    const QString sql = u"SELECT COUNT(*), TOTAL(rad), TOTAL(rad * rad), MIN(rad), MAX(rad), TOTAL(%1),"
+                        " TOTAL(%1 * %1), TOTAL(%1 * rad) FROM readings"_s.arg(x)
+                        + whereClause(stations, where, fromDay, toDay);
+    ReadingStats st;
+    if (!q.exec(sql) || !q.next()) {
+        error = sqlError(q.lastError());
+        return st;
+    }
+    st.count = q.value(0).toLongLong();
+    if (st.count == 0) return st;
+    st.sum = q.value(1).toDouble();
+    st.sumSq = q.value(2).toDouble();
+    st.min = q.value(3).toInt();
+    st.max = q.value(4).toInt();
+    st.sx = q.value(5).toDouble();
+    st.sxx = q.value(6).toDouble();
+    st.sxy = q.value(7).toDouble();
+    return st;
+}
+
+bool SqlStore::forEachReading(const QVector<int> &stations, const QString &where,
+                              const std::function<void(const PackedReading &)> &fn) const
+{
+    TRACE_SCOPE("sqlite scan");
+    QSqlQuery q(database());
+    q.setForwardOnly(true);
+    if (!q.exec(u"SELECT station, day, rad FROM readings"_s + whereClause(stations, where))) {
+        error = sqlError(q.lastError());
+        return false;
+    }
+    while (q.next()) fn(readRow(q));
+    return true;
+}
+
+bool SqlStore::scanAll(const std::function<void(const PackedReading &)> &fn) const
+{
+    TRACE_SCOPE("sqlite scan");
+    QSqlQuery q(database());
+    q.setForwardOnly(true);
+    if (!q.exec(u"SELECT station, day, rad FROM readings ORDER BY rowid"_s)) {
+        error = sqlError(q.lastError());
+        return false;
+    }
+    while (q.next()) fn(readRow(q));
+    return true;
+}
+
+bool SqlStore::forEachDay(const QVector<int> &stations, const QString &where,
+                          const std::function<void(int, qint64, double, qint64)> &fn) const
+{
+    TRACE_SCOPE("sqlite daily");
+    // группы идут в порядке покрывающего индекса (station, day, rad) — без сортировки
+    QSqlQuery q(database());
+    q.setForwardOnly(true);
+    if (!q.exec(u"SELECT station, day, TOTAL(rad), COUNT(*) FROM readings"_s + whereClause(stations, where)
+                + u" GROUP BY station, day"_s)) {
+        error = sqlError(q.lastError());
+        return false;
+    }
+    while (q.next()) {
+        const int regId = registryId(q.value(0).toInt());
+        if (regId >= 0) fn(regId, q.value(1).toLongLong(), q.value(2).toDouble(), q.value(3).toLongLong());
+    }
+    return true;
+}
+
+bool SqlStore::dayRange(const QString &where, qint64 *firstDay, qint64 *lastDay) const
+{
+    QSqlQuery q(database());
+    if (!q.exec(u"SELECT MIN(day), MAX(day) FROM readings"_s + whereClause({}, where)) || !q.next()) {
+        error = sqlError(q.lastError());
+        return false;
+    }
+    if (q.value(0).isNull()) return false;
+    *firstDay = q.value(0).toLongLong();
+    *lastDay = q.value(1).toLongLong();
+    return true;
+}
+
+QVector<StationSummary> SqlStore::summaries(const QString &where) const
+{
+    TRACE_SCOPE("sqlite summary");
+    QString above;
+    for (int k = 0; k < StationSummary::kThresholds; ++k)
+        above += u", SUM(rad > %1)"_s.arg(RadiationModel::kBandLimits[k]);
+
+    QVector<StationSummary> out;
+    QVector<int> dbIds;
+    {
+        QSqlQuery q(database());
+        q.setForwardOnly(true);
+        if (!q.exec(u"SELECT station, COUNT(*), TOTAL(rad), TOTAL(rad * rad), MIN(rad), MAX(rad), MAX(day)"_s + above
+                    + u" FROM readings"_s + whereClause({}, where) + u" GROUP BY station"_s)) {
+            error = sqlError(q.lastError());
+            return out;
+        }
+        while (q.next()) {
+            StationSummary s;
+            s.station = registryId(q.value(0).toInt());
+            if (s.station < 0) continue;
+            s.count = q.value(1).toLongLong();
+            s.sum = q.value(2).toDouble();
+            s.sumSq = q.value(3).toDouble();
+            s.min = q.value(4).toInt();
+            s.max = q.value(5).toInt();
+            s.lastDay = q.value(6).toLongLong();
+            for (int k = 0; k < StationSummary::kThresholds; ++k) s.above[k] = q.value(7 + k).toLongLong();
+            out.append(s);
+            dbIds.append(q.value(0).toInt());
+        }
+    }
+
+    // последнее показание — по индексу (station, day): последний день, среди равных — позже записанное
+    QSqlQuery last(database());
+    last.prepare(u"SELECT rad FROM readings WHERE station = ? AND day = ?"_s
+                 + (where.isEmpty() ? QString() : u" AND (%1)"_s.arg(where)) + u" ORDER BY rowid DESC LIMIT 1"_s);
+    for (qsizetype i = 0; i < out.size(); ++i) {
+        last.bindValue(0, dbIds[i]);
+        last.bindValue(1, out[i].lastDay);
+        if (last.exec() && last.next()) out[i].lastRad = last.value(0).toInt();
+    }
+    std::sort(out.begin(), out.end(), [](const StationSummary &a, const StationSummary &b) { return a.station < b.station; });
+    return out;
+}
+
+QVector<std::pair<int, qint64>> SqlStore::stationCounts(const QString &where) const
+{
+    QVector<std::pair<int, qint64>> out;
+    QSqlQuery q(database());
+    q.setForwardOnly(true);
+    if (!q.exec(u"SELECT station, COUNT(*) FROM readings"_s + whereClause({}, where) + u" GROUP BY station"_s)) {
+        error = sqlError(q.lastError());
+        return out;
+    }
+    while (q.next()) {
+        const int regId = registryId(q.value(0).toInt());
+        if (regId >= 0) out.append({regId, q.value(1).toLongLong()});
+    }
+    return out;
+}
+
+QVector<PackedReading> SqlStore::rows(Order order, int station, const QString &where, const RowKey *after,
+                                      int limit, RowKey *last) const
+{
+    QVector<PackedReading> out;
+    QSqlQuery q(database());
+    q.setForwardOnly(true);
+    q.prepare(windowSql(u"station, day, rad, rowid"_s, order, station, where, after) + u" LIMIT ?"_s);
+    if (after) bindAfter(q, order, station, *after);
+    q.addBindValue(limit);
+    if (!q.exec()) {
+        error = sqlError(q.lastError());
+        return out;
+    }
+    out.reserve(limit);
+    while (q.next()) {
+        out.append(readRow(q));
+        if (last) *last = RowKey{q.value(1).toLongLong(), q.value(2).toInt(), q.value(3).toLongLong()};
+    }
+    return out;
+}
+
+bool SqlStore::rowKey(Order order, int station, const QString &where, const RowKey *after, qint64 skip, RowKey *out) const
+{
+    TRACE_SCOPE("sqlite seek");
+    // перебираются только столбцы ключа по индексу, без чтения строк таблицы
+    QSqlQuery q(database());
+    q.setForwardOnly(true);
+    q.prepare(windowSql(u"day, rad, rowid"_s, order, station, where, after) + u" LIMIT 1 OFFSET ?"_s);
+    if (after) bindAfter(q, order, station, *after);
+    q.addBindValue(skip);
+    if (!q.exec() || !q.next()) {
+        error = q.lastError().type() != QSqlError::NoError ? sqlError(q.lastError()) : u"Строка вне выборки"_s;
+        return false;
+    }
+    *out = RowKey{q.value(0).toLongLong(), q.value(1).toInt(), q.value(2).toLongLong()};
+    return true;
+}
+
+bool SqlStore::ensureIndex(Order order, QString *err)
+{
+    switch (order) {
+    case Order::DayAsc:
+    case Order::DayDesc:
+        return exec(u"CREATE INDEX IF NOT EXISTS readings_day ON readings(day)"_s, err);
+    case Order::RadAsc:
+    case Order::RadDesc:
+        return exec(u"CREATE INDEX IF NOT EXISTS readings_rad ON readings(rad)"_s, err);
+    default:
+        return true;   // порядок вставки и блоки станций обходятся без дополнительных индексов
+    }
+}
+
+SqlReadingSource SqlStore::source(const QString &where) const
+{
+    SqlReadingSource src;
+    src.path = path;
+    src.where = where;
+    src.dbToRegistry = dbToRegistry;
+    src.registryToDb = registryToDb;
+    return src;
+}
+
+// ============================
+// SqlReadingSource
+// ============================
+
+bool SqlReadingSource::forEachReading(const QVector<int> &stations, const std::function<void(const PackedReading &)> &fn,
+                                      QString *error) const
+{
+    TRACE_SCOPE("sqlite scan");
+    const QString name = u"sqlsource-%1"_s.arg(connectionCounter.fetchAndAddRelaxed(1));
+    bool ok = false;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase(u"QSQLITE"_s, name);
+        db.setDatabaseName(path);
+        db.setConnectOptions(u"QSQLITE_OPEN_READONLY"_s);
+        if (!db.open()) {
+            if (error) *error = sqlError(db.lastError());
+        } else {
+            QSqlQuery q(db);
+            q.setForwardOnly(true);
+            ok = q.exec(u"SELECT station, day, rad FROM readings"_s
+                        + whereSql(registryToDb, stations, where, -ResultCache::kAllDays, ResultCache::kAllDays));
+            if (!ok && error) *error = sqlError(q.lastError());
+            while (ok && q.next()) fn(readingOf(q, dbToRegistry));
+        }
+    }
+    QSqlDatabase::removeDatabase(name);
+    return ok;
+}
+
+// ============================
+// SqlReadingWriter
+// ============================
+
+bool SqlReadingWriter::begin(const QVector<GeneratedStation> &stations, QString *error)
+{
+    if (!store->open(fileName, error) || !store->beginImport(true, error)) return false;
+    ids.clear();
+    ids.reserve(stations.size());
+    for (const GeneratedStation &st : stations) {
+        const int id = store->addStation(st.name, &st.pos);
+        if (id < 0) {
+            if (error) *error = store->lastError();
+            return false;
+        }
+        ids.append(id);
+    }
+    return true;
+}
+
+bool SqlReadingWriter::write(int station, qint64 day, int rad)
+{
+    return store->insertRaw(ids.value(station, -1), day, rad);
+}
+
+bool SqlReadingWriter::finish(QString *error)
+{
+    const bool ok = store->endImport(error);
+    store->close();
+    return ok;
+}
+
+// ============================
+// SqlRecordsModel
+// ============================
+
+SqlRecordsModel::SqlRecordsModel(SqlStore *store, StationRegistry *registry, QObject *parent)
+    : QAbstractTableModel(parent), store(store), registry(registry)
+{
+}
+
+void SqlRecordsModel::setQuery(const QString &where, SqlStore::Order order)
+{
+    TRACE_SCOPE("sqlite query");
+    beginResetModel();
+    pages.clear();
+    resume.clear();
+    condition = where;
+    sortOrder = order;
+    segments.clear();
+    segmentStart.clear();
+
+    if (order == SqlStore::Order::CityAsc || order == SqlStore::Order::CityDesc) {
+        // число строк станций одним GROUP BY, порядок блоков — по рангу имени в реестре
+        segments = store->stationCounts(where);
+        const StationRegistry *reg = registry;
+        const bool asc = order == SqlStore::Order::CityAsc;
+        std::sort(segments.begin(), segments.end(), [reg, asc](const auto &a, const auto &b) {
+            return asc ? reg->collationRank(a.first) < reg->collationRank(b.first)
+                       : reg->collationRank(a.first) > reg->collationRank(b.first);
+        });
+        total = 0;
+        segmentStart.reserve(segments.size());
+        for (const auto &seg : segments) {
+            segmentStart.append(total);
+            total += seg.second;
+        }
+    } else {
+        // вся выборка — один блок
+        total = store->count(where);
+        segments.append({-1, total});
+        segmentStart.append(0);
+    }
+    endResetModel();
+}
+
+int SqlRecordsModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(std::min<qint64>(total, std::numeric_limits<int>::max()));
+}
+
+int SqlRecordsModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : 3;
+}
+
+QVariant SqlRecordsModel::data(const QModelIndex &idx, int role) const
+{
+    if (!idx.isValid()) return QVariant();
+    const QVector<PackedReading> *pg = page(idx.row() / kPageRows);
+    const int i = idx.row() % kPageRows;
+    if (!pg || i >= pg->size()) return QVariant();
+    return RadiationModel::cellData(registry, pg->at(i), idx.column(), role);
+}
+
+QVariant SqlRecordsModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    return RadiationModel::headerText(section, orientation, role);
+}
+
+const QVector<PackedReading> *SqlRecordsModel::page(int p) const
+{
+    if (const QVector<PackedReading> *cached = pages.object(p)) return cached;
+
+    const qint64 from = qint64(p) * kPageRows;
+    if (from >= total) return nullptr;
+    auto *rows = new QVector<PackedReading>(fetch(from, int(std::min<qint64>(kPageRows, total - from))));
+    pages.insert(p, rows);   // вытесняет самую давнюю страницу
+    return pages.object(p);
+}
+
+QVector<PackedReading> SqlRecordsModel::fetch(qint64 from, int limit) const
+{
+    // окно может задеть несколько соседних блоков станций
+    QVector<PackedReading> out;
+    out.reserve(limit);
+    qsizetype s = std::upper_bound(segmentStart.cbegin(), segmentStart.cend(), from) - segmentStart.cbegin() - 1;
+    for (; s >= 0 && s < segments.size() && out.size() < limit; ++s) {
+        const qint64 start = std::max(from + out.size(), segmentStart[s]);
+        const qint64 end = segmentStart[s] + segments[s].second;
+        const int need = int(std::min<qint64>(limit - out.size(), end - start));
+        if (need <= 0) continue;
+
+        SqlStore::RowKey after, last;
+        const bool fromBlockStart = start == segmentStart[s];
+        if (!fromBlockStart && !keyBefore(s, start, &after)) break;
+        const QVector<PackedReading> part = store->rows(sortOrder, segments[s].first, condition,
+                                                        fromBlockStart ? nullptr : &after, need, &last);
+        if (part.isEmpty()) break;
+        out += part;
+        if (start + part.size() < end) resume.insert(start + part.size(), last);
+    }
+    return out;
+}
+
+bool SqlRecordsModel::keyBefore(qsizetype s, qint64 row, SqlStore::RowKey *out) const
+{
+    const auto known = resume.constFind(row);
+    if (known != resume.cend()) {
+        *out = *known;
+        return true;
+    }
+    // ближайшая закладка того же блока выше row: пропуск отсчитывается от неё, иначе от начала блока
+    const SqlStore::RowKey *base = nullptr;
+    qint64 baseRow = segmentStart[s];
+    auto it = resume.upperBound(row);
+    if (it != resume.begin() && (--it).key() > segmentStart[s]) {
+        base = &it.value();
+        baseRow = it.key();
+    }
+    if (!store->rowKey(sortOrder, segments[s].first, condition, base, row - 1 - baseRow, out)) return false;
+    resume.insert(row, *out);
+    return true;
+}
@@ -0,0 +1,242 @@
+#ifndef SQLSTORE_H
+#define SQLSTORE_H
+
+#include <QAbstractTableModel>
+#include <QCache>
+#include <QFileInfo>
+#include <QHash>
+#include <QMap>
+#include <QString>
+#include <QVector>
+#include <functional>
+#include <memory>
+#include "datagen.h"
+#include "groupby.h"
+#include "radiationmodel.h"
+#include "resultcache.h"
+
+class QSqlDatabase;
+class QSqlQuery;
+class StationRegistry;
+class FilterExpression;
+
+// ============================
+// Хранилище SQLite
+// ============================
+// Набор, который не помещается в память, лежит в файле SQLite:
+//
+//   stations(id, name, lat, lon)
+//   readings(station, day, rad)   индекс (station, day, rad) — покрывающий
+//
+// Фильтр (FilterExpression::toSql), сортировка и сводки уходят в SQL: выборка по
+// станциям и датам идёт по индексу, сводка считается агрегатами SQLite, в память
+// попадают только видимые строки таблицы и точки графика. Индексы по day и rad
+// для сортировки строятся при первой сортировке по этим столбцам.
+//
+// Окна таблицы читаются по ключу (WHERE (ключ, rowid) > (последний)), а не через
+// OFFSET: SQLite не перебирает пропущенные строки, прокрутка в конец набора стоит
+// столько же, сколько в начало.
+//
+// Id станций в базе свои; наружу (в PackedReading, в аргументах) — id реестра.
+class SqlReadingSource;
+
+class SqlStore
+{
+public:
+    static constexpr int kInsertBatch = 50000;   // строк на транзакцию при массовой вставке
+
+    enum class Order { Insertion, CityAsc, CityDesc, DayAsc, DayDesc, RadDesc, RadAsc };
+
+    // Положение строки в порядке окна: по нему следующее окно продолжается без OFFSET
+    struct RowKey {
+        qint64 day = 0;
+        int rad = 0;
+        qint64 rowid = 0;
+    };
+
+    static bool isDatabaseFile(const QString &fileName)
+    {
+        const QString suffix = QFileInfo(fileName).suffix().toLower();
+        return suffix == QLatin1StringView("sqlite") || suffix == QLatin1StringView("db");
+    }
+
+    explicit SqlStore(StationRegistry *registry);
+    ~SqlStore();
+
+    // Открывает или создаёт базу; станции базы регистрируются в реестре
+    bool open(const QString &fileName, QString *error);
+    void close();
+    bool isOpen() const { return opened; }
+    QString fileName() const { return path; }
+
+    // Массовая вставка: один подготовленный INSERT в промежуточную таблицу, коммит каждые
+    // kInsertBatch строк; endImport одной транзакцией переносит её в readings (replace —
+    // вместо прежних записей). Сбой на любом шаге или close() до endImport базу не меняют
+    bool beginImport(bool replace, QString *error);
+    int addStation(const QString &name, const Coord *pos = nullptr);   // id станции в базе
+    bool insert(int station, qint64 day, int rad);                      // station — id реестра
+    bool insertRaw(int dbStation, qint64 day, int rad);
+    bool endImport(QString *error);
+    // Весь набор модели (только радиация — показатели в базе не хранятся)
+    bool importModel(const RadiationModel &records, bool replace, QString *error);
+    // То же для потокового источника: source(sink) подаёт записи (station — id реестра)
+    // и возвращает false при ошибке чтения — тогда импорт откатывается
+    using ReadingSource = std::function<bool(const std::function<void(const PackedReading &)> &)>;
+    bool importReadings(const ReadingSource &source, bool replace, QString *error);
+    // Одна запись в своей транзакции — добавление из окна; индексы обновляются сразу
+    bool append(int station, qint64 day, int rad, QString *error);
+
+    // Условие WHERE для фильтра; пусто — без фильтра
+    QString whereFor(const FilterExpression &expr) const;
+
+    qint64 count(const QString &where = QString()) const;
+    // Сводка по станциям (пустой список — по всем) с учётом условия
+    ReadingStats stats(const QVector<int> &stations, const QString &where = QString(),
+                       qint64 fromDay = -ResultCache::kAllDays, qint64 toDay = ResultCache::kAllDays) const;
+    // Показания станций (пустой список — все) в порядке, удобном SQLite; station — id реестра
+    bool forEachReading(const QVector<int> &stations, const QString &where,
+                        const std::function<void(const PackedReading &)> &fn) const;
+    // Все показания в порядке вставки (rowid) — для сохранения в другой формат
+    bool scanAll(const std::function<void(const PackedReading &)> &fn) const;
+    // Суммы по станции и дню (GROUP BY по покрывающему индексу): fn(станция, день, сумма, число)
+    bool forEachDay(const QVector<int> &stations, const QString &where,
+                    const std::function<void(int, qint64, double, qint64)> &fn) const;
+    // Первый и последний день выборки; false — выборка пуста
+    bool dayRange(const QString &where, qint64 *firstDay, qint64 *lastDay) const;
+    // Сводки станций агрегатами SQLite, по возрастанию id реестра — как GroupBy::byStation
+    QVector<StationSummary> summaries(const QString &where) const;
+    // Число строк каждой станции (id реестра) с учётом условия
+    QVector<std::pair<int, qint64>> stationCounts(const QString &where) const;
+
+    // Окно строк в порядке order сразу после after (nullptr — с начала). station ≥ 0 —
+    // блок одной станции по дате (порядок по городу), order тогда не учитывается.
+    // last — ключ последней строки окна
+    QVector<PackedReading> rows(Order order, int station, const QString &where, const RowKey *after,
+                                int limit, RowKey *last) const;
+    // Ключ строки через skip строк после after (skip = 0 — первая строка после after);
+    // единственный запрос с OFFSET — для прыжка полосой прокрутки, от ближайшего известного ключа
+    bool rowKey(Order order, int station, const QString &where, const RowKey *after, qint64 skip, RowKey *out) const;
+    // Индекс под сортировку; false — ошибка SQLite
+    bool ensureIndex(Order order, QString *error);
+
+    // Срез для чтения из рабочего потока: своё соединение, условие where
+    SqlReadingSource source(const QString &where) const;
+
+    QString lastError() const { return error; }
+
+private:
+    // " WHERE ..." из списка станций, условия фильтра и диапазона дней; пусто — без условий
+    QString whereClause(const QVector<int> &stations, const QString &where,
+                        qint64 fromDay = -ResultCache::kAllDays, qint64 toDay = ResultCache::kAllDays) const;
+    // SELECT columns окна: условие, ключ после after (параметры — bindAfter) и порядок
+    QString windowSql(const QString &columns, Order order, int station, const QString &where, bool after) const;
+    QSqlDatabase database() const;
+    bool exec(const QString &sql, QString *err = nullptr);
+    bool prepareInserts(const QString &table, QString *err);
+    // Откат незавершённого импорта: промежуточная таблица удаляется, synchronous и индекс
+    // readings_station_day восстанавливаются
+    void abortImport();
+    PackedReading readRow(const QSqlQuery &q) const;
+    int registryId(int dbStation) const { return dbStation >= 0 && dbStation < dbToRegistry.size() ? dbToRegistry[dbStation] : -1; }
+
+    StationRegistry *registry;
+    QString connection;   // имя соединения QSqlDatabase
+    QString path;
+    bool opened = false;
+    mutable QString error;
+
+    QVector<int> dbToRegistry;     // id станции в базе → id реестра
+    QHash<int, int> registryToDb;
+
+    std::unique_ptr<QSqlQuery> insertQuery;
+    std::unique_ptr<QSqlQuery> stationQuery;
+    qint64 pendingRows = 0;        // вставлено в текущей транзакции
+    bool importing = false;        // между beginImport и endImport
+    bool replacing = false;        // импорт заменяет прежние записи
+};
+
+// ============================
+// Чтение базы из рабочего потока
+// ============================
+// Соединение QSqlDatabase нельзя передать в другой поток, поэтому срез хранит только
+// имя файла, условие и таблицу id станций, а каждый обход открывает своё соединение
+// только для чтения (WAL позволяет читать, пока окно пишет). Реестр не трогается.
+class SqlReadingSource
+{
+public:
+    QString fileName() const { return path; }
+    // fn(запись) по станциям stations (пусто — все); false — ошибка SQLite, текст в error
+    bool forEachReading(const QVector<int> &stations, const std::function<void(const PackedReading &)> &fn,
+                        QString *error = nullptr) const;
+
+private:
+    friend class SqlStore;
+
+    QString path;
+    QString where;
+    QVector<int> dbToRegistry;
+    QHash<int, int> registryToDb;
+};
+
+// Генератор пишет прямо в базу: большой набор не проходит через память
+class SqlReadingWriter : public ReadingWriter
+{
+public:
+    SqlReadingWriter(SqlStore *store, const QString &fileName) : store(store), fileName(fileName) {}
+
+    bool begin(const QVector<GeneratedStation> &stations, QString *error) override;
+    bool write(int station, qint64 day, int rad) override;
+    bool finish(QString *error) override;
+
+private:
+    SqlStore *store;
+    QString fileName;
+    QVector<int> ids;   // номер станции генератора → id в базе
+};
+
+// ============================
+// Таблица поверх базы
+// ============================
+// Как PagedJsonModel: строки читаются окнами по kPageRows при прокрутке, окна лежат
+// в LRU-кэше. Порядок по городу — блоки станций в порядке имён, внутри по дате:
+// окно каждой станции берётся по индексу (station, day), без сортировки всей таблицы.
+// Прочитанное окно оставляет закладку — ключ своей последней строки, поэтому следующее
+// окно начинается прямо с неё; прыжок прокруткой отсчитывается от ближайшей закладки.
+class SqlRecordsModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    static constexpr int kPageRows = 1024;
+    static constexpr int kMaxCachedPages = 64;
+
+    SqlRecordsModel(SqlStore *store, StationRegistry *registry, QObject *parent = nullptr);
+
+    // Новое условие и порядок: одна выборка COUNT (для города — GROUP BY station) и сброс модели
+    void setQuery(const QString &where, SqlStore::Order order);
+    QString where() const { return condition; }
+    SqlStore::Order order() const { return sortOrder; }
+    qint64 recordCount() const { return total; }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    const QVector<PackedReading> *page(int p) const;
+    QVector<PackedReading> fetch(qint64 from, int limit) const;
+    // Ключ строки row − 1 блока s (row — не первая строка блока); false — ошибка SQLite
+    bool keyBefore(qsizetype s, qint64 row, SqlStore::RowKey *out) const;
+
+    SqlStore *store;
+    StationRegistry *registry;
+    QString condition;
+    SqlStore::Order sortOrder = SqlStore::Order::Insertion;
+    qint64 total = 0;
+    QVector<std::pair<int, qint64>> segments;   // блоки: станция (−1 — вся выборка) и число строк
+    QVector<qint64> segmentStart;               // номер первой строки блока
+    mutable QCache<int, QVector<PackedReading>> pages{kMaxCachedPages};
+    mutable QMap<qint64, SqlStore::RowKey> resume;   // строка r → ключ строки r − 1 того же блока
+};
+
+#endif
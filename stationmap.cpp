@@ -0,0 +1,319 @@
+#include "stationmap.h"
+#include "tracing.h"
+#include <QPainter>
+#include <QPaintEvent>
+#include <QLinearGradient>
+#include <QRect>
+#include <QtConcurrent>
+#include <QtMath>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+using namespace Qt::StringLiterals;
+
+QColor radiationColor(double rad)
+{
+    struct Stop { double v; QColor c; };
+    static const Stop stops[] = {
+        {  0.0, QColor("#22c55e") },
+        { 15.0, QColor("#a3e635") },
+        { 30.0, QColor("#facc15") },
+        { 60.0, QColor("#f97316") },
+        {100.0, QColor("#dc2626") },
+    };
+    constexpr int n = int(sizeof(stops) / sizeof(stops[0]));
+
+    if (rad <= stops[0].v) return stops[0].c;
+    for (int i = 1; i < n; ++i) {
+        if (rad <= stops[i].v) {
+            const double t = (rad - stops[i-1].v) / (stops[i].v - stops[i-1].v);
+            const QColor &a = stops[i-1].c;
+            const QColor &b = stops[i].c;
+            return QColor(int(a.red()   + t * (b.red()   - a.red())),
+                          int(a.green() + t * (b.green() - a.green())),
+                          int(a.blue()  + t * (b.blue()  - a.blue())));
+        }
+    }
+    return stops[n-1].c;
+}
+
+// ============================
+// StationKdTree
+// ============================
+
+void StationKdTree::build(const QVector<QPointF> &points)
+{
+    pts = points;
+    nodes.clear();
+    nodes.reserve(pts.size());
+
+    QVector<int> idx(pts.size());
+    std::iota(idx.begin(), idx.end(), 0);
+    root = buildRec(idx.data(), int(idx.size()), 0);
+}
+
+int StationKdTree::buildRec(int *idx, int count, int depth)
+{
+    if (count <= 0) return -1;
+
+    const int axis = depth % 2;
+    const int mid = count / 2;
+    std::nth_element(idx, idx + mid, idx + count, [this, axis](int a, int b) {
+        return axis == 0 ? pts[a].x() < pts[b].x() : pts[a].y() < pts[b].y();
+    });
+
+    const int node = int(nodes.size());
+    nodes.append({idx[mid], -1, -1, axis});
+    const int left  = buildRec(idx, mid, depth + 1);
+    const int right = buildRec(idx + mid + 1, count - mid - 1, depth + 1);
+    nodes[node].left = left;
+    nodes[node].right = right;
+    return node;
+}
+
+void StationKdTree::nearest(const QPointF &q, int k, QVector<Neighbour> &out) const
+{
+    out.clear();
+    if (k <= 0) return;
+    searchRec(root, q, k, out);
+}
+
+void StationKdTree::searchRec(int n, const QPointF &q, int k, QVector<Neighbour> &best) const
+{
+    if (n < 0) return;
+
+    const Node &node = nodes[n];
+    const QPointF &p = pts[node.point];
+    const double dx = q.x() - p.x();
+    const double dy = q.y() - p.y();
+    const double d2 = dx * dx + dy * dy;
+
+    if (best.size() < k || d2 < best.last().dist2) {
+        auto it = std::upper_bound(best.begin(), best.end(), d2,
+                                   [](double v, const Neighbour &nb){ return v < nb.dist2; });
+        best.insert(it, Neighbour{node.point, d2});
+        if (best.size() > k) best.removeLast();
+    }
+
+    const double diff = node.axis == 0 ? dx : dy;
+    const int nearSide = diff < 0 ? node.left : node.right;
+    const int farSide  = diff < 0 ? node.right : node.left;
+
+    searchRec(nearSide, q, k, best);
+    // дальнюю ветку смотрим, только если гиперплоскость ближе текущего k-го соседа
+    if (best.size() < k || diff * diff < best.last().dist2)
+        searchRec(farSide, q, k, best);
+}
+
+// ============================
+// StationRangeIndex
+// ============================
+
+void StationRangeIndex::clear()
+{
+    series.clear();
+    minDay = 0;
+    maxDay = 0;
+}
+
+void StationRangeIndex::add(int station, qint64 day, double sum, qint64 count)
+{
+    if (series.isEmpty() || day < minDay) minDay = day;
+    if (series.isEmpty() || day > maxDay) maxDay = day;
+    series[station].raw.push_back({day, sum, count});
+}
+
+void StationRangeIndex::finalize()
+{
+    for (auto it = series.begin(); it != series.end(); ++it) {
+        Series &s = it.value();
+        std::sort(s.raw.begin(), s.raw.end(),
+                  [](const Entry &a, const Entry &b){ return a.day < b.day; });
+
+        // показания одного дня сливаются в одну точку
+        s.days.clear();
+        s.prefix = {0.0};
+        s.counts = {0};
+        for (const Entry &e : std::as_const(s.raw)) {
+            if (s.days.isEmpty() || s.days.last() != e.day) {
+                s.days.append(e.day);
+                s.prefix.append(s.prefix.last());
+                s.counts.append(s.counts.last());
+            }
+            s.prefix.last() += e.sum;
+            s.counts.last() += e.count;
+        }
+        s.raw.clear();
+        s.raw.squeeze();
+    }
+}
+
+bool StationRangeIndex::mean(int station, qint64 fromDay, qint64 toDay, double *out) const
+{
+    auto it = series.constFind(station);
+    if (it == series.constEnd()) return false;
+
+    const Series &s = it.value();
+    const auto lo = std::lower_bound(s.days.cbegin(), s.days.cend(), fromDay) - s.days.cbegin();
+    const auto hi = std::upper_bound(s.days.cbegin(), s.days.cend(), toDay) - s.days.cbegin();
+    if (hi <= lo) return false;
+
+    *out = (s.prefix[hi] - s.prefix[lo]) / double(s.counts[hi] - s.counts[lo]);
+    return true;
+}
+
+// ============================
+// IdwInterpolator
+// ============================
+
+HeatmapGrid IdwInterpolator::compute(const QVector<StationSample> &samples, const GeoBounds &bounds,
+                                     const QSize &size, double power)
+{
+    TRACE_SCOPE("idw");
+    HeatmapGrid grid;
+    grid.size = size;
+    grid.bounds = bounds;
+    grid.values.fill(std::nanf(""), size.width() * size.height());
+    grid.image = QImage(size, QImage::Format_ARGB32);
+    grid.image.fill(Qt::transparent);
+    if (samples.isEmpty() || size.isEmpty()) return grid;
+
+    const double refLat = (bounds.minLat + bounds.maxLat) / 2.0;
+    const double lonScale = std::cos(qDegreesToRadians(refLat));
+
+    QVector<QPointF> projected;
+    projected.reserve(samples.size());
+    for (const StationSample &s : samples)
+        projected.append(QPointF(s.pos.lon * lonScale, s.pos.lat));
+
+    StationKdTree tree;
+    tree.build(projected);
+
+    QVector<QRect> tiles;
+    for (int ty = 0; ty < size.height(); ty += kTileSize)
+        for (int tx = 0; tx < size.width(); tx += kTileSize)
+            tiles.append(QRect(tx, ty,
+                               std::min(kTileSize, size.width() - tx),
+                               std::min(kTileSize, size.height() - ty)));
+
+    // пишем в непересекающиеся участки буферов: bits() берём один раз до запуска потоков
+    uchar *bits = grid.image.bits();
+    const qsizetype bpl = grid.image.bytesPerLine();
+    float *values = grid.values.data();
+    const int k = std::min(kNeighbours, int(samples.size()));
+    const double halfPower = power / 2.0;
+    const double latSpan = bounds.maxLat - bounds.minLat;
+    const double lonSpan = bounds.maxLon - bounds.minLon;
+
+    QtConcurrent::blockingMap(tiles, [&](const QRect &tile) {
+        TRACE_SCOPE("idw tile");
+        QVector<StationKdTree::Neighbour> nb;
+        nb.reserve(k + 1);
+
+        for (int y = tile.top(); y <= tile.bottom(); ++y) {
+            const double lat = bounds.maxLat - (y + 0.5) / size.height() * latSpan;
+            QRgb *line = reinterpret_cast<QRgb*>(bits + y * bpl);
+
+            for (int x = tile.left(); x <= tile.right(); ++x) {
+                const double lon = bounds.minLon + (x + 0.5) / size.width() * lonSpan;
+                tree.nearest(QPointF(lon * lonScale, lat), k, nb);
+
+                double v = 0.0;
+                if (nb.first().dist2 < 1e-12) {
+                    v = samples[nb.first().index].value;
+                } else {
+                    double sw = 0.0, swv = 0.0;
+                    for (const auto &n : nb) {
+                        const double w = 1.0 / std::pow(n.dist2, halfPower);
+                        sw += w;
+                        swv += w * samples[n.index].value;
+                    }
+                    v = swv / sw;
+                }
+
+                values[y * size.width() + x] = float(v);
+                const QColor c = radiationColor(v);
+                line[x] = qRgba(c.red(), c.green(), c.blue(), 200);
+            }
+        }
+    });
+
+    return grid;
+}
+
+// ============================
+// HeatmapWidget
+// ============================
+
+HeatmapWidget::HeatmapWidget(QWidget *parent)
+    : QWidget(parent)
+{
+    setMinimumSize(600, 420);
+}
+
+void HeatmapWidget::setHeatmap(const HeatmapGrid &g, const QVector<StationSample> &s)
+{
+    grid = g;
+    stations = s;
+    update();
+}
+
+void HeatmapWidget::clear()
+{
+    grid = HeatmapGrid();
+    stations.clear();
+    update();
+}
+
+QPointF HeatmapWidget::project(const Coord &c, const QRectF &area) const
+{
+    const GeoBounds &b = grid.bounds;
+    const double x = (c.lon - b.minLon) / (b.maxLon - b.minLon);
+    const double y = (b.maxLat - c.lat) / (b.maxLat - b.minLat);
+    return QPointF(area.left() + x * area.width(), area.top() + y * area.height());
+}
+
+void HeatmapWidget::paintEvent(QPaintEvent *)
+{
+    QPainter p(this);
+    p.setRenderHint(QPainter::Antialiasing);
+    p.fillRect(rect(), QColor("#f8fafc"));
+
+    if (grid.image.isNull()) {
+        p.setPen(QColor("#64748b"));
+        p.drawText(rect(), Qt::AlignCenter, u"Нет данных для построения карты"_s);
+        return;
+    }
+
+    // сохраняем пропорции сетки
+    const QRectF bounds = QRectF(rect()).adjusted(12, 12, -12, -48);
+    QSizeF target = QSizeF(grid.size).scaled(bounds.size(), Qt::KeepAspectRatio);
+    const QRectF area(bounds.center() - QPointF(target.width() / 2, target.height() / 2), target);
+
+    p.setRenderHint(QPainter::SmoothPixmapTransform);
+    p.drawImage(area, grid.image);
+    p.setPen(QPen(QColor("#cbd5e1"), 1));
+    p.drawRect(area);
+
+    QFont f = p.font(); f.setPointSize(9); p.setFont(f);
+    for (const StationSample &s : stations) {
+        const QPointF pt = project(s.pos, area);
+        p.setPen(QPen(Qt::black, 1));
+        p.setBrush(radiationColor(s.value));
+        p.drawEllipse(pt, 5, 5);
+        p.setPen(QColor("#0f172a"));
+        p.drawText(pt + QPointF(7, -6), QString(u"%1 (%2)"_s).arg(s.name).arg(s.value, 0, 'f', 1));
+    }
+
+    // легенда
+    const QRectF legend(area.left(), area.bottom() + 14, std::min(300.0, area.width()), 12);
+    QLinearGradient lg(legend.topLeft(), legend.topRight());
+    for (int v = 0; v <= 100; v += 10) lg.setColorAt(v / 100.0, radiationColor(v));
+    p.setPen(Qt::NoPen);
+    p.setBrush(lg);
+    p.drawRect(legend);
+    p.setPen(QColor("#334155"));
+    p.drawText(legend.bottomLeft() + QPointF(0, 14), u"0"_s);
+    p.drawText(legend.bottomRight() + QPointF(-40, 14), u"100 мкР/ч"_s);
+}
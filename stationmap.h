@@ -0,0 +1,139 @@
+#ifndef STATIONMAP_H
+#define STATIONMAP_H
+
+#include <QWidget>
+#include <QVector>
+#include <QHash>
+#include <QString>
+#include <QImage>
+#include <QPointF>
+#include <QSize>
+#include <QColor>
+
+struct Coord { double lat; double lon; };
+
+// Границы области карты (градусы)
+struct GeoBounds {
+    double minLat = 0.0;
+    double maxLat = 0.0;
+    double minLon = 0.0;
+    double maxLon = 0.0;
+};
+
+// Станция с координатами и значением радиации за выбранный период
+struct StationSample {
+    QString name;
+    Coord pos;
+    double value;
+};
+
+// Цветовая шкала радиации, согласованная с цветами таблицы (≤15, ≤30, ≤60, >60 мкР/ч)
+QColor radiationColor(double rad);
+
+// ============================
+// k-d дерево по станциям
+// ============================
+// Точки задаются в локальной равнопромежуточной проекции (x = lon·cos(lat0), y = lat),
+// поэтому евклидово расстояние близко к реальному на масштабе региона.
+class StationKdTree
+{
+public:
+    struct Neighbour { int index; double dist2; };
+
+    void build(const QVector<QPointF> &points);
+    // k ближайших точек, отсортированных по расстоянию; out переиспользуется между вызовами
+    void nearest(const QPointF &q, int k, QVector<Neighbour> &out) const;
+    int size() const { return pts.size(); }
+
+private:
+    struct Node { int point; int left; int right; int axis; };
+
+    int buildRec(int *idx, int count, int depth);
+    void searchRec(int n, const QPointF &q, int k, QVector<Neighbour> &best) const;
+
+    QVector<QPointF> pts;
+    QVector<Node> nodes;
+    int root = -1;
+};
+
+// ============================
+// Индекс значений по станциям и дням
+// ============================
+// Ключ — id станции из StationRegistry. Суммы по дням + префиксные суммы показаний
+// и их числа: среднее за любой период за O(log n).
+class StationRangeIndex
+{
+public:
+    void clear();
+    void add(int station, qint64 day, int rad) { add(station, day, rad, 1); }
+    // Уже сложенные count показаний дня (например, GROUP BY в базе)
+    void add(int station, qint64 day, double sum, qint64 count);
+    void finalize();
+
+    bool isEmpty() const { return series.isEmpty(); }
+    bool mean(int station, qint64 fromDay, qint64 toDay, double *out) const;
+    QList<int> stations() const { return series.keys(); }
+    qint64 firstDay() const { return minDay; }
+    qint64 lastDay() const { return maxDay; }
+
+private:
+    struct Entry {
+        qint64 day;
+        double sum;
+        qint64 count;
+    };
+    struct Series {
+        QVector<Entry> raw;
+        QVector<qint64> days;     // различные дни по возрастанию
+        QVector<double> prefix;   // prefix[i] = сумма показаний первых i дней
+        QVector<qint64> counts;   // counts[i] = их число
+    };
+    QHash<int, Series> series;
+    qint64 minDay = 0;
+    qint64 maxDay = 0;
+};
+
+// ============================
+// Интерполяция IDW
+// ============================
+struct HeatmapGrid {
+    QSize size;
+    GeoBounds bounds;
+    QVector<float> values;   // построчно, size.width() * size.height()
+    QImage image;
+};
+
+class IdwInterpolator
+{
+public:
+    static constexpr int kNeighbours = 8;
+    static constexpr int kTileSize = 32;
+
+    // Сетка считается плитками kTileSize×kTileSize параллельно (QtConcurrent)
+    static HeatmapGrid compute(const QVector<StationSample> &samples, const GeoBounds &bounds,
+                               const QSize &size, double power = 2.0);
+};
+
+// ============================
+// Виджет тепловой карты
+// ============================
+class HeatmapWidget : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit HeatmapWidget(QWidget *parent = nullptr);
+
+    void setHeatmap(const HeatmapGrid &grid, const QVector<StationSample> &stations);
+    void clear();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    QPointF project(const Coord &c, const QRectF &area) const;
+
+    HeatmapGrid grid;
+    QVector<StationSample> stations;
+};
+
+#endif
@@ -0,0 +1,186 @@
+#include "stationregistry.h"
+#include <algorithm>
+#include <numeric>
+
+// ============================
+// StationRegistry
+// ============================
+
+StationRegistry::StationRegistry(QObject *parent)
+    : QObject(parent)
+{
+}
+
+int StationRegistry::intern(const QString &name)
+{
+    const auto it = ids.constFind(name);
+    if (it != ids.constEnd()) return it.value();
+
+    const int id = int(names.size());
+    names.append(name);
+    ids.insert(name, id);
+    coords.append(Coord{0.0, 0.0});
+    hasCoord.resize(int(names.size()));
+
+    if (updateDepth > 0) {
+        if (pendingFirst < 0) pendingFirst = id;
+    } else {
+        emit stationsAdded(id, id);
+    }
+    return id;
+}
+
+int StationRegistry::find(const QString &name) const
+{
+    return ids.value(name, -1);
+}
+
+void StationRegistry::setCoord(int id, const Coord &c)
+{
+    if (id < 0 || id >= names.size()) return;
+    coords[id] = c;
+    hasCoord.setBit(id);
+}
+
+bool StationRegistry::coord(int id, Coord *out) const
+{
+    if (id < 0 || id >= names.size() || !hasCoord.testBit(id)) return false;
+    *out = coords[id];
+    return true;
+}
+
+qsizetype StationRegistry::memoryUsage() const
+{
+    // оценка: символы имён (дважды — список и ключи хэша), координаты, ранги
+    qsizetype chars = 0;
+    for (const QString &n : names) chars += n.size();
+    return 2 * chars * qsizetype(sizeof(QChar))
+         + names.capacity() * qsizetype(sizeof(QString))
+         + ids.capacity() * qsizetype(sizeof(QString) + sizeof(int))
+         + coords.capacity() * qsizetype(sizeof(Coord))
+         + ranks.capacity() * qsizetype(sizeof(int));
+}
+
+int StationRegistry::collationRank(int id) const
+{
+    // реестр только растёт, поэтому устаревание определяется по размеру
+    if (ranks.size() != names.size()) {
+        QVector<int> order(names.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [this](int a, int b) {
+            return names[a].localeAwareCompare(names[b]) < 0;
+        });
+        ranks.resize(names.size());
+        for (int i = 0; i < order.size(); ++i) ranks[order[i]] = i;
+    }
+    return ranks.value(id, -1);
+}
+
+void StationRegistry::beginUpdate()
+{
+    ++updateDepth;
+}
+
+void StationRegistry::endUpdate()
+{
+    if (updateDepth == 0 || --updateDepth > 0) return;
+    if (pendingFirst >= 0) {
+        const int first = pendingFirst;
+        pendingFirst = -1;
+        emit stationsAdded(first, count() - 1);
+    }
+}
+
+// ============================
+// StationListModel
+// ============================
+
+StationListModel::StationListModel(StationRegistry *registry, bool checkable, QObject *parent)
+    : QAbstractListModel(parent), registry(registry), checkable(checkable)
+{
+    checked.resize(registry->count());
+    connect(registry, &StationRegistry::stationsAdded, this, &StationListModel::onStationsAdded);
+}
+
+int StationListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(checked.size());
+}
+
+QVariant StationListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= checked.size()) return QVariant();
+
+    switch (role) {
+    case Qt::DisplayRole:
+    case Qt::EditRole:
+        return registry->name(index.row());
+    case StationIdRole:
+        return index.row();
+    case Qt::CheckStateRole:
+        if (checkable) return checked.testBit(index.row()) ? Qt::Checked : Qt::Unchecked;
+        break;
+    default:
+        break;
+    }
+    return QVariant();
+}
+
+bool StationListModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (!checkable || role != Qt::CheckStateRole || !index.isValid()) return false;
+
+    const bool on = value.toInt() == Qt::Checked;
+    if (checked.testBit(index.row()) == on) return true;
+    checked.setBit(index.row(), on);
+    nChecked += on ? 1 : -1;
+    emit dataChanged(index, index, {Qt::CheckStateRole});
+    return true;
+}
+
+Qt::ItemFlags StationListModel::flags(const QModelIndex &index) const
+{
+    Qt::ItemFlags f = QAbstractListModel::flags(index);
+    if (checkable && index.isValid()) f |= Qt::ItemIsUserCheckable;
+    return f;
+}
+
+QVector<int> StationListModel::checkedIds() const
+{
+    QVector<int> out;
+    out.reserve(nChecked);
+    for (int i = 0; i < checked.size(); ++i)
+        if (checked.testBit(i)) out.append(i);
+    return out;
+}
+
+void StationListModel::setChecked(const QVector<int> &stationIds, bool on)
+{
+    if (!checkable || stationIds.isEmpty()) return;
+
+    int lo = int(checked.size()), hi = -1;
+    for (int id : stationIds) {
+        if (id < 0 || id >= checked.size() || checked.testBit(id) == on) continue;
+        checked.setBit(id, on);
+        nChecked += on ? 1 : -1;
+        lo = std::min(lo, id);
+        hi = std::max(hi, id);
+    }
+    if (hi >= lo)
+        emit dataChanged(index(lo), index(hi), {Qt::CheckStateRole});
+}
+
+void StationListModel::setAllChecked(bool on)
+{
+    if (!checkable || checked.isEmpty()) return;
+    checked.fill(on);
+    nChecked = on ? int(checked.size()) : 0;
+    emit dataChanged(index(0), index(int(checked.size()) - 1), {Qt::CheckStateRole});
+}
+
+void StationListModel::onStationsAdded(int first, int last)
+{
+    beginInsertRows(QModelIndex(), first, last);
+    checked.resize(last + 1);
+    endInsertRows();
+}
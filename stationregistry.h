@@ -0,0 +1,89 @@
+#ifndef STATIONREGISTRY_H
+#define STATIONREGISTRY_H
+
+#include <QObject>
+#include <QAbstractListModel>
+#include <QVector>
+#include <QHash>
+#include <QString>
+#include <QBitArray>
+#include "stationmap.h"
+
+// Роль с id станции — одна для списка станций и таблицы записей
+enum StationRoles { StationIdRole = Qt::UserRole + 1 };
+
+// ============================
+// Реестр станций
+// ============================
+// Имена интернируются в компактные id (0, 1, 2, ...) в порядке регистрации;
+// все сравнения в таблице, анализе и графиках идут по id, а не по тексту.
+class StationRegistry : public QObject
+{
+    Q_OBJECT
+public:
+    explicit StationRegistry(QObject *parent = nullptr);
+
+    int intern(const QString &name);        // id существующей или новой станции
+    int find(const QString &name) const;    // -1, если станция не зарегистрирована
+    QString name(int id) const { return names.value(id); }
+    int count() const { return int(names.size()); }
+
+    void setCoord(int id, const Coord &c);
+    bool coord(int id, Coord *out) const;
+
+    // Позиция станции при сортировке по имени (localeAwareCompare), считается лениво
+    int collationRank(int id) const;
+
+    // Приблизительный объём памяти под имена, координаты и индексы, байт
+    qsizetype memoryUsage() const;
+
+    // Пакетная регистрация: stationsAdded испускается один раз в endUpdate()
+    void beginUpdate();
+    void endUpdate();
+
+signals:
+    void stationsAdded(int first, int last);
+
+private:
+    QVector<QString> names;
+    QHash<QString, int> ids;
+    QVector<Coord> coords;
+    QBitArray hasCoord;
+    mutable QVector<int> ranks;
+
+    int updateDepth = 0;
+    int pendingFirst = -1;
+};
+
+// ============================
+// Модель списка станций
+// ============================
+// Строка модели == id станции, поэтому данные не копируются; для выпадающего списка
+// и списка наложения используются отдельные экземпляры (с галочками и без).
+class StationListModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    StationListModel(StationRegistry *registry, bool checkable, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+
+    QVector<int> checkedIds() const;
+    int checkedCount() const { return nChecked; }
+    // Массовая отметка — одно уведомление dataChanged вместо сигнала на каждую строку
+    void setChecked(const QVector<int> &stationIds, bool on);
+    void setAllChecked(bool on);
+
+private:
+    void onStationsAdded(int first, int last);
+
+    StationRegistry *registry;
+    bool checkable;
+    QBitArray checked;
+    int nChecked = 0;
+};
+
+#endif
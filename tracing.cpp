@@ -0,0 +1,210 @@
+#include "tracing.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QCoreApplication>
+#include <QHash>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+using namespace Qt::StringLiterals;
+
+namespace Trace {
+
+namespace {
+
+constexpr int kCapacity = 16384;   // событий на поток; старые перезаписываются
+
+// Буфер принадлежит одному живому потоку; после выхода потока он возвращается в
+// список свободных и достаётся следующему. Потоки пула QThreadPool истекают и
+// создаются заново, а буферов остаётся не больше, чем потоков жило одновременно.
+struct ThreadBuffer {
+    int tid = 0;
+    QString threadName;
+    std::unique_ptr<Event[]> events{new Event[kCapacity]};
+    std::atomic<quint64> head{0};      // пишет только поток-владелец
+    std::atomic<quint64> cleared{0};   // события до этого номера стёрты clear()
+};
+
+QMutex registryMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+std::vector<ThreadBuffer *> freeBuffers;
+
+// При выходе потока буфер освобождается; события в нём остаются до перезаписи
+struct LocalBuffer {
+    ThreadBuffer *buf = nullptr;
+    ~LocalBuffer()
+    {
+        if (!buf) return;
+        QMutexLocker lock(&registryMutex);
+        freeBuffers.push_back(buf);
+    }
+};
+thread_local LocalBuffer localBuffer;
+
+std::function<void(const OperationSummary &)> operationListener;
+OperationSummary lastSummary;
+
+const auto epoch = std::chrono::steady_clock::now();
+
+ThreadBuffer *threadBuffer()
+{
+    if (localBuffer.buf) return localBuffer.buf;
+
+    QThread *t = QThread::currentThread();
+    QString threadName = t->objectName();
+    if (threadName.isEmpty())
+        threadName = (QCoreApplication::instance() && t == QCoreApplication::instance()->thread())
+                         ? u"GUI"_s : u"worker"_s;
+
+    QMutexLocker lock(&registryMutex);
+    ThreadBuffer *buf = nullptr;
+    if (!freeBuffers.empty()) {
+        buf = freeBuffers.back();
+        freeBuffers.pop_back();
+    } else {
+        buffers.push_back(std::make_unique<ThreadBuffer>());
+        buf = buffers.back().get();
+        buf->tid = int(buffers.size());
+    }
+    buf->threadName = threadName;
+    localBuffer.buf = buf;
+    return buf;
+}
+
+// Снимок событий всех потоков. Запись идёт без блокировок, поэтому самое старое
+// событие буфера может оказаться перезаписанным во время чтения — для диагностики это допустимо.
+template <typename Fn>
+void forEachEvent(Fn fn)
+{
+    QMutexLocker lock(&registryMutex);
+    for (const auto &buf : buffers) {
+        const quint64 head = buf->head.load(std::memory_order_acquire);
+        const quint64 oldest = head > quint64(kCapacity) ? head - kCapacity : 0;
+        const quint64 first = std::max(oldest, buf->cleared.load(std::memory_order_relaxed));
+        for (quint64 i = first; i < head; ++i)
+            fn(*buf, buf->events[i % kCapacity]);
+    }
+}
+
+} // namespace
+
+void setEnabled(bool on)
+{
+    enabledFlag.store(on, std::memory_order_relaxed);
+}
+
+qint64 nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - epoch).count();
+}
+
+void record(const char *name, qint64 startUs, qint64 durUs)
+{
+    ThreadBuffer *buf = threadBuffer();
+    const quint64 head = buf->head.load(std::memory_order_relaxed);
+    buf->events[head % kCapacity] = Event{name, startUs, durUs};
+    buf->head.store(head + 1, std::memory_order_release);
+}
+
+void clear()
+{
+    // head принадлежит пишущему потоку: clear только сдвигает границу чтения,
+    // событие, записанное одновременно с очисткой, либо стирается, либо остаётся целым
+    QMutexLocker lock(&registryMutex);
+    for (const auto &buf : buffers) buf->cleared.store(buf->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+}
+
+void setOperationListener(std::function<void(const OperationSummary &)> listener)
+{
+    operationListener = std::move(listener);
+}
+
+OperationSummary lastOperation()
+{
+    return lastSummary;
+}
+
+bool exportChromeJson(const QString &fileName, QString *error)
+{
+    QJsonArray events;
+    QHash<int, QString> threads;
+
+    forEachEvent([&](const ThreadBuffer &buf, const Event &e) {
+        threads.insert(buf.tid, buf.threadName);
+        QJsonObject obj;
+        obj["name"_L1] = QString::fromUtf8(e.name);
+        obj["cat"_L1] = u"app"_s;
+        obj["ph"_L1] = u"X"_s;
+        obj["ts"_L1] = double(e.startUs);
+        obj["dur"_L1] = double(e.durUs);
+        obj["pid"_L1] = 1;
+        obj["tid"_L1] = buf.tid;
+        events.append(obj);
+    });
+
+    for (auto it = threads.cbegin(); it != threads.cend(); ++it) {
+        QJsonObject meta;
+        meta["name"_L1] = u"thread_name"_s;
+        meta["ph"_L1] = u"M"_s;
+        meta["pid"_L1] = 1;
+        meta["tid"_L1] = it.key();
+        meta["args"_L1] = QJsonObject{{"name"_L1, it.value()}};
+        events.append(meta);
+    }
+
+    QJsonObject root;
+    root["traceEvents"_L1] = events;
+    root["displayTimeUnit"_L1] = u"ms"_s;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return true;
+}
+
+Operation::Operation(const char *name)
+    : name(name), start(isEnabled() ? nowUs() : -1)
+{
+}
+
+void Operation::finish()
+{
+    if (start < 0) return;
+    const qint64 end = nowUs();
+    record(name, start, end - start);
+
+    OperationSummary summary;
+    summary.name = QString::fromUtf8(name);
+    summary.totalUs = end - start;
+
+    // вложенные участки всех потоков, целиком попавшие в интервал операции
+    QHash<QString, qint64> byName;
+    QVector<QString> order;
+    forEachEvent([&](const ThreadBuffer &, const Event &e) {
+        if (e.startUs < start || e.startUs + e.durUs > end) return;
+        if (e.name == name && e.startUs == start) return;
+        const QString key = QString::fromUtf8(e.name);
+        if (!byName.contains(key)) order.append(key);
+        byName[key] += e.durUs;
+    });
+    for (const QString &key : order) summary.parts.append({key, byName.value(key)});
+    std::sort(summary.parts.begin(), summary.parts.end(),
+              [](const auto &a, const auto &b){ return a.second > b.second; });
+
+    start = -1;
+    lastSummary = summary;
+    if (operationListener) operationListener(summary);
+}
+
+} // namespace Trace
@@ -0,0 +1,95 @@
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <QString>
+#include <QVector>
+#include <QPair>
+#include <atomic>
+#include <functional>
+
+// ============================
+// Трассировка горячих участков
+// ============================
+// TRACE_SCOPE("имя") замеряет время блока и пишет событие в кольцевой буфер
+// своего потока (без блокировок). Когда трассировка выключена, стоимость — одна
+// relaxed-загрузка флага. Имена должны быть строковыми литералами: хранится указатель.
+// По умолчанию выключена: включается в меню «Диагностика».
+namespace Trace {
+
+struct Event {
+    const char *name;
+    qint64 startUs;
+    qint64 durUs;
+};
+
+// Разбивка последней операции верхнего уровня (загрузка, сортировка, график...)
+struct OperationSummary {
+    QString name;
+    qint64 totalUs = 0;
+    QVector<QPair<QString, qint64>> parts;   // суммарное время по именам вложенных участков
+};
+
+inline std::atomic<bool> enabledFlag{false};
+
+inline bool isEnabled() { return enabledFlag.load(std::memory_order_relaxed); }
+void setEnabled(bool on);
+
+qint64 nowUs();
+void record(const char *name, qint64 startUs, qint64 durUs);
+void clear();
+
+// Вызывается в GUI-потоке по завершении каждой операции верхнего уровня
+void setOperationListener(std::function<void(const OperationSummary &)> listener);
+OperationSummary lastOperation();
+
+// Формат Chrome trace event (открывается в chrome://tracing и ui.perfetto.dev)
+bool exportChromeJson(const QString &fileName, QString *error = nullptr);
+
+class Scope
+{
+public:
+    explicit Scope(const char *name)
+        : name(name), start(isEnabled() ? nowUs() : -1) {}
+    ~Scope() { finish(); }
+
+    void finish()
+    {
+        if (start < 0) return;
+        record(name, start, nowUs() - start);
+        start = -1;
+    }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+private:
+    const char *name;
+    qint64 start;
+};
+
+// Операция верхнего уровня: по завершении собирает разбивку по вложенным участкам
+class Operation
+{
+public:
+    explicit Operation(const char *name);
+    ~Operation() { finish(); }
+
+    // Досрочное завершение (например, перед модальным сообщением); повторные вызовы игнорируются
+    void finish();
+
+    Operation(const Operation &) = delete;
+    Operation &operator=(const Operation &) = delete;
+
+private:
+    const char *name;
+    qint64 start;
+};
+
+} // namespace Trace
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) Trace::Scope TRACE_CONCAT(traceScope_, __LINE__)(name)
+#define TRACE_OPERATION(name) Trace::Operation TRACE_CONCAT(traceOperation_, __LINE__)(name)
+
+#endif